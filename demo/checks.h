@@ -0,0 +1,1057 @@
+// This file contains self checks for the numerical components used by the demo. Each
+// check compares an accelerated or cached component against a brute force reference,
+// either on the scene geometry or on small synthetic inputs, and reports the largest
+// discrepancy it finds. The checks are run with "solverType": "check".
+
+#pragma once
+
+#include <filesystem>
+#include <zombie/zombie.h>
+#include "config.h"
+#include "scene.h"
+
+bool reportCheck(const std::string& name, bool passed, double maxError)
+{
+    std::cout << (passed ? "passed: " : "FAILED: ") << name
+              << " (max error: " << maxError << ")" << std::endl;
+
+    return passed;
+}
+
+Vector2 sampleBoundingBox(const std::pair<Vector2, Vector2>& bbox, pcg32& sampler)
+{
+    Vector2 u(sampler.nextFloat(), sampler.nextFloat());
+    return bbox.first + u.cwiseProduct(bbox.second - bbox.first);
+}
+
+bool checkBoundaryCaches(const Scene& scene, int nQueries)
+{
+    // save the partitioned boundary mesh to a cache file and load it back; a cache written
+    // for a different content hash must be rejected
+    std::string cacheFile = (std::filesystem::temp_directory_path() / "zombie_check.cache").string();
+    uint64_t contentHash = zombie::computeBoundaryMeshHash<2>(scene.vertices, scene.segments);
+    std::vector<Vector2> absorbingBoundaryVertices, reflectingBoundaryVertices;
+    std::vector<std::vector<size_t>> absorbingBoundarySegments, reflectingBoundarySegments;
+    bool passed = zombie::saveBoundaryMeshCache<2>(cacheFile, contentHash,
+                                                   scene.absorbingBoundaryVertices,
+                                                   scene.absorbingBoundarySegments,
+                                                   scene.reflectingBoundaryVertices,
+                                                   scene.reflectingBoundarySegments) &&
+                  zombie::loadBoundaryMeshCache<2>(cacheFile, contentHash,
+                                                   absorbingBoundaryVertices, absorbingBoundarySegments,
+                                                   reflectingBoundaryVertices, reflectingBoundarySegments) &&
+                  absorbingBoundaryVertices == scene.absorbingBoundaryVertices &&
+                  absorbingBoundarySegments == scene.absorbingBoundarySegments &&
+                  reflectingBoundaryVertices == scene.reflectingBoundaryVertices &&
+                  reflectingBoundarySegments == scene.reflectingBoundarySegments &&
+                  !zombie::loadBoundaryMeshCache<2>(cacheFile, contentHash + 1,
+                                                    absorbingBoundaryVertices, absorbingBoundarySegments,
+                                                    reflectingBoundaryVertices, reflectingBoundarySegments);
+
+    // save an acceleration structure and compare distances against one restored from the cache
+    zombie::FcpwBoundaryHandler<2, false> builtHandler, loadedHandler;
+    builtHandler.buildAccelerationStructure(scene.vertices, scene.segments);
+    passed = passed && builtHandler.saveAccelerationStructure(cacheFile, contentHash) &&
+             loadedHandler.loadAccelerationStructure(cacheFile, contentHash);
+
+    double maxError = 0.0;
+    if (passed) {
+        zombie::GeometricQueries<2> builtQueries(false), loadedQueries(false);
+        zombie::populateGeometricQueries<2>(builtHandler, scene.bbox, builtQueries);
+        zombie::populateGeometricQueries<2>(loadedHandler, scene.bbox, loadedQueries);
+
+        pcg32 sampler;
+        for (int i = 0; i < nQueries; i++) {
+            Vector2 x = sampleBoundingBox(scene.bbox, sampler);
+            float d1 = builtQueries.computeDistToAbsorbingBoundary(x, true);
+            float d2 = loadedQueries.computeDistToAbsorbingBoundary(x, true);
+            maxError = std::max(maxError, (double)std::fabs(d1 - d2));
+        }
+    }
+
+    std::filesystem::remove(cacheFile);
+    return reportCheck("boundary mesh and acceleration structure caches", passed && maxError == 0.0, maxError);
+}
+
+bool checkVectorizedRobinBvh(const Scene& scene, int nQueries)
+{
+    // compare Robin star radii computed with the vectorized BVH, using the packet width
+    // selected for this host, against brute force star radii
+    std::vector<float> robinCoeffValues(scene.reflectingBoundarySegments.size(), 1.0f);
+    zombie::FcpwBoundaryHandler<2, false> absorbingBoundaryHandler;
+    zombie::FcpwBoundaryHandler<2, true> bruteForceHandler, vectorizedHandler;
+    absorbingBoundaryHandler.buildAccelerationStructure(scene.absorbingBoundaryVertices,
+                                                        scene.absorbingBoundarySegments);
+    bruteForceHandler.buildAccelerationStructure(scene.reflectingBoundaryVertices, scene.reflectingBoundarySegments,
+                                                 {}, false, robinCoeffValues, robinCoeffValues, false);
+    vectorizedHandler.buildAccelerationStructure(scene.reflectingBoundaryVertices, scene.reflectingBoundarySegments,
+                                                 {}, false, robinCoeffValues, robinCoeffValues, true, true);
+
+    zombie::HarmonicGreensFnFreeSpace<3> harmonicGreensFn;
+    std::function<float(float)> branchTraversalWeight = [&harmonicGreensFn](float r2) -> float {
+        float r = std::max(std::sqrt(r2), 1e-2f);
+        return std::fabs(harmonicGreensFn.evaluate(r));
+    };
+    zombie::GeometricQueries<2> bruteForceQueries(false), vectorizedQueries(false);
+    zombie::populateGeometricQueries<2, true>(absorbingBoundaryHandler, bruteForceHandler,
+                                              branchTraversalWeight, scene.bbox, bruteForceQueries);
+    zombie::populateGeometricQueries<2, true>(absorbingBoundaryHandler, vectorizedHandler,
+                                              branchTraversalWeight, scene.bbox, vectorizedQueries);
+
+    double maxError = 0.0;
+    float maxRadius = (scene.bbox.second - scene.bbox.first).norm();
+    pcg32 sampler;
+    for (int i = 0; i < nQueries; i++) {
+        Vector2 x = sampleBoundingBox(scene.bbox, sampler);
+        float r1 = bruteForceQueries.computeStarRadiusForReflectingBoundary(x, 1e-3f, maxRadius, 1e-3f, false);
+        float r2 = vectorizedQueries.computeStarRadiusForReflectingBoundary(x, 1e-3f, maxRadius, 1e-3f, false);
+        maxError = std::max(maxError, (double)std::fabs(r1 - r2)/std::max(r1, 1e-3f));
+    }
+
+    std::string name = "Robin star radii with packet width " + std::to_string(zombie::selectPacketWidth());
+    return reportCheck(name, maxError < 1e-4, maxError);
+}
+
+bool checkImplicitBoundaries(int nQueries)
+{
+    // setup a CSG domain whose absorbing box boundary is trimmed by a reflecting disk
+    zombie::ImplicitBoundaryHandler<2> absorbingBoundaryHandler, reflectingBoundaryHandler;
+    absorbingBoundaryHandler.addBox(Vector2(0.0f, 0.0f), Vector2(1.0f, 1.0f));
+    reflectingBoundaryHandler.addSphere(Vector2(0.0f, 0.0f), 1.2f);
+    std::pair<Vector2, Vector2> bbox(Vector2(-1.5f, -1.5f), Vector2(1.5f, 1.5f));
+    zombie::GeometricQueries<2> queries(true);
+    zombie::populateGeometricQueries<2>(absorbingBoundaryHandler, reflectingBoundaryHandler,
+                                        true, bbox, queries);
+
+    // sample the trimmed absorbing boundary densely for brute force distances
+    pcg32 sampler;
+    std::vector<Vector2> boundaryPts;
+    for (int i = 0; i < 16*nQueries; i++) {
+        float u[2] = {sampler.nextFloat(), sampler.nextFloat()};
+        Vector2 pt, normal;
+        if (absorbingBoundaryHandler.sampleBoundary(u, pt, normal) &&
+            reflectingBoundaryHandler.containsPoint(pt)) {
+            boundaryPts.emplace_back(pt);
+        }
+    }
+
+    // compare distances to the trimmed absorbing boundary against brute force distances, and
+    // check that the parity of ray intersections with the trimmed boundaries matches insideDomain
+    double maxError = 0.0;
+    int nParityMismatches = 0;
+    for (int i = 0; i < nQueries; i++) {
+        Vector2 x = sampleBoundingBox(bbox, sampler);
+        bool insideDomain = queries.insideDomain(x, false);
+        float angle = 2.0f*M_PI*sampler.nextFloat();
+        Vector2 dir(std::cos(angle), std::sin(angle));
+        int nHits = queries.countBoundaryIntersections(x, dir, std::numeric_limits<float>::max());
+        if ((nHits%2 == 1) != insideDomain) nParityMismatches++;
+
+        if (insideDomain) {
+            float d = queries.computeDistToAbsorbingBoundary(x, false);
+            float dBruteForce = std::numeric_limits<float>::max();
+            for (const Vector2& pt: boundaryPts) dBruteForce = std::min(dBruteForce, (pt - x).norm());
+            maxError = std::max(maxError, (double)std::fabs(d - dBruteForce));
+        }
+    }
+
+    return reportCheck("trimmed implicit boundary distances (" + std::to_string(nParityMismatches) +
+                       " parity mismatches)", nParityMismatches == 0 && maxError < 1e-2, maxError);
+}
+
+bool checkWindingNumbers(const Scene& scene, int nQueries)
+{
+    // compare winding numbers computed with the dipole tree against exact winding numbers
+    // summed over all boundary segments, away from the boundary where both are smooth
+    zombie::WindingNumberTree<2> windingNumberTree;
+    windingNumberTree.addMesh(scene.vertices, scene.segments);
+    windingNumberTree.build();
+
+    double maxError = 0.0;
+    int nMisclassified = 0;
+    pcg32 sampler;
+    for (int i = 0; i < nQueries; i++) {
+        Vector2 x = sampleBoundingBox(scene.bbox, sampler);
+        if (scene.queries.computeDistToBoundary(x, false) < 1e-2f) continue;
+
+        float exactWindingNumber = 0.0f;
+        for (const std::vector<size_t>& segment: scene.segments) {
+            Vector2 v[2] = {scene.vertices[segment[0]], scene.vertices[segment[1]]};
+            exactWindingNumber += zombie::computeElementWindingNumber<2>(v, x);
+        }
+
+        float windingNumber = windingNumberTree.computeWindingNumber(x);
+        maxError = std::max(maxError, (double)std::fabs(windingNumber - exactWindingNumber));
+        if ((windingNumber > 0.5f) != (exactWindingNumber > 0.5f)) nMisclassified++;
+    }
+
+    return reportCheck("winding number tree (" + std::to_string(nMisclassified) + " misclassified points)",
+                       nMisclassified == 0 && maxError < 0.25, maxError);
+}
+
+void createSyntheticSplatData(int nSamples, int nEvalPts, pcg32& sampler,
+                              std::vector<zombie::SamplePoint<float, 2>>& samplePts,
+                              zombie::bvc::EvaluationPoints<float, 2>& evalPts)
+{
+    // place absorbing and reflecting boundary sample pts on the unit circle and domain
+    // sample pts inside it, with random boundary data
+    for (int i = 0; i < nSamples; i++) {
+        float angle = 2.0f*M_PI*sampler.nextFloat();
+        Vector2 pt(std::cos(angle), std::sin(angle));
+        zombie::SampleType type = i%3 == 0 ? zombie::SampleType::OnAbsorbingBoundary :
+                                  i%3 == 1 ? zombie::SampleType::OnReflectingBoundary :
+                                             zombie::SampleType::InDomain;
+        Vector2 normal = pt;
+        if (type == zombie::SampleType::InDomain) pt *= 0.9f*sampler.nextFloat();
+
+        zombie::SamplePoint<float, 2> samplePt(pt, normal, type, 1.0f/(2.0f*M_PI), 1.0f, 1.0f);
+        samplePt.estimateBoundaryNormalAligned = i%5 == 0;
+        samplePt.solution = 2.0f*sampler.nextFloat() - 1.0f;
+        samplePt.normalDerivative = 2.0f*sampler.nextFloat() - 1.0f;
+        samplePt.robin = 2.0f*sampler.nextFloat() - 1.0f;
+        samplePt.source = 2.0f*sampler.nextFloat() - 1.0f;
+        samplePt.robinCoeff = type == zombie::SampleType::OnReflectingBoundary ? 4.0f*sampler.nextFloat() : 0.0f;
+        samplePts.emplace_back(samplePt);
+    }
+
+    // place evaluation pts well inside the unit circle
+    for (int i = 0; i < nEvalPts; i++) {
+        Vector2 pt = 0.8f*Vector2(2.0f*sampler.nextFloat() - 1.0f, 2.0f*sampler.nextFloat() - 1.0f)/std::sqrt(2.0f);
+        evalPts.add(pt, Vector2::Zero(), zombie::SampleType::InDomain, 1.0f, 1.0f);
+    }
+}
+
+double computeRelativeError(const std::vector<float>& estimates, const std::vector<float>& references)
+{
+    double squaredError = 0.0, squaredNorm = 0.0;
+    for (size_t i = 0; i < estimates.size(); i++) {
+        squaredError += (estimates[i] - references[i])*(estimates[i] - references[i]);
+        squaredNorm += references[i]*references[i];
+    }
+
+    return std::sqrt(squaredError/std::max(squaredNorm, 1e-12));
+}
+
+void getSplatEstimates(const zombie::bvc::EvaluationPoints<float, 2>& evalPts, std::vector<float>& estimates)
+{
+    // gather the estimated solution and gradient at each evaluation pt
+    estimates.clear();
+    std::vector<float> gradient;
+    for (int i = 0; i < evalPts.size(); i++) {
+        estimates.emplace_back(evalPts.getEstimatedSolution(i));
+        evalPts.getEstimatedGradient(i, gradient);
+        estimates.insert(estimates.end(), gradient.begin(), gradient.end());
+    }
+}
+
+bool checkSplatKernels(int nSamples)
+{
+    // compare the tiled splat kernel against splatting sample pts one at a time to each
+    // evaluation pt, for the harmonic and Yukawa Green's functions
+    pcg32 sampler;
+    std::vector<zombie::SamplePoint<float, 2>> samplePts;
+    zombie::bvc::EvaluationPoints<float, 2> evalPts;
+    createSyntheticSplatData(nSamples, 256, sampler, samplePts, evalPts);
+
+    zombie::GeometricQueries<2> queries(true);
+    zombie::WalkOnStars<float, 2> walkOnStars(queries);
+    zombie::bvc::BoundaryValueCaching<float, 2> boundaryValueCaching(queries, walkOnStars);
+
+    double maxError = 0.0;
+    for (float absorptionCoeff: {0.0f, 2.0f}) {
+        zombie::PDE<float, 2> pde;
+        pde.absorptionCoeff = absorptionCoeff;
+        evalPts.reset();
+        boundaryValueCaching.splat(pde, samplePts, 1e-3f, 0.0f, 2.0f, 0.0f, 0.0f, evalPts);
+
+        std::vector<float> estimates, references, gradient;
+        getSplatEstimates(evalPts, estimates);
+        for (int i = 0; i < evalPts.size(); i++) {
+            zombie::bvc::EvaluationPoint<float, 2> evalPt(evalPts.pt[i], Vector2::Zero(),
+                                                          zombie::SampleType::InDomain, 1.0f, 1.0f);
+            for (const zombie::SamplePoint<float, 2>& samplePt: samplePts) {
+                boundaryValueCaching.splat(pde, samplePt, 1e-3f, 0.0f, 2.0f, 0.0f, 0.0f, evalPt);
+            }
+
+            references.emplace_back(evalPt.getEstimatedSolution());
+            evalPt.getEstimatedGradient(gradient);
+            references.insert(references.end(), gradient.begin(), gradient.end());
+        }
+
+        maxError = std::max(maxError, computeRelativeError(estimates, references));
+    }
+
+    return reportCheck("tiled splat kernel", maxError < 1e-4, maxError);
+}
+
+bool checkProgressiveSplatting(int nSamples)
+{
+    pcg32 sampler;
+    std::vector<zombie::SamplePoint<float, 2>> samplePts;
+    zombie::bvc::EvaluationPoints<float, 2> progressiveEvalPts;
+    createSyntheticSplatData(nSamples, 256, sampler, samplePts, progressiveEvalPts);
+    zombie::bvc::EvaluationPoints<float, 2> directEvalPts = progressiveEvalPts;
+    zombie::bvc::EvaluationPoints<float, 2> treeEvalPts = progressiveEvalPts;
+
+    zombie::GeometricQueries<2> queries(true);
+    zombie::WalkOnStars<float, 2> walkOnStars(queries);
+    zombie::bvc::BoundaryValueCaching<float, 2> boundaryValueCaching(queries, walkOnStars);
+    zombie::PDE<float, 2> pde;
+
+    // splat half of the sample pts, refine their boundary data and splat the updates,
+    // and then splat the other half
+    int nHalf = nSamples/2;
+    std::vector<zombie::SamplePoint<float, 2>> firstSamplePts(samplePts.begin(), samplePts.begin() + nHalf);
+    std::vector<zombie::SamplePoint<float, 2>> secondSamplePts(samplePts.begin() + nHalf, samplePts.end());
+    boundaryValueCaching.splat(pde, firstSamplePts, 1e-3f, 0.0f, 2.0f, 0.0f, 0.0f, progressiveEvalPts);
+
+    std::vector<zombie::SamplePoint<float, 2>> prevFirstSamplePts = firstSamplePts;
+    for (zombie::SamplePoint<float, 2>& samplePt: firstSamplePts) {
+        samplePt.solution += 0.3f;
+        samplePt.normalDerivative *= 0.5f;
+        samplePt.robin += 0.2f;
+        samplePt.source -= 1.0f;
+    }
+
+    boundaryValueCaching.splatUpdates(pde, prevFirstSamplePts, firstSamplePts, 1e-3f, 0.0f, 2.0f,
+                                      0.0f, 0.0f, progressiveEvalPts);
+    boundaryValueCaching.splat(pde, secondSamplePts, 1e-3f, 0.0f, 2.0f, 0.0f, 0.0f, progressiveEvalPts);
+
+    // splat all refined sample pts at once as a reference
+    std::vector<zombie::SamplePoint<float, 2>> refinedSamplePts = firstSamplePts;
+    refinedSamplePts.insert(refinedSamplePts.end(), secondSamplePts.begin(), secondSamplePts.end());
+    boundaryValueCaching.splat(pde, refinedSamplePts, 1e-3f, 0.0f, 2.0f, 0.0f, 0.0f, directEvalPts);
+
+    // build a splat tree before the refinement, refit it to the refined sample pts and splat
+    // it with an opening angle of 0, which reduces to direct summation
+    std::vector<zombie::SamplePoint<float, 2>> prevSamplePts = prevFirstSamplePts;
+    prevSamplePts.insert(prevSamplePts.end(), secondSamplePts.begin(), secondSamplePts.end());
+    zombie::bvc::SplatTree<float, 2> splatTree;
+    splatTree.build(prevSamplePts, 2.0f);
+    splatTree.refit(refinedSamplePts);
+    boundaryValueCaching.splat(pde, splatTree, 0.0f, 1e-3f, 0.0f, 0.0f, 0.0f, treeEvalPts);
+
+    std::vector<float> progressiveEstimates, treeEstimates, references;
+    getSplatEstimates(progressiveEvalPts, progressiveEstimates);
+    getSplatEstimates(treeEvalPts, treeEstimates);
+    getSplatEstimates(directEvalPts, references);
+    double maxError = std::max(computeRelativeError(progressiveEstimates, references),
+                               computeRelativeError(treeEstimates, references));
+
+    return reportCheck("progressive splatting and splat tree refits", maxError < 1e-4, maxError);
+}
+
+bool checkBoundaryValueCaches(int nSamples)
+{
+    // save two sets of sample pts to a boundary value cache and load them back; the content
+    // hash must reject stale caches and change with the PDE fingerprint and absorption
+    pcg32 sampler;
+    std::vector<zombie::SamplePoint<float, 2>> samplePts;
+    zombie::bvc::EvaluationPoints<float, 2> evalPts;
+    createSyntheticSplatData(nSamples, 256, sampler, samplePts, evalPts);
+    zombie::bvc::EvaluationPoints<float, 2> cachedEvalPts = evalPts;
+    int nHalf = nSamples/2;
+    std::vector<zombie::SamplePoint<float, 2>> firstSamplePts(samplePts.begin(), samplePts.begin() + nHalf);
+    std::vector<zombie::SamplePoint<float, 2>> secondSamplePts(samplePts.begin() + nHalf, samplePts.end());
+    std::vector<zombie::SamplePoint<float, 2>> firstCachedSamplePts, secondCachedSamplePts;
+
+    zombie::PDE<float, 2> pde, screenedPde;
+    screenedPde.absorptionCoeff = 1.0f;
+    uint64_t contentHash = zombie::bvc::computePDEHash<float, 2>(pde, 1);
+    bool passed = contentHash != zombie::bvc::computePDEHash<float, 2>(pde, 2) &&
+                  contentHash != zombie::bvc::computePDEHash<float, 2>(screenedPde, 1);
+
+    std::string cacheFile = (std::filesystem::temp_directory_path() / "zombie_check_bvc.cache").string();
+    std::vector<const std::vector<zombie::SamplePoint<float, 2>> *> samplePtSets = {&firstSamplePts, &secondSamplePts};
+    std::vector<std::vector<zombie::SamplePoint<float, 2>> *> cachedSamplePtSets = {&firstCachedSamplePts,
+                                                                                    &secondCachedSamplePts};
+    passed = passed && zombie::bvc::saveBoundaryValueCache<float, 2>(cacheFile, contentHash, samplePtSets) &&
+             !zombie::bvc::loadBoundaryValueCache<float, 2>(cacheFile, contentHash + 1, cachedSamplePtSets) &&
+             zombie::bvc::loadBoundaryValueCache<float, 2>(cacheFile, contentHash, cachedSamplePtSets) &&
+             firstCachedSamplePts.size() == firstSamplePts.size() &&
+             secondCachedSamplePts.size() == secondSamplePts.size();
+    std::filesystem::remove(cacheFile);
+
+    // splatting the cached sample pts must reproduce the estimates of the original sample pts
+    double maxError = 0.0;
+    if (passed) {
+        zombie::GeometricQueries<2> queries(true);
+        zombie::WalkOnStars<float, 2> walkOnStars(queries);
+        zombie::bvc::BoundaryValueCaching<float, 2> boundaryValueCaching(queries, walkOnStars);
+        boundaryValueCaching.splat(pde, samplePts, 1e-3f, 0.0f, 2.0f, 0.0f, 0.0f, evalPts);
+        boundaryValueCaching.splat(pde, firstCachedSamplePts, 1e-3f, 0.0f, 2.0f, 0.0f, 0.0f, cachedEvalPts);
+        boundaryValueCaching.splat(pde, secondCachedSamplePts, 1e-3f, 0.0f, 2.0f, 0.0f, 0.0f, cachedEvalPts);
+
+        std::vector<float> estimates, references;
+        getSplatEstimates(cachedEvalPts, estimates);
+        getSplatEstimates(evalPts, references);
+        maxError = computeRelativeError(estimates, references);
+    }
+
+    return reportCheck("boundary value cache round trip", passed && maxError < 1e-5, maxError);
+}
+
+bool checkReverseWalkAccumulation(int nSamples)
+{
+    // add random sample contributions to evaluation pts in parallel, and compare the merged
+    // totals against a serial reference for each accumulation mode; a small memory budget
+    // makes the per-thread blocks fall back to atomics for part of the evaluation pts
+    const int nEvalPts = 1000;
+    const zombie::SampleType types[3] = {zombie::SampleType::OnAbsorbingBoundary,
+                                         zombie::SampleType::OnReflectingBoundary,
+                                         zombie::SampleType::InDomain};
+    pcg32 sampler;
+    std::vector<int> indices(nSamples);
+    std::vector<float> weights(nSamples);
+    std::vector<zombie::SampleContribution<float>> sampleContributions(nSamples);
+    std::vector<double> poissonKernelReferences(nEvalPts, 0.0);
+    std::vector<std::vector<double>> references(5, std::vector<double>(nEvalPts, 0.0));
+    for (int s = 0; s < nSamples; s++) {
+        indices[s] = (int)sampler.nextUInt(nEvalPts);
+        weights[s] = 0.5f + sampler.nextFloat();
+        sampleContributions[s].contribution = 2.0f*sampler.nextFloat() - 1.0f;
+        sampleContributions[s].pdf = 1.0f;
+        sampleContributions[s].type = types[sampler.nextUInt(3)];
+        sampleContributions[s].boundaryNormalAligned = sampler.nextFloat() < 0.3f;
+
+        int k = sampleContributions[s].type == zombie::SampleType::InDomain ? 4 :
+                (sampleContributions[s].type == zombie::SampleType::OnReflectingBoundary ? 2 : 0) +
+                (sampleContributions[s].boundaryNormalAligned ? 1 : 0);
+        references[k][indices[s]] += weights[s]*sampleContributions[s].contribution;
+        if (k == 0) poissonKernelReferences[indices[s]] += weights[s];
+    }
+
+    const std::pair<zombie::rws::AccumulationMode, float> modes[3] = {
+        {zombie::rws::AccumulationMode::ThreadLocal, 4.0f},
+        {zombie::rws::AccumulationMode::ThreadLocal, 0.5f},
+        {zombie::rws::AccumulationMode::Atomic, 4.0f}
+    };
+
+    double maxError = 0.0;
+    bool passed = true;
+    for (const std::pair<zombie::rws::AccumulationMode, float>& mode: modes) {
+        zombie::rws::EvaluationPoints<float, 2> evalPts(mode.first, mode.second);
+        for (int i = 0; i < nEvalPts; i++) {
+            evalPts.add(Vector2::Zero(), Vector2::Zero(), zombie::SampleType::InDomain, 1.0f, 1.0f);
+        }
+
+        // splat the contributions in two rounds to also exercise repeated merges
+        for (int round = 0; round < 2; round++) {
+            auto run = [&](const tbb::blocked_range<int>& range) {
+                zombie::rws::EvaluationPoints<float, 2>::ContributionBuffer *buffer =
+                    evalPts.getContributionBuffer();
+                for (int s = range.begin(); s < range.end(); ++s) {
+                    evalPts.addContribution(indices[s], sampleContributions[s], weights[s], true, buffer);
+                }
+            };
+
+            int nHalf = nSamples/2;
+            tbb::blocked_range<int> range(round == 0 ? 0 : nHalf, round == 0 ? nHalf : nSamples);
+            tbb::parallel_for(range, run);
+            evalPts.mergeContributions();
+        }
+
+        passed = passed && !evalPts.hasUnmergedContributions();
+        for (int i = 0; i < nEvalPts; i++) {
+            zombie::rws::EvaluationPoint<float, 2> evalPt = evalPts.getEvaluationPoint(i);
+            const float totals[5] = {evalPt.totalAbsorbingBoundaryContribution,
+                                     evalPt.totalAbsorbingBoundaryNormalAlignedContribution,
+                                     evalPt.totalReflectingBoundaryContribution,
+                                     evalPt.totalReflectingBoundaryNormalAlignedContribution,
+                                     evalPt.totalSourceContribution};
+            for (int k = 0; k < 5; k++) {
+                maxError = std::max(maxError, std::fabs(totals[k] - references[k][i]));
+            }
+
+            maxError = std::max(maxError, std::fabs(evalPt.totalPoissonKernelContribution -
+                                                    poissonKernelReferences[i]));
+        }
+    }
+
+    return reportCheck("reverse walk splat accumulation", passed && maxError < 1e-3, maxError);
+}
+
+template <typename NeighborFinder>
+int countNeighborSearchMismatches(const NeighborFinder& neighborFinder, const std::vector<Vector2>& points,
+                                  const std::vector<Vector2>& queryPts, float radius, size_t k)
+{
+    // compares radius and k nearest neighbor searches against brute force; points within
+    // a relative distance of 1e-5 of the search radius may be reported either way
+    int nMismatches = 0;
+    float squaredRadius = radius*radius;
+    std::vector<size_t> indices, visitedIndices, kNearestIndices;
+    std::vector<float> squaredDists;
+    for (const Vector2& queryPt: queryPts) {
+        size_t nIndices = neighborFinder.radiusSearch(queryPt, radius, indices);
+        visitedIndices.clear();
+        size_t nVisitedIndices = neighborFinder.radiusSearch(queryPt, radius,
+                                                             [&visitedIndices](size_t index) -> void {
+            visitedIndices.emplace_back(index);
+        });
+
+        std::sort(indices.begin(), indices.end());
+        std::sort(visitedIndices.begin(), visitedIndices.end());
+        bool mismatch = nIndices != indices.size() || nVisitedIndices != visitedIndices.size() ||
+                        indices != visitedIndices;
+
+        // every point inside the ball must be found exactly once, and no point outside it
+        size_t nInside = 0, nFoundInside = 0;
+        squaredDists.clear();
+        for (const Vector2& point: points) {
+            squaredDists.emplace_back((point - queryPt).squaredNorm());
+            if (squaredDists.back() < squaredRadius*(1.0f - 1e-5f)) nInside++;
+        }
+
+        for (size_t index: indices) {
+            float squaredDist = (points[index] - queryPt).squaredNorm();
+            if (squaredDist > squaredRadius*(1.0f + 1e-5f)) mismatch = true;
+            if (squaredDist < squaredRadius*(1.0f - 1e-5f)) nFoundInside++;
+        }
+
+        mismatch = mismatch || nFoundInside != nInside ||
+                   std::adjacent_find(indices.begin(), indices.end()) != indices.end();
+
+        // the k nearest neighbors must have the k smallest distances
+        neighborFinder.kNearest(queryPt, k, kNearestIndices);
+        std::partial_sort(squaredDists.begin(), squaredDists.begin() + k, squaredDists.end());
+        mismatch = mismatch || kNearestIndices.size() != k;
+        for (size_t i = 0; i < kNearestIndices.size() && i < k; i++) {
+            float squaredDist = (points[kNearestIndices[i]] - queryPt).squaredNorm();
+            if (std::fabs(squaredDist - squaredDists[i]) > 1e-5f*squaredDists[i] + 1e-12f) mismatch = true;
+        }
+
+        if (mismatch) nMismatches++;
+    }
+
+    return nMismatches;
+}
+
+bool checkRadiusSearch(int nQueries)
+{
+    // scatter points in the unit square, and query them from a slightly larger square
+    pcg32 sampler;
+    std::pair<Vector2, Vector2> bbox(Vector2(-0.1f, -0.1f), Vector2(1.1f, 1.1f));
+    std::vector<Vector2> points(4096), queryPts(nQueries);
+    for (Vector2& point: points) point = Vector2(sampler.nextFloat(), sampler.nextFloat());
+    for (Vector2& queryPt: queryPts) queryPt = sampleBoundingBox(bbox, sampler);
+
+    zombie::NearestNeighborFinder<2> nearestNeighborFinder;
+    nearestNeighborFinder.buildAccelerationStructure(points);
+    int nMismatches = countNeighborSearchMismatches(nearestNeighborFinder, points, queryPts, 0.05f, 8);
+
+    double maxError = (double)nMismatches/nQueries;
+    return reportCheck("radius search against brute force", nMismatches == 0, maxError);
+}
+
+bool checkGridNeighborSearch(int nQueries)
+{
+    // index a shuffled regular lattice, which the grid stores by node, and clustered points,
+    // which it stores in a spatial hash; half of the lattice queries lie on nodes
+    pcg32 sampler;
+    std::pair<Vector2, Vector2> bbox(Vector2(-0.1f, -0.1f), Vector2(1.1f, 1.1f));
+    std::vector<Vector2> latticePts, scatteredPts(4096), queryPts(nQueries);
+    for (int i = 0; i < 64; i++) {
+        for (int j = 0; j < 48; j++) {
+            latticePts.emplace_back(Vector2(i/63.0f, 0.75f*j/47.0f));
+        }
+    }
+
+    for (int i = (int)latticePts.size() - 1; i > 0; i--) {
+        std::swap(latticePts[i], latticePts[sampler.nextUInt(i + 1)]);
+    }
+
+    for (int i = 0; i < (int)scatteredPts.size(); i++) {
+        float scale = i%4 == 0 ? 1.0f : 0.1f;
+        scatteredPts[i] = Vector2(scale*sampler.nextFloat(), scale*sampler.nextFloat());
+    }
+
+    for (int i = 0; i < nQueries; i++) {
+        queryPts[i] = i%2 == 0 ? sampleBoundingBox(bbox, sampler) : latticePts[sampler.nextUInt(latticePts.size())];
+    }
+
+    zombie::GridNeighborFinder<2> latticeNeighborFinder, scatteredNeighborFinder;
+    latticeNeighborFinder.buildAccelerationStructure(latticePts);
+    scatteredNeighborFinder.buildAccelerationStructure(scatteredPts);
+    bool passed = latticeNeighborFinder.isLattice() && !scatteredNeighborFinder.isLattice();
+    int nMismatches = countNeighborSearchMismatches(latticeNeighborFinder, latticePts, queryPts, 0.05f, 8) +
+                      countNeighborSearchMismatches(scatteredNeighborFinder, scatteredPts, queryPts, 0.05f, 8);
+
+    double maxError = (double)nMismatches/(2*nQueries);
+    return reportCheck("grid neighbor search against brute force", passed && nMismatches == 0, maxError);
+}
+
+void createUnitDiskQueries(zombie::GeometricQueries<2>& queries)
+{
+    // geometric queries for a unit disk with an absorbing boundary, which lets the walk
+    // estimators be checked against closed form solutions without a scene
+    queries.computeDistToAbsorbingBoundary = [](const Vector2& x, bool computeSignedDistance) -> float {
+        return computeSignedDistance ? x.norm() - 1.0f : std::fabs(1.0f - x.norm());
+    };
+    queries.computeDistToReflectingBoundary = [](const Vector2& x, bool computeSignedDistance) -> float {
+        return std::numeric_limits<float>::max();
+    };
+    queries.computeDistToBoundary = queries.computeDistToAbsorbingBoundary;
+    queries.projectToAbsorbingBoundary = [](Vector2& x, Vector2& normal, float& distance,
+                                            bool computeSignedDistance) -> bool {
+        distance = computeSignedDistance ? x.norm() - 1.0f : std::fabs(x.norm() - 1.0f);
+        normal = x.normalized();
+        x = normal;
+        return true;
+    };
+    queries.offsetPointAlongDirection = [](const Vector2& x, const Vector2& dir) -> Vector2 {
+        return x + 1e-5f*dir;
+    };
+    queries.intersectReflectingBoundary = [](const Vector2& x, const Vector2& normal, const Vector2& dir,
+                                             float tMax, bool onReflectingBoundary,
+                                             zombie::IntersectionPoint<2>& intersectionPt) -> bool {
+        return false;
+    };
+    queries.intersectsWithReflectingBoundary = [](const Vector2& xi, const Vector2& xj,
+                                                  const Vector2& ni, const Vector2& nj,
+                                                  bool offseti, bool offsetj) -> bool {
+        return false;
+    };
+    queries.sampleReflectingBoundary = [](const Vector2& x, float radius, const Vector2& randNums,
+                                          zombie::BoundarySample<2>& boundarySample) -> bool {
+        return false;
+    };
+    queries.computeStarRadiusForReflectingBoundary = [](const Vector2& x, float minRadius, float maxRadius,
+                                                        float silhouettePrecision, bool flipNormalOrientation) -> float {
+        return maxRadius;
+    };
+    queries.outsideBoundingDomain = [](const Vector2& x) -> bool {
+        return x.norm() > 1.01f;
+    };
+    queries.insideDomain = [](const Vector2& x, bool useRayIntersections) -> bool {
+        return x.norm() < 1.0f;
+    };
+}
+
+bool checkBidirectionalEstimator(int nSamples)
+{
+    // solve a Dirichlet problem with the linear solution u = x + 0.5 on the unit disk with
+    // forward walks and reverse walks from uniformly sampled boundary pts, after a pilot pass
+    // that fixes the blend weights; the blended estimate must be a convex combination of the
+    // two estimates, and no less accurate than the worse of them
+    zombie::GeometricQueries<2> queries(true);
+    createUnitDiskQueries(queries);
+    zombie::PDE<float, 2> pde;
+    pde.dirichlet = [](const Vector2& x, bool flipNormalOrientation) -> float { return x.x() + 0.5f; };
+    pde.source = [](const Vector2& x) -> float { return 0.0f; };
+
+    const float maxFloat = std::numeric_limits<float>::max();
+    zombie::rws::EvaluationPoints<float, 2> evalPts;
+    std::vector<zombie::SamplePoint<float, 2>> forwardSamplePts;
+    std::vector<zombie::SampleEstimationData<2>> sampleEstimationData;
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 16; j++) {
+            Vector2 pt(-0.6f + 1.2f*i/15.0f, -0.6f + 1.2f*j/15.0f);
+            evalPts.add(pt, Vector2::Zero(), zombie::SampleType::InDomain, 1.0f - pt.norm(), maxFloat);
+            forwardSamplePts.emplace_back(pt, Vector2::Zero(), zombie::SampleType::InDomain,
+                                          1.0f, 1.0f - pt.norm(), maxFloat);
+            sampleEstimationData.emplace_back(16, zombie::EstimationQuantity::Solution);
+        }
+    }
+
+    zombie::GridNeighborFinder<2> nearestNeighborFinder;
+    nearestNeighborFinder.buildAccelerationStructure(evalPts.pt);
+    const float normalOffset = 5e-3f;
+    zombie::rws::VisibilitySettings visibilitySettings;
+    zombie::SplatContributionCallback<float, 2> splatContribution =
+        std::bind(&zombie::rws::splatContribution<float, 2, zombie::GridNeighborFinder<2>>,
+        std::placeholders::_1, std::placeholders::_2, std::cref(queries),
+        std::cref(nearestNeighborFinder), std::cref(pde), normalOffset,
+        0.0f, 0.0f, std::ref(evalPts), std::cref(visibilitySettings));
+    zombie::MergeContributionsCallback mergeContributions = [&evalPts]() -> void { evalPts.mergeContributions(); };
+
+    pcg32 sampler;
+    std::vector<zombie::SamplePoint<float, 2>> absorbingBoundarySamplePts, emptySamplePts[4];
+    zombie::WalkSettings walkSettings(1e-3f, 1e-3f, 1e-3f, 0.0f, 1024, 0, 1024, false,
+                                      false, false, false, false, false, false, false);
+    zombie::BidirectionalWalkOnStars<float, 2> bidirectionalWalkOnStars(queries, splatContribution, mergeContributions);
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass > 0) {
+            bidirectionalWalkOnStars.fixWeights(evalPts, forwardSamplePts);
+            bidirectionalWalkOnStars.reset();
+            for (zombie::SamplePoint<float, 2>& samplePt: forwardSamplePts) samplePt.reset();
+        }
+
+        absorbingBoundarySamplePts.clear();
+        for (int i = 0; i < nSamples; i++) {
+            float theta = 2.0f*M_PI*sampler.nextFloat();
+            Vector2 normal(std::cos(theta), std::sin(theta));
+            absorbingBoundarySamplePts.emplace_back((1.0f - normalOffset)*normal, normal,
+                                                    zombie::SampleType::OnAbsorbingBoundary,
+                                                    1.0f/(2.0f*M_PI), normalOffset, maxFloat);
+        }
+
+        bidirectionalWalkOnStars.solveForward(pde, walkSettings, sampleEstimationData, forwardSamplePts);
+        bidirectionalWalkOnStars.solveReverse(pde, walkSettings, absorbingBoundarySamplePts, emptySamplePts[0],
+                                              emptySamplePts[1], emptySamplePts[2], emptySamplePts[3],
+                                              8, evalPts);
+    }
+
+    std::vector<float> solution, forwardWeights;
+    bidirectionalWalkOnStars.combine(evalPts, forwardSamplePts, solution, &forwardWeights);
+
+    bool passed = true;
+    double forwardError = 0.0, reverseError = 0.0, combinedError = 0.0;
+    for (int i = 0; i < evalPts.size(); i++) {
+        float exactSolution = evalPts.pt[i].x() + 0.5f;
+        float forwardSolution = forwardSamplePts[i].statistics->getEstimatedSolution();
+        float reverseSolution = evalPts.getEstimatedSolution(i, nSamples, 0, 0, 0, 0);
+        float blendedSolution = forwardWeights[i]*forwardSolution + (1.0f - forwardWeights[i])*reverseSolution;
+        passed = passed && forwardWeights[i] >= 0.0f && forwardWeights[i] <= 1.0f &&
+                 std::fabs(solution[i] - blendedSolution) < 1e-4f;
+
+        forwardError += (forwardSolution - exactSolution)*(forwardSolution - exactSolution);
+        reverseError += (reverseSolution - exactSolution)*(reverseSolution - exactSolution);
+        combinedError += (solution[i] - exactSolution)*(solution[i] - exactSolution);
+    }
+
+    double maxError = std::sqrt(combinedError/evalPts.size());
+    passed = passed && combinedError <= std::max(forwardError, reverseError);
+    return reportCheck("bidirectional estimator blend", passed, maxError);
+}
+
+bool checkSobolSampling(int nSequences)
+{
+    // the first 2^m samples of each pair of dimensions must form a (0, m, 2)-net, i.e., each
+    // elementary interval of area 2^-m must hold exactly one sample, and integrating a smooth
+    // function with 256 samples must be far more accurate than with independent samples
+    const int log2SampleCount = 8;
+    const int nSamples = 1 << log2SampleCount;
+    const double exactIntegral = 0.5*(std::exp(1.0) - 1.0);
+    zombie::OwenScrambledSobolSampleGenerator sobolGenerator;
+    zombie::IndependentSampleGenerator independentGenerator;
+
+    bool passed = true;
+    double sobolError = 0.0, independentError = 0.0;
+    std::vector<Vector2> samples(nSamples);
+    std::vector<int> counts(nSamples);
+    for (int s = 0; s < nSequences; s++) {
+        uint32_t dimensionPair = s%4;
+        double sobolIntegral = 0.0, independentIntegral = 0.0;
+        for (int i = 0; i < nSamples; i++) {
+            float u[2], v[2];
+            sobolGenerator.generate2D(s, i, dimensionPair, u);
+            independentGenerator.generate2D(s, i, dimensionPair, v);
+            passed = passed && u[0] >= 0.0f && u[0] < 1.0f && u[1] >= 0.0f && u[1] < 1.0f;
+            samples[i] = Vector2(u[0], u[1]);
+            sobolIntegral += std::exp(u[0])*u[1];
+            independentIntegral += std::exp(v[0])*v[1];
+        }
+
+        for (int m = 1; m <= log2SampleCount; m++) {
+            int nPrefix = 1 << m;
+            for (int a = 0; a <= m; a++) {
+                std::fill(counts.begin(), counts.begin() + nPrefix, 0);
+                for (int i = 0; i < nPrefix; i++) {
+                    int x = (int)(samples[i].x()*(1 << a));
+                    int y = (int)(samples[i].y()*(1 << (m - a)));
+                    counts[(x << (m - a)) + y]++;
+                }
+
+                passed = passed && std::all_of(counts.begin(), counts.begin() + nPrefix,
+                                               [](int count) -> bool { return count == 1; });
+            }
+        }
+
+        sobolError += std::pow(sobolIntegral/nSamples - exactIntegral, 2.0);
+        independentError += std::pow(independentIntegral/nSamples - exactIntegral, 2.0);
+    }
+
+    sobolError = std::sqrt(sobolError/nSequences);
+    independentError = std::sqrt(independentError/nSequences);
+    return reportCheck("Owen-scrambled Sobol stratification", passed && sobolError < 0.1*independentError,
+                       sobolError);
+}
+
+bool checkSourceImportanceSampling(int nSamples)
+{
+    // estimate the area of the unit disk and the integral of a narrow Gaussian source inside it
+    // from importance sampled domain pts; both Monte Carlo estimates must match the closed form
+    // values, which also checks that the pdfs account for the rejected candidate pts
+    zombie::GeometricQueries<2> queries(true);
+    createUnitDiskQueries(queries);
+    std::function<bool(const Vector2&)> insideSolveRegion = [&queries](const Vector2& x) -> bool {
+        return queries.insideDomain(x, true);
+    };
+    std::function<float(const Vector2&)> source = [](const Vector2& x) -> float {
+        return std::exp(-20.0f*(x - Vector2(0.3f, 0.2f)).squaredNorm());
+    };
+
+    const int nRounds = 8;
+    const double exactArea = M_PI;
+    const double exactIntegral = M_PI/20.0;
+    Vector2 solveRegionMin(-1.0f, -1.0f), solveRegionMax(1.0f, 1.0f);
+    zombie::SourceImportanceDomainSampler<float, 2> domainSampler(queries, insideSolveRegion, solveRegionMin,
+                                                                  solveRegionMax, source, 32);
+
+    bool passed = true;
+    double area = 0.0, integral = 0.0;
+    std::vector<zombie::SamplePoint<float, 2>> samplePts;
+    for (int round = 0; round < nRounds; round++) {
+        domainSampler.generateSamples(nSamples, samplePts);
+        passed = passed && samplePts.size() > 0;
+
+        double roundArea = 0.0, roundIntegral = 0.0;
+        for (const zombie::SamplePoint<float, 2>& samplePt: samplePts) {
+            passed = passed && samplePt.pt.norm() < 1.0f && samplePt.pdf > 0.0f;
+            roundArea += 1.0/samplePt.pdf;
+            roundIntegral += source(samplePt.pt)/samplePt.pdf;
+        }
+
+        area += roundArea/std::max<size_t>(1, samplePts.size());
+        integral += roundIntegral/std::max<size_t>(1, samplePts.size());
+    }
+
+    double maxError = std::max(std::fabs(area/nRounds - exactArea)/exactArea,
+                               std::fabs(integral/nRounds - exactIntegral)/exactIntegral);
+    return reportCheck("source importance domain sampling", passed && maxError < 0.05, maxError);
+}
+
+bool checkVoxelClassifiedSampling(int nSamples)
+{
+    // sample the unit disk with a coarse voxel grid, so that many cells straddle the boundary;
+    // every sample must lie inside the disk, and the number of samples in each cell must be
+    // within 5 standard deviations of the expected count, computed from the area of the cell
+    // inside the disk by brute force; a misclassified cell falls far outside this range
+    zombie::GeometricQueries<2> queries(true);
+    createUnitDiskQueries(queries);
+    std::function<bool(const Vector2&)> insideSolveRegion = [&queries](const Vector2& x) -> bool {
+        return queries.insideDomain(x, true);
+    };
+
+    const int nRounds = 8;
+    const int histogramRes = 16;
+    Vector2 solveRegionMin(-1.0f, -1.0f), solveRegionMax(1.0f, 1.0f);
+    zombie::VoxelClassifiedDomainSampler<float, 2> domainSampler(queries, insideSolveRegion, solveRegionMin,
+                                                                 solveRegionMax, M_PI, 16);
+
+    bool passed = true;
+    int nTotalSamples = 0;
+    std::vector<int> counts(histogramRes*histogramRes, 0);
+    std::vector<zombie::SamplePoint<float, 2>> samplePts;
+    for (int round = 0; round < nRounds; round++) {
+        domainSampler.generateSamples(nSamples, samplePts);
+        for (const zombie::SamplePoint<float, 2>& samplePt: samplePts) {
+            passed = passed && insideSolveRegion(samplePt.pt) && std::fabs(samplePt.pdf*M_PI - 1.0f) < 1e-4f;
+            int x = std::clamp((int)((samplePt.pt.x() + 1.0f)*0.5f*histogramRes), 0, histogramRes - 1);
+            int y = std::clamp((int)((samplePt.pt.y() + 1.0f)*0.5f*histogramRes), 0, histogramRes - 1);
+            counts[x*histogramRes + y]++;
+        }
+
+        nTotalSamples += (int)samplePts.size();
+    }
+
+    // compare the counts with the expected counts, skipping cells with a tiny expected count
+    const int subRes = 64;
+    double maxError = 0.0;
+    for (int i = 0; i < histogramRes*histogramRes; i++) {
+        int nInside = 0;
+        for (int j = 0; j < subRes*subRes; j++) {
+            Vector2 pt(-1.0f + 2.0f*((i/histogramRes) + ((j/subRes) + 0.5f)/subRes)/histogramRes,
+                       -1.0f + 2.0f*((i%histogramRes) + ((j%subRes) + 0.5f)/subRes)/histogramRes);
+            if (pt.norm() < 1.0f) nInside++;
+        }
+
+        double expected = nTotalSamples*(4.0/(histogramRes*histogramRes))*nInside/(subRes*subRes)/M_PI;
+        if (expected >= 5.0) maxError = std::max(maxError, std::fabs(counts[i] - expected)/std::sqrt(expected));
+    }
+
+    passed = passed && std::abs(nTotalSamples - nRounds*nSamples) < 0.05*nRounds*nSamples;
+    return reportCheck("voxel classified domain sampling", passed && maxError < 5.0, maxError);
+}
+
+bool checkBoundarySampleGeneration(int nSamples)
+{
+    // build a polygon approximating the unit circle with uneven edge lengths, and exclude the
+    // edges with x >= 0.5 from the solve region
+    const int nEdges = 257;
+    pcg32 sampler;
+    std::vector<Vector2> positions;
+    std::vector<std::vector<size_t>> indices;
+    for (int i = 0; i < nEdges; i++) {
+        float theta = 2.0f*M_PI*(i + 0.8f*sampler.nextFloat())/nEdges;
+        positions.emplace_back(Vector2(std::cos(theta), std::sin(theta)));
+        indices.emplace_back(std::vector<size_t>{(size_t)i, (size_t)((i + 1)%nEdges)});
+    }
+
+    zombie::GeometricQueries<2> queries(true);
+    createUnitDiskQueries(queries);
+    std::function<bool(const Vector2&)> insideSolveRegion = [](const Vector2& x) -> bool {
+        return x.x() < 0.5f;
+    };
+
+    std::vector<float> weights(nEdges);
+    double area = 0.0;
+    for (int i = 0; i < nEdges; i++) {
+        const Vector2& pa = positions[indices[i][0]];
+        const Vector2& pb = positions[indices[i][1]];
+        weights[i] = insideSolveRegion(0.5f*(pa + pb)) ? (pb - pa).norm() : 0.0f;
+        area += weights[i];
+    }
+
+    // drawing sorted numbers with a linear scan must select the same edges as a bisection
+    // per number, and the counting sort must group unsorted numbers by the edge they select
+    zombie::CDFTable table;
+    table.build(weights);
+    std::vector<float> sortedU(nSamples), u(nSamples);
+    for (int i = 0; i < nSamples; i++) {
+        sortedU[i] = (i + sampler.nextFloat())/nSamples;
+        u[i] = sampler.nextFloat();
+    }
+
+    std::vector<int> sortedPrimitives(nSamples), primitiveOffsets, sortedIndices;
+    table.sampleSorted(sortedU.data(), nSamples, sortedPrimitives.data());
+    zombie::sortSamplesByPrimitive(table, u, false, nEdges, primitiveOffsets, sortedIndices);
+
+    bool passed = primitiveOffsets.back() == nSamples;
+    std::vector<uint8_t> visited(nSamples, 0);
+    for (int i = 0; i < nSamples; i++) {
+        passed = passed && sortedPrimitives[i] == table.sample(sortedU[i]);
+    }
+
+    for (int p = 0; p < nEdges; p++) {
+        for (int j = primitiveOffsets[p]; j < primitiveOffsets[p + 1] && passed; j++) {
+            passed = !visited[sortedIndices[j]] && table.sample(u[sortedIndices[j]]) == p;
+            visited[sortedIndices[j]] = 1;
+        }
+    }
+
+    // the samples must lie on the edges they were generated on, with uniform pdfs, and the
+    // stratified edge selection must give each edge its expected count to within two samples,
+    // one for the partially covered stratum at each end of the edge
+    zombie::UniformLineSegmentBoundarySampler<float> boundarySampler(positions, indices, queries, insideSolveRegion);
+    boundarySampler.initialize(0.0f, false);
+    std::vector<zombie::SamplePoint<float, 2>> samplePts;
+    std::vector<int> primitiveIndices;
+    boundarySampler.generateSamples(nSamples, zombie::SampleType::OnAbsorbingBoundary, 0.0f,
+                                    samplePts, primitiveIndices);
+    passed = passed && (int)samplePts.size() == nSamples;
+
+    std::vector<int> counts(nEdges, 0);
+    for (int i = 0; i < (int)samplePts.size() && passed; i++) {
+        int p = primitiveIndices[i];
+        const Vector2& pa = positions[indices[p][0]];
+        const Vector2& pb = positions[indices[p][1]];
+        Vector2 s = pb - pa;
+        float t = std::clamp((samplePts[i].pt - pa).dot(s)/s.squaredNorm(), 0.0f, 1.0f);
+        passed = (samplePts[i].pt - (pa + t*s)).norm() < 1e-5f &&
+                 std::fabs(samplePts[i].pdf*area - 1.0) < 1e-3;
+        counts[p]++;
+    }
+
+    double maxError = 0.0;
+    for (int p = 0; p < nEdges; p++) {
+        passed = passed && (weights[p] > 0.0f || counts[p] == 0);
+        maxError = std::max(maxError, std::fabs(counts[p] - nSamples*weights[p]/area));
+    }
+
+    return reportCheck("boundary sample generation", passed && maxError < 2.0, maxError);
+}
+
+bool checkWalkSplitting(int nQueries)
+{
+    // solve a Poisson problem on the unit disk with the closed form solution
+    // u = x^2 - y^2 + 0.5 + (1 - |x|^2)/4 for a unit source, with and without walk splitting;
+    // splitting must take more steps per walk, and both estimates must be unbiased, i.e.,
+    // their mean errors must be within 4 standard errors of zero
+    zombie::GeometricQueries<2> queries(true);
+    createUnitDiskQueries(queries);
+    zombie::PDE<float, 2> pde;
+    pde.dirichlet = [](const Vector2& x, bool flipNormalOrientation) -> float {
+        return x.x()*x.x() - x.y()*x.y() + 0.5f;
+    };
+    pde.source = [](const Vector2& x) -> float { return 1.0f; };
+    auto exactSolution = [](const Vector2& x) -> float {
+        return x.x()*x.x() - x.y()*x.y() + 0.5f + 0.25f*(1.0f - x.squaredNorm());
+    };
+
+    const int gridRes = 16;
+    const float maxFloat = std::numeric_limits<float>::max();
+    int nSteps[2] = {0, 0};
+    double meanErrors[2], standardErrors[2];
+    for (int split = 0; split < 2; split++) {
+        std::vector<zombie::SamplePoint<float, 2>> samplePts;
+        std::vector<zombie::SampleEstimationData<2>> sampleEstimationData;
+        for (int i = 0; i < gridRes; i++) {
+            for (int j = 0; j < gridRes; j++) {
+                Vector2 pt(-0.6f + 1.2f*i/(gridRes - 1), -0.6f + 1.2f*j/(gridRes - 1));
+                samplePts.emplace_back(pt, Vector2::Zero(), zombie::SampleType::InDomain,
+                                       1.0f, 1.0f - pt.norm(), maxFloat);
+                sampleEstimationData.emplace_back(std::max(1, nQueries/gridRes/gridRes),
+                                                  zombie::EstimationQuantity::Solution);
+            }
+        }
+
+        // split every walk into 2 branches at each of its first 3 steps
+        zombie::WalkSettings walkSettings(1e-3f, 1e-3f, 1e-3f, 0.0f, 1024, 1024, 1024, false,
+                                          false, false, false, false, false, false, false);
+        std::function<float(const zombie::WalkState<float, 2>&)> splittingImportance = {};
+        if (split == 1) {
+            walkSettings.maxSplitDepth = 3;
+            walkSettings.maxSplitBranches = 2;
+            splittingImportance = [](const zombie::WalkState<float, 2>& state) -> float { return 2.0f; };
+        }
+
+        std::atomic<int> nWalkSteps(0);
+        std::function<void(const zombie::WalkState<float, 2>&)> countWalkSteps =
+            [&nWalkSteps](const zombie::WalkState<float, 2>& state) -> void {
+            nWalkSteps.fetch_add(1, std::memory_order_relaxed);
+        };
+        zombie::WalkOnStars<float, 2> walkOnStars(queries, countWalkSteps, {}, splittingImportance);
+        walkOnStars.solve(pde, walkSettings, sampleEstimationData, samplePts);
+        nSteps[split] = nWalkSteps.load();
+
+        double errorSum = 0.0, squaredErrorSum = 0.0;
+        for (const zombie::SamplePoint<float, 2>& samplePt: samplePts) {
+            double error = samplePt.statistics->getEstimatedSolution() - exactSolution(samplePt.pt);
+            errorSum += error;
+            squaredErrorSum += error*error;
+        }
+
+        int nPts = (int)samplePts.size();
+        meanErrors[split] = errorSum/nPts;
+        standardErrors[split] = std::sqrt(std::max(0.0, squaredErrorSum/nPts - meanErrors[split]*meanErrors[split])/nPts);
+    }
+
+    bool passed = nSteps[1] > nSteps[0];
+    double maxError = 0.0;
+    for (int split = 0; split < 2; split++) {
+        passed = passed && std::fabs(meanErrors[split]) < 4.0*standardErrors[split];
+        maxError = std::max(maxError, std::fabs(meanErrors[split]));
+    }
+
+    return reportCheck("walk splitting", passed, maxError);
+}
+
+void runSelfChecks(const Scene& scene, const json& solverConfig)
+{
+    // load config settings
+    const int nQueries = getOptional<int>(solverConfig, "nCheckQueries", 4096);
+    const int nSamples = getOptional<int>(solverConfig, "nCheckSamples", 4096);
+
+    // run the checks and exit with a failure code if any of them fails
+    int nFailed = 0;
+    if (!checkBoundaryCaches(scene, nQueries)) nFailed++;
+    if (!checkVectorizedRobinBvh(scene, nQueries)) nFailed++;
+    if (!checkImplicitBoundaries(nQueries)) nFailed++;
+    if (!checkWindingNumbers(scene, nQueries)) nFailed++;
+    if (!checkSplatKernels(nSamples)) nFailed++;
+    if (!checkProgressiveSplatting(nSamples)) nFailed++;
+    if (!checkBoundaryValueCaches(nSamples)) nFailed++;
+    if (!checkReverseWalkAccumulation(nSamples)) nFailed++;
+    if (!checkRadiusSearch(nQueries)) nFailed++;
+    if (!checkGridNeighborSearch(nQueries)) nFailed++;
+    if (!checkBidirectionalEstimator(nSamples)) nFailed++;
+    if (!checkSobolSampling(nQueries)) nFailed++;
+    if (!checkSourceImportanceSampling(nSamples)) nFailed++;
+    if (!checkVoxelClassifiedSampling(nSamples)) nFailed++;
+    if (!checkBoundarySampleGeneration(nSamples)) nFailed++;
+    if (!checkWalkSplitting(nQueries)) nFailed++;
+
+    std::cout << nFailed << " self check(s) failed" << std::endl;
+    if (nFailed > 0) exit(EXIT_FAILURE);
+}
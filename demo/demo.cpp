@@ -1,9 +1,11 @@
 // This file is the entry point for the 2D demo application demonstrating how to use Zombie.
 // It reads a 'scene' description from a JSON file, runs the WalkOnStars or BoundaryValueCaching
-// solver, and writes the result to a PMF or PNG file.
+// solver, and writes the result to a PMF or PNG file. It can also run self checks of the
+// numerical components used by the solvers against brute force references.
 
 #include "scene.h"
 #include "grid.h"
+#include "checks.h"
 
 using json = nlohmann::json;
 
@@ -14,11 +16,16 @@ void runWalkOnStars(const Scene& scene, const json& solverConfig, const json& ou
     const float epsilonShellForReflectingBoundary = getOptional<float>(solverConfig, "epsilonShellForReflectingBoundary", 1e-3f);
     const float silhouettePrecision = getOptional<float>(solverConfig, "silhouettePrecision", 1e-3f);
     const float russianRouletteThreshold = getOptional<float>(solverConfig, "russianRouletteThreshold", 0.0f);
+    const float splittingThreshold = getOptional<float>(solverConfig, "splittingThreshold", 1.0f);
+    const float reflectingBoundarySplittingImportance = getOptional<float>(solverConfig, "reflectingBoundarySplittingImportance", 0.0f);
 
     const int nWalks = getOptional<int>(solverConfig, "nWalks", 128);
     const int maxWalkLength = getOptional<int>(solverConfig, "maxWalkLength", 1024);
     const int stepsBeforeApplyingTikhonov = getOptional<int>(solverConfig, "stepsBeforeApplyingTikhonov", 0);
     const int stepsBeforeUsingMaximalSpheres = getOptional<int>(solverConfig, "stepsBeforeUsingMaximalSpheres", maxWalkLength);
+    const int stepsUsingSampleGenerator = getOptional<int>(solverConfig, "stepsUsingSampleGenerator", 8);
+    const int maxSplitBranches = getOptional<int>(solverConfig, "maxSplitBranches", 4);
+    const int maxSplitDepth = getOptional<int>(solverConfig, "maxSplitDepth", 0);
     const int gridRes = getRequired<int>(outputConfig, "gridRes");
 
     const bool disableGradientControlVariates = getOptional<bool>(solverConfig, "disableGradientControlVariates", false);
@@ -29,6 +36,7 @@ void runWalkOnStars(const Scene& scene, const json& solverConfig, const json& ou
     const bool ignoreSourceContribution = getOptional<bool>(solverConfig, "ignoreSourceContribution", false);
     const bool printLogs = getOptional<bool>(solverConfig, "printLogs", false);
     const bool runSingleThreaded = getOptional<bool>(solverConfig, "runSingleThreaded", false);
+    const bool useSobolSampling = getOptional<bool>(solverConfig, "useSobolSampling", false);
 
     const std::pair<Vector2, Vector2>& bbox = scene.bbox;
     const zombie::GeometricQueries<2>& queries = scene.queries;
@@ -62,7 +70,25 @@ void runWalkOnStars(const Scene& scene, const json& solverConfig, const json& ou
                                       ignoreAbsorbingBoundaryContribution,
                                       ignoreReflectingBoundaryContribution,
                                       ignoreSourceContribution, printLogs);
-    zombie::WalkOnStars<float, 2> walkOnStars(queries);
+    if (useSobolSampling) {
+        walkSettings.sampleGenerator = std::make_shared<zombie::OwenScrambledSobolSampleGenerator>();
+        walkSettings.stepsUsingSampleGenerator = stepsUsingSampleGenerator;
+    }
+
+    // split walks that reach the reflecting boundary, using the default importance of
+    // maxSplitBranches there unless a different importance is given
+    walkSettings.splittingThreshold = splittingThreshold;
+    walkSettings.maxSplitBranches = maxSplitBranches;
+    walkSettings.maxSplitDepth = maxSplitDepth;
+    std::function<float(const zombie::WalkState<float, 2>&)> splittingImportanceCallback = {};
+    if (reflectingBoundarySplittingImportance > 0.0f) {
+        splittingImportanceCallback = [reflectingBoundarySplittingImportance](
+                                      const zombie::WalkState<float, 2>& state) -> float {
+            return state.onReflectingBoundary ? reflectingBoundarySplittingImportance : 1.0f;
+        };
+    }
+
+    zombie::WalkOnStars<float, 2> walkOnStars(queries, {}, {}, splittingImportanceCallback);
     walkOnStars.solve(pde, walkSettings, sampleEstimationData, samplePts, runSingleThreaded, reportProgress);
     pb.finish();
 
@@ -98,6 +124,12 @@ void runBoundaryValueCaching(const Scene& scene, const json& solverConfig, const
     const int absorbingBoundaryCacheSize = getOptional<int>(solverConfig, "absorbingBoundaryCacheSize", 1024);
     const int reflectingBoundaryCacheSize = getOptional<int>(solverConfig, "reflectingBoundaryCacheSize", 1024);
     const int domainCacheSize = getOptional<int>(solverConfig, "domainCacheSize", 1024);
+    const int sourceImportanceGridRes = getOptional<int>(solverConfig, "sourceImportanceGridRes", 0);
+    const int domainVoxelGridRes = getOptional<int>(solverConfig, "domainVoxelGridRes", 0);
+    const int nNearestCachedSamplesNearBoundary = getOptional<int>(solverConfig, "nNearestCachedSamplesNearBoundary", 0);
+    const int nWalksForPilotBoundaryEstimates = getOptional<int>(solverConfig, "nWalksForPilotBoundaryEstimates", 0);
+    const int pilotBoundaryCacheSize = getOptional<int>(solverConfig, "pilotBoundaryCacheSize", 256);
+    const int nWalksForSparseCacheNearBoundary = getOptional<int>(solverConfig, "nWalksForSparseCacheNearBoundary", nWalksForCachedSolutionEstimates);
 
     const bool useFiniteDifferencesForBoundaryDerivatives = getOptional<bool>(solverConfig, "useFiniteDifferencesForBoundaryDerivatives", false);
 
@@ -106,6 +138,10 @@ void runBoundaryValueCaching(const Scene& scene, const json& solverConfig, const
     const float normalOffsetForReflectingBoundary = getOptional<float>(solverConfig, "normalOffsetForReflectingBoundary", 0.0f);
     const float radiusClampForKernels = getOptional<float>(solverConfig, "radiusClampForKernels", 0.0f);
     const float regularizationForKernels = getOptional<float>(solverConfig, "regularizationForKernels", 0.0f);
+    const float splatTreeOpeningAngle = getOptional<float>(solverConfig, "splatTreeOpeningAngle", 0.0f);
+    const float maxDistToCachedSampleNearBoundary = getOptional<float>(solverConfig, "maxDistToCachedSampleNearBoundary", 0.0f);
+
+    const std::string boundaryValueCacheFile = getOptional<std::string>(solverConfig, "boundaryValueCacheFile", "");
 
     const std::pair<Vector2, Vector2>& bbox = scene.bbox;
     const zombie::GeometricQueries<2>& queries = scene.queries;
@@ -120,49 +156,144 @@ void runBoundaryValueCaching(const Scene& scene, const json& solverConfig, const
         return solveDoubleSided ? !queries.outsideBoundingDomain(x) : queries.insideDomain(x, true);
     };
 
-    std::vector<zombie::bvc::EvaluationPoint<float, 2>> evalPts;
-    createEvaluationGrid<zombie::bvc::EvaluationPoint<float, 2>>(evalPts, queries, bbox.first, bbox.second, gridRes);
+    zombie::bvc::EvaluationPoints<float, 2> evalPts;
+    createEvaluationGrid<zombie::bvc::EvaluationPoints<float, 2>>(evalPts, queries, bbox.first, bbox.second, gridRes);
 
-    // generate boundary and domain samples
+    // initialize solvers
+    zombie::WalkOnStars<float, 2> walkOnStars(queries);
+    zombie::bvc::BoundaryValueCaching<float, 2, zombie::EstimationQuantity::Solution> boundaryValueCaching(queries, walkOnStars);
+    zombie::WalkSettings walkSettings(epsilonShellForAbsorbingBoundary,
+                                      epsilonShellForReflectingBoundary,
+                                      silhouettePrecision, russianRouletteThreshold,
+                                      maxWalkLength, stepsBeforeApplyingTikhonov,
+                                      stepsBeforeUsingMaximalSpheres, solveDoubleSided,
+                                      !disableGradientControlVariates,
+                                      !disableGradientAntitheticVariates,
+                                      useCosineSamplingForDirectionalDerivatives,
+                                      ignoreAbsorbingBoundaryContribution,
+                                      ignoreReflectingBoundaryContribution,
+                                      ignoreSourceContribution, printLogs);
+
+    // generate boundary and domain samples, unless they can be loaded together with their
+    // boundary estimates from a cache written by a previous run with the same scene and settings
     std::vector<zombie::SamplePoint<float, 2>> absorbingBoundaryCache;
     std::vector<zombie::SamplePoint<float, 2>> absorbingBoundaryCacheNormalAligned;
     std::vector<zombie::SamplePoint<float, 2>> reflectingBoundaryCache;
     std::vector<zombie::SamplePoint<float, 2>> reflectingBoundaryCacheNormalAligned;
     std::vector<zombie::SamplePoint<float, 2>> domainCache;
 
-    zombie::UniformLineSegmentBoundarySampler<float> absorbingBoundarySampler(
-        scene.absorbingBoundaryVertices, scene.absorbingBoundarySegments, queries, insideSolveRegionBoundarySampler);
-    absorbingBoundarySampler.initialize(normalOffsetForAbsorbingBoundary, solveDoubleSided);
-    absorbingBoundarySampler.generateSamples(absorbingBoundarySampler.getSampleCount(absorbingBoundaryCacheSize, false),
-                                             zombie::SampleType::OnAbsorbingBoundary, normalOffsetForAbsorbingBoundary,
-                                             absorbingBoundaryCache, false);
-    if (solveDoubleSided) {
-        absorbingBoundarySampler.generateSamples(absorbingBoundarySampler.getSampleCount(absorbingBoundaryCacheSize, true),
-                                                 zombie::SampleType::OnAbsorbingBoundary, normalOffsetForAbsorbingBoundary,
-                                                 absorbingBoundaryCacheNormalAligned, true);
+    uint64_t cacheHash = zombie::hashValue<uint64_t>(
+        zombie::computeBoundaryMeshHash<2>(scene.absorbingBoundaryVertices, scene.absorbingBoundarySegments),
+        zombie::computeBoundaryMeshHash<2>(scene.reflectingBoundaryVertices, scene.reflectingBoundarySegments));
+    cacheHash = zombie::hashValue<uint64_t>(scene.dataHash, cacheHash);
+    for (float setting: {epsilonShellForAbsorbingBoundary, epsilonShellForReflectingBoundary,
+                         silhouettePrecision, russianRouletteThreshold, robinCoeffCutoffForNormalDerivative,
+                         normalOffsetForAbsorbingBoundary, normalOffsetForReflectingBoundary}) {
+        cacheHash = zombie::hashValue<float>(setting, cacheHash);
+    }
+    for (int setting: {maxWalkLength, stepsBeforeApplyingTikhonov, stepsBeforeUsingMaximalSpheres,
+                       nWalksForCachedSolutionEstimates, nWalksForCachedGradientEstimates,
+                       absorbingBoundaryCacheSize, reflectingBoundaryCacheSize, domainCacheSize,
+                       sourceImportanceGridRes, domainVoxelGridRes,
+                       nWalksForPilotBoundaryEstimates, pilotBoundaryCacheSize}) {
+        cacheHash = zombie::hashValue<int>(setting, cacheHash);
     }
+    for (bool setting: {solveDoubleSided, disableGradientControlVariates, disableGradientAntitheticVariates,
+                        useCosineSamplingForDirectionalDerivatives, ignoreAbsorbingBoundaryContribution,
+                        ignoreReflectingBoundaryContribution, ignoreSourceContribution,
+                        useFiniteDifferencesForBoundaryDerivatives}) {
+        cacheHash = zombie::hashValue<bool>(setting, cacheHash);
+    }
+
+    bool loadedBoundaryValueCache = !boundaryValueCacheFile.empty() &&
+        zombie::bvc::loadBoundaryValueCache<float, 2>(boundaryValueCacheFile, cacheHash,
+                                                      {&absorbingBoundaryCache, &absorbingBoundaryCacheNormalAligned,
+                                                       &reflectingBoundaryCache, &reflectingBoundaryCacheNormalAligned,
+                                                       &domainCache});
+    if (!loadedBoundaryValueCache) {
+        // optionally distribute boundary samples adaptively, using boundary estimates
+        // computed with a few walks at a pilot set of boundary samples; the pilot samples
+        // only set the importance and are not added to the cache
+        auto adaptBoundarySampler = [&](zombie::UniformLineSegmentBoundarySampler<float>& boundarySampler,
+                                        int nPrimitives, zombie::SampleType sampleType,
+                                        float normalOffsetForBoundary) -> void {
+            if (nWalksForPilotBoundaryEstimates <= 0 || nPrimitives == 0) return;
+
+            std::vector<zombie::SamplePoint<float, 2>> pilotSamplePts, pilotSamplePtsNormalAligned;
+            std::vector<int> primitiveIndices, primitiveIndicesNormalAligned;
+            boundarySampler.generateSamples(boundarySampler.getSampleCount(pilotBoundaryCacheSize, false),
+                                            sampleType, normalOffsetForBoundary, pilotSamplePts,
+                                            primitiveIndices, false);
+            if (solveDoubleSided) {
+                boundarySampler.generateSamples(boundarySampler.getSampleCount(pilotBoundaryCacheSize, true),
+                                                sampleType, normalOffsetForBoundary, pilotSamplePtsNormalAligned,
+                                                primitiveIndicesNormalAligned, true);
+                pilotSamplePts.insert(pilotSamplePts.end(), pilotSamplePtsNormalAligned.begin(),
+                                      pilotSamplePtsNormalAligned.end());
+                primitiveIndices.insert(primitiveIndices.end(), primitiveIndicesNormalAligned.begin(),
+                                        primitiveIndicesNormalAligned.end());
+            }
+
+            boundaryValueCaching.computeBoundaryEstimates(pde, walkSettings, nWalksForPilotBoundaryEstimates,
+                                                          nWalksForPilotBoundaryEstimates, robinCoeffCutoffForNormalDerivative,
+                                                          pilotSamplePts, useFiniteDifferencesForBoundaryDerivatives,
+                                                          runSingleThreaded);
+            boundarySampler.setImportance(zombie::estimateBoundaryImportance<float, 2>(pilotSamplePts, primitiveIndices,
+                                                                                       nPrimitives, (bbox.second - bbox.first).norm(),
+                                                                                       robinCoeffCutoffForNormalDerivative));
+        };
+
+        zombie::UniformLineSegmentBoundarySampler<float> absorbingBoundarySampler(
+            scene.absorbingBoundaryVertices, scene.absorbingBoundarySegments, queries, insideSolveRegionBoundarySampler);
+        absorbingBoundarySampler.initialize(normalOffsetForAbsorbingBoundary, solveDoubleSided);
+        adaptBoundarySampler(absorbingBoundarySampler, scene.absorbingBoundarySegments.size(),
+                             zombie::SampleType::OnAbsorbingBoundary, normalOffsetForAbsorbingBoundary);
+        absorbingBoundarySampler.generateSamples(absorbingBoundarySampler.getSampleCount(absorbingBoundaryCacheSize, false),
+                                                 zombie::SampleType::OnAbsorbingBoundary, normalOffsetForAbsorbingBoundary,
+                                                 absorbingBoundaryCache, false);
+        if (solveDoubleSided) {
+            absorbingBoundarySampler.generateSamples(absorbingBoundarySampler.getSampleCount(absorbingBoundaryCacheSize, true),
+                                                     zombie::SampleType::OnAbsorbingBoundary, normalOffsetForAbsorbingBoundary,
+                                                     absorbingBoundaryCacheNormalAligned, true);
+        }
 
-    zombie::UniformLineSegmentBoundarySampler<float> reflectingBoundarySampler(
-        scene.reflectingBoundaryVertices, scene.reflectingBoundarySegments, queries, insideSolveRegionBoundarySampler);
-    reflectingBoundarySampler.initialize(normalOffsetForReflectingBoundary, solveDoubleSided);
-    reflectingBoundarySampler.generateSamples(reflectingBoundarySampler.getSampleCount(reflectingBoundaryCacheSize, false),
-                                              zombie::SampleType::OnReflectingBoundary, normalOffsetForReflectingBoundary,
-                                              reflectingBoundaryCache, false);
-    if (solveDoubleSided) {
-        reflectingBoundarySampler.generateSamples(reflectingBoundarySampler.getSampleCount(reflectingBoundaryCacheSize, true),
+        zombie::UniformLineSegmentBoundarySampler<float> reflectingBoundarySampler(
+            scene.reflectingBoundaryVertices, scene.reflectingBoundarySegments, queries, insideSolveRegionBoundarySampler);
+        reflectingBoundarySampler.initialize(normalOffsetForReflectingBoundary, solveDoubleSided);
+        adaptBoundarySampler(reflectingBoundarySampler, scene.reflectingBoundarySegments.size(),
+                             zombie::SampleType::OnReflectingBoundary, normalOffsetForReflectingBoundary);
+        reflectingBoundarySampler.generateSamples(reflectingBoundarySampler.getSampleCount(reflectingBoundaryCacheSize, false),
                                                   zombie::SampleType::OnReflectingBoundary, normalOffsetForReflectingBoundary,
-                                                  reflectingBoundaryCacheNormalAligned, true);
-    }
+                                                  reflectingBoundaryCache, false);
+        if (solveDoubleSided) {
+            reflectingBoundarySampler.generateSamples(reflectingBoundarySampler.getSampleCount(reflectingBoundaryCacheSize, true),
+                                                      zombie::SampleType::OnReflectingBoundary, normalOffsetForReflectingBoundary,
+                                                      reflectingBoundaryCacheNormalAligned, true);
+        }
 
-    if (!ignoreSourceContribution) {
-        float regionVolume = solveDoubleSided ? (bbox.second - bbox.first).prod() :
-                                                std::fabs(queries.computeSignedDomainVolume());
-        zombie::UniformDomainSampler<float, 2> domainSampler(queries, insideSolveRegionDomainSampler,
-                                                             bbox.first, bbox.second, regionVolume);
-        domainSampler.generateSamples(domainCacheSize, domainCache);
+        if (!ignoreSourceContribution && sourceImportanceGridRes > 0) {
+            zombie::SourceImportanceDomainSampler<float, 2> domainSampler(queries, insideSolveRegionDomainSampler,
+                                                                          bbox.first, bbox.second, pde.source,
+                                                                          sourceImportanceGridRes);
+            domainSampler.generateSamples(domainCacheSize, domainCache);
+
+        } else if (!ignoreSourceContribution && domainVoxelGridRes > 0 && !solveDoubleSided) {
+            float regionVolume = std::fabs(queries.computeSignedDomainVolume());
+            zombie::VoxelClassifiedDomainSampler<float, 2> domainSampler(queries, insideSolveRegionDomainSampler,
+                                                                         bbox.first, bbox.second, regionVolume,
+                                                                         domainVoxelGridRes);
+            domainSampler.generateSamples(domainCacheSize, domainCache);
+
+        } else if (!ignoreSourceContribution) {
+            float regionVolume = solveDoubleSided ? (bbox.second - bbox.first).prod() :
+                                                    std::fabs(queries.computeSignedDomainVolume());
+            zombie::UniformDomainSampler<float, 2> domainSampler(queries, insideSolveRegionDomainSampler,
+                                                                 bbox.first, bbox.second, regionVolume);
+            domainSampler.generateSamples(domainCacheSize, domainCache);
+        }
     }
 
-    // estimate solution on the boundary and set source values in the interior
+    // estimate solution on the boundary and set source values in the interior, and save them for later runs
     int totalWork = absorbingBoundaryCache.size() +
                     absorbingBoundaryCacheNormalAligned.size() +
                     reflectingBoundaryCache.size() +
@@ -171,57 +302,103 @@ void runBoundaryValueCaching(const Scene& scene, const json& solverConfig, const
     ProgressBar pb(totalWork);
     std::function<void(int, int)> reportProgress = [&pb](int i, int tid) -> void { pb.report(i, tid); };
 
-    zombie::WalkOnStars<float, 2> walkOnStars(queries);
-    zombie::bvc::BoundaryValueCaching<float, 2> boundaryValueCaching(queries, walkOnStars);
-    zombie::WalkSettings walkSettings(epsilonShellForAbsorbingBoundary,
-                                      epsilonShellForReflectingBoundary,
-                                      silhouettePrecision, russianRouletteThreshold,
-                                      maxWalkLength, stepsBeforeApplyingTikhonov,
-                                      stepsBeforeUsingMaximalSpheres, solveDoubleSided,
-                                      !disableGradientControlVariates,
-                                      !disableGradientAntitheticVariates,
-                                      useCosineSamplingForDirectionalDerivatives,
-                                      ignoreAbsorbingBoundaryContribution,
-                                      ignoreReflectingBoundaryContribution,
-                                      ignoreSourceContribution, printLogs);
-    boundaryValueCaching.computeBoundaryEstimates(pde, walkSettings, nWalksForCachedSolutionEstimates,
-                                                  nWalksForCachedGradientEstimates, robinCoeffCutoffForNormalDerivative,
-                                                  absorbingBoundaryCache, useFiniteDifferencesForBoundaryDerivatives,
-                                                  runSingleThreaded, reportProgress);
-    boundaryValueCaching.computeBoundaryEstimates(pde, walkSettings, nWalksForCachedSolutionEstimates,
-                                                  nWalksForCachedGradientEstimates, robinCoeffCutoffForNormalDerivative,
-                                                  absorbingBoundaryCacheNormalAligned, useFiniteDifferencesForBoundaryDerivatives,
-                                                  runSingleThreaded, reportProgress);
-    boundaryValueCaching.computeBoundaryEstimates(pde, walkSettings, nWalksForCachedSolutionEstimates,
-                                                  nWalksForCachedGradientEstimates, robinCoeffCutoffForNormalDerivative,
-                                                  reflectingBoundaryCache, useFiniteDifferencesForBoundaryDerivatives,
-                                                  runSingleThreaded, reportProgress);
-    boundaryValueCaching.computeBoundaryEstimates(pde, walkSettings, nWalksForCachedSolutionEstimates,
-                                                  nWalksForCachedGradientEstimates, robinCoeffCutoffForNormalDerivative,
-                                                  reflectingBoundaryCacheNormalAligned, useFiniteDifferencesForBoundaryDerivatives,
-                                                  runSingleThreaded, reportProgress);
-    boundaryValueCaching.setSourceValues(pde, domainCache, runSingleThreaded);
+    if (!loadedBoundaryValueCache) {
+        boundaryValueCaching.computeBoundaryEstimates(pde, walkSettings, nWalksForCachedSolutionEstimates,
+                                                      nWalksForCachedGradientEstimates, robinCoeffCutoffForNormalDerivative,
+                                                      absorbingBoundaryCache, useFiniteDifferencesForBoundaryDerivatives,
+                                                      runSingleThreaded, reportProgress);
+        boundaryValueCaching.computeBoundaryEstimates(pde, walkSettings, nWalksForCachedSolutionEstimates,
+                                                      nWalksForCachedGradientEstimates, robinCoeffCutoffForNormalDerivative,
+                                                      absorbingBoundaryCacheNormalAligned, useFiniteDifferencesForBoundaryDerivatives,
+                                                      runSingleThreaded, reportProgress);
+        boundaryValueCaching.computeBoundaryEstimates(pde, walkSettings, nWalksForCachedSolutionEstimates,
+                                                      nWalksForCachedGradientEstimates, robinCoeffCutoffForNormalDerivative,
+                                                      reflectingBoundaryCache, useFiniteDifferencesForBoundaryDerivatives,
+                                                      runSingleThreaded, reportProgress);
+        boundaryValueCaching.computeBoundaryEstimates(pde, walkSettings, nWalksForCachedSolutionEstimates,
+                                                      nWalksForCachedGradientEstimates, robinCoeffCutoffForNormalDerivative,
+                                                      reflectingBoundaryCacheNormalAligned, useFiniteDifferencesForBoundaryDerivatives,
+                                                      runSingleThreaded, reportProgress);
+        boundaryValueCaching.setSourceValues(pde, domainCache, runSingleThreaded);
+
+        if (!boundaryValueCacheFile.empty() &&
+            !zombie::bvc::saveBoundaryValueCache<float, 2>(boundaryValueCacheFile, cacheHash,
+                                                           {&absorbingBoundaryCache, &absorbingBoundaryCacheNormalAligned,
+                                                            &reflectingBoundaryCache, &reflectingBoundaryCacheNormalAligned,
+                                                            &domainCache})) {
+            std::cerr << "Failed to save boundary value cache to " << boundaryValueCacheFile << std::endl;
+        }
+    }
 
     // splat solution to evaluation points
-    boundaryValueCaching.splat(pde, absorbingBoundaryCache, radiusClampForKernels, regularizationForKernels,
-                               robinCoeffCutoffForNormalDerivative, normalOffsetForAbsorbingBoundary,
-                               normalOffsetForReflectingBoundary, evalPts, reportProgress);
-    boundaryValueCaching.splat(pde, absorbingBoundaryCacheNormalAligned, radiusClampForKernels, regularizationForKernels,
-                               robinCoeffCutoffForNormalDerivative, normalOffsetForAbsorbingBoundary,
-                               normalOffsetForReflectingBoundary, evalPts, reportProgress);
-    boundaryValueCaching.splat(pde, reflectingBoundaryCache, radiusClampForKernels, regularizationForKernels,
-                               robinCoeffCutoffForNormalDerivative, normalOffsetForAbsorbingBoundary,
-                               normalOffsetForReflectingBoundary, evalPts, reportProgress);
-    boundaryValueCaching.splat(pde, reflectingBoundaryCacheNormalAligned, radiusClampForKernels, regularizationForKernels,
-                               robinCoeffCutoffForNormalDerivative, normalOffsetForAbsorbingBoundary,
-                               normalOffsetForReflectingBoundary, evalPts, reportProgress);
-    boundaryValueCaching.splat(pde, domainCache, radiusClampForKernels, regularizationForKernels,
-                               robinCoeffCutoffForNormalDerivative, normalOffsetForAbsorbingBoundary,
-                               normalOffsetForReflectingBoundary, evalPts, reportProgress);
-    boundaryValueCaching.estimateSolutionNearBoundary(pde, walkSettings, true, normalOffsetForAbsorbingBoundary,
-                                                      nWalksForCachedSolutionEstimates, evalPts, runSingleThreaded);
-    boundaryValueCaching.estimateSolutionNearBoundary(pde, walkSettings, false, normalOffsetForReflectingBoundary,
-                                                      nWalksForCachedSolutionEstimates, evalPts, runSingleThreaded);
+    if (splatTreeOpeningAngle > 0.0f) {
+        std::vector<zombie::SamplePoint<float, 2>> samplePts;
+        samplePts.insert(samplePts.end(), absorbingBoundaryCache.begin(), absorbingBoundaryCache.end());
+        samplePts.insert(samplePts.end(), absorbingBoundaryCacheNormalAligned.begin(), absorbingBoundaryCacheNormalAligned.end());
+        samplePts.insert(samplePts.end(), reflectingBoundaryCache.begin(), reflectingBoundaryCache.end());
+        samplePts.insert(samplePts.end(), reflectingBoundaryCacheNormalAligned.begin(), reflectingBoundaryCacheNormalAligned.end());
+        samplePts.insert(samplePts.end(), domainCache.begin(), domainCache.end());
+
+        zombie::bvc::SplatTree<float, 2> splatTree;
+        splatTree.build(samplePts, robinCoeffCutoffForNormalDerivative, printLogs);
+        boundaryValueCaching.splat(pde, splatTree, splatTreeOpeningAngle, radiusClampForKernels,
+                                   regularizationForKernels, normalOffsetForAbsorbingBoundary,
+                                   normalOffsetForReflectingBoundary, evalPts, runSingleThreaded);
+        pb.report(samplePts.size(), 0);
+
+    } else {
+        boundaryValueCaching.splat(pde, absorbingBoundaryCache, radiusClampForKernels, regularizationForKernels,
+                                   robinCoeffCutoffForNormalDerivative, normalOffsetForAbsorbingBoundary,
+                                   normalOffsetForReflectingBoundary, evalPts, reportProgress);
+        boundaryValueCaching.splat(pde, absorbingBoundaryCacheNormalAligned, radiusClampForKernels, regularizationForKernels,
+                                   robinCoeffCutoffForNormalDerivative, normalOffsetForAbsorbingBoundary,
+                                   normalOffsetForReflectingBoundary, evalPts, reportProgress);
+        boundaryValueCaching.splat(pde, reflectingBoundaryCache, radiusClampForKernels, regularizationForKernels,
+                                   robinCoeffCutoffForNormalDerivative, normalOffsetForAbsorbingBoundary,
+                                   normalOffsetForReflectingBoundary, evalPts, reportProgress);
+        boundaryValueCaching.splat(pde, reflectingBoundaryCacheNormalAligned, radiusClampForKernels, regularizationForKernels,
+                                   robinCoeffCutoffForNormalDerivative, normalOffsetForAbsorbingBoundary,
+                                   normalOffsetForReflectingBoundary, evalPts, reportProgress);
+        boundaryValueCaching.splat(pde, domainCache, radiusClampForKernels, regularizationForKernels,
+                                   robinCoeffCutoffForNormalDerivative, normalOffsetForAbsorbingBoundary,
+                                   normalOffsetForReflectingBoundary, evalPts, reportProgress);
+    }
+
+    // estimate solution near the boundary, either by interpolating the boundary caches
+    // or by running walks from each evaluation point
+    if (nNearestCachedSamplesNearBoundary > 0) {
+        float maxDistToCachedSample = maxDistToCachedSampleNearBoundary > 0.0f ?
+                                      maxDistToCachedSampleNearBoundary : (bbox.second - bbox.first).norm()/64.0f;
+        std::vector<zombie::SamplePoint<float, 2>> absorbingBoundaryCaches = absorbingBoundaryCache;
+        absorbingBoundaryCaches.insert(absorbingBoundaryCaches.end(), absorbingBoundaryCacheNormalAligned.begin(),
+                                       absorbingBoundaryCacheNormalAligned.end());
+        std::vector<zombie::SamplePoint<float, 2>> reflectingBoundaryCaches = reflectingBoundaryCache;
+        reflectingBoundaryCaches.insert(reflectingBoundaryCaches.end(), reflectingBoundaryCacheNormalAligned.begin(),
+                                        reflectingBoundaryCacheNormalAligned.end());
+
+        std::vector<Vector2> cachedPositions;
+        zombie::NearestNeighborFinder<2> absorbingBoundaryCacheFinder, reflectingBoundaryCacheFinder;
+        for (const zombie::SamplePoint<float, 2>& samplePt: absorbingBoundaryCaches) cachedPositions.emplace_back(samplePt.pt);
+        absorbingBoundaryCacheFinder.buildAccelerationStructure(cachedPositions);
+        cachedPositions.clear();
+        for (const zombie::SamplePoint<float, 2>& samplePt: reflectingBoundaryCaches) cachedPositions.emplace_back(samplePt.pt);
+        reflectingBoundaryCacheFinder.buildAccelerationStructure(cachedPositions);
+
+        boundaryValueCaching.estimateSolutionNearBoundary(pde, walkSettings, true, normalOffsetForAbsorbingBoundary,
+                                                          nWalksForSparseCacheNearBoundary, absorbingBoundaryCaches,
+                                                          absorbingBoundaryCacheFinder, nNearestCachedSamplesNearBoundary,
+                                                          maxDistToCachedSample, evalPts, runSingleThreaded);
+        boundaryValueCaching.estimateSolutionNearBoundary(pde, walkSettings, false, normalOffsetForReflectingBoundary,
+                                                          nWalksForSparseCacheNearBoundary, reflectingBoundaryCaches,
+                                                          reflectingBoundaryCacheFinder, nNearestCachedSamplesNearBoundary,
+                                                          maxDistToCachedSample, evalPts, runSingleThreaded);
+
+    } else {
+        boundaryValueCaching.estimateSolutionNearBoundary(pde, walkSettings, true, normalOffsetForAbsorbingBoundary,
+                                                          nWalksForCachedSolutionEstimates, evalPts, runSingleThreaded);
+        boundaryValueCaching.estimateSolutionNearBoundary(pde, walkSettings, false, normalOffsetForReflectingBoundary,
+                                                          nWalksForCachedSolutionEstimates, evalPts, runSingleThreaded);
+    }
     pb.finish();
 
     // save to file
@@ -251,10 +428,25 @@ void runReverseWalkSplatter(const Scene& scene, const json& solverConfig, const
     const int absorbingBoundarySampleCount = getOptional<int>(solverConfig, "absorbingBoundarySampleCount", 1024);
     const int reflectingBoundarySampleCount = getOptional<int>(solverConfig, "reflectingBoundarySampleCount", 1024);
     const int domainSampleCount = getOptional<int>(solverConfig, "domainSampleCount", 1024);
+    const int sourceImportanceGridRes = getOptional<int>(solverConfig, "sourceImportanceGridRes", 0);
+    const int domainVoxelGridRes = getOptional<int>(solverConfig, "domainVoxelGridRes", 0);
 
     const float normalOffsetForAbsorbingBoundary = getOptional<float>(solverConfig, "normalOffsetForAbsorbingBoundary", 5.0f*epsilonShellForAbsorbingBoundary);
     const float radiusClampForKernels = getOptional<float>(solverConfig, "radiusClampForKernels", 0.0f);
     const float regularizationForKernels = getOptional<float>(solverConfig, "regularizationForKernels", 0.0f);
+    const bool useAtomicSplatting = getOptional<bool>(solverConfig, "useAtomicSplatting", false);
+    const std::string splatVisibilityMode = getOptional<std::string>(solverConfig, "splatVisibilityMode", "traceRays");
+    const float starRadiusShrinkFactorForVisibility = getOptional<float>(solverConfig, "starRadiusShrinkFactorForVisibility", 0.95f);
+    const float visibilityValidationProbability = getOptional<float>(solverConfig, "visibilityValidationProbability", 0.0f);
+
+    // load config settings for combining reverse walk splatting with forward walk-on-stars
+    const int nWalksForForwardEstimates = getOptional<int>(solverConfig, "nWalksForForwardEstimates", 0);
+    const int nBatchesForReverseEstimates = getOptional<int>(solverConfig, "nBatchesForReverseEstimates", 16);
+    const bool fixBidirectionalWeightsWithPilot = getOptional<bool>(solverConfig, "fixBidirectionalWeightsWithPilot", true);
+    if (nWalksForForwardEstimates > 0 && nBatchesForReverseEstimates < 2) {
+        std::cerr << "nBatchesForReverseEstimates must be at least 2 to weight the reverse estimates" << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
     const std::pair<Vector2, Vector2>& bbox = scene.bbox;
     const zombie::GeometricQueries<2>& queries = scene.queries;
@@ -269,8 +461,12 @@ void runReverseWalkSplatter(const Scene& scene, const json& solverConfig, const
         return solveDoubleSided ? !queries.outsideBoundingDomain(x) : queries.insideDomain(x, true);
     };
 
-    std::vector<zombie::rws::EvaluationPoint<float, 2>> evalPts;
-    createEvaluationGrid<zombie::rws::EvaluationPoint<float, 2>>(evalPts, queries, bbox.first, bbox.second, gridRes);
+    zombie::rws::EvaluationPoints<float, 2> evalPts(useAtomicSplatting ? zombie::rws::AccumulationMode::Atomic :
+                                                                         zombie::rws::AccumulationMode::ThreadLocal);
+    createEvaluationGrid<zombie::rws::EvaluationPoints<float, 2>>(evalPts, queries, bbox.first, bbox.second, gridRes);
+    for (int i = 0; i < evalPts.size(); i++) {
+        evalPts.insideSolveRegion[i] = insideSolveRegionDomainSampler(evalPts.pt[i]) ? 1 : 0;
+    }
 
     // generate boundary and domain samples
     std::vector<zombie::SamplePoint<float, 2>> absorbingBoundarySamplePts;
@@ -279,68 +475,106 @@ void runReverseWalkSplatter(const Scene& scene, const json& solverConfig, const
     std::vector<zombie::SamplePoint<float, 2>> reflectingBoundaryNormalAlignedSamplePts;
     std::vector<zombie::SamplePoint<float, 2>> domainSamplePts;
 
-    if (!ignoreAbsorbingBoundaryContribution) {
-        zombie::UniformLineSegmentBoundarySampler<float> absorbingBoundarySampler(
-            scene.absorbingBoundaryVertices, scene.absorbingBoundarySegments, queries, insideSolveRegionBoundarySampler);
-        absorbingBoundarySampler.initialize(normalOffsetForAbsorbingBoundary, solveDoubleSided);
-        absorbingBoundarySampler.generateSamples(absorbingBoundarySampler.getSampleCount(absorbingBoundarySampleCount, false),
-                                                 zombie::SampleType::OnAbsorbingBoundary, normalOffsetForAbsorbingBoundary,
-                                                 absorbingBoundarySamplePts, false);
-        if (solveDoubleSided) {
-            absorbingBoundarySampler.generateSamples(absorbingBoundarySampler.getSampleCount(absorbingBoundarySampleCount, true),
+    // samplers are seeded on construction, so each call draws an independent set of sample points
+    auto generateSamplePts = [&]() -> void {
+        if (!ignoreAbsorbingBoundaryContribution) {
+            zombie::UniformLineSegmentBoundarySampler<float> absorbingBoundarySampler(
+                scene.absorbingBoundaryVertices, scene.absorbingBoundarySegments, queries, insideSolveRegionBoundarySampler);
+            absorbingBoundarySampler.initialize(normalOffsetForAbsorbingBoundary, solveDoubleSided);
+            absorbingBoundarySampler.generateSamples(absorbingBoundarySampler.getSampleCount(absorbingBoundarySampleCount, false),
                                                      zombie::SampleType::OnAbsorbingBoundary, normalOffsetForAbsorbingBoundary,
-                                                     absorbingBoundaryNormalAlignedSamplePts, true);
+                                                     absorbingBoundarySamplePts, false);
+            if (solveDoubleSided) {
+                absorbingBoundarySampler.generateSamples(absorbingBoundarySampler.getSampleCount(absorbingBoundarySampleCount, true),
+                                                         zombie::SampleType::OnAbsorbingBoundary, normalOffsetForAbsorbingBoundary,
+                                                         absorbingBoundaryNormalAlignedSamplePts, true);
+            }
         }
-    }
 
-    if (!ignoreReflectingBoundaryContribution) {
-        zombie::UniformLineSegmentBoundarySampler<float> reflectingBoundarySampler(
-            scene.reflectingBoundaryVertices, scene.reflectingBoundarySegments, queries, insideSolveRegionBoundarySampler);
-        reflectingBoundarySampler.initialize(0.0f, solveDoubleSided);
-        reflectingBoundarySampler.generateSamples(reflectingBoundarySampler.getSampleCount(reflectingBoundarySampleCount, false),
-                                                  zombie::SampleType::OnReflectingBoundary, 0.0f,
-                                                  reflectingBoundarySamplePts, false);
-        if (solveDoubleSided) {
-            reflectingBoundarySampler.generateSamples(reflectingBoundarySampler.getSampleCount(reflectingBoundarySampleCount, true),
+        if (!ignoreReflectingBoundaryContribution) {
+            zombie::UniformLineSegmentBoundarySampler<float> reflectingBoundarySampler(
+                scene.reflectingBoundaryVertices, scene.reflectingBoundarySegments, queries, insideSolveRegionBoundarySampler);
+            reflectingBoundarySampler.initialize(0.0f, solveDoubleSided);
+            reflectingBoundarySampler.generateSamples(reflectingBoundarySampler.getSampleCount(reflectingBoundarySampleCount, false),
                                                       zombie::SampleType::OnReflectingBoundary, 0.0f,
-                                                      reflectingBoundaryNormalAlignedSamplePts, true);
+                                                      reflectingBoundarySamplePts, false);
+            if (solveDoubleSided) {
+                reflectingBoundarySampler.generateSamples(reflectingBoundarySampler.getSampleCount(reflectingBoundarySampleCount, true),
+                                                          zombie::SampleType::OnReflectingBoundary, 0.0f,
+                                                          reflectingBoundaryNormalAlignedSamplePts, true);
+            }
         }
-    }
 
-    if (!ignoreSourceContribution) {
-        float regionVolume = solveDoubleSided ? (bbox.second - bbox.first).prod() :
-                                                std::fabs(queries.computeSignedDomainVolume());
-        zombie::UniformDomainSampler<float, 2> domainSampler(queries, insideSolveRegionDomainSampler,
-                                                             bbox.first, bbox.second, regionVolume);
-        domainSampler.generateSamples(domainSampleCount, domainSamplePts);
-    }
+        if (!ignoreSourceContribution && sourceImportanceGridRes > 0) {
+            zombie::SourceImportanceDomainSampler<float, 2> domainSampler(queries, insideSolveRegionDomainSampler,
+                                                                          bbox.first, bbox.second, pde.source,
+                                                                          sourceImportanceGridRes);
+            domainSampler.generateSamples(domainSampleCount, domainSamplePts);
+
+        } else if (!ignoreSourceContribution && domainVoxelGridRes > 0 && !solveDoubleSided) {
+            float regionVolume = std::fabs(queries.computeSignedDomainVolume());
+            zombie::VoxelClassifiedDomainSampler<float, 2> domainSampler(queries, insideSolveRegionDomainSampler,
+                                                                         bbox.first, bbox.second, regionVolume,
+                                                                         domainVoxelGridRes);
+            domainSampler.generateSamples(domainSampleCount, domainSamplePts);
+
+        } else if (!ignoreSourceContribution) {
+            float regionVolume = solveDoubleSided ? (bbox.second - bbox.first).prod() :
+                                                    std::fabs(queries.computeSignedDomainVolume());
+            zombie::UniformDomainSampler<float, 2> domainSampler(queries, insideSolveRegionDomainSampler,
+                                                                 bbox.first, bbox.second, regionVolume);
+            domainSampler.generateSamples(domainSampleCount, domainSamplePts);
+        }
+    };
+
+    generateSamplePts();
 
     // initialize nearest neigbhbor finder for evaluation points and assign
     // solution value to evaluation points on the absorbing boundary
-    std::vector<Vector2> evalPtPositions;
-    for (auto& evalPt: evalPts) {
-        evalPtPositions.push_back(evalPt.pt);
-
-        if (evalPt.type == zombie::SampleType::OnAbsorbingBoundary) {
-            evalPt.totalAbsorbingBoundaryContribution = pde.dirichlet(evalPt.pt, false);
+    std::vector<Vector2> evalPtPositions = evalPts.pt;
+    for (int i = 0; i < evalPts.size(); i++) {
+        if (evalPts.type[i] == zombie::SampleType::OnAbsorbingBoundary) {
+            evalPts.totalAbsorbingBoundaryContribution[i] = pde.dirichlet(evalPts.pt[i], false);
         }
     }
-    zombie::NearestNeighborFinder<2> nearestNeighborFinder;
+    zombie::GridNeighborFinder<2> nearestNeighborFinder;
     nearestNeighborFinder.buildAccelerationStructure(evalPtPositions);
 
+    // setup visibility checks for splatting; the star-shaped guarantee only implies visibility
+    // for single-sided problems, where evaluation points outside the domain are never splatted to
+    zombie::rws::VisibilityMode visibilityMode = zombie::rws::VisibilityMode::TraceRays;
+    if (splatVisibilityMode == "skipNearbyRays" ||
+        (splatVisibilityMode == "trustStarShapedRegion" && solveDoubleSided)) {
+        visibilityMode = zombie::rws::VisibilityMode::SkipNearbyRays;
+
+    } else if (splatVisibilityMode == "trustStarShapedRegion") {
+        visibilityMode = zombie::rws::VisibilityMode::TrustStarShapedRegion;
+
+    } else if (splatVisibilityMode != "traceRays") {
+        std::cerr << "Unknown splat visibility mode: " << splatVisibilityMode << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    zombie::rws::VisibilityStatistics visibilityStatistics;
+    zombie::rws::VisibilitySettings visibilitySettings(visibilityMode, starRadiusShrinkFactorForVisibility,
+                                                       visibilityValidationProbability, &visibilityStatistics);
+
     // bind splat contribution callback
     zombie::SplatContributionCallback<float, 2> splatContribution =
-        std::bind(&zombie::rws::splatContribution<float, 2, zombie::NearestNeighborFinder<2>>,
+        std::bind(&zombie::rws::splatContribution<float, 2, zombie::GridNeighborFinder<2>>,
         std::placeholders::_1, std::placeholders::_2, std::cref(queries),
         std::cref(nearestNeighborFinder), std::cref(pde), normalOffsetForAbsorbingBoundary,
-        radiusClampForKernels, regularizationForKernels, std::ref(evalPts));
+        radiusClampForKernels, regularizationForKernels, std::ref(evalPts), std::cref(visibilitySettings));
+    zombie::MergeContributionsCallback mergeContributions = [&evalPts]() -> void { evalPts.mergeContributions(); };
 
     // estimate solution at evaluation points
     int totalWork = absorbingBoundarySamplePts.size() +
                     absorbingBoundaryNormalAlignedSamplePts.size() +
                     reflectingBoundarySamplePts.size() +
                     reflectingBoundaryNormalAlignedSamplePts.size() +
-                    domainSamplePts.size();
+                    domainSamplePts.size() +
+                    (nWalksForForwardEstimates > 0 ? evalPts.size() : 0);
+    if (nWalksForForwardEstimates > 0 && fixBidirectionalWeightsWithPilot) totalWork *= 2;
     ProgressBar pb(totalWork);
     std::function<void(int, int)> reportProgress = [&pb](int i, int tid) -> void { pb.report(i, tid); };
 
@@ -353,18 +587,67 @@ void runReverseWalkSplatter(const Scene& scene, const json& solverConfig, const
                                       ignoreAbsorbingBoundaryContribution,
                                       ignoreReflectingBoundaryContribution,
                                       ignoreSourceContribution, printLogs);
-    zombie::ReverseWalkOnStars<float, 2> reverseWalkOnStars(queries, splatContribution);
-    reverseWalkOnStars.solve(pde, walkSettings, absorbingBoundarySamplePts, runSingleThreaded, reportProgress);
-    reverseWalkOnStars.solve(pde, walkSettings, absorbingBoundaryNormalAlignedSamplePts, runSingleThreaded, reportProgress);
-    reverseWalkOnStars.solve(pde, walkSettings, reflectingBoundarySamplePts, runSingleThreaded, reportProgress);
-    reverseWalkOnStars.solve(pde, walkSettings, reflectingBoundaryNormalAlignedSamplePts, runSingleThreaded, reportProgress);
-    reverseWalkOnStars.solve(pde, walkSettings, domainSamplePts, runSingleThreaded, reportProgress);
+    std::vector<zombie::SamplePoint<float, 2>> forwardSamplePts;
+    std::vector<float> combinedSolution;
+    if (nWalksForForwardEstimates > 0) {
+        // estimate the solution at the evaluation points with forward walks as well, and
+        // blend both estimates with inverse variance weights; the weights are optionally
+        // fixed by a pilot pass with its own sample points, so that they are independent
+        // of the estimates they blend
+        createSolutionGrid(forwardSamplePts, queries, bbox.first, bbox.second, gridRes);
+        std::vector<zombie::SampleEstimationData<2>> sampleEstimationData(forwardSamplePts.size());
+        for (int i = 0; i < forwardSamplePts.size(); i++) {
+            sampleEstimationData[i].nWalks = nWalksForForwardEstimates;
+            sampleEstimationData[i].estimationQuantity = solveDoubleSided || queries.insideDomain(forwardSamplePts[i].pt, true) ?
+                                                         zombie::EstimationQuantity::Solution:
+                                                         zombie::EstimationQuantity::None;
+        }
+
+        zombie::BidirectionalWalkOnStars<float, 2> bidirectionalWalkOnStars(queries, splatContribution, mergeContributions);
+        int nPasses = fixBidirectionalWeightsWithPilot ? 2 : 1;
+        for (int pass = 0; pass < nPasses; pass++) {
+            if (pass > 0) {
+                bidirectionalWalkOnStars.fixWeights(evalPts, forwardSamplePts);
+                bidirectionalWalkOnStars.reset();
+                for (auto& samplePt: forwardSamplePts) samplePt.reset();
+                generateSamplePts();
+            }
+
+            bidirectionalWalkOnStars.solveForward(pde, walkSettings, sampleEstimationData, forwardSamplePts,
+                                                  runSingleThreaded, reportProgress);
+            bidirectionalWalkOnStars.solveReverse(pde, walkSettings, absorbingBoundarySamplePts,
+                                                  absorbingBoundaryNormalAlignedSamplePts, reflectingBoundarySamplePts,
+                                                  reflectingBoundaryNormalAlignedSamplePts, domainSamplePts,
+                                                  nBatchesForReverseEstimates, evalPts, runSingleThreaded, reportProgress);
+        }
+        bidirectionalWalkOnStars.combine(evalPts, forwardSamplePts, combinedSolution);
+
+    } else {
+        zombie::ReverseWalkOnStars<float, 2> reverseWalkOnStars(queries, splatContribution, mergeContributions);
+        reverseWalkOnStars.solve(pde, walkSettings, absorbingBoundarySamplePts, runSingleThreaded, reportProgress);
+        reverseWalkOnStars.solve(pde, walkSettings, absorbingBoundaryNormalAlignedSamplePts, runSingleThreaded, reportProgress);
+        reverseWalkOnStars.solve(pde, walkSettings, reflectingBoundarySamplePts, runSingleThreaded, reportProgress);
+        reverseWalkOnStars.solve(pde, walkSettings, reflectingBoundaryNormalAlignedSamplePts, runSingleThreaded, reportProgress);
+        reverseWalkOnStars.solve(pde, walkSettings, domainSamplePts, runSingleThreaded, reportProgress);
+    }
     pb.finish();
 
+    if (visibilityValidationProbability > 0.0f) {
+        std::cout << "Skipped " << visibilityStatistics.nSkippedRays << " of "
+                  << visibilityStatistics.nVisibilityChecks << " visibility rays, "
+                  << visibilityStatistics.nFailedValidations << " of "
+                  << visibilityStatistics.nValidatedRays << " validated rays were occluded." << std::endl;
+    }
+
     // save to file
-    saveEvaluationGrid(evalPts, absorbingBoundarySamplePts.size(), absorbingBoundaryNormalAlignedSamplePts.size(),
-                       reflectingBoundarySamplePts.size(), reflectingBoundaryNormalAlignedSamplePts.size(),
-                       domainSamplePts.size(), pde, queries, solveDoubleSided, outputConfig);
+    if (nWalksForForwardEstimates > 0) {
+        saveSolutionGrid(combinedSolution, forwardSamplePts, pde, queries, solveDoubleSided, outputConfig);
+
+    } else {
+        saveEvaluationGrid(evalPts, absorbingBoundarySamplePts.size(), absorbingBoundaryNormalAlignedSamplePts.size(),
+                           reflectingBoundarySamplePts.size(), reflectingBoundaryNormalAlignedSamplePts.size(),
+                           domainSamplePts.size(), pde, queries, solveDoubleSided, outputConfig);
+    }
 };
 
 int main(int argc, const char *argv[])
@@ -396,6 +679,9 @@ int main(int argc, const char *argv[])
     } else if (solverType == "rws") {
         runReverseWalkSplatter(scene, solverConfig, outputConfig);
 
+    } else if (solverType == "check") {
+        runSelfChecks(scene, solverConfig);
+
     } else {
         std::cerr << "Unknown solver type: " << solverType << std::endl;
         return EXIT_FAILURE;
@@ -56,7 +56,8 @@ void createSolutionGrid(std::vector<zombie::SamplePoint<float, 2>>& samplePts,
     }
 }
 
-void saveSolutionGrid(const std::vector<zombie::SamplePoint<float, 2>>& samplePts,
+void saveSolutionGrid(const std::vector<float>& values,
+                      const std::vector<zombie::SamplePoint<float, 2>>& samplePts,
                       const zombie::PDE<float, 2>& pde,
                       const zombie::GeometricQueries<2>& queries,
                       const bool isDoubleSided, const json& config)
@@ -92,7 +93,7 @@ void saveSolutionGrid(const std::vector<zombie::SamplePoint<float, 2>>& samplePt
             boundaryData->get(j, i) = Array3(dirichletVal, robinVal, sourceVal);
 
             // solution data
-            float value = samplePts[idx].statistics ? samplePts[idx].statistics->getEstimatedSolution(): 0.0f;
+            float value = values[idx];
             bool maskOutValue = (!inDomain && !isDoubleSided) || std::min(std::abs(distToAbsorbingBoundary),
                                                                           std::abs(distToReflectingBoundary))
                                                                           < boundaryDistanceMask;
@@ -105,14 +106,29 @@ void saveSolutionGrid(const std::vector<zombie::SamplePoint<float, 2>>& samplePt
                   saveColormapped, colormap, colormapMinVal, colormapMaxVal);
 }
 
-template <typename EvaluationPointType>
-void createEvaluationGrid(std::vector<EvaluationPointType>& evalPts,
+void saveSolutionGrid(const std::vector<zombie::SamplePoint<float, 2>>& samplePts,
+                      const zombie::PDE<float, 2>& pde,
+                      const zombie::GeometricQueries<2>& queries,
+                      const bool isDoubleSided, const json& config)
+{
+    // extract the estimated solution at each sample point
+    std::vector<float> values(samplePts.size(), 0.0f);
+    for (int i = 0; i < (int)samplePts.size(); i++) {
+        if (samplePts[i].statistics) values[i] = samplePts[i].statistics->getEstimatedSolution();
+    }
+
+    saveSolutionGrid(values, samplePts, pde, queries, isDoubleSided, config);
+}
+
+template <typename EvaluationPointsType>
+void createEvaluationGrid(EvaluationPointsType& evalPts,
                           const zombie::GeometricQueries<2>& queries,
                           const Vector2& bMin, const Vector2& bMax,
                           const int gridRes)
 {
     // create a grid of evaluation points
     Vector2 extent = bMax - bMin;
+    evalPts.reserve(gridRes*gridRes);
     for (int i = 0; i < gridRes; i++) {
         for (int j = 0; j < gridRes; j++) {
             Vector2 pt((i/float(gridRes))*extent.x() + bMin.x(),
@@ -120,15 +136,13 @@ void createEvaluationGrid(std::vector<EvaluationPointType>& evalPts,
             float distToAbsorbingBoundary = queries.computeDistToAbsorbingBoundary(pt, false);
             float distToReflectingBoundary = queries.computeDistToReflectingBoundary(pt, false);
 
-            evalPts.emplace_back(EvaluationPointType(pt, Vector2::Zero(),
-                                                     zombie::SampleType::InDomain,
-                                                     distToAbsorbingBoundary,
-                                                     distToReflectingBoundary));
+            evalPts.add(pt, Vector2::Zero(), zombie::SampleType::InDomain,
+                        distToAbsorbingBoundary, distToReflectingBoundary);
         }
     }
 }
 
-void saveEvaluationGrid(const std::vector<zombie::bvc::EvaluationPoint<float, 2>>& evalPts,
+void saveEvaluationGrid(const zombie::bvc::EvaluationPoints<float, 2>& evalPts,
                         const zombie::PDE<float, 2>& pde,
                         const zombie::GeometricQueries<2>& queries,
                         const bool isDoubleSided, const json& config)
@@ -153,18 +167,18 @@ void saveEvaluationGrid(const std::vector<zombie::bvc::EvaluationPoint<float, 2>
             int idx = i*gridRes + j;
 
             // scene data
-            float inDomain = queries.insideDomain(evalPts[idx].pt, true) ? 1 : 0;
-            float distToAbsorbingBoundary = evalPts[idx].distToAbsorbingBoundary;
-            float distToReflectingBoundary = evalPts[idx].distToReflectingBoundary;
+            float inDomain = queries.insideDomain(evalPts.pt[idx], true) ? 1 : 0;
+            float distToAbsorbingBoundary = evalPts.distToAbsorbingBoundary[idx];
+            float distToReflectingBoundary = evalPts.distToReflectingBoundary[idx];
             boundaryDistance->get(j, i) = Array3(distToAbsorbingBoundary, distToReflectingBoundary, inDomain);
 
-            float dirichletVal = pde.dirichlet(evalPts[idx].pt, false);
-            float robinVal = pde.robin(evalPts[idx].pt, false);
-            float sourceVal = pde.source(evalPts[idx].pt);
+            float dirichletVal = pde.dirichlet(evalPts.pt[idx], false);
+            float robinVal = pde.robin(evalPts.pt[idx], false);
+            float sourceVal = pde.source(evalPts.pt[idx]);
             boundaryData->get(j, i) = Array3(dirichletVal, robinVal, sourceVal);
 
             // solution data
-            float value = evalPts[idx].getEstimatedSolution();
+            float value = evalPts.getEstimatedSolution(idx);
             bool maskOutValue = (!inDomain && !isDoubleSided) || std::min(std::abs(distToAbsorbingBoundary),
                                                                           std::abs(distToReflectingBoundary))
                                                                           < boundaryDistanceMask;
@@ -177,7 +191,7 @@ void saveEvaluationGrid(const std::vector<zombie::bvc::EvaluationPoint<float, 2>
                   saveColormapped, colormap, colormapMinVal, colormapMaxVal);
 }
 
-void saveEvaluationGrid(const std::vector<zombie::rws::EvaluationPoint<float, 2>>& evalPts,
+void saveEvaluationGrid(const zombie::rws::EvaluationPoints<float, 2>& evalPts,
                         int nAbsorbingBoundarySamples, int nAbsorbingBoundaryNormalAlignedSamples,
                         int nReflectingBoundarySamples, int nReflectingBoundaryNormalAlignedSamples,
                         int nSourceSamples, const zombie::PDE<float, 2>& pde,
@@ -204,22 +218,22 @@ void saveEvaluationGrid(const std::vector<zombie::rws::EvaluationPoint<float, 2>
             int idx = i*gridRes + j;
 
             // scene data
-            float inDomain = queries.insideDomain(evalPts[idx].pt, true) ? 1 : 0;
-            float distToAbsorbingBoundary = evalPts[idx].distToAbsorbingBoundary;
-            float distToReflectingBoundary = evalPts[idx].distToReflectingBoundary;
+            float inDomain = queries.insideDomain(evalPts.pt[idx], true) ? 1 : 0;
+            float distToAbsorbingBoundary = evalPts.distToAbsorbingBoundary[idx];
+            float distToReflectingBoundary = evalPts.distToReflectingBoundary[idx];
             boundaryDistance->get(j, i) = Array3(distToAbsorbingBoundary, distToReflectingBoundary, inDomain);
 
-            float dirichletVal = pde.dirichlet(evalPts[idx].pt, false);
-            float robinVal = pde.robin(evalPts[idx].pt, false);
-            float sourceVal = pde.source(evalPts[idx].pt);
+            float dirichletVal = pde.dirichlet(evalPts.pt[idx], false);
+            float robinVal = pde.robin(evalPts.pt[idx], false);
+            float sourceVal = pde.source(evalPts.pt[idx]);
             boundaryData->get(j, i) = Array3(dirichletVal, robinVal, sourceVal);
 
             // solution data
-            float value = evalPts[idx].getEstimatedSolution(nAbsorbingBoundarySamples,
-                                                            nAbsorbingBoundaryNormalAlignedSamples,
-                                                            nReflectingBoundarySamples,
-                                                            nReflectingBoundaryNormalAlignedSamples,
-                                                            nSourceSamples);
+            float value = evalPts.getEstimatedSolution(idx, nAbsorbingBoundarySamples,
+                                                       nAbsorbingBoundaryNormalAlignedSamples,
+                                                       nReflectingBoundarySamples,
+                                                       nReflectingBoundaryNormalAlignedSamples,
+                                                       nSourceSamples);
             bool maskOutValue = (!inDomain && !isDoubleSided) || std::min(std::abs(distToAbsorbingBoundary),
                                                                           std::abs(distToReflectingBoundary))
                                                                           < boundaryDistanceMask;
@@ -31,6 +31,7 @@ public:
     const bool isDoubleSided;
     zombie::PDE<float, 2> pde;
     zombie::GeometricQueries<2> queries;
+    uint64_t dataHash; // hash of the files and coefficients defining the boundary mesh and PDE
 
 protected:
     // loads boundary mesh from OBJ file
@@ -46,12 +47,16 @@ protected:
     zombie::FcpwBoundaryHandler<2, false> absorbingBoundaryHandler;
     zombie::FcpwBoundaryHandler<2, false> reflectingNeumannBoundaryHandler;
     zombie::FcpwBoundaryHandler<2, true> reflectingRobinBoundaryHandler;
+    zombie::WindingNumberTree<2> windingNumberTree;
+    bool useWindingNumbers;
 
     std::shared_ptr<Image<1>> isReflectingBoundary;
     std::shared_ptr<Image<1>> absorbingBoundaryValue;
     std::shared_ptr<Image<1>> reflectingBoundaryValue;
     std::shared_ptr<Image<1>> sourceValue;
     float absorptionCoeff, robinCoeff;
+    std::string accelerationStructureCacheFile;
+    bool enableBvhVectorization;
 
     std::function<bool(float, int)> ignoreCandidateSilhouette;
     zombie::HarmonicGreensFnFreeSpace<3> harmonicGreensFn;
@@ -75,6 +80,23 @@ queries(getOptional<bool>(config, "isWatertight", true))
     bool flipOrientation = getOptional<bool>(config, "flipOrientation", true);
     absorptionCoeff = getOptional<float>(config, "absorptionCoeff", 0.0f);
     robinCoeff = getOptional<float>(config, "robinCoeff", 0.0f);
+    useWindingNumbers = getOptional<bool>(config, "useWindingNumbers", false);
+    accelerationStructureCacheFile = getOptional<std::string>(config, "accelerationStructureCacheFile", "");
+    enableBvhVectorization = getOptional<bool>(config, "enableBvhVectorization", false);
+
+    // hash the inputs defining the scene, so that caches of data computed from it can be validated
+    dataHash = zombie::hashValue<float>(absorptionCoeff);
+    dataHash = zombie::hashValue<float>(robinCoeff, dataHash);
+    for (bool setting: {isDoubleSided, normalize, flipOrientation}) {
+        dataHash = zombie::hashValue<bool>(setting, dataHash);
+    }
+    for (const std::string& file: {boundaryFile, isReflectingBoundaryFile, absorbingBoundaryValueFile,
+                                   reflectingBoundaryValueFile, sourceValueFile}) {
+        if (!zombie::hashFile(file, dataHash)) {
+            std::cerr << "Scene::Scene(): could not read " << file << "!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
 
     // load images specifying boundary conditions and source term
     isReflectingBoundary = std::make_shared<Image<1>>(isReflectingBoundaryFile);
@@ -132,8 +154,8 @@ void Scene::populateGeometricQueries()
                                      absorbingBoundaryVertices, absorbingBoundarySegments,
                                      reflectingBoundaryVertices, reflectingBoundarySegments);
 
-    // build acceleration structures for absorbing and reflecting boundaries
-    absorbingBoundaryHandler.buildAccelerationStructure(absorbingBoundaryVertices, absorbingBoundarySegments);
+    // build acceleration structures for absorbing and reflecting boundaries, or restore them
+    // from cache files written by a previous run with the same scene
     ignoreCandidateSilhouette = [this](float dihedralAngle, int index) -> bool {
         // ignore convex vertices/edges for closest silhouette point tests when solving an interior problem;
         // NOTE: for complex scenes with both open and closed meshes, the primitive index argument
@@ -141,18 +163,49 @@ void Scene::populateGeometricQueries()
         // vertex/edge should be ignored as a candidate for silhouette tests.
         return this->isDoubleSided ? false : dihedralAngle < 1e-3f;
     };
+    bool useCache = !accelerationStructureCacheFile.empty();
+    std::string absorbingCacheFile = accelerationStructureCacheFile + ".absorbing";
+    std::string reflectingCacheFile = accelerationStructureCacheFile + ".reflecting";
+#ifdef FCPW_USE_ENOKI
+    if (enableBvhVectorization) {
+        // packets wider than the SIMD width FCPW is compiled for are split into several operations
+        std::cout << "Vectorized BVH packet width: " << zombie::selectPacketWidth();
+#ifdef FCPW_SIMD_WIDTH
+        std::cout << " (compiled SIMD width: " << FCPW_SIMD_WIDTH << ")";
+#endif
+        std::cout << std::endl;
+    }
+#endif
+    if (!useCache || !absorbingBoundaryHandler.loadAccelerationStructure(absorbingCacheFile, dataHash,
+                                                                         enableBvhVectorization)) {
+        absorbingBoundaryHandler.buildAccelerationStructure(absorbingBoundaryVertices, absorbingBoundarySegments,
+                                                            {}, false, {}, {}, true, enableBvhVectorization);
+        if (useCache) absorbingBoundaryHandler.saveAccelerationStructure(absorbingCacheFile, dataHash);
+    }
+
     if (robinCoeff > 0.0f) {
-        std::vector<float> minRobinCoeffValues(reflectingBoundarySegments.size(), robinCoeff);
-        std::vector<float> maxRobinCoeffValues(reflectingBoundarySegments.size(), robinCoeff);
-        reflectingRobinBoundaryHandler.buildAccelerationStructure(reflectingBoundaryVertices,
-                                                                  reflectingBoundarySegments,
-                                                                  ignoreCandidateSilhouette, false,
-                                                                  minRobinCoeffValues, maxRobinCoeffValues);
+        if (!useCache || !reflectingRobinBoundaryHandler.loadAccelerationStructure(reflectingCacheFile, dataHash,
+                                                                                   enableBvhVectorization)) {
+            std::vector<float> minRobinCoeffValues(reflectingBoundarySegments.size(), robinCoeff);
+            std::vector<float> maxRobinCoeffValues(reflectingBoundarySegments.size(), robinCoeff);
+            reflectingRobinBoundaryHandler.buildAccelerationStructure(reflectingBoundaryVertices,
+                                                                      reflectingBoundarySegments,
+                                                                      ignoreCandidateSilhouette, false,
+                                                                      minRobinCoeffValues, maxRobinCoeffValues,
+                                                                      true, enableBvhVectorization);
+            if (useCache) reflectingRobinBoundaryHandler.saveAccelerationStructure(reflectingCacheFile, dataHash);
+        }
 
     } else {
-        reflectingNeumannBoundaryHandler.buildAccelerationStructure(reflectingBoundaryVertices,
-                                                                    reflectingBoundarySegments,
-                                                                    ignoreCandidateSilhouette, true);
+        if (!useCache || !reflectingNeumannBoundaryHandler.loadAccelerationStructure(reflectingCacheFile, dataHash,
+                                                                                     enableBvhVectorization,
+                                                                                     ignoreCandidateSilhouette)) {
+            reflectingNeumannBoundaryHandler.buildAccelerationStructure(reflectingBoundaryVertices,
+                                                                        reflectingBoundarySegments,
+                                                                        ignoreCandidateSilhouette, true, {}, {},
+                                                                        true, enableBvhVectorization);
+            if (useCache) reflectingNeumannBoundaryHandler.saveAccelerationStructure(reflectingCacheFile, dataHash);
+        }
     }
 
     // populate geometric queries
@@ -170,4 +223,11 @@ void Scene::populateGeometricQueries()
                                                    reflectingNeumannBoundaryHandler,
                                                    branchTraversalWeight, bbox, queries);
     }
+
+    // classify points against the domain with winding numbers instead of ray intersections
+    if (useWindingNumbers) {
+        windingNumberTree.addMesh(vertices, segments);
+        windingNumberTree.build();
+        zombie::populateWindingNumberQuery<2>(windingNumberTree, queries);
+    }
 }
@@ -86,7 +86,7 @@ public:
 };
 
 template <>
-class HarmonicGreensFnFreeSpace<2>: public GreensFnFreeSpace<2> {
+class HarmonicGreensFnFreeSpace<2> final: public GreensFnFreeSpace<2> {
 public:
     // constructor
     HarmonicGreensFnFreeSpace(): GreensFnFreeSpace<2>() {}
@@ -122,7 +122,7 @@ public:
 };
 
 template <>
-class HarmonicGreensFnFreeSpace<3>: public GreensFnFreeSpace<3> {
+class HarmonicGreensFnFreeSpace<3> final: public GreensFnFreeSpace<3> {
 public:
     // constructor
     HarmonicGreensFnFreeSpace(): GreensFnFreeSpace<3>() {}
@@ -169,7 +169,7 @@ public:
 };
 
 template <>
-class YukawaGreensFnFreeSpace<2>: public GreensFnFreeSpace<2> {
+class YukawaGreensFnFreeSpace<2> final: public GreensFnFreeSpace<2> {
 public:
     // constructor
     YukawaGreensFnFreeSpace(float lambda_):
@@ -222,7 +222,7 @@ public:
 };
 
 template <>
-class YukawaGreensFnFreeSpace<3>: public GreensFnFreeSpace<3> {
+class YukawaGreensFnFreeSpace<3> final: public GreensFnFreeSpace<3> {
 public:
     // constructor
     YukawaGreensFnFreeSpace(float lambda_):
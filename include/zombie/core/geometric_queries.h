@@ -80,6 +80,10 @@ struct GeometricQueries {
     std::function<int(const Vector<DIM>&, const Vector<DIM>&, const Vector<DIM>&,
                       float, bool, bool, std::vector<IntersectionPoint<DIM>>&)> intersectBoundaryAllHits;
 
+    // counts the intersections of a ray with the boundary; returns -1 if the ray passes
+    // through an edge or vertex of the boundary, where the count is unreliable
+    std::function<int(const Vector<DIM>&, const Vector<DIM>&, float)> countBoundaryIntersections;
+
     // checks whether there is a line of sight between two points
     std::function<bool(const Vector<DIM>&, const Vector<DIM>&, const Vector<DIM>&,
                        const Vector<DIM>&, bool, bool)> intersectsWithReflectingBoundary;
@@ -90,6 +94,10 @@ struct GeometricQueries {
     // computes the radius of a star-shaped region on a reflecting boundary
     std::function<float(const Vector<DIM>&, float, float, float, bool)> computeStarRadiusForReflectingBoundary;
 
+    // computes the generalized winding number of the boundary at a point; optional, and
+    // used by insideDomain in place of ray intersections when set
+    std::function<float(const Vector<DIM>&)> computeWindingNumber;
+
     // checks if a point is inside the domain (assuming it is watertight)
     std::function<bool(const Vector<DIM>&, bool)> insideDomain;
 
@@ -288,6 +288,19 @@ public:
         return std::clamp(first - 1, 0, size - 2);
     }
 
+    // generates samples from table for uniform samples in the range [0, 1) sorted in increasing
+    // order, with a single bisection followed by a linear scan over the table
+    void sampleSorted(const float *u, int nSamples, int *indices) const {
+        if (nSamples <= 0) return;
+        int last = (int)table.size() - 2;
+        int index = sample(u[0]);
+
+        for (int i = 0; i < nSamples; i++) {
+            while (index < last && table[index + 1] <= u[i]) index++;
+            indices[i] = index;
+        }
+    }
+
 protected:
     // member
     std::vector<float> table;
@@ -405,12 +418,11 @@ protected:
 // source: https://pbr-book.org/3ed-2018/Sampling_and_Reconstruction/Stratified_Sampling#LatinHypercube
 // NOTE: sample quality reduces with increasing dimension
 template <size_t DIM>
-inline void generateStratifiedSamples(std::vector<float>& samples, int nSamples, pcg32& sampler)
+inline void generateStratifiedSamples(float *samples, int nSamples, pcg32& sampler)
 {
     const float epsilon = std::numeric_limits<float>::epsilon();
     const float oneMinusEpsilon = 1.0f - epsilon;
     float invNSamples = 1.0f/nSamples;
-    samples.resize(DIM*nSamples);
 
     // generate LHS samples along diagonal
     for (int i = 0; i < nSamples; ++i) {
@@ -429,4 +441,180 @@ inline void generateStratifiedSamples(std::vector<float>& samples, int nSamples,
     }
 }
 
+template <size_t DIM>
+inline void generateStratifiedSamples(std::vector<float>& samples, int nSamples, pcg32& sampler)
+{
+    samples.resize(DIM*nSamples);
+    generateStratifiedSamples<DIM>(samples.data(), nSamples, sampler);
+}
+
+// interface for generators of randomized sample sequences: each sample is identified by the seed
+// of its sequence (e.g., one per sample point), its index in the sequence (e.g., one per walk), and
+// a pair of its dimensions (e.g., one per walk step), and all values lie in the range [0, 1)
+class SampleGenerator {
+public:
+    // destructor
+    virtual ~SampleGenerator() {}
+
+    // generates the specified pair of dimensions of a sample in a sequence
+    virtual void generate2D(uint32_t sequenceSeed, uint32_t sampleIndex,
+                            uint32_t dimensionPair, float *u) const = 0;
+
+protected:
+    // hashes an integer; source: https://nullprogram.com/blog/2018/07/31/
+    static uint32_t hash(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+
+        return x;
+    }
+
+    // combines a seed with the hash of an integer
+    static uint32_t hashCombine(uint32_t seed, uint32_t x) {
+        return seed ^ (hash(x) + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+    }
+
+    // converts an integer to a float in the range [0, 1)
+    static float toUnitFloat(uint32_t x) {
+        return (x >> 8)*0x1p-24f;
+    }
+};
+
+// generates independent uniform samples by hashing the sequence seed, sample index and dimension
+class IndependentSampleGenerator: public SampleGenerator {
+public:
+    // generates the specified pair of dimensions of a sample in a sequence
+    void generate2D(uint32_t sequenceSeed, uint32_t sampleIndex,
+                    uint32_t dimensionPair, float *u) const {
+        uint32_t seed = hashCombine(hashCombine(sequenceSeed, sampleIndex), dimensionPair);
+        u[0] = toUnitFloat(hash(hashCombine(seed, 0)));
+        u[1] = toUnitFloat(hash(hashCombine(seed, 1)));
+    }
+};
+
+// generates Owen-scrambled Sobol samples, padding pairs of dimensions drawn from the (0, 2)-sequence
+// formed by the first two Sobol dimensions; the sample indices are shuffled independently for each
+// pair of dimensions to decorrelate the pairs, so every pair remains well stratified on its own.
+// Sample counts that are powers of two give the best stratification.
+// source: Burley 2020, "Practical Hash-based Owen Scrambling", JCGT 9(4)
+class OwenScrambledSobolSampleGenerator: public SampleGenerator {
+public:
+    // generates the specified pair of dimensions of a sample in a sequence
+    void generate2D(uint32_t sequenceSeed, uint32_t sampleIndex,
+                    uint32_t dimensionPair, float *u) const {
+        uint32_t seed = hashCombine(sequenceSeed, dimensionPair);
+        uint32_t index = nestedUniformScramble(sampleIndex, hash(seed));
+        u[0] = toUnitFloat(nestedUniformScramble(sobol(index, 0), hashCombine(seed, 0)));
+        u[1] = toUnitFloat(nestedUniformScramble(sobol(index, 1), hashCombine(seed, 1)));
+    }
+
+protected:
+    // reverses the bits of an integer
+    static uint32_t reverseBits(uint32_t x) {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+        x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+
+        return (x >> 16) | (x << 16);
+    }
+
+    // hash-based permutation that only propagates changes from lower to higher bits;
+    // source: https://psychopath.io/post/2021_01_30_building_a_better_lk_hash
+    static uint32_t laineKarrasPermutation(uint32_t x, uint32_t seed) {
+        x += seed;
+        x ^= x*0x6c50b47cu;
+        x ^= x*0xb82f1e52u;
+        x ^= x*0xc7afe638u;
+        x ^= x*0x8d22f6e6u;
+
+        return x;
+    }
+
+    // performs a nested uniform (Owen) scramble of the bits of an integer
+    static uint32_t nestedUniformScramble(uint32_t x, uint32_t seed) {
+        return reverseBits(laineKarrasPermutation(reverseBits(x), seed));
+    }
+
+    // returns the first (van der Corput) or second Sobol dimension of a sample
+    static uint32_t sobol(uint32_t index, int dimension) {
+        if (dimension == 0) return reverseBits(index);
+
+        uint32_t x = 0;
+        for (uint32_t v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1) {
+            if (index & 1) x ^= v;
+        }
+
+        return x;
+    }
+};
+
+// draws consecutive pairs of dimensions of a single sample (e.g., a random walk) from a
+// SampleGenerator, and falls back on a pseudorandom sampler once the specified number of
+// pairs is exhausted or if no generator is set
+class SampleStream {
+public:
+    // constructors
+    SampleStream(): generator(nullptr), sequenceSeed(0), sampleIndex(0),
+                    dimensionPair(0), nDimensionPairs(0) {}
+    SampleStream(const SampleGenerator *generator_, uint32_t sequenceSeed_,
+                 uint32_t sampleIndex_, int nDimensionPairs_):
+                 generator(generator_), sequenceSeed(sequenceSeed_), sampleIndex(sampleIndex_),
+                 dimensionPair(0), nDimensionPairs(nDimensionPairs_) {}
+
+    // returns whether the next pair of dimensions is drawn from the generator
+    bool hasNext2D() const {
+        return generator != nullptr && dimensionPair < nDimensionPairs;
+    }
+
+    // draws the next pair of dimensions
+    void next2D(pcg32& sampler, float *u) {
+        if (hasNext2D()) {
+            generator->generate2D(sequenceSeed, sampleIndex, dimensionPair++, u);
+
+        } else {
+            u[0] = sampler.nextFloat();
+            u[1] = sampler.nextFloat();
+        }
+    }
+
+    // samples a direction on the unit sphere from the next pair of dimensions
+    template <size_t DIM>
+    Vector<DIM> sampleUnitSphereUniform(pcg32& sampler) {
+        if (!hasNext2D()) return SphereSampler<DIM>::sampleUnitSphereUniform(sampler);
+
+        float u[2];
+        generator->generate2D(sequenceSeed, sampleIndex, dimensionPair++, u);
+        return SphereSampler<DIM>::sampleUnitSphereUniform(u);
+    }
+
+protected:
+    // members
+    const SampleGenerator *generator;
+    uint32_t sequenceSeed;
+    uint32_t sampleIndex;
+    int dimensionPair;
+    int nDimensionPairs;
+};
+
+// generates samples in DIM dimensions from consecutive pairs of dimensions of a sample generator;
+// the last dimension of each pair is discarded if DIM is odd
+template <size_t DIM>
+inline void generateSequenceSamples(std::vector<float>& samples, int nSamples,
+                                    const SampleGenerator& generator, uint32_t sequenceSeed)
+{
+    samples.resize(DIM*nSamples);
+    for (int i = 0; i < nSamples; i++) {
+        for (int j = 0; j < DIM; j += 2) {
+            float u[2];
+            generator.generate2D(sequenceSeed, i, j/2, u);
+            samples[DIM*i + j] = u[0];
+            if (j + 1 < DIM) samples[DIM*i + j + 1] = u[1];
+        }
+    }
+}
+
 } // zombie
@@ -35,7 +35,12 @@ struct WalkSettings {
                  ignoreAbsorbingBoundaryContribution(false),
                  ignoreReflectingBoundaryContribution(false),
                  ignoreSourceContribution(false),
-                 printLogs(false) {}
+                 printLogs(false),
+                 sampleGenerator(nullptr),
+                 stepsUsingSampleGenerator(8),
+                 splittingThreshold(1.0f),
+                 maxSplitBranches(4),
+                 maxSplitDepth(0) {}
     WalkSettings(float epsilonShellForAbsorbingBoundary_,
                  float epsilonShellForReflectingBoundary_,
                  float silhouettePrecision_, float russianRouletteThreshold_,
@@ -59,7 +64,12 @@ struct WalkSettings {
                  ignoreAbsorbingBoundaryContribution(ignoreAbsorbingBoundaryContribution_),
                  ignoreReflectingBoundaryContribution(ignoreReflectingBoundaryContribution_),
                  ignoreSourceContribution(ignoreSourceContribution_),
-                 printLogs(printLogs_) {}
+                 printLogs(printLogs_),
+                 sampleGenerator(nullptr),
+                 stepsUsingSampleGenerator(8),
+                 splittingThreshold(1.0f),
+                 maxSplitBranches(4),
+                 maxSplitDepth(0) {}
 
     // members
     float epsilonShellForAbsorbingBoundary;
@@ -77,6 +87,20 @@ struct WalkSettings {
     bool ignoreReflectingBoundaryContribution;
     bool ignoreSourceContribution;
     bool printLogs;
+    // NOTE: when set, walk directions are drawn from this generator (e.g., an OwenScrambledSobolSampleGenerator)
+    // for the first stepsUsingSampleGenerator steps of each walk, with one sequence per sample point and
+    // one sample per walk; all other random decisions use the sample point's pseudorandom sampler
+    std::shared_ptr<const SampleGenerator> sampleGenerator;
+    int stepsUsingSampleGenerator;
+    // NOTE: walk splitting is disabled when maxSplitDepth is 0; otherwise, a walk whose throughput
+    // times importance (see WalkOnStars) exceeds splittingThreshold is split into up to maxSplitBranches
+    // weighted branches that share its prefix, and branches are split again up to maxSplitDepth times.
+    // Walk throughputs start at 1 and never increase along harmonic or screened walks, so the default
+    // importance is maxSplitBranches on the reflecting boundary, where walks pick up Neumann flux, and
+    // 1 elsewhere: walks split when they reach the reflecting boundary with enough throughput left
+    float splittingThreshold;
+    int maxSplitBranches;
+    int maxSplitDepth;
 };
 
 template <typename T, size_t DIM>
@@ -94,7 +118,9 @@ struct WalkState {
               onReflectingBoundary(onReflectingBoundary_),
               totalReflectingBoundaryContribution(0.0f),
               totalSourceContribution(0.0f),
-              walkLength(walkLength_) {}
+              totalSplitContribution(0.0f),
+              walkLength(walkLength_),
+              splitDepth(0) {}
 
     // members
     std::unique_ptr<GreensFnBall<DIM>> greensFn;
@@ -106,19 +132,174 @@ struct WalkState {
     bool onReflectingBoundary;
     T totalReflectingBoundaryContribution;
     T totalSourceContribution;
+    T totalSplitContribution; // NOTE: sum of the contributions of the branches the walk was split into
     int walkLength;
+    int splitDepth;
+    SampleStream sampleStream;
 };
 
 enum class WalkCompletionCode {
     ReachedAbsorbingBoundary,
     TerminatedWithRussianRoulette,
     ExceededMaxWalkLength,
-    EscapedDomain
+    EscapedDomain,
+    Split
+};
+
+// policies for tracking the estimates added to SampleStatistics, ordered by cost: Sum only
+// tracks the mean, SumOfSquares also tracks the variance via sums in double precision, and
+// Welford tracks the variance with a numerically stable update that divides per estimate
+enum class StatisticsPolicy {
+    Sum,
+    SumOfSquares,
+    Welford
+};
+
+// double precision counterpart of the estimate type, used to accumulate sums of squares
+template <typename T>
+struct DoublePrecision {
+    using Type = typename std::decay<decltype(std::declval<T>().template cast<double>().eval())>::type;
+    static Type convert(const T& x) { return x.template cast<double>(); }
+    static T convertBack(const Type& x) { return x.template cast<typename T::Scalar>(); }
+};
+
+template <>
+struct DoublePrecision<float> {
+    using Type = double;
+    static Type convert(const float& x) { return x; }
+    static float convertBack(const Type& x) { return (float)x; }
+};
+
+// running statistics of a single estimated quantity under the given policy; the caller
+// tracks the number of estimates N, which includes the estimate passed to add and
+// excludes the batch passed to merge
+template <typename T, StatisticsPolicy Policy>
+class RunningStatistics;
+
+template <typename T>
+class RunningStatistics<T, StatisticsPolicy::Sum> {
+public:
+    // resets statistics
+    void reset() {
+        sum = T(0.0f);
+    }
+
+    // adds estimate
+    void add(const T& estimate, int N) {
+        sum += estimate;
+    }
+
+    // adds a batch of estimates given their sum and sum of squares
+    void merge(const T& batchSum, const T& batchSumOfSquares, int count, int N) {
+        sum += batchSum;
+    }
+
+    // adds the sum of the given statistics to the sum of the existing estimates
+    void correct(const RunningStatistics& corrections) {
+        sum += corrections.sum;
+    }
+
+    // returns mean
+    T mean(int N) const {
+        return sum/float(std::max(1, N));
+    }
+
+    // returns variance, which is not tracked by this policy
+    T variance(int N) const {
+        return T(0.0f);
+    }
+
+protected:
+    // members
+    T sum;
+};
+
+template <typename T>
+class RunningStatistics<T, StatisticsPolicy::SumOfSquares> {
+public:
+    using Double = DoublePrecision<T>;
+
+    // resets statistics
+    void reset() {
+        sum = typename Double::Type(0.0);
+        sumOfSquares = typename Double::Type(0.0);
+    }
+
+    // adds estimate
+    void add(const T& estimate, int N) {
+        typename Double::Type x = Double::convert(estimate);
+        sum += x;
+        sumOfSquares += x*x;
+    }
+
+    // adds a batch of estimates given their sum and sum of squares
+    void merge(const T& batchSum, const T& batchSumOfSquares, int count, int N) {
+        sum += Double::convert(batchSum);
+        sumOfSquares += Double::convert(batchSumOfSquares);
+    }
+
+    // returns mean
+    T mean(int N) const {
+        return Double::convertBack(sum/double(std::max(1, N)));
+    }
+
+    // returns variance
+    T variance(int N) const {
+        if (N < 2) return T(0.0f);
+        typename Double::Type mean = sum/double(N);
+        return Double::convertBack((sumOfSquares - sum*mean)/double(N - 1));
+    }
+
+protected:
+    // members
+    typename Double::Type sum, sumOfSquares;
+};
+
+template <typename T>
+class RunningStatistics<T, StatisticsPolicy::Welford> {
+public:
+    // resets statistics
+    void reset() {
+        runningMean = T(0.0f);
+        M2 = T(0.0f);
+    }
+
+    // adds estimate
+    void add(const T& estimate, int N) {
+        T delta = estimate - runningMean;
+        runningMean += delta/N;
+        T delta2 = estimate - runningMean;
+        M2 += delta*delta2;
+    }
+
+    // merges a batch of estimates into the statistics of N estimates (Chan et al. 1979)
+    void merge(const T& batchSum, const T& batchSumOfSquares, int count, int N) {
+        T batchMean = batchSum/float(count);
+        T batchM2 = batchSumOfSquares - batchSum*batchMean;
+        T delta = batchMean - runningMean;
+        float total = float(N + count);
+        runningMean += delta*(float(count)/total);
+        M2 += batchM2 + delta*delta*(float(N)*float(count)/total);
+    }
+
+    // returns mean
+    T mean(int N) const {
+        return runningMean;
+    }
+
+    // returns variance
+    T variance(int N) const {
+        return M2/std::max(1, N - 1);
+    }
+
+protected:
+    // members
+    T runningMean, M2;
 };
 
 // NOTE: For data with multiple channels (e.g., 2D or 3D positions, rgb etc.), use
 // Eigen::Array (in place of Eigen::VectorXf) as it supports component wise operations
-template <typename T, size_t DIM>
+template <typename T, size_t DIM, StatisticsPolicy Policy=StatisticsPolicy::Welford>
 class SampleStatistics {
 public:
     // constructor
@@ -128,11 +309,10 @@ public:
 
     // resets statistics
     void reset() {
-        solutionMean = T(0.0f);
-        solutionM2 = T(0.0f);
+        solution.reset();
         for (int i = 0; i < DIM; i++) {
+            gradient[i].reset();
             gradientMean[i] = T(0.0f);
-            gradientM2[i] = T(0.0f);
         }
         totalFirstSourceContribution = T(0.0f);
         totalDerivativeContribution = T(0.0f);
@@ -144,24 +324,101 @@ public:
     // adds solution estimate to running sum
     void addSolutionEstimate(const T& estimate) {
         nSolutionEstimates += 1;
-        update(estimate, solutionMean, solutionM2, nSolutionEstimates);
+        solution.add(estimate, nSolutionEstimates);
     }
 
     // adds gradient estimate to running sum
     void addGradientEstimate(const T *boundaryEstimate, const T *sourceEstimate) {
         nGradientEstimates += 1;
         for (int i = 0; i < DIM; i++) {
-            update(boundaryEstimate[i] + sourceEstimate[i], gradientMean[i],
-                   gradientM2[i], nGradientEstimates);
+            gradient[i].add(boundaryEstimate[i] + sourceEstimate[i], nGradientEstimates);
         }
+
+        updateGradientMean();
     }
 
     // adds gradient estimate to running sum
     void addGradientEstimate(const T *estimate) {
         nGradientEstimates += 1;
         for (int i = 0; i < DIM; i++) {
-            update(estimate[i], gradientMean[i], gradientM2[i], nGradientEstimates);
+            gradient[i].add(estimate[i], nGradientEstimates);
+        }
+
+        updateGradientMean();
+    }
+
+    // adds a batch of solution estimates given only their sum; since the spread of the
+    // estimates within the batch is unknown, this is only supported by the Sum policy
+    void addSolutionEstimateSum(const T& sum, int count) {
+        static_assert(Policy == StatisticsPolicy::Sum,
+                      "SampleStatistics::addSolutionEstimateSum() requires StatisticsPolicy::Sum");
+        addSolutionEstimates(sum, T(0.0f), count);
+    }
+
+    // adds a batch of solution estimates given their sum and sum of squares
+    void addSolutionEstimates(const T& sum, const T& sumOfSquares, int count) {
+        if (count <= 0) return;
+        solution.merge(sum, sumOfSquares, count, nSolutionEstimates);
+        nSolutionEstimates += count;
+    }
+
+    // adds a batch of gradient estimates given only their sum; since the spread of the
+    // estimates within the batch is unknown, this is only supported by the Sum policy
+    void addGradientEstimateSums(const T *sum, int count) {
+        static_assert(Policy == StatisticsPolicy::Sum,
+                      "SampleStatistics::addGradientEstimateSums() requires StatisticsPolicy::Sum");
+        if (count <= 0) return;
+        for (int i = 0; i < DIM; i++) {
+            gradient[i].merge(sum[i], T(0.0f), count, nGradientEstimates);
         }
+
+        nGradientEstimates += count;
+        updateGradientMean();
+    }
+
+    // adds a batch of gradient estimates given their sum and sum of squares
+    void addGradientEstimates(const T *sum, const T *sumOfSquares, int count) {
+        if (count <= 0) return;
+        for (int i = 0; i < DIM; i++) {
+            gradient[i].merge(sum[i], sumOfSquares[i], count, nGradientEstimates);
+        }
+
+        nGradientEstimates += count;
+        updateGradientMean();
+    }
+
+    // adds a correction to the sum of the existing solution estimates without changing
+    // their count; only supported by the Sum policy
+    void addSolutionCorrection(const T& correction) {
+        static_assert(Policy == StatisticsPolicy::Sum,
+                      "SampleStatistics::addSolutionCorrection() requires StatisticsPolicy::Sum");
+        solution.merge(correction, T(0.0f), 0, nSolutionEstimates);
+    }
+
+    // adds corrections to the sums of the existing gradient estimates without changing
+    // their count; only supported by the Sum policy
+    void addGradientCorrections(const T *corrections) {
+        static_assert(Policy == StatisticsPolicy::Sum,
+                      "SampleStatistics::addGradientCorrections() requires StatisticsPolicy::Sum");
+        for (int i = 0; i < DIM; i++) {
+            gradient[i].merge(corrections[i], T(0.0f), 0, nGradientEstimates);
+        }
+
+        updateGradientMean();
+    }
+
+    // adds the sums of the estimates in the given statistics to the sums of the existing
+    // estimates without changing the estimate counts, e.g., to account for a change in the
+    // data the existing estimates were computed from; only supported by the Sum policy
+    void addCorrections(const SampleStatistics& corrections) {
+        static_assert(Policy == StatisticsPolicy::Sum,
+                      "SampleStatistics::addCorrections() requires StatisticsPolicy::Sum");
+        solution.correct(corrections.solution);
+        for (int i = 0; i < DIM; i++) {
+            gradient[i].correct(corrections.gradient[i]);
+        }
+
+        updateGradientMean();
     }
 
     // adds source contribution for the first step to running sum
@@ -181,13 +438,12 @@ public:
 
     // returns estimated solution
     T getEstimatedSolution() const {
-        return solutionMean;
+        return solution.mean(nSolutionEstimates);
     }
 
     // returns variance of estimated solution
     T getEstimatedSolutionVariance() const {
-        int N = std::max(1, nSolutionEstimates - 1);
-        return solutionM2/N;
+        return solution.variance(nSolutionEstimates);
     }
 
     // returns estimated gradient
@@ -195,13 +451,16 @@ public:
         return gradientMean;
     }
 
+    // copies estimated gradient into the given vector
+    void getEstimatedGradient(std::vector<T>& mean) const {
+        mean.assign(gradientMean, gradientMean + DIM);
+    }
+
     // returns variance of estimated gradient
     std::vector<T> getEstimatedGradientVariance() const {
-        int N = std::max(1, nGradientEstimates - 1);
         std::vector<T> variance(DIM);
-
         for (int i = 0; i < DIM; i++) {
-            variance[i] = gradientM2[i]/N;
+            variance[i] = gradient[i].variance(nGradientEstimates);
         }
 
         return variance;
@@ -236,17 +495,17 @@ public:
     }
 
 protected:
-    // updates statistics
-    void update(const T& estimate, T& mean, T& M2, int N) {
-        T delta = estimate - mean;
-        mean += delta/N;
-        T delta2 = estimate - mean;
-        M2 += delta*delta2;
+    // updates the estimated gradient from the running statistics
+    void updateGradientMean() {
+        for (int i = 0; i < DIM; i++) {
+            gradientMean[i] = gradient[i].mean(nGradientEstimates);
+        }
     }
 
     // members
-    T solutionMean, solutionM2;
-    T gradientMean[DIM], gradientM2[DIM];
+    RunningStatistics<T, Policy> solution;
+    RunningStatistics<T, Policy> gradient[DIM];
+    T gradientMean[DIM];
     T totalFirstSourceContribution;
     T totalDerivativeContribution;
     int nSolutionEstimates, nGradientEstimates;
@@ -32,21 +32,28 @@ template <typename T, size_t DIM>
 using SplatContributionCallback = std::function<void(const WalkState<T, DIM>&,
                                                      const SampleContribution<T>&)>;
 
+// called once all walks of a solve have finished, e.g., to merge per-thread splat buffers
+using MergeContributionsCallback = std::function<void()>;
+
 template <typename T, size_t DIM>
 class ReverseWalkOnStars {
 public:
     // constructor
     ReverseWalkOnStars(const GeometricQueries<DIM>& queries_,
-                       SplatContributionCallback<T, DIM> splatContribution_);
+                       SplatContributionCallback<T, DIM> splatContribution_,
+                       MergeContributionsCallback mergeContributions_={});
 
     // solves the given PDE by splatting contributions (dirichlet/neumann/robin/source)
-    // from a walk starting at the input sample point
+    // from a walk starting at the input sample point; NOTE: does not invoke the merge
+    // callback, which the caller must invoke once all walks have been performed, since
+    // splatted contributions may not be visible until then
     void solve(const PDE<T, DIM>& pde,
                const WalkSettings& walkSettings,
                SamplePoint<T, DIM>& samplePt) const;
 
     // solves the given PDE by splatting contributions (dirichlet/neumann/robin/source)
-    // from walks starting at the input sample points
+    // from walks starting at the input sample points, and merges the contributions
+    // after all walks have been performed
     void solve(const PDE<T, DIM>& pde,
                const WalkSettings& walkSettings,
                std::vector<SamplePoint<T, DIM>>& samplePts,
@@ -69,6 +76,7 @@ protected:
     // members
     const GeometricQueries<DIM>& queries;
     SplatContributionCallback<T, DIM> splatContribution;
+    MergeContributionsCallback mergeContributions;
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -76,8 +84,10 @@ protected:
 
 template <typename T, size_t DIM>
 inline ReverseWalkOnStars<T, DIM>::ReverseWalkOnStars(const GeometricQueries<DIM>& queries_,
-                                                      SplatContributionCallback<T, DIM> splatContribution_):
-                                                      queries(queries_), splatContribution(splatContribution_)
+                                                      SplatContributionCallback<T, DIM> splatContribution_,
+                                                      MergeContributionsCallback mergeContributions_):
+                                                      queries(queries_), splatContribution(splatContribution_),
+                                                      mergeContributions(mergeContributions_)
 {
     // do nothing
 }
@@ -181,6 +191,8 @@ inline void ReverseWalkOnStars<T, DIM>::solve(const PDE<T, DIM>& pde,
         tbb::blocked_range<int> range(0, nPoints);
         tbb::parallel_for(range, run);
     }
+
+    if (mergeContributions) mergeContributions();
 }
 
 template <typename T, size_t DIM>
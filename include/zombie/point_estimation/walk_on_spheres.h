@@ -175,7 +175,7 @@ inline WalkCompletionCode WalkOnSpheres<T, DIM>::walk(const PDE<T, DIM>& pde,
         computeSourceContribution(pde, walkSettings, sampler, state);
 
         // sample a direction uniformly
-        Vector<DIM> direction = SphereSampler<DIM>::sampleUnitSphereUniform(sampler);
+        Vector<DIM> direction = state.sampleStream.template sampleUnitSphereUniform<DIM>(sampler);
 
         // update walk position
         state.currentPt += distToAbsorbingBoundary*direction;
@@ -290,11 +290,16 @@ inline void WalkOnSpheres<T, DIM>::estimateSolution(const PDE<T, DIM>& pde,
         samplePt.firstSphereRadius = samplePt.distToAbsorbingBoundary;
     }
 
+    // draw walk directions from the sample generator, if any, using a new sequence per call
+    uint32_t sequenceSeed = walkSettings.sampleGenerator ? samplePt.sampler.nextUInt() : 0;
+
     // perform random walks
     for (int w = 0; w < nWalks; w++) {
         // initialize the walk state
         WalkState<T, DIM> state(samplePt.pt, Vector<DIM>::Zero(), Vector<DIM>::Zero(),
                                 0.0f, 1.0f, false, 0);
+        state.sampleStream = SampleStream(walkSettings.sampleGenerator.get(), sequenceSeed, w,
+                                          walkSettings.stepsUsingSampleGenerator);
 
         // initialize the greens function
         if (pde.absorptionCoeff > 0.0f && walkSettings.stepsBeforeApplyingTikhonov == 0) {
@@ -349,6 +354,9 @@ inline void WalkOnSpheres<T, DIM>::estimateSolutionAndGradient(const PDE<T, DIM>
     std::vector<float> stratifiedSamples;
     generateStratifiedSamples<DIM - 1>(stratifiedSamples, 2*nWalks, samplePt.sampler);
 
+    // draw walk directions from the sample generator, if any, using a new sequence per call
+    uint32_t sequenceSeed = walkSettings.sampleGenerator ? samplePt.sampler.nextUInt() : 0;
+
     // perform random walks
     for (int w = 0; w < nWalks; w++) {
         // initialize temporary variables for antithetic sampling
@@ -435,6 +443,8 @@ inline void WalkOnSpheres<T, DIM>::estimateSolutionAndGradient(const PDE<T, DIM>
 
             // perform walk
             samplePt.sampler.seed(seed);
+            state.sampleStream = SampleStream(walkSettings.sampleGenerator.get(), sequenceSeed, w,
+                                              walkSettings.stepsUsingSampleGenerator);
             WalkCompletionCode code = walk(pde, walkSettings, distToAbsorbingBoundary,
                                            samplePt.sampler, state);
 
@@ -22,10 +22,14 @@ namespace zombie {
 template <typename T, size_t DIM>
 class WalkOnStars {
 public:
-    // constructor
+    // constructor; the optional splitting importance callback scales the walk throughput
+    // compared against WalkSettings::splittingThreshold (e.g., to split walks near the query
+    // point when estimating gradients); without it, walks on the reflecting boundary have an
+    // importance of WalkSettings::maxSplitBranches and all other walks an importance of 1
     WalkOnStars(const GeometricQueries<DIM>& queries_,
                 std::function<void(const WalkState<T, DIM>&)> walkStateCallback_={},
-                std::function<T(const WalkState<T, DIM>&)> terminalContributionCallback_={});
+                std::function<T(const WalkState<T, DIM>&)> terminalContributionCallback_={},
+                std::function<float(const WalkState<T, DIM>&)> splittingImportanceCallback_={});
 
     // solves the given PDE at the input point; NOTE: assumes the point does not
     // lie on the boundary when estimating the gradient
@@ -69,6 +73,22 @@ protected:
                             bool flipNormalOrientation, pcg32& sampler,
                             WalkState<T, DIM>& state) const;
 
+    // returns the number of branches to split the walk into at its current state
+    int computeSplitBranchCount(const WalkSettings& walkSettings,
+                                const WalkState<T, DIM>& state) const;
+
+    // splits the walk into several weighted branches that continue from its current state,
+    // reusing the distance and star radius computed for the current step, and accumulates the
+    // contributions of the branches into state.totalSplitContribution
+    WalkCompletionCode splitWalk(const PDE<T, DIM>& pde,
+                                 const WalkSettings& walkSettings,
+                                 int nBranches, float distToAbsorbingBoundary,
+                                 float starRadius, bool flipNormalOrientation,
+                                 pcg32& sampler, WalkState<T, DIM>& state) const;
+
+    // returns whether a walk with the given completion code contributes to the estimate
+    bool contributesToEstimate(WalkCompletionCode code) const;
+
     // returns the terminal contribution from the end of the walk
     T getTerminalContribution(WalkCompletionCode code,
                               const PDE<T, DIM>& pde,
@@ -92,6 +112,7 @@ protected:
     const GeometricQueries<DIM>& queries;
     std::function<void(const WalkState<T, DIM>&)> walkStateCallback;
     std::function<T(const WalkState<T, DIM>&)> terminalContributionCallback;
+    std::function<float(const WalkState<T, DIM>&)> splittingImportanceCallback;
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -100,9 +121,11 @@ protected:
 template <typename T, size_t DIM>
 inline WalkOnStars<T, DIM>::WalkOnStars(const GeometricQueries<DIM>& queries_,
                                         std::function<void(const WalkState<T, DIM>&)> walkStateCallback_,
-                                        std::function<T(const WalkState<T, DIM>&)> terminalContributionCallback_):
+                                        std::function<T(const WalkState<T, DIM>&)> terminalContributionCallback_,
+                                        std::function<float(const WalkState<T, DIM>&)> splittingImportanceCallback_):
                                         queries(queries_), walkStateCallback(walkStateCallback_),
-                                        terminalContributionCallback(terminalContributionCallback_)
+                                        terminalContributionCallback(terminalContributionCallback_),
+                                        splittingImportanceCallback(splittingImportanceCallback_)
 {
     // do nothing
 }
@@ -321,6 +344,16 @@ inline WalkCompletionCode WalkOnStars<T, DIM>::walk(const PDE<T, DIM>& pde,
             }
         }
 
+        // split the walk into weighted branches if its throughput is large enough; NOTE: branches
+        // skip this check on their first step, since they start from the state the walk split at
+        if (state.splitDepth < walkSettings.maxSplitDepth && !(firstStep && state.splitDepth > 0)) {
+            int nBranches = computeSplitBranchCount(walkSettings, state);
+            if (nBranches > 1) {
+                return splitWalk(pde, walkSettings, nBranches, distToAbsorbingBoundary,
+                                 starRadius, flipNormalOrientation, sampler, state);
+            }
+        }
+
         // update the ball center and radius
         state.greensFn->updateBall(state.currentPt, starRadius);
 
@@ -330,7 +363,7 @@ inline WalkCompletionCode WalkOnStars<T, DIM>::walk(const PDE<T, DIM>& pde,
         }
 
         // sample a direction uniformly
-        Vector<DIM> direction = SphereSampler<DIM>::sampleUnitSphereUniform(sampler);
+        Vector<DIM> direction = state.sampleStream.template sampleUnitSphereUniform<DIM>(sampler);
 
         // perform hemispherical sampling if on the reflecting boundary, which cancels
         // the alpha term in our integral expression
@@ -418,6 +451,90 @@ inline WalkCompletionCode WalkOnStars<T, DIM>::walk(const PDE<T, DIM>& pde,
     return WalkCompletionCode::ReachedAbsorbingBoundary;
 }
 
+template <typename T, size_t DIM>
+inline int WalkOnStars<T, DIM>::computeSplitBranchCount(const WalkSettings& walkSettings,
+                                                        const WalkState<T, DIM>& state) const
+{
+    // split the walk into enough branches to bring the throughput of each branch (times
+    // its importance) back below the splitting threshold; by default, walks are split where
+    // they reach the reflecting boundary, since the Neumann flux they pick up there adds variance
+    float importance = 1.0f;
+    if (splittingImportanceCallback) importance = splittingImportanceCallback(state);
+    else if (state.onReflectingBoundary) importance = (float)walkSettings.maxSplitBranches;
+    float ratio = state.throughput*importance/walkSettings.splittingThreshold;
+    if (ratio <= 1.0f) return 1;
+
+    return ratio < walkSettings.maxSplitBranches ? (int)std::ceil(ratio) : walkSettings.maxSplitBranches;
+}
+
+template <typename T, size_t DIM>
+inline WalkCompletionCode WalkOnStars<T, DIM>::splitWalk(const PDE<T, DIM>& pde,
+                                                         const WalkSettings& walkSettings,
+                                                         int nBranches, float distToAbsorbingBoundary,
+                                                         float starRadius, bool flipNormalOrientation,
+                                                         pcg32& sampler, WalkState<T, DIM>& state) const
+{
+    WalkCompletionCode code = WalkCompletionCode::EscapedDomain;
+    int nContributingBranches = 0;
+    int maxWalkLength = state.walkLength;
+
+    for (int b = 0; b < nBranches; b++) {
+        // initialize the branch state from the walk state, with an equal share of its throughput;
+        // NOTE: branches draw their directions independently, since the walk's sample stream
+        // would otherwise give every branch the same directions
+        WalkState<T, DIM> branchState(state.currentPt, state.currentNormal, state.prevDirection,
+                                      state.prevDistance, state.throughput/nBranches,
+                                      state.onReflectingBoundary, state.walkLength);
+        branchState.splitDepth = state.splitDepth + 1;
+
+        // initialize the greens function
+        if (pde.absorptionCoeff > 0.0f && walkSettings.stepsBeforeApplyingTikhonov <= state.walkLength) {
+            branchState.greensFn = std::make_unique<YukawaGreensFnBall<DIM>>(pde.absorptionCoeff);
+
+        } else {
+            branchState.greensFn = std::make_unique<HarmonicGreensFnBall<DIM>>();
+        }
+
+        // perform walk, starting with the star radius of the current step
+        WalkCompletionCode branchCode = walk(pde, walkSettings, distToAbsorbingBoundary, starRadius,
+                                             flipNormalOrientation, sampler, branchState);
+        maxWalkLength = std::max(maxWalkLength, branchState.walkLength);
+
+        if (contributesToEstimate(branchCode)) {
+            // accumulate the branch contribution
+            T terminalContribution = getTerminalContribution(branchCode, pde, walkSettings, branchState);
+            state.totalSplitContribution += branchState.throughput*terminalContribution +
+                                            branchState.totalReflectingBoundaryContribution +
+                                            branchState.totalSourceContribution +
+                                            branchState.totalSplitContribution;
+            nContributingBranches++;
+
+        } else if (nContributingBranches == 0) {
+            code = branchCode;
+        }
+    }
+
+    // record the length of the longest branch
+    state.walkLength = maxWalkLength;
+
+    // branches that do not contribute (e.g., that escape the domain) are dropped just like unsplit
+    // walks, so the branch contributions are averaged over the contributing branches only; the
+    // walk itself is dropped if none of its branches contribute
+    if (nContributingBranches == 0) return code;
+    state.totalSplitContribution *= float(nBranches)/nContributingBranches;
+
+    return WalkCompletionCode::Split;
+}
+
+template <typename T, size_t DIM>
+inline bool WalkOnStars<T, DIM>::contributesToEstimate(WalkCompletionCode code) const
+{
+    return code == WalkCompletionCode::ReachedAbsorbingBoundary ||
+           code == WalkCompletionCode::TerminatedWithRussianRoulette ||
+           code == WalkCompletionCode::Split ||
+           (code == WalkCompletionCode::ExceededMaxWalkLength && terminalContributionCallback);
+}
+
 template <typename T, size_t DIM>
 inline T WalkOnStars<T, DIM>::getTerminalContribution(WalkCompletionCode code,
                                                       const PDE<T, DIM>& pde,
@@ -440,7 +557,7 @@ inline T WalkOnStars<T, DIM>::getTerminalContribution(WalkCompletionCode code,
         return terminalContributionCallback(state);
     }
 
-    // terminated with russian roulette or ignoring absorbing boundary values
+    // terminated with russian roulette, split, or ignoring absorbing boundary values
     return T(0.0f);
 }
 
@@ -525,11 +642,16 @@ inline void WalkOnStars<T, DIM>::estimateSolution(const PDE<T, DIM>& pde,
         }
     }
 
+    // draw walk directions from the sample generator, if any, using a new sequence per call
+    uint32_t sequenceSeed = walkSettings.sampleGenerator ? samplePt.sampler.nextUInt() : 0;
+
     // perform random walks
     for (int w = 0; w < nWalks; w++) {
         // initialize the walk state
         WalkState<T, DIM> state(samplePt.pt, currentNormal, prevDirection, prevDistance, 1.0f,
                                 samplePt.type == SampleType::OnReflectingBoundary, 0);
+        state.sampleStream = SampleStream(walkSettings.sampleGenerator.get(), sequenceSeed, w,
+                                          walkSettings.stepsUsingSampleGenerator);
 
         // initialize the greens function
         if (pde.absorptionCoeff > 0.0f && walkSettings.stepsBeforeApplyingTikhonov == 0) {
@@ -544,14 +666,13 @@ inline void WalkOnStars<T, DIM>::estimateSolution(const PDE<T, DIM>& pde,
                                        samplePt.firstSphereRadius, flipNormalOrientation,
                                        samplePt.sampler, state);
 
-        if ((code == WalkCompletionCode::ReachedAbsorbingBoundary ||
-             code == WalkCompletionCode::TerminatedWithRussianRoulette) ||
-            (code == WalkCompletionCode::ExceededMaxWalkLength && terminalContributionCallback)) {
+        if (contributesToEstimate(code)) {
             // compute the walk contribution
             T terminalContribution = getTerminalContribution(code, pde, walkSettings, state);
             T totalContribution = state.throughput*terminalContribution +
                                   state.totalReflectingBoundaryContribution +
-                                  state.totalSourceContribution;
+                                  state.totalSourceContribution +
+                                  state.totalSplitContribution;
 
             // update statistics
             samplePt.statistics->addSolutionEstimate(totalContribution);
@@ -590,6 +711,9 @@ inline void WalkOnStars<T, DIM>::estimateSolutionAndGradient(const PDE<T, DIM>&
     std::vector<float> stratifiedSamples;
     generateStratifiedSamples<DIM - 1>(stratifiedSamples, 2*nWalks, samplePt.sampler);
 
+    // draw walk directions from the sample generator, if any, using a new sequence per call
+    uint32_t sequenceSeed = walkSettings.sampleGenerator ? samplePt.sampler.nextUInt() : 0;
+
     // perform random walks
     for (int w = 0; w < nWalks; w++) {
         // initialize temporary variables for antithetic sampling
@@ -678,17 +802,18 @@ inline void WalkOnStars<T, DIM>::estimateSolutionAndGradient(const PDE<T, DIM>&
 
             // perform walk
             samplePt.sampler.seed(seed);
+            state.sampleStream = SampleStream(walkSettings.sampleGenerator.get(), sequenceSeed, w,
+                                              walkSettings.stepsUsingSampleGenerator);
             WalkCompletionCode code = walk(pde, walkSettings, distToAbsorbingBoundary, 0.0f,
                                            false, samplePt.sampler, state);
 
-            if ((code == WalkCompletionCode::ReachedAbsorbingBoundary ||
-                 code == WalkCompletionCode::TerminatedWithRussianRoulette) ||
-                (code == WalkCompletionCode::ExceededMaxWalkLength && terminalContributionCallback)) {
+            if (contributesToEstimate(code)) {
                 // compute the walk contribution
                 T terminalContribution = getTerminalContribution(code, pde, walkSettings, state);
                 T totalContribution = state.throughput*terminalContribution +
                                       state.totalReflectingBoundaryContribution +
-                                      state.totalSourceContribution;
+                                      state.totalSourceContribution +
+                                      state.totalSplitContribution;
 
                 // compute the gradient contribution
                 T boundaryGradientEstimate[DIM];
@@ -0,0 +1,402 @@
+// This file provides utilities to write and read binary cache files, which are used to
+// persist data that is expensive to recompute (e.g., acceleration structures) across runs.
+// Cache files begin with a small header containing a magic number, a format version and a
+// content hash that callers compute from the inputs used to produce the cached data, so
+// that stale caches can be detected and rebuilt. Files are memory mapped for reading,
+// and arrays stored in a cache can be accessed in place without an intermediate copy.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#ifdef _WIN32
+    #include <iterator>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#define BINARY_CACHE_MAGIC 0x43424d5au // "ZMBC"
+#define BINARY_CACHE_ALIGNMENT 16
+
+namespace zombie {
+
+// computes a 64-bit FNV-1a hash of a range of bytes; a previously computed hash can be
+// passed in to combine the hashes of several ranges
+uint64_t hashBytes(const void *data, size_t nBytes, uint64_t hash=14695981039346656037ull);
+
+template <typename T>
+uint64_t hashValue(const T& value, uint64_t hash=14695981039346656037ull);
+
+template <typename T>
+uint64_t hashVector(const std::vector<T>& values, uint64_t hash=14695981039346656037ull);
+
+// combines the hash of the contents of a file into the given hash, e.g., to key a cache on the
+// files that define the inputs of the cached data; returns false if the file could not be read
+bool hashFile(const std::string& filename, uint64_t& hash);
+
+// Read-only memory mapped view of a file
+class MemoryMappedFile {
+public:
+    // constructor
+    MemoryMappedFile();
+
+    // destructor
+    ~MemoryMappedFile();
+
+    // maps the file into memory; returns false if the file could not be opened. An empty
+    // file is opened successfully with a null data pointer and zero size
+    bool open(const std::string& filename);
+
+    // unmaps the file
+    void close();
+
+    // returns a pointer to the start of the mapped file
+    const uint8_t *data() const;
+
+    // returns the size of the mapped file in bytes
+    size_t size() const;
+
+protected:
+    // members
+    const uint8_t *ptr;
+    size_t nBytes;
+#ifdef _WIN32
+    std::vector<uint8_t> buffer;
+#endif
+};
+
+// Helper class to sequentially write values and arrays to a binary cache file
+class BinaryCacheWriter {
+public:
+    // constructor
+    BinaryCacheWriter(const std::string& filename, uint32_t version, uint64_t contentHash);
+
+    // returns whether the file was opened successfully
+    bool isOpen() const;
+
+    // writes a trivially copyable value
+    template <typename T>
+    void write(const T& value);
+
+    // writes an array of trivially copyable values, prefixed by its length
+    template <typename T>
+    void writeArray(const T *values, size_t n);
+
+    // writes a vector of trivially copyable values, prefixed by its length
+    template <typename T>
+    void writeVector(const std::vector<T>& values);
+
+    // flushes and closes the file; returns false if any write failed
+    bool close();
+
+protected:
+    // pads the file so that the next write starts at an aligned offset
+    void pad();
+
+    // members
+    std::ofstream out;
+    size_t offset;
+};
+
+// Helper class to sequentially read values and arrays from a memory mapped binary cache file
+class BinaryCacheReader {
+public:
+    // constructor
+    BinaryCacheReader();
+
+    // maps the file and validates its header; returns false if the file does not exist,
+    // is corrupt, or was written with a different version or content hash
+    bool open(const std::string& filename, uint32_t version, uint64_t contentHash);
+
+    // reads a trivially copyable value
+    template <typename T>
+    bool read(T& value);
+
+    // returns a pointer to an array stored in the mapped file without copying it, or
+    // nullptr if the array could not be read; the pointer is valid until the reader
+    // is destroyed
+    template <typename T>
+    const T *readArray(size_t& n);
+
+    // copies an array stored in the mapped file into a vector
+    template <typename T>
+    bool readVector(std::vector<T>& values);
+
+protected:
+    // skips padding so that the next read starts at an aligned offset
+    void skipPadding();
+
+    // members
+    MemoryMappedFile file;
+    size_t offset;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Implementation
+
+struct BinaryCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t contentHash;
+};
+
+inline uint64_t hashBytes(const void *data, size_t nBytes, uint64_t hash)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < nBytes; i++) {
+        hash ^= (uint64_t)bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+template <typename T>
+inline uint64_t hashValue(const T& value, uint64_t hash)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "hashValue(): type must be trivially copyable");
+    return hashBytes(&value, sizeof(T), hash);
+}
+
+template <typename T>
+inline uint64_t hashVector(const std::vector<T>& values, uint64_t hash)
+{
+    uint64_t n = values.size();
+    hash = hashValue<uint64_t>(n, hash);
+    if (n > 0) hash = hashBytes(values.data(), n*sizeof(T), hash);
+
+    return hash;
+}
+
+inline bool hashFile(const std::string& filename, uint64_t& hash)
+{
+    MemoryMappedFile file;
+    if (!file.open(filename)) return false;
+
+    hash = hashValue<uint64_t>((uint64_t)file.size(), hash);
+    hash = hashBytes(file.data(), file.size(), hash);
+
+    return true;
+}
+
+inline MemoryMappedFile::MemoryMappedFile(): ptr(nullptr), nBytes(0)
+{
+    // do nothing
+}
+
+inline MemoryMappedFile::~MemoryMappedFile()
+{
+    close();
+}
+
+inline bool MemoryMappedFile::open(const std::string& filename)
+{
+    close();
+
+#ifdef _WIN32
+    std::ifstream in(filename, std::ios::binary);
+    if (!in.is_open()) return false;
+
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    ptr = buffer.data();
+    nBytes = buffer.size();
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    if (st.st_size == 0) {
+        // mmap rejects empty mappings, so represent an empty file with a null view
+        ::close(fd);
+        return true;
+    }
+
+    void *mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping remains valid after the descriptor is closed
+    if (mapped == MAP_FAILED) return false;
+
+    ptr = static_cast<const uint8_t *>(mapped);
+    nBytes = (size_t)st.st_size;
+#endif
+
+    return true;
+}
+
+inline void MemoryMappedFile::close()
+{
+#ifdef _WIN32
+    buffer.clear();
+    buffer.shrink_to_fit();
+#else
+    if (ptr != nullptr) munmap(const_cast<uint8_t *>(ptr), nBytes);
+#endif
+
+    ptr = nullptr;
+    nBytes = 0;
+}
+
+inline const uint8_t* MemoryMappedFile::data() const
+{
+    return ptr;
+}
+
+inline size_t MemoryMappedFile::size() const
+{
+    return nBytes;
+}
+
+inline BinaryCacheWriter::BinaryCacheWriter(const std::string& filename, uint32_t version, uint64_t contentHash):
+out(filename, std::ios::binary | std::ios::trunc),
+offset(0)
+{
+    if (out.is_open()) {
+        BinaryCacheHeader header;
+        header.magic = BINARY_CACHE_MAGIC;
+        header.version = version;
+        header.contentHash = contentHash;
+        write(header);
+    }
+}
+
+inline bool BinaryCacheWriter::isOpen() const
+{
+    return out.is_open();
+}
+
+template <typename T>
+inline void BinaryCacheWriter::write(const T& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "BinaryCacheWriter::write(): type must be trivially copyable");
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    offset += sizeof(T);
+}
+
+template <typename T>
+inline void BinaryCacheWriter::writeArray(const T *values, size_t n)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "BinaryCacheWriter::writeArray(): type must be trivially copyable");
+    write<uint64_t>(n);
+    pad();
+
+    if (n > 0) {
+        out.write(reinterpret_cast<const char *>(values), n*sizeof(T));
+        offset += n*sizeof(T);
+    }
+}
+
+template <typename T>
+inline void BinaryCacheWriter::writeVector(const std::vector<T>& values)
+{
+    writeArray<T>(values.data(), values.size());
+}
+
+inline bool BinaryCacheWriter::close()
+{
+    if (!out.is_open()) return false;
+
+    out.flush();
+    bool success = out.good();
+    out.close();
+
+    return success;
+}
+
+inline void BinaryCacheWriter::pad()
+{
+    static const char zeros[BINARY_CACHE_ALIGNMENT] = {};
+    size_t remainder = offset%BINARY_CACHE_ALIGNMENT;
+
+    if (remainder > 0) {
+        size_t nPadding = BINARY_CACHE_ALIGNMENT - remainder;
+        out.write(zeros, nPadding);
+        offset += nPadding;
+    }
+}
+
+inline BinaryCacheReader::BinaryCacheReader(): offset(0)
+{
+    // do nothing
+}
+
+inline bool BinaryCacheReader::open(const std::string& filename, uint32_t version, uint64_t contentHash)
+{
+    offset = 0;
+    if (!file.open(filename)) return false;
+
+    BinaryCacheHeader header;
+    if (!read(header) ||
+        header.magic != BINARY_CACHE_MAGIC ||
+        header.version != version ||
+        header.contentHash != contentHash) {
+        file.close();
+        return false;
+    }
+
+    return true;
+}
+
+template <typename T>
+inline bool BinaryCacheReader::read(T& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "BinaryCacheReader::read(): type must be trivially copyable");
+    if (offset + sizeof(T) > file.size()) return false;
+
+    std::memcpy(&value, file.data() + offset, sizeof(T));
+    offset += sizeof(T);
+
+    return true;
+}
+
+template <typename T>
+inline const T* BinaryCacheReader::readArray(size_t& n)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "BinaryCacheReader::readArray(): type must be trivially copyable");
+    static_assert(alignof(T) <= BINARY_CACHE_ALIGNMENT, "BinaryCacheReader::readArray(): unsupported alignment");
+    uint64_t length = 0;
+    n = 0;
+    if (!read(length)) return nullptr;
+
+    skipPadding();
+    if (length > (file.size() - std::min(offset, file.size()))/std::max(sizeof(T), (size_t)1)) return nullptr;
+
+    const T *values = reinterpret_cast<const T *>(file.data() + offset);
+    offset += length*sizeof(T);
+    n = (size_t)length;
+
+    return values;
+}
+
+template <typename T>
+inline bool BinaryCacheReader::readVector(std::vector<T>& values)
+{
+    size_t n = 0;
+    const T *data = readArray<T>(n);
+    if (data == nullptr) return false;
+
+    values.resize(n);
+    if (n > 0) std::memcpy(values.data(), data, n*sizeof(T));
+
+    return true;
+}
+
+inline void BinaryCacheReader::skipPadding()
+{
+    size_t remainder = offset%BINARY_CACHE_ALIGNMENT;
+    if (remainder > 0) offset += BINARY_CACHE_ALIGNMENT - remainder;
+}
+
+} // zombie
@@ -3,11 +3,15 @@
 // and compute the bounding box of a mesh. The FcpwBoundaryHandler class builds an acceleration
 // structure to perform geometric queries against a mesh, while the 'populateGeometricQueries'
 // function populates the GeometricQueries structure using FcpwBoundaryHandler objects for the
-// absorbing (Dirichlet) and reflecting (Neumann or Robin) boundaries.
+// absorbing (Dirichlet) and reflecting (Neumann or Robin) boundaries. Partitioned boundary
+// meshes and the acceleration structures of boundary handlers can be written to and loaded
+// from binary caches to avoid rebuilding them on every run.
 
 #pragma once
 
 #include <zombie/core/geometric_queries.h>
+#include <zombie/utils/binary_cache.h>
+#include <zombie/utils/packet_width.h>
 #include <cmath>
 #include <fcpw/utilities/scene_loader.h>
 #include <zombie/utils/robin_boundary_bvh/baseline.h>
@@ -16,8 +20,12 @@
 #else
     #include <zombie/utils/robin_boundary_bvh/bvh.h>
 #endif
+#include <zombie/utils/robin_boundary_bvh/compressed_bvh.h>
 
 #define RAY_OFFSET 1e-6f
+#define BOUNDARY_CACHE_VERSION 4
+#define PARITY_RAY_EDGE_TOLERANCE 1e-5f
+#define MAX_PARITY_RAY_DIRECTIONS 4
 
 namespace zombie {
 
@@ -49,6 +57,32 @@ void partitionBoundaryMesh(const std::function<bool(const Vector<DIM>&)>& onRefl
                            std::vector<Vector<DIM>>& reflectingPositions,
                            std::vector<std::vector<size_t>>& reflectingIndices);
 
+// computes a hash of a boundary mesh and its Robin coefficients, for use as the content hash
+// of boundary caches; other settings that affect the cached data (e.g., the criterion used
+// by ignoreCandidateSilhouette) should be folded into the hash with hashValue
+template <size_t DIM>
+uint64_t computeBoundaryMeshHash(const std::vector<Vector<DIM>>& positions,
+                                 const std::vector<std::vector<size_t>>& indices,
+                                 const std::vector<float>& minRobinCoeffValues={},
+                                 const std::vector<float>& maxRobinCoeffValues={});
+
+// writes the absorbing and reflecting parts of a partitioned boundary mesh to a binary cache file
+template <size_t DIM>
+bool saveBoundaryMeshCache(const std::string& cacheFile, uint64_t contentHash,
+                           const std::vector<Vector<DIM>>& absorbingPositions,
+                           const std::vector<std::vector<size_t>>& absorbingIndices,
+                           const std::vector<Vector<DIM>>& reflectingPositions,
+                           const std::vector<std::vector<size_t>>& reflectingIndices);
+
+// loads a partitioned boundary mesh from a cache file written by saveBoundaryMeshCache;
+// returns false if the cache does not exist or was written for a different content hash
+template <size_t DIM>
+bool loadBoundaryMeshCache(const std::string& cacheFile, uint64_t contentHash,
+                           std::vector<Vector<DIM>>& absorbingPositions,
+                           std::vector<std::vector<size_t>>& absorbingIndices,
+                           std::vector<Vector<DIM>>& reflectingPositions,
+                           std::vector<std::vector<size_t>>& reflectingIndices);
+
 // Helper class to build an acceleration structure to perform geometric queries such as
 // ray intersection, closest point, etc. against a mesh. Also provides a utility function
 // to update Robin coefficients after building the acceleration structure.
@@ -75,6 +109,20 @@ public:
     // updates the Robin coefficients for the mesh
     void updateRobinCoefficients(const std::vector<float>& minRobinCoeffValues,
                                  const std::vector<float>& maxRobinCoeffValues);
+
+    // writes the boundary mesh and the data needed to restore the acceleration structure
+    // to a binary cache file; returns false if nothing has been built
+    bool saveAccelerationStructure(const std::string& cacheFile, uint64_t contentHash);
+
+    // restores an acceleration structure from a cache file written by saveAccelerationStructure;
+    // returns false if the cache does not exist or is stale, in which case buildAccelerationStructure
+    // should be called (and the cache saved) instead. NOTE: FCPW scenes and BVHs own their
+    // geometry and node storage and cannot adopt external arrays, so the cached arrays are
+    // read in place from the file mapping and copied once into the acceleration structure.
+    // For Robin conditions the cached BVH nodes are restored without rebuilding the BVH,
+    // while for Dirichlet and Neumann conditions FCPW rebuilds its BVH from the cached mesh.
+    bool loadAccelerationStructure(const std::string& cacheFile, uint64_t contentHash,
+                                   bool enableBvhVectorization=false);
 };
 
 // populates the GeometricQueries structure
@@ -274,6 +322,135 @@ void partitionBoundaryMesh(const std::function<bool(const Vector<DIM>&)>& onRefl
     }
 }
 
+template <size_t DIM>
+uint64_t computeBoundaryMeshHash(const std::vector<Vector<DIM>>& positions,
+                                 const std::vector<std::vector<size_t>>& indices,
+                                 const std::vector<float>& minRobinCoeffValues,
+                                 const std::vector<float>& maxRobinCoeffValues)
+{
+    uint64_t hash = hashValue<uint64_t>(DIM);
+    hash = hashValue<uint64_t>(positions.size(), hash);
+    for (size_t i = 0; i < positions.size(); i++) {
+        hash = hashBytes(positions[i].data(), DIM*sizeof(float), hash);
+    }
+
+    hash = hashValue<uint64_t>(indices.size(), hash);
+    for (size_t i = 0; i < indices.size(); i++) {
+        hash = hashVector<size_t>(indices[i], hash);
+    }
+
+    hash = hashVector<float>(minRobinCoeffValues, hash);
+    hash = hashVector<float>(maxRobinCoeffValues, hash);
+
+    return hash;
+}
+
+// identifies the contents of a boundary cache file, so that a file written by one
+// cache function is not mistaken for another
+enum class BoundaryCacheType : uint32_t {
+    Mesh,
+    FcpwScene,
+    RobinBvh
+};
+
+template <size_t DIM>
+void writeBoundaryCacheHeader(BinaryCacheWriter& writer, BoundaryCacheType type)
+{
+    writer.write<uint32_t>((uint32_t)type);
+    writer.write<uint32_t>((uint32_t)DIM);
+}
+
+template <size_t DIM>
+bool readBoundaryCacheHeader(BinaryCacheReader& reader, BoundaryCacheType type)
+{
+    uint32_t cachedType = 0, dim = 0;
+    return reader.read(cachedType) && cachedType == (uint32_t)type &&
+           reader.read(dim) && dim == DIM;
+}
+
+template <size_t DIM>
+void writeBoundaryMeshToCache(BinaryCacheWriter& writer,
+                              const std::vector<Vector<DIM>>& positions,
+                              const std::vector<std::vector<size_t>>& indices)
+{
+    std::vector<uint64_t> flatIndices(DIM*indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+        for (size_t j = 0; j < DIM; j++) {
+            flatIndices[DIM*i + j] = indices[i][j];
+        }
+    }
+
+    writer.writeArray<float>(reinterpret_cast<const float *>(positions.data()), DIM*positions.size());
+    writer.writeVector(flatIndices);
+}
+
+template <size_t DIM>
+bool readBoundaryMeshFromCache(BinaryCacheReader& reader,
+                               std::vector<Vector<DIM>>& positions,
+                               std::vector<std::vector<size_t>>& indices)
+{
+    size_t nPositionCoords = 0, nIndices = 0;
+    const float *flatPositions = reader.readArray<float>(nPositionCoords);
+    const uint64_t *flatIndices = reader.readArray<uint64_t>(nIndices);
+    if (flatPositions == nullptr || flatIndices == nullptr ||
+        nPositionCoords%DIM != 0 || nIndices%DIM != 0) {
+        return false;
+    }
+
+    size_t V = nPositionCoords/DIM;
+    positions.resize(V);
+    for (size_t i = 0; i < V; i++) {
+        for (size_t j = 0; j < DIM; j++) {
+            positions[i][j] = flatPositions[DIM*i + j];
+        }
+    }
+
+    size_t F = nIndices/DIM;
+    indices.resize(F);
+    for (size_t i = 0; i < F; i++) {
+        indices[i].resize(DIM);
+        for (size_t j = 0; j < DIM; j++) {
+            if (flatIndices[DIM*i + j] >= V) return false;
+            indices[i][j] = (size_t)flatIndices[DIM*i + j];
+        }
+    }
+
+    return true;
+}
+
+template <size_t DIM>
+bool saveBoundaryMeshCache(const std::string& cacheFile, uint64_t contentHash,
+                           const std::vector<Vector<DIM>>& absorbingPositions,
+                           const std::vector<std::vector<size_t>>& absorbingIndices,
+                           const std::vector<Vector<DIM>>& reflectingPositions,
+                           const std::vector<std::vector<size_t>>& reflectingIndices)
+{
+    BinaryCacheWriter writer(cacheFile, BOUNDARY_CACHE_VERSION, contentHash);
+    if (!writer.isOpen()) return false;
+
+    writeBoundaryCacheHeader<DIM>(writer, BoundaryCacheType::Mesh);
+    writeBoundaryMeshToCache<DIM>(writer, absorbingPositions, absorbingIndices);
+    writeBoundaryMeshToCache<DIM>(writer, reflectingPositions, reflectingIndices);
+
+    return writer.close();
+}
+
+template <size_t DIM>
+bool loadBoundaryMeshCache(const std::string& cacheFile, uint64_t contentHash,
+                           std::vector<Vector<DIM>>& absorbingPositions,
+                           std::vector<std::vector<size_t>>& absorbingIndices,
+                           std::vector<Vector<DIM>>& reflectingPositions,
+                           std::vector<std::vector<size_t>>& reflectingIndices)
+{
+    BinaryCacheReader reader;
+    if (!reader.open(cacheFile, BOUNDARY_CACHE_VERSION, contentHash)) return false;
+
+    if (!readBoundaryCacheHeader<DIM>(reader, BoundaryCacheType::Mesh)) return false;
+
+    return readBoundaryMeshFromCache<DIM>(reader, absorbingPositions, absorbingIndices) &&
+           readBoundaryMeshFromCache<DIM>(reader, reflectingPositions, reflectingIndices);
+}
+
 inline float intAsFloat(int a)
 {
     union {int a; float b;} u;
@@ -330,6 +507,57 @@ inline Vector3 offsetPointAlongDirection<3>(const Vector3& p, const Vector3& n)
                            std::fabs(p(2)) < origin ? p(2) + floatScale*n(2) : pOffset(2));
 }
 
+template <size_t DIM>
+inline Vector<DIM> computeParityRayDirection(int index)
+{
+    // directions from an additive recurrence with irrational increments, so that rays
+    // are unlikely to run parallel to axis aligned faces or pass exactly through vertices
+    const float alpha[3] = {0.7548776662f, 0.5698402910f, 0.4301597090f};
+    Vector<DIM> dir;
+    for (size_t i = 0; i < DIM; i++) {
+        float u = 0.5f + (index + 1)*alpha[i%3];
+        dir(i) = 2.0f*(u - std::floor(u)) - 1.0f;
+    }
+
+    return dir.normalized();
+}
+
+template <size_t DIM>
+inline bool isEdgeOrVertexHit(const fcpw::Interaction<DIM>& interaction)
+{
+    // a ray through a vertex (2D), or an edge or vertex (3D), is reported by zero, one or
+    // both of the primitives sharing it, so the hit count's parity is unreliable
+    if constexpr (DIM == 2) {
+        float s = interaction.uv(0);
+        return s < PARITY_RAY_EDGE_TOLERANCE || s > 1.0f - PARITY_RAY_EDGE_TOLERANCE;
+
+    } else {
+        float u = interaction.uv(0);
+        float v = interaction.uv(1);
+        float w = 1.0f - u - v;
+        return std::min(u, std::min(v, w)) < PARITY_RAY_EDGE_TOLERANCE;
+    }
+}
+
+template <size_t DIM, typename AggregateType>
+inline int countRayIntersections(const AggregateType *aggregate, const Vector<DIM>& origin,
+                                 const Vector<DIM>& dir, float tMax)
+{
+    // find all hits in a single traversal; FCPW has no count-only ray query, so the hits
+    // are written to a per-thread buffer that is reused across calls. Returns -1 if the
+    // ray passes through an edge or vertex of the boundary
+    fcpw::Ray<DIM> queryRay(origin, dir, tMax);
+    static thread_local std::vector<fcpw::Interaction<DIM>> queryInteractions;
+    queryInteractions.clear();
+    int nHits = aggregate->intersect(queryRay, queryInteractions, false, true);
+
+    for (int i = 0; i < nHits; i++) {
+        if (isEdgeOrVertexHit<DIM>(queryInteractions[i])) return -1;
+    }
+
+    return nHits;
+}
+
 template <size_t DIM, bool useRobinConditions>
 FcpwBoundaryHandler<DIM, useRobinConditions>::FcpwBoundaryHandler()
 {
@@ -364,11 +592,288 @@ void FcpwBoundaryHandler<DIM, useRobinConditions>::updateRobinCoefficients(const
     exit(EXIT_FAILURE);
 }
 
+template <size_t DIM, bool useRobinConditions>
+bool FcpwBoundaryHandler<DIM, useRobinConditions>::saveAccelerationStructure(const std::string& cacheFile,
+                                                                             uint64_t contentHash)
+{
+    std::cerr << "FcpwBoundaryHandler::saveAccelerationStructure: Unsupported dimension: " << DIM
+              << ", useRobinConditions: " << useRobinConditions
+              << std::endl;
+    exit(EXIT_FAILURE);
+
+    return false;
+}
+
+template <size_t DIM, bool useRobinConditions>
+bool FcpwBoundaryHandler<DIM, useRobinConditions>::loadAccelerationStructure(const std::string& cacheFile,
+                                                                             uint64_t contentHash,
+                                                                             bool enableBvhVectorization)
+{
+    std::cerr << "FcpwBoundaryHandler::loadAccelerationStructure: Unsupported dimension: " << DIM
+              << ", useRobinConditions: " << useRobinConditions
+              << std::endl;
+    exit(EXIT_FAILURE);
+
+    return false;
+}
+
+template <size_t DIM>
+struct RobinPrimitiveCacheRecord {
+    int index;
+    int indices[DIM];
+    float n[DIM][DIM];
+    float minRobinCoeff;
+    float maxRobinCoeff;
+    uint8_t hasAdjacentFace[DIM];
+    uint8_t ignoreAdjacentFace[DIM];
+};
+
+template <size_t DIM>
+struct RobinBvhNodeCacheRecord {
+    float boxMin[DIM];
+    float boxMax[DIM];
+    float coneAxis[DIM];
+    float coneHalfAngle;
+    float coneRadius;
+    int offset;
+    int nReferences;
+    float minRobinCoeff;
+    float maxRobinCoeff;
+};
+
+template <size_t DIM, typename PrimitiveType, typename NodeBound>
+bool saveRobinBoundaryCache(const std::string& cacheFile, uint64_t contentHash,
+                            const PolygonSoup<DIM>& soup,
+                            const std::vector<PrimitiveType *>& primitivePtrs,
+                            const RobinBvh<DIM, RobinBvhNode<DIM>, PrimitiveType, NodeBound> *bvh)
+{
+    if (bvh == nullptr) return false;
+    BinaryCacheWriter writer(cacheFile, BOUNDARY_CACHE_VERSION, contentHash);
+    if (!writer.isOpen()) return false;
+
+    // collect primitive data in the order referenced by the bvh
+    int P = (int)primitivePtrs.size();
+    std::vector<RobinPrimitiveCacheRecord<DIM>> primitiveRecords(P);
+    for (int i = 0; i < P; i++) {
+        const PrimitiveType *prim = primitivePtrs[i];
+        RobinPrimitiveCacheRecord<DIM>& record = primitiveRecords[i];
+        record.index = prim->getIndex();
+        record.minRobinCoeff = prim->minRobinCoeff;
+        record.maxRobinCoeff = prim->maxRobinCoeff;
+
+        for (size_t j = 0; j < DIM; j++) {
+            record.indices[j] = prim->indices[j];
+            record.hasAdjacentFace[j] = prim->hasAdjacentFace[j] ? 1 : 0;
+            record.ignoreAdjacentFace[j] = prim->ignoreAdjacentFace[j] ? 1 : 0;
+            for (size_t k = 0; k < DIM; k++) {
+                record.n[j][k] = prim->n[j][k];
+            }
+        }
+    }
+
+    // collect flattened bvh nodes
+    const std::vector<RobinBvhNode<DIM>>& flatTree = bvh->getFlatTree();
+    int N = (int)flatTree.size();
+    std::vector<RobinBvhNodeCacheRecord<DIM>> nodeRecords(N);
+    for (int i = 0; i < N; i++) {
+        const RobinBvhNode<DIM>& node = flatTree[i];
+        RobinBvhNodeCacheRecord<DIM>& record = nodeRecords[i];
+        record.coneHalfAngle = node.cone.halfAngle;
+        record.coneRadius = node.cone.radius;
+        record.offset = node.referenceOffset;
+        record.nReferences = node.nReferences;
+        record.minRobinCoeff = node.minRobinCoeff;
+        record.maxRobinCoeff = node.maxRobinCoeff;
+
+        for (size_t j = 0; j < DIM; j++) {
+            record.boxMin[j] = node.box.pMin[j];
+            record.boxMax[j] = node.box.pMax[j];
+            record.coneAxis[j] = node.cone.axis[j];
+        }
+    }
+
+    // write cache
+    writeBoundaryCacheHeader<DIM>(writer, BoundaryCacheType::RobinBvh);
+    writer.writeArray<float>(reinterpret_cast<const float *>(soup.positions.data()), DIM*soup.positions.size());
+    writer.writeVector(primitiveRecords);
+    writer.writeVector(nodeRecords);
+
+    return writer.close();
+}
+
+template <size_t DIM, typename PrimitiveType>
+bool readRobinBoundaryCache(const std::string& cacheFile, uint64_t contentHash,
+                            PolygonSoup<DIM>& soup,
+                            std::vector<PrimitiveType>& primitives,
+                            std::vector<PrimitiveType *>& primitivePtrs,
+                            std::vector<RobinBvhNode<DIM>>& flatTree)
+{
+    BinaryCacheReader reader;
+    if (!reader.open(cacheFile, BOUNDARY_CACHE_VERSION, contentHash)) return false;
+
+    if (!readBoundaryCacheHeader<DIM>(reader, BoundaryCacheType::RobinBvh)) return false;
+
+    // access cached arrays in place
+    size_t nPositionCoords = 0, P = 0, N = 0;
+    const float *positions = reader.readArray<float>(nPositionCoords);
+    const RobinPrimitiveCacheRecord<DIM> *primitiveRecords = reader.readArray<RobinPrimitiveCacheRecord<DIM>>(P);
+    const RobinBvhNodeCacheRecord<DIM> *nodeRecords = reader.readArray<RobinBvhNodeCacheRecord<DIM>>(N);
+    if (positions == nullptr || primitiveRecords == nullptr || nodeRecords == nullptr ||
+        nPositionCoords%DIM != 0 || P == 0 || N == 0) {
+        return false;
+    }
+
+    // restore soup positions
+    int V = (int)(nPositionCoords/DIM);
+    soup.positions.resize(V);
+    std::memcpy(soup.positions.data(), positions, nPositionCoords*sizeof(float));
+
+    // restore primitives in the order referenced by the bvh
+    soup.indices.resize(DIM*P);
+    primitives.clear();
+    primitives.resize(P);
+    primitivePtrs.resize(P, nullptr);
+    std::vector<uint8_t> isIndexRestored(P, 0);
+
+    for (int i = 0; i < (int)P; i++) {
+        // each face must be restored exactly once
+        const RobinPrimitiveCacheRecord<DIM>& record = primitiveRecords[i];
+        if (record.index < 0 || record.index >= (int)P || isIndexRestored[record.index]) return false;
+        isIndexRestored[record.index] = 1;
+
+        PrimitiveType& prim = primitives[i];
+        primitivePtrs[i] = &prim;
+        prim.soup = &soup;
+        prim.setIndex(record.index);
+        prim.minRobinCoeff = record.minRobinCoeff;
+        prim.maxRobinCoeff = record.maxRobinCoeff;
+
+        for (size_t j = 0; j < DIM; j++) {
+            if (record.indices[j] < 0 || record.indices[j] >= V) return false;
+
+            prim.indices[j] = record.indices[j];
+            prim.hasAdjacentFace[j] = record.hasAdjacentFace[j] != 0;
+            prim.ignoreAdjacentFace[j] = record.ignoreAdjacentFace[j] != 0;
+            soup.indices[DIM*record.index + j] = record.indices[j];
+            for (size_t k = 0; k < DIM; k++) {
+                prim.n[j][k] = record.n[j][k];
+            }
+        }
+    }
+
+    // restore flattened bvh nodes
+    flatTree.resize(N);
+    for (int i = 0; i < (int)N; i++) {
+        const RobinBvhNodeCacheRecord<DIM>& record = nodeRecords[i];
+        bool isLeaf = record.nReferences > 0;
+        if ((isLeaf && (record.offset < 0 || record.offset + record.nReferences > (int)P)) ||
+            (!isLeaf && (record.offset <= 0 || i + record.offset >= (int)N))) {
+            return false;
+        }
+
+        RobinBvhNode<DIM>& node = flatTree[i];
+        node.cone.halfAngle = record.coneHalfAngle;
+        node.cone.radius = record.coneRadius;
+        node.referenceOffset = record.offset;
+        node.nReferences = record.nReferences;
+        node.minRobinCoeff = record.minRobinCoeff;
+        node.maxRobinCoeff = record.maxRobinCoeff;
+
+        for (size_t j = 0; j < DIM; j++) {
+            node.box.pMin[j] = record.boxMin[j];
+            node.box.pMax[j] = record.boxMax[j];
+            node.cone.axis[j] = record.coneAxis[j];
+        }
+    }
+
+    return true;
+}
+
+template <size_t DIM, typename PrimitiveType>
+bool loadRobinBoundaryCache(const std::string& cacheFile, uint64_t contentHash,
+                            PolygonSoup<DIM>& soup,
+                            std::vector<PrimitiveType>& primitives,
+                            std::vector<PrimitiveType *>& primitivePtrs,
+                            std::vector<RobinBvhNode<DIM>>& flatTree)
+{
+    if (!readRobinBoundaryCache<DIM, PrimitiveType>(cacheFile, contentHash, soup,
+                                                    primitives, primitivePtrs, flatTree)) {
+        // leave no partially restored data behind
+        soup.positions.clear();
+        soup.indices.clear();
+        primitives.clear();
+        primitivePtrs.clear();
+        flatTree.clear();
+
+        return false;
+    }
+
+    return true;
+}
+
+template <size_t DIM>
+bool saveFcpwSceneCache(const std::string& cacheFile, uint64_t contentHash,
+                        const std::vector<Vector<DIM>>& positions,
+                        const std::vector<int>& indices,
+                        bool computeSilhouettes, bool buildBvh)
+{
+    if (positions.size() == 0) return false;
+    BinaryCacheWriter writer(cacheFile, BOUNDARY_CACHE_VERSION, contentHash);
+    if (!writer.isOpen()) return false;
+
+    writeBoundaryCacheHeader<DIM>(writer, BoundaryCacheType::FcpwScene);
+    writer.write<uint8_t>(computeSilhouettes ? 1 : 0);
+    writer.write<uint8_t>(buildBvh ? 1 : 0);
+    writer.writeArray<float>(reinterpret_cast<const float *>(positions.data()), DIM*positions.size());
+    writer.writeVector(indices);
+
+    return writer.close();
+}
+
+template <size_t DIM>
+bool loadFcpwSceneCache(BinaryCacheReader& reader,
+                        const std::string& cacheFile, uint64_t contentHash,
+                        const Vector<DIM> *& positions, int& V,
+                        const int *& indices, int& F,
+                        bool& computeSilhouettes, bool& buildBvh)
+{
+    if (!reader.open(cacheFile, BOUNDARY_CACHE_VERSION, contentHash)) return false;
+
+    uint8_t cachedComputeSilhouettes = 0, cachedBuildBvh = 0;
+    if (!readBoundaryCacheHeader<DIM>(reader, BoundaryCacheType::FcpwScene) ||
+        !reader.read(cachedComputeSilhouettes) || !reader.read(cachedBuildBvh)) {
+        return false;
+    }
+
+    // access the cached arrays in place; they remain valid while the reader is open
+    size_t nPositionCoords = 0, nIndices = 0;
+    const float *cachedPositions = reader.readArray<float>(nPositionCoords);
+    const int *cachedIndices = reader.readArray<int>(nIndices);
+    if (cachedPositions == nullptr || cachedIndices == nullptr ||
+        nPositionCoords == 0 || nPositionCoords%DIM != 0 || nIndices%DIM != 0) {
+        return false;
+    }
+
+    int nVertices = (int)(nPositionCoords/DIM);
+    for (size_t i = 0; i < nIndices; i++) {
+        if (cachedIndices[i] < 0 || cachedIndices[i] >= nVertices) return false;
+    }
+
+    positions = reinterpret_cast<const Vector<DIM> *>(cachedPositions);
+    V = nVertices;
+    indices = cachedIndices;
+    F = (int)(nIndices/DIM);
+    computeSilhouettes = cachedComputeSilhouettes != 0;
+    buildBvh = cachedBuildBvh != 0;
+
+    return true;
+}
+
 template <>
 class FcpwBoundaryHandler<2, false> {
 public:
     // constructor
-    FcpwBoundaryHandler() {}
+    FcpwBoundaryHandler(): meshComputeSilhouettes(false), meshBuildBvh(true) {}
 
     // builds an FCPW acceleration structure (specifically a bounding volume hierarchy) from
     // a set of positions and indices. For problems with Dirichlet or Robin boundary conditions,
@@ -384,39 +889,55 @@ public:
                                     const std::vector<float>& maxRobinCoeffValues={},
                                     bool buildBvh=true, bool enableBvhVectorization=false) {
         if (positions.size() > 0) {
-            // scene geometry is made up of line segments
-            std::vector<std::vector<fcpw::PrimitiveType>> objectTypes(
-                1, std::vector<fcpw::PrimitiveType>{fcpw::PrimitiveType::LineSegment});
-            scene.setObjectTypes(objectTypes);
-
-            // set the vertex and line segment count
-            int V = (int)positions.size();
-            int L = (int)indices.size();
-            scene.setObjectVertexCount(V, 0);
-            scene.setObjectLineSegmentCount(L, 0);
-
-            // specify the vertex positions
-            for (int i = 0; i < V; i++) {
-                scene.setObjectVertex(positions[i], i, 0);
+            // flatten the indices, which FCPW copies into the scene along with the positions
+            int F = (int)indices.size();
+            std::vector<int> flatIndices(2*F);
+            for (int i = 0; i < F; i++) {
+                for (int j = 0; j < 2; j++) {
+                    flatIndices[2*i + j] = (int)indices[i][j];
+                }
             }
 
-            // specify the line segment indices
-            for (int i = 0; i < L; i++) {
-                fcpw::Vector2i index(indices[i][0], indices[i][1]);
-                scene.setObjectLineSegment(index, i, 0);
-            }
+            meshComputeSilhouettes = computeSilhouettes;
+            meshBuildBvh = buildBvh;
+            buildScene(positions.data(), (int)positions.size(), flatIndices.data(), F,
+                       ignoreCandidateSilhouette, enableBvhVectorization);
+        }
+    }
 
-            // compute silhouettes
-            if (computeSilhouettes) {
-                scene.computeSilhouettes(ignoreCandidateSilhouette);
-            }
+    // writes the boundary mesh stored in the FCPW scene and the build settings to a binary
+    // cache file; returns false if nothing has been built, or if FCPW released the mesh
+    // data to reduce its memory footprint after building a vectorized BVH
+    bool saveAccelerationStructure(const std::string& cacheFile, uint64_t contentHash) {
+        const std::unique_ptr<fcpw::SceneData<2>>& sceneData = scene.getSceneData();
+        if (sceneData == nullptr || sceneData->soups.size() == 0) return false;
 
-            // build aggregate
-            fcpw::AggregateType aggregateType = buildBvh ?
-                                                fcpw::AggregateType::Bvh_SurfaceArea :
-                                                fcpw::AggregateType::Baseline;
-            scene.build(aggregateType, enableBvhVectorization, true, true);
+        const fcpw::PolygonSoup<2>& soup = sceneData->soups[0];
+        return saveFcpwSceneCache<2>(cacheFile, contentHash, soup.positions, soup.indices,
+                                     meshComputeSilhouettes, meshBuildBvh);
+    }
+
+    // loads the boundary mesh and build settings from a cache file written by
+    // saveAccelerationStructure, and rebuilds the acceleration structure from them; returns
+    // false if the cache does not exist or is stale, in which case buildAccelerationStructure
+    // should be called (and the cache saved) instead. NOTE: FCPW scenes own their geometry
+    // and BVH and cannot adopt external storage, so the cached mesh is read in place from
+    // the file mapping and copied once into the scene, and the BVH is rebuilt; only mesh
+    // loading and preprocessing are skipped
+    bool loadAccelerationStructure(const std::string& cacheFile, uint64_t contentHash,
+                                   bool enableBvhVectorization=false,
+                                   std::function<bool(float, int)> ignoreCandidateSilhouette={}) {
+        BinaryCacheReader reader;
+        const Vector2 *positions = nullptr;
+        const int *indices = nullptr;
+        int V = 0, F = 0;
+        if (!loadFcpwSceneCache<2>(reader, cacheFile, contentHash, positions, V, indices, F,
+                                    meshComputeSilhouettes, meshBuildBvh)) {
+            return false;
         }
+
+        buildScene(positions, V, indices, F, ignoreCandidateSilhouette, enableBvhVectorization);
+        return true;
     }
 
     // updates the Robin coefficients for the mesh
@@ -426,15 +947,53 @@ public:
         exit(EXIT_FAILURE);
     }
 
-    // member
+    // builds the FCPW scene from V positions and F faces with flattened indices
+    void buildScene(const Vector2 *positions, int V, const int *indices, int F,
+                    std::function<bool(float, int)> ignoreCandidateSilhouette,
+                    bool enableBvhVectorization) {
+        // scene geometry is made up of line segments
+        std::vector<std::vector<fcpw::PrimitiveType>> objectTypes(
+            1, std::vector<fcpw::PrimitiveType>{fcpw::PrimitiveType::LineSegment});
+        scene.setObjectTypes(objectTypes);
+
+        // set the vertex and line segment count
+        scene.setObjectVertexCount(V, 0);
+        scene.setObjectLineSegmentCount(F, 0);
+
+        // specify the vertex positions
+        for (int i = 0; i < V; i++) {
+            scene.setObjectVertex(positions[i], i, 0);
+        }
+
+        // specify the line segment indices
+        for (int i = 0; i < F; i++) {
+            fcpw::Vector2i index(indices[2*i], indices[2*i + 1]);
+            scene.setObjectLineSegment(index, i, 0);
+        }
+
+        // compute silhouettes
+        if (meshComputeSilhouettes) {
+            scene.computeSilhouettes(ignoreCandidateSilhouette);
+        }
+
+        // build aggregate
+        fcpw::AggregateType aggregateType = meshBuildBvh ?
+                                            fcpw::AggregateType::Bvh_SurfaceArea :
+                                            fcpw::AggregateType::Baseline;
+        scene.build(aggregateType, enableBvhVectorization, true, true);
+    }
+
+    // members
     fcpw::Scene<2> scene;
+    bool meshComputeSilhouettes;
+    bool meshBuildBvh;
 };
 
 template <>
 class FcpwBoundaryHandler<3, false> {
 public:
     // constructor
-    FcpwBoundaryHandler() {}
+    FcpwBoundaryHandler(): meshComputeSilhouettes(false), meshBuildBvh(true) {}
 
     // builds an FCPW acceleration structure (specifically a bounding volume hierarchy) from
     // a set of positions and indices. For problems with Dirichlet or Robin boundary conditions,
@@ -450,39 +1009,55 @@ public:
                                     const std::vector<float>& maxRobinCoeffValues={},
                                     bool buildBvh=true, bool enableBvhVectorization=false) {
         if (positions.size() > 0) {
-            // scene geometry is made up of triangles
-            std::vector<std::vector<fcpw::PrimitiveType>> objectTypes(
-                1, std::vector<fcpw::PrimitiveType>{fcpw::PrimitiveType::Triangle});
-            scene.setObjectTypes(objectTypes);
-
-            // set the vertex and triangle count
-            int V = (int)positions.size();
-            int T = (int)indices.size();
-            scene.setObjectVertexCount(V, 0);
-            scene.setObjectTriangleCount(T, 0);
-
-            // specify the vertex positions
-            for (int i = 0; i < V; i++) {
-                scene.setObjectVertex(positions[i], i, 0);
+            // flatten the indices, which FCPW copies into the scene along with the positions
+            int F = (int)indices.size();
+            std::vector<int> flatIndices(3*F);
+            for (int i = 0; i < F; i++) {
+                for (int j = 0; j < 3; j++) {
+                    flatIndices[3*i + j] = (int)indices[i][j];
+                }
             }
 
-            // specify the triangle indices
-            for (int i = 0; i < T; i++) {
-                fcpw::Vector3i index(indices[i][0], indices[i][1], indices[i][2]);
-                scene.setObjectTriangle(index, i, 0);
-            }
+            meshComputeSilhouettes = computeSilhouettes;
+            meshBuildBvh = buildBvh;
+            buildScene(positions.data(), (int)positions.size(), flatIndices.data(), F,
+                       ignoreCandidateSilhouette, enableBvhVectorization);
+        }
+    }
 
-            // compute silhouettes
-            if (computeSilhouettes) {
-                scene.computeSilhouettes(ignoreCandidateSilhouette);
-            }
+    // writes the boundary mesh stored in the FCPW scene and the build settings to a binary
+    // cache file; returns false if nothing has been built, or if FCPW released the mesh
+    // data to reduce its memory footprint after building a vectorized BVH
+    bool saveAccelerationStructure(const std::string& cacheFile, uint64_t contentHash) {
+        const std::unique_ptr<fcpw::SceneData<3>>& sceneData = scene.getSceneData();
+        if (sceneData == nullptr || sceneData->soups.size() == 0) return false;
 
-            // build aggregate
-            fcpw::AggregateType aggregateType = buildBvh ?
-                                                fcpw::AggregateType::Bvh_SurfaceArea :
-                                                fcpw::AggregateType::Baseline;
-            scene.build(aggregateType, enableBvhVectorization, true, true);
+        const fcpw::PolygonSoup<3>& soup = sceneData->soups[0];
+        return saveFcpwSceneCache<3>(cacheFile, contentHash, soup.positions, soup.indices,
+                                     meshComputeSilhouettes, meshBuildBvh);
+    }
+
+    // loads the boundary mesh and build settings from a cache file written by
+    // saveAccelerationStructure, and rebuilds the acceleration structure from them; returns
+    // false if the cache does not exist or is stale, in which case buildAccelerationStructure
+    // should be called (and the cache saved) instead. NOTE: FCPW scenes own their geometry
+    // and BVH and cannot adopt external storage, so the cached mesh is read in place from
+    // the file mapping and copied once into the scene, and the BVH is rebuilt; only mesh
+    // loading and preprocessing are skipped
+    bool loadAccelerationStructure(const std::string& cacheFile, uint64_t contentHash,
+                                   bool enableBvhVectorization=false,
+                                   std::function<bool(float, int)> ignoreCandidateSilhouette={}) {
+        BinaryCacheReader reader;
+        const Vector3 *positions = nullptr;
+        const int *indices = nullptr;
+        int V = 0, F = 0;
+        if (!loadFcpwSceneCache<3>(reader, cacheFile, contentHash, positions, V, indices, F,
+                                    meshComputeSilhouettes, meshBuildBvh)) {
+            return false;
         }
+
+        buildScene(positions, V, indices, F, ignoreCandidateSilhouette, enableBvhVectorization);
+        return true;
     }
 
     // updates the Robin coefficients for the mesh
@@ -492,8 +1067,46 @@ public:
         exit(EXIT_FAILURE);
     }
 
-    // member
+    // builds the FCPW scene from V positions and F faces with flattened indices
+    void buildScene(const Vector3 *positions, int V, const int *indices, int F,
+                    std::function<bool(float, int)> ignoreCandidateSilhouette,
+                    bool enableBvhVectorization) {
+        // scene geometry is made up of triangles
+        std::vector<std::vector<fcpw::PrimitiveType>> objectTypes(
+            1, std::vector<fcpw::PrimitiveType>{fcpw::PrimitiveType::Triangle});
+        scene.setObjectTypes(objectTypes);
+
+        // set the vertex and triangle count
+        scene.setObjectVertexCount(V, 0);
+        scene.setObjectTriangleCount(F, 0);
+
+        // specify the vertex positions
+        for (int i = 0; i < V; i++) {
+            scene.setObjectVertex(positions[i], i, 0);
+        }
+
+        // specify the triangle indices
+        for (int i = 0; i < F; i++) {
+            fcpw::Vector3i index(indices[3*i], indices[3*i + 1], indices[3*i + 2]);
+            scene.setObjectTriangle(index, i, 0);
+        }
+
+        // compute silhouettes
+        if (meshComputeSilhouettes) {
+            scene.computeSilhouettes(ignoreCandidateSilhouette);
+        }
+
+        // build aggregate
+        fcpw::AggregateType aggregateType = meshBuildBvh ?
+                                            fcpw::AggregateType::Bvh_SurfaceArea :
+                                            fcpw::AggregateType::Baseline;
+        scene.build(aggregateType, enableBvhVectorization, true, true);
+    }
+
+    // members
     fcpw::Scene<3> scene;
+    bool meshComputeSilhouettes;
+    bool meshBuildBvh;
 };
 
 template <>
@@ -503,8 +1116,12 @@ public:
     FcpwBoundaryHandler() {
         baseline = nullptr;
         bvh = nullptr;
+        compressedBvh = nullptr;
+        vectorWidth = 0;
 #ifdef FCPW_USE_ENOKI
-        mbvh = nullptr;
+        mbvh4 = nullptr;
+        mbvh8 = nullptr;
+        mbvh16 = nullptr;
 #endif
     }
 
@@ -592,14 +1209,15 @@ public:
             }
 
             // build aggregate
+            vectorWidth = 0;
+            compressedBvh = nullptr;
             if (buildBvh) {
                 if (enableBvhVectorization) {
 #ifdef FCPW_USE_ENOKI
+                    vectorWidth = selectPacketWidth();
                     bvh = createRobinBvh<2, RobinLineSegment<PrimitiveBound>, NodeBound>(soup, lineSegmentPtrs, silhouettePtrsStub,
-                                                                                         true, true, FCPW_SIMD_WIDTH);
-                    mbvh = createVectorizedRobinBvh<2, RobinLineSegment<PrimitiveBound>, WideNodeBound, NodeBound>(
-                                                                                         bvh.get(), lineSegmentPtrs,
-                                                                                         silhouettePtrsStub, true);
+                                                                                         true, true, vectorWidth);
+                    buildVectorizedBvh();
 #else
                     bvh = createRobinBvh<2, RobinLineSegment<PrimitiveBound>, NodeBound>(soup, lineSegmentPtrs, silhouettePtrsStub);
 #endif
@@ -613,6 +1231,51 @@ public:
         }
     }
 
+    // writes the boundary mesh, per-face Robin data and the flattened BVH to a binary cache
+    // file; returns false if no BVH has been built
+    bool saveAccelerationStructure(const std::string& cacheFile, uint64_t contentHash) const {
+        return saveRobinBoundaryCache<2, RobinLineSegment<PrimitiveBound>, NodeBound>(cacheFile, contentHash, soup, lineSegmentPtrs,
+                                                                                      bvh.get());
+    }
+
+    // loads an acceleration structure from a cache file written by saveAccelerationStructure,
+    // skipping BVH construction; returns false if the cache does not exist, is stale or is
+    // corrupt, in which case the handler is left empty and buildAccelerationStructure should
+    // be called (and the cache saved) instead.
+    // NOTE: the BVH stores its nodes in FCPW's flattened node array, which cannot adopt
+    // external storage, so cached arrays are read in place from the file mapping and copied
+    // once into the soup, primitives and BVH nodes. The cache does not depend on the packet
+    // width: the vectorized BVH is collapsed from the cached nodes with the width selected
+    // for this host, so a cache written on a host with a different width remains valid
+    bool loadAccelerationStructure(const std::string& cacheFile, uint64_t contentHash,
+                                   bool enableBvhVectorization=false) {
+        int width = 0;
+#ifdef FCPW_USE_ENOKI
+        if (enableBvhVectorization) width = selectPacketWidth();
+        mbvh4 = nullptr;
+        mbvh8 = nullptr;
+        mbvh16 = nullptr;
+#endif
+        baseline = nullptr;
+        bvh = nullptr;
+        compressedBvh = nullptr;
+        vectorWidth = 0;
+
+        std::vector<RobinBvhNode<2>> flatTree;
+        if (!loadRobinBoundaryCache<2, RobinLineSegment<PrimitiveBound>>(cacheFile, contentHash, soup,
+                                                                         lineSegments, lineSegmentPtrs, flatTree)) {
+            return false;
+        }
+
+        bvh = createRobinBvh<2, RobinLineSegment<PrimitiveBound>, NodeBound>(lineSegmentPtrs, silhouettePtrsStub, std::move(flatTree));
+        vectorWidth = width;
+#ifdef FCPW_USE_ENOKI
+        if (vectorWidth > 0) buildVectorizedBvh();
+#endif
+
+        return bvh != nullptr;
+    }
+
     // updates the Robin coefficients for the mesh
     void updateRobinCoefficients(const std::vector<float>& minRobinCoeffValues,
                                  const std::vector<float>& maxRobinCoeffValues) {
@@ -620,29 +1283,81 @@ public:
             baseline->updateRobinCoefficients(minRobinCoeffValues, maxRobinCoeffValues);
 
 #ifdef FCPW_USE_ENOKI
-        } else if (mbvh != nullptr) {
-            mbvh->updateRobinCoefficients(minRobinCoeffValues, maxRobinCoeffValues);
+        } else if (vectorWidth > 0) {
+            applyToVectorizedBvh([&](auto *mbvh) {
+                mbvh->updateRobinCoefficients(minRobinCoeffValues, maxRobinCoeffValues);
+            });
 #endif
         } else if (bvh != nullptr) {
             bvh->updateRobinCoefficients(minRobinCoeffValues, maxRobinCoeffValues);
         }
+
+        if (compressedBvh != nullptr) {
+            compressedBvh->updateRobinCoefficients();
+        }
+    }
+
+    // builds a compressed copy of the BVH with quantized node bounds, which is used in
+    // place of the BVH for star radius queries to reduce memory traffic during traversal;
+    // requires a non-vectorized BVH to have been built or loaded
+    void compressAccelerationStructure(bool printStats=true) {
+        compressedBvh = nullptr;
+        if (bvh != nullptr && vectorWidth == 0) {
+            compressedBvh = createCompressedRobinBvh<2, RobinLineSegment<PrimitiveBound>, NodeBound>(
+                                                                    bvh.get(), lineSegmentPtrs, printStats);
+        }
     }
 
+#ifdef FCPW_USE_ENOKI
+    // collapses the BVH into a wide BVH whose leaf packets have the selected width; all
+    // widths are instantiated so that the width can be selected at runtime
+    void buildVectorizedBvh() {
+        mbvh4 = nullptr;
+        mbvh8 = nullptr;
+        mbvh16 = nullptr;
+
+        if (vectorWidth == 16) {
+            mbvh16 = createVectorizedRobinBvh<2, RobinLineSegment<PrimitiveBound>, WideNodeBound, NodeBound, 16>(
+                                                                    bvh.get(), lineSegmentPtrs, silhouettePtrsStub, true);
+
+        } else if (vectorWidth == 8) {
+            mbvh8 = createVectorizedRobinBvh<2, RobinLineSegment<PrimitiveBound>, WideNodeBound, NodeBound, 8>(
+                                                                    bvh.get(), lineSegmentPtrs, silhouettePtrsStub, true);
+
+        } else {
+            mbvh4 = createVectorizedRobinBvh<2, RobinLineSegment<PrimitiveBound>, WideNodeBound, NodeBound, 4>(
+                                                                    bvh.get(), lineSegmentPtrs, silhouettePtrsStub, true);
+        }
+    }
+
+    // invokes the callback with the vectorized BVH of the selected packet width
+    template <typename Callback>
+    void applyToVectorizedBvh(Callback callback) const {
+        if (mbvh16 != nullptr) callback(mbvh16.get());
+        else if (mbvh8 != nullptr) callback(mbvh8.get());
+        else if (mbvh4 != nullptr) callback(mbvh4.get());
+    }
+#endif
+
     // members
     typedef RobinLineSegmentBound PrimitiveBound;
     typedef RobinBvhNodeBound<2> NodeBound;
     std::unique_ptr<RobinBaseline<2, RobinLineSegment<PrimitiveBound>>> baseline;
     std::unique_ptr<RobinBvh<2, RobinBvhNode<2>, RobinLineSegment<PrimitiveBound>, NodeBound>> bvh;
+    std::unique_ptr<RobinCompressedBvh<2, RobinLineSegment<PrimitiveBound>, NodeBound>> compressedBvh;
 #ifdef FCPW_USE_ENOKI
     typedef RobinMbvhNodeBound<2> WideNodeBound;
-    std::unique_ptr<RobinMbvh<FCPW_SIMD_WIDTH, 2,
-                              RobinLineSegment<PrimitiveBound>,
-                              RobinMbvhNode<2>, WideNodeBound>> mbvh;
+    template <size_t WIDTH>
+    using RobinMbvhType = RobinMbvh<WIDTH, 2, RobinLineSegment<PrimitiveBound>, RobinMbvhNode<2>, WideNodeBound>;
+    std::unique_ptr<RobinMbvhType<4>> mbvh4;
+    std::unique_ptr<RobinMbvhType<8>> mbvh8;
+    std::unique_ptr<RobinMbvhType<16>> mbvh16;
 #endif
     PolygonSoup<2> soup;
     std::vector<RobinLineSegment<PrimitiveBound>> lineSegments;
     std::vector<RobinLineSegment<PrimitiveBound> *> lineSegmentPtrs;
     std::vector<fcpw::SilhouettePrimitive<2> *> silhouettePtrsStub;
+    int vectorWidth; // leaf packet width of the vectorized BVH, 0 if not vectorized
 };
 
 template <>
@@ -652,8 +1367,12 @@ public:
     FcpwBoundaryHandler() {
         baseline = nullptr;
         bvh = nullptr;
+        compressedBvh = nullptr;
+        vectorWidth = 0;
 #ifdef FCPW_USE_ENOKI
-        mbvh = nullptr;
+        mbvh4 = nullptr;
+        mbvh8 = nullptr;
+        mbvh16 = nullptr;
 #endif
     }
 
@@ -768,14 +1487,15 @@ public:
             }
 
             // build aggregate
+            vectorWidth = 0;
+            compressedBvh = nullptr;
             if (buildBvh) {
                 if (enableBvhVectorization) {
 #ifdef FCPW_USE_ENOKI
+                    vectorWidth = selectPacketWidth();
                     bvh = createRobinBvh<3, RobinTriangle<PrimitiveBound>, NodeBound>(soup, trianglePtrs, silhouettePtrsStub,
-                                                                                      true, true, FCPW_SIMD_WIDTH);
-                    mbvh = createVectorizedRobinBvh<3, RobinTriangle<PrimitiveBound>, WideNodeBound, NodeBound>(
-                                                                                      bvh.get(), trianglePtrs,
-                                                                                      silhouettePtrsStub, true);
+                                                                                      true, true, vectorWidth);
+                    buildVectorizedBvh();
 #else
                     bvh = createRobinBvh<3, RobinTriangle<PrimitiveBound>, NodeBound>(soup, trianglePtrs, silhouettePtrsStub);
 #endif
@@ -789,6 +1509,51 @@ public:
         }
     }
 
+    // writes the boundary mesh, per-face Robin data and the flattened BVH to a binary cache
+    // file; returns false if no BVH has been built
+    bool saveAccelerationStructure(const std::string& cacheFile, uint64_t contentHash) const {
+        return saveRobinBoundaryCache<3, RobinTriangle<PrimitiveBound>, NodeBound>(cacheFile, contentHash, soup, trianglePtrs,
+                                                                                   bvh.get());
+    }
+
+    // loads an acceleration structure from a cache file written by saveAccelerationStructure,
+    // skipping BVH construction; returns false if the cache does not exist, is stale or is
+    // corrupt, in which case the handler is left empty and buildAccelerationStructure should
+    // be called (and the cache saved) instead.
+    // NOTE: the BVH stores its nodes in FCPW's flattened node array, which cannot adopt
+    // external storage, so cached arrays are read in place from the file mapping and copied
+    // once into the soup, primitives and BVH nodes. The cache does not depend on the packet
+    // width: the vectorized BVH is collapsed from the cached nodes with the width selected
+    // for this host, so a cache written on a host with a different width remains valid
+    bool loadAccelerationStructure(const std::string& cacheFile, uint64_t contentHash,
+                                   bool enableBvhVectorization=false) {
+        int width = 0;
+#ifdef FCPW_USE_ENOKI
+        if (enableBvhVectorization) width = selectPacketWidth();
+        mbvh4 = nullptr;
+        mbvh8 = nullptr;
+        mbvh16 = nullptr;
+#endif
+        baseline = nullptr;
+        bvh = nullptr;
+        compressedBvh = nullptr;
+        vectorWidth = 0;
+
+        std::vector<RobinBvhNode<3>> flatTree;
+        if (!loadRobinBoundaryCache<3, RobinTriangle<PrimitiveBound>>(cacheFile, contentHash, soup,
+                                                                      triangles, trianglePtrs, flatTree)) {
+            return false;
+        }
+
+        bvh = createRobinBvh<3, RobinTriangle<PrimitiveBound>, NodeBound>(trianglePtrs, silhouettePtrsStub, std::move(flatTree));
+        vectorWidth = width;
+#ifdef FCPW_USE_ENOKI
+        if (vectorWidth > 0) buildVectorizedBvh();
+#endif
+
+        return bvh != nullptr;
+    }
+
     // updates the Robin coefficients for the mesh
     void updateRobinCoefficients(const std::vector<float>& minRobinCoeffValues,
                                  const std::vector<float>& maxRobinCoeffValues) {
@@ -796,29 +1561,81 @@ public:
             baseline->updateRobinCoefficients(minRobinCoeffValues, maxRobinCoeffValues);
 
 #ifdef FCPW_USE_ENOKI
-        } else if (mbvh != nullptr) {
-            mbvh->updateRobinCoefficients(minRobinCoeffValues, maxRobinCoeffValues);
+        } else if (vectorWidth > 0) {
+            applyToVectorizedBvh([&](auto *mbvh) {
+                mbvh->updateRobinCoefficients(minRobinCoeffValues, maxRobinCoeffValues);
+            });
 #endif
         } else if (bvh != nullptr) {
             bvh->updateRobinCoefficients(minRobinCoeffValues, maxRobinCoeffValues);
         }
+
+        if (compressedBvh != nullptr) {
+            compressedBvh->updateRobinCoefficients();
+        }
     }
 
+    // builds a compressed copy of the BVH with quantized node bounds, which is used in
+    // place of the BVH for star radius queries to reduce memory traffic during traversal;
+    // requires a non-vectorized BVH to have been built or loaded
+    void compressAccelerationStructure(bool printStats=true) {
+        compressedBvh = nullptr;
+        if (bvh != nullptr && vectorWidth == 0) {
+            compressedBvh = createCompressedRobinBvh<3, RobinTriangle<PrimitiveBound>, NodeBound>(
+                                                                    bvh.get(), trianglePtrs, printStats);
+        }
+    }
+
+#ifdef FCPW_USE_ENOKI
+    // collapses the BVH into a wide BVH whose leaf packets have the selected width; all
+    // widths are instantiated so that the width can be selected at runtime
+    void buildVectorizedBvh() {
+        mbvh4 = nullptr;
+        mbvh8 = nullptr;
+        mbvh16 = nullptr;
+
+        if (vectorWidth == 16) {
+            mbvh16 = createVectorizedRobinBvh<3, RobinTriangle<PrimitiveBound>, WideNodeBound, NodeBound, 16>(
+                                                                    bvh.get(), trianglePtrs, silhouettePtrsStub, true);
+
+        } else if (vectorWidth == 8) {
+            mbvh8 = createVectorizedRobinBvh<3, RobinTriangle<PrimitiveBound>, WideNodeBound, NodeBound, 8>(
+                                                                    bvh.get(), trianglePtrs, silhouettePtrsStub, true);
+
+        } else {
+            mbvh4 = createVectorizedRobinBvh<3, RobinTriangle<PrimitiveBound>, WideNodeBound, NodeBound, 4>(
+                                                                    bvh.get(), trianglePtrs, silhouettePtrsStub, true);
+        }
+    }
+
+    // invokes the callback with the vectorized BVH of the selected packet width
+    template <typename Callback>
+    void applyToVectorizedBvh(Callback callback) const {
+        if (mbvh16 != nullptr) callback(mbvh16.get());
+        else if (mbvh8 != nullptr) callback(mbvh8.get());
+        else if (mbvh4 != nullptr) callback(mbvh4.get());
+    }
+#endif
+
     // members
     typedef RobinTriangleBound PrimitiveBound;
     typedef RobinBvhNodeBound<3> NodeBound;
     std::unique_ptr<RobinBaseline<3, RobinTriangle<PrimitiveBound>>> baseline;
     std::unique_ptr<RobinBvh<3, RobinBvhNode<3>, RobinTriangle<PrimitiveBound>, NodeBound>> bvh;
+    std::unique_ptr<RobinCompressedBvh<3, RobinTriangle<PrimitiveBound>, NodeBound>> compressedBvh;
 #ifdef FCPW_USE_ENOKI
     typedef RobinMbvhNodeBound<3> WideNodeBound;
-    std::unique_ptr<RobinMbvh<FCPW_SIMD_WIDTH, 3,
-                              RobinTriangle<PrimitiveBound>,
-                              RobinMbvhNode<3>, WideNodeBound>> mbvh;
+    template <size_t WIDTH>
+    using RobinMbvhType = RobinMbvh<WIDTH, 3, RobinTriangle<PrimitiveBound>, RobinMbvhNode<3>, WideNodeBound>;
+    std::unique_ptr<RobinMbvhType<4>> mbvh4;
+    std::unique_ptr<RobinMbvhType<8>> mbvh8;
+    std::unique_ptr<RobinMbvhType<16>> mbvh16;
 #endif
     PolygonSoup<3> soup;
     std::vector<RobinTriangle<PrimitiveBound>> triangles;
     std::vector<RobinTriangle<PrimitiveBound> *> trianglePtrs;
     std::vector<fcpw::SilhouettePrimitive<3> *> silhouettePtrsStub;
+    int vectorWidth; // leaf packet width of the vectorized BVH, 0 if not vectorized
 };
 
 template <size_t DIM, typename AbsorbingBoundaryAggregateType, typename ReflectingBoundaryAggregateType>
@@ -1038,7 +1855,8 @@ void populateGeometricQueries(const AbsorbingBoundaryAggregateType *absorbingBou
 
             // intersect absorbing boundary
             fcpw::Ray<DIM> queryRay(queryOrigin, queryDir, tMax);
-            std::vector<fcpw::Interaction<DIM>> queryInteractions;
+            static thread_local std::vector<fcpw::Interaction<DIM>> queryInteractions;
+            queryInteractions.clear();
             int nHits = absorbingBoundaryAggregate->intersect(queryRay, queryInteractions, false, true);
             nIntersections += nHits;
 
@@ -1058,7 +1876,8 @@ void populateGeometricQueries(const AbsorbingBoundaryAggregateType *absorbingBou
 
             // intersect reflecting boundary
             fcpw::Ray<DIM> queryRay(queryOrigin, queryDir, tMax);
-            std::vector<fcpw::Interaction<DIM>> queryInteractions;
+            static thread_local std::vector<fcpw::Interaction<DIM>> queryInteractions;
+            queryInteractions.clear();
             int nHits = reflectingBoundaryAggregate->intersect(queryRay, queryInteractions, false, true);
             nIntersections += nHits;
 
@@ -1104,20 +1923,39 @@ void populateGeometricQueries(const AbsorbingBoundaryAggregateType *absorbingBou
 
         return false;
     };
+    geometricQueries.countBoundaryIntersections = [absorbingBoundaryAggregate, reflectingBoundaryAggregate](
+                                                   const Vector<DIM>& origin, const Vector<DIM>& dir,
+                                                   float tMax) -> int {
+        int nIntersections = 0;
+        if (absorbingBoundaryAggregate != nullptr) {
+            int nHits = countRayIntersections<DIM>(absorbingBoundaryAggregate, origin, dir, tMax);
+            if (nHits < 0) return -1;
+            nIntersections += nHits;
+        }
+
+        if (reflectingBoundaryAggregate != nullptr) {
+            int nHits = countRayIntersections<DIM>(reflectingBoundaryAggregate, origin, dir, tMax);
+            if (nHits < 0) return -1;
+            nIntersections += nHits;
+        }
+
+        return nIntersections;
+    };
     geometricQueries.insideDomain = [&geometricQueries](const Vector<DIM>& x, bool useRayIntersections) -> bool {
         if (!geometricQueries.domainIsWatertight) return true;
+        if (useRayIntersections && geometricQueries.computeWindingNumber) {
+            // winding numbers are robust to small gaps in the boundary
+            return std::fabs(geometricQueries.computeWindingNumber(x)) > 0.5f;
+        }
+
         if (useRayIntersections) {
-            bool isInside = true;
-            Vector<DIM> zero = Vector<DIM>::Zero();
-            for (size_t i = 0; i < DIM; i++) {
-                Vector<DIM> dir = zero;
-                dir(i) = 1.0f;
-                std::vector<IntersectionPoint<DIM>> is;
-                int hits = geometricQueries.intersectBoundaryAllHits(x, zero, dir, maxFloat, false, false, is);
-                isInside = isInside && (hits%2 == 1);
+            // a single ray suffices to classify the point by parity; another direction
+            // is only tried if the ray passes through an edge or vertex
+            for (int i = 0; i < MAX_PARITY_RAY_DIRECTIONS; i++) {
+                Vector<DIM> dir = computeParityRayDirection<DIM>(i);
+                int hits = geometricQueries.countBoundaryIntersections(x, dir, maxFloat);
+                if (hits >= 0) return hits%2 == 1;
             }
-
-            return isInside;
         }
 
         return geometricQueries.computeDistToBoundary(x, true) < 0.0f;
@@ -1182,6 +2020,23 @@ void populateStarRadiusQueryForRobinBoundary(const RobinBoundaryAggregateType *r
     };
 }
 
+// populates geometric queries for a Robin boundary aggregate, with star radius queries
+// answered by a possibly different aggregate over the same boundary
+template <size_t DIM, typename RobinBoundaryAggregateType, typename StarRadiusAggregateType>
+void populateRobinGeometricQueries(const fcpw::Aggregate<DIM> *absorbingBoundaryAggregate,
+                                   const RobinBoundaryAggregateType *reflectingBoundaryAggregate,
+                                   const StarRadiusAggregateType *starRadiusAggregate,
+                                   const std::function<float(float)>& branchTraversalWeight,
+                                   const std::pair<Vector<DIM>, Vector<DIM>>& boundingBoxExtents,
+                                   GeometricQueries<DIM>& geometricQueries)
+{
+    populateGeometricQueries<DIM, fcpw::Aggregate<DIM>, RobinBoundaryAggregateType>(
+        absorbingBoundaryAggregate, reflectingBoundaryAggregate,
+        branchTraversalWeight, boundingBoxExtents, geometricQueries);
+    populateStarRadiusQueryForRobinBoundary<DIM, StarRadiusAggregateType>(
+        starRadiusAggregate, geometricQueries);
+}
+
 template <size_t DIM>
 void populateGeometricQueries(FcpwBoundaryHandler<DIM, false>& absorbingBoundaryHandler,
                               const std::pair<Vector<DIM>, Vector<DIM>>& boundingBoxExtents,
@@ -1250,34 +2105,33 @@ void populateGeometricQueries<2, true>(FcpwBoundaryHandler<2, false>& absorbingB
     if (reflectingBoundaryHandler.baseline != nullptr) {
         using RobinAggregateType = RobinBaseline<2, RobinLineSegment<PrimitiveBound>>;
         RobinAggregateType *reflectingBoundaryAggregate = reflectingBoundaryHandler.baseline.get();
-        populateGeometricQueries<2, fcpw::Aggregate<2>, RobinAggregateType>(
-            absorbingBoundaryAggregate, reflectingBoundaryAggregate,
-            branchTraversalWeight, boundingBoxExtents, geometricQueries);
-        populateStarRadiusQueryForRobinBoundary<2, RobinAggregateType>(
-            reflectingBoundaryAggregate, geometricQueries);
+        populateRobinGeometricQueries<2>(absorbingBoundaryAggregate, reflectingBoundaryAggregate,
+                                         reflectingBoundaryAggregate, branchTraversalWeight,
+                                         boundingBoxExtents, geometricQueries);
 
 #ifdef FCPW_USE_ENOKI
-    } else if (reflectingBoundaryHandler.mbvh != nullptr) {
-        using WideNodeBound = FcpwBoundaryHandler<2, true>::WideNodeBound;
-        using RobinAggregateType = RobinMbvh<FCPW_SIMD_WIDTH, 2,
-                                             RobinLineSegment<PrimitiveBound>,
-                                             RobinMbvhNode<2>, WideNodeBound>;
-        RobinAggregateType *reflectingBoundaryAggregate = reflectingBoundaryHandler.mbvh.get();
-        populateGeometricQueries<2, fcpw::Aggregate<2>, RobinAggregateType>(
-            absorbingBoundaryAggregate, reflectingBoundaryAggregate,
-            branchTraversalWeight, boundingBoxExtents, geometricQueries);
-        populateStarRadiusQueryForRobinBoundary<2, RobinAggregateType>(
-            reflectingBoundaryAggregate, geometricQueries);
+    } else if (reflectingBoundaryHandler.vectorWidth > 0) {
+        reflectingBoundaryHandler.applyToVectorizedBvh([&](auto *reflectingBoundaryAggregate) {
+            populateRobinGeometricQueries<2>(absorbingBoundaryAggregate, reflectingBoundaryAggregate,
+                                             reflectingBoundaryAggregate, branchTraversalWeight,
+                                             boundingBoxExtents, geometricQueries);
+        });
 #endif
     } else if (reflectingBoundaryHandler.bvh != nullptr) {
         using NodeBound = FcpwBoundaryHandler<2, true>::NodeBound;
         using RobinAggregateType = RobinBvh<2, RobinBvhNode<2>, RobinLineSegment<PrimitiveBound>, NodeBound>;
         RobinAggregateType *reflectingBoundaryAggregate = reflectingBoundaryHandler.bvh.get();
-        populateGeometricQueries<2, fcpw::Aggregate<2>, RobinAggregateType>(
-            absorbingBoundaryAggregate, reflectingBoundaryAggregate,
-            branchTraversalWeight, boundingBoxExtents, geometricQueries);
-        populateStarRadiusQueryForRobinBoundary<2, RobinAggregateType>(
-            reflectingBoundaryAggregate, geometricQueries);
+
+        if (reflectingBoundaryHandler.compressedBvh != nullptr) {
+            populateRobinGeometricQueries<2>(absorbingBoundaryAggregate, reflectingBoundaryAggregate,
+                                             reflectingBoundaryHandler.compressedBvh.get(), branchTraversalWeight,
+                                             boundingBoxExtents, geometricQueries);
+
+        } else {
+            populateRobinGeometricQueries<2>(absorbingBoundaryAggregate, reflectingBoundaryAggregate,
+                                             reflectingBoundaryAggregate, branchTraversalWeight,
+                                             boundingBoxExtents, geometricQueries);
+        }
     }
 }
 
@@ -1294,34 +2148,33 @@ void populateGeometricQueries<3, true>(FcpwBoundaryHandler<3, false>& absorbingB
     if (reflectingBoundaryHandler.baseline != nullptr) {
         using RobinAggregateType = RobinBaseline<3, RobinTriangle<PrimitiveBound>>;
         RobinAggregateType *reflectingBoundaryAggregate = reflectingBoundaryHandler.baseline.get();
-        populateGeometricQueries<3, fcpw::Aggregate<3>, RobinAggregateType>(
-            absorbingBoundaryAggregate, reflectingBoundaryAggregate,
-            branchTraversalWeight, boundingBoxExtents, geometricQueries);
-        populateStarRadiusQueryForRobinBoundary<3, RobinAggregateType>(
-            reflectingBoundaryAggregate, geometricQueries);
+        populateRobinGeometricQueries<3>(absorbingBoundaryAggregate, reflectingBoundaryAggregate,
+                                         reflectingBoundaryAggregate, branchTraversalWeight,
+                                         boundingBoxExtents, geometricQueries);
 
 #ifdef FCPW_USE_ENOKI
-    } else if (reflectingBoundaryHandler.mbvh != nullptr) {
-        using WideNodeBound = FcpwBoundaryHandler<3, true>::WideNodeBound;
-        using RobinAggregateType = RobinMbvh<FCPW_SIMD_WIDTH, 3,
-                                             RobinTriangle<PrimitiveBound>,
-                                             RobinMbvhNode<3>, WideNodeBound>;
-        RobinAggregateType *reflectingBoundaryAggregate = reflectingBoundaryHandler.mbvh.get();
-        populateGeometricQueries<3, fcpw::Aggregate<3>, RobinAggregateType>(
-            absorbingBoundaryAggregate, reflectingBoundaryAggregate,
-            branchTraversalWeight, boundingBoxExtents, geometricQueries);
-        populateStarRadiusQueryForRobinBoundary<3, RobinAggregateType>(
-            reflectingBoundaryAggregate, geometricQueries);
+    } else if (reflectingBoundaryHandler.vectorWidth > 0) {
+        reflectingBoundaryHandler.applyToVectorizedBvh([&](auto *reflectingBoundaryAggregate) {
+            populateRobinGeometricQueries<3>(absorbingBoundaryAggregate, reflectingBoundaryAggregate,
+                                             reflectingBoundaryAggregate, branchTraversalWeight,
+                                             boundingBoxExtents, geometricQueries);
+        });
 #endif
     } else if (reflectingBoundaryHandler.bvh != nullptr) {
         using NodeBound = FcpwBoundaryHandler<3, true>::NodeBound;
         using RobinAggregateType = RobinBvh<3, RobinBvhNode<3>, RobinTriangle<PrimitiveBound>, NodeBound>;
         RobinAggregateType *reflectingBoundaryAggregate = reflectingBoundaryHandler.bvh.get();
-        populateGeometricQueries<3, fcpw::Aggregate<3>, RobinAggregateType>(
-            absorbingBoundaryAggregate, reflectingBoundaryAggregate,
-            branchTraversalWeight, boundingBoxExtents, geometricQueries);
-        populateStarRadiusQueryForRobinBoundary<3, RobinAggregateType>(
-            reflectingBoundaryAggregate, geometricQueries);
+
+        if (reflectingBoundaryHandler.compressedBvh != nullptr) {
+            populateRobinGeometricQueries<3>(absorbingBoundaryAggregate, reflectingBoundaryAggregate,
+                                             reflectingBoundaryHandler.compressedBvh.get(), branchTraversalWeight,
+                                             boundingBoxExtents, geometricQueries);
+
+        } else {
+            populateRobinGeometricQueries<3>(absorbingBoundaryAggregate, reflectingBoundaryAggregate,
+                                             reflectingBoundaryAggregate, branchTraversalWeight,
+                                             boundingBoxExtents, geometricQueries);
+        }
     }
 }
 
@@ -0,0 +1,383 @@
+// This file implements nearest neighbor search on a uniform grid. Points that lie on
+// the nodes of a regular lattice (e.g., a grid of evaluation points) are indexed directly
+// by their node, while scattered points are bucketed into a spatial hash. The class has
+// the same interface as NearestNeighborFinder, and can be used in its place.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+namespace zombie {
+
+template<size_t DIM>
+using Vector = Eigen::Matrix<float, DIM, 1>;
+
+// Accelerated k nearest neighbor and radius search queries on a uniform grid
+template <size_t DIM>
+class GridNeighborFinder {
+public:
+    // constructor
+    GridNeighborFinder();
+
+    // build acceleration structure
+    void buildAccelerationStructure(const std::vector<Vector<DIM>>& points);
+
+    // returns the indices of points in the input set
+    size_t kNearest(const Vector<DIM>& queryPt, size_t k,
+                    std::vector<size_t>& outIndices) const;
+
+    // returns all neighbors within a ball of input radius
+    size_t radiusSearch(const Vector<DIM>& queryPt, float radius,
+                        std::vector<size_t>& outIndices) const;
+
+    // invokes visitor(index) on every neighbor within a ball of input radius without
+    // allocating, and returns the number of neighbors visited
+    template <typename Visitor>
+    size_t radiusSearch(const Vector<DIM>& queryPt, float radius, Visitor&& visitor) const;
+
+    // returns whether the points were found to lie on a regular lattice
+    bool isLattice() const;
+
+protected:
+    using Cell = Eigen::Matrix<int, DIM, 1>;
+
+    // tries to index the points by the nodes of a regular lattice
+    bool buildLattice();
+
+    // buckets the points into a spatial hash
+    void buildHashGrid();
+
+    // returns the cell containing the input point
+    Cell computeCell(const Vector<DIM>& pt) const;
+
+    // returns the hash table bucket of the input cell
+    uint32_t computeBucket(const Cell& cell) const;
+
+    // members
+    std::vector<Vector<DIM>> points;
+    Vector<DIM> origin;
+    Vector<DIM> cellSize;
+    Cell cellMin;
+    Cell cellMax;
+    bool lattice;
+
+    // lattice: point index at each node, or -1 if the node is empty
+    Cell latticeStrides;
+    std::vector<int> nodeToPoint;
+
+    // spatial hash: point indices sorted by bucket, with bucket offsets into the sorted list
+    uint32_t bucketMask;
+    std::vector<uint32_t> bucketOffsets;
+    std::vector<uint32_t> bucketPointIndices;
+    std::vector<Cell> bucketPointCells;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Implementation
+
+template <size_t DIM>
+inline GridNeighborFinder<DIM>::GridNeighborFinder():
+origin(Vector<DIM>::Zero()), cellSize(Vector<DIM>::Ones()),
+cellMin(Cell::Zero()), cellMax(Cell::Constant(-1)),
+lattice(false), latticeStrides(Cell::Zero()), bucketMask(0)
+{
+    // do nothing
+}
+
+template <size_t DIM>
+inline void GridNeighborFinder<DIM>::buildAccelerationStructure(const std::vector<Vector<DIM>>& points_)
+{
+    points = points_;
+    nodeToPoint.clear();
+    bucketOffsets.clear();
+    bucketPointIndices.clear();
+    bucketPointCells.clear();
+    cellMin = Cell::Zero();
+    cellMax = Cell::Constant(-1);
+    if (points.size() == 0) return;
+
+    lattice = buildLattice();
+    if (!lattice) buildHashGrid();
+}
+
+template <size_t DIM>
+inline bool GridNeighborFinder<DIM>::buildLattice()
+{
+    // find the distinct coordinates along each axis
+    int nPoints = (int)points.size();
+    Vector<DIM> bMin = Vector<DIM>::Constant(std::numeric_limits<float>::max());
+    Vector<DIM> bMax = Vector<DIM>::Constant(std::numeric_limits<float>::lowest());
+    for (int i = 0; i < nPoints; i++) {
+        bMin = bMin.cwiseMin(points[i]);
+        bMax = bMax.cwiseMax(points[i]);
+    }
+
+    Cell resolution;
+    float maxExtent = std::max((bMax - bMin).maxCoeff(), 1e-6f);
+    float epsilon = 1e-5f*maxExtent;
+    std::vector<float> coords(nPoints);
+    for (size_t d = 0; d < DIM; d++) {
+        for (int i = 0; i < nPoints; i++) coords[i] = points[i][d];
+        std::sort(coords.begin(), coords.end());
+
+        int nDistinct = 1;
+        for (int i = 1; i < nPoints; i++) {
+            if (coords[i] - coords[i - 1] > epsilon) nDistinct++;
+        }
+
+        resolution[d] = nDistinct;
+        cellSize[d] = nDistinct > 1 ? (bMax[d] - bMin[d])/(nDistinct - 1) : maxExtent;
+    }
+
+    // reject point sets whose lattice would be mostly empty
+    double nNodes = 1.0;
+    for (size_t d = 0; d < DIM; d++) nNodes *= resolution[d];
+    if (nNodes > 2.0*nPoints) return false;
+
+    // assign each point to a node, rejecting point sets that are not evenly spaced
+    // or that have multiple points at the same node
+    origin = bMin;
+    cellMin = Cell::Zero();
+    cellMax = resolution - Cell::Ones();
+    latticeStrides[0] = 1;
+    for (size_t d = 1; d < DIM; d++) latticeStrides[d] = latticeStrides[d - 1]*resolution[d - 1];
+    nodeToPoint.assign((size_t)nNodes, -1);
+
+    for (int i = 0; i < nPoints; i++) {
+        int node = 0;
+        for (size_t d = 0; d < DIM; d++) {
+            float u = (points[i][d] - origin[d])/cellSize[d];
+            float k = std::round(u);
+            if (std::fabs(u - k) > 1e-3f) {
+                nodeToPoint.clear();
+                return false;
+            }
+
+            node += (int)k*latticeStrides[d];
+        }
+
+        if (nodeToPoint[node] != -1) {
+            nodeToPoint.clear();
+            return false;
+        }
+
+        nodeToPoint[node] = i;
+    }
+
+    return true;
+}
+
+template <size_t DIM>
+inline void GridNeighborFinder<DIM>::buildHashGrid()
+{
+    // choose a cell size that places roughly one point in each cell, ignoring
+    // axes along which the points have no extent
+    int nPoints = (int)points.size();
+    Vector<DIM> bMin = Vector<DIM>::Constant(std::numeric_limits<float>::max());
+    Vector<DIM> bMax = Vector<DIM>::Constant(std::numeric_limits<float>::lowest());
+    for (int i = 0; i < nPoints; i++) {
+        bMin = bMin.cwiseMin(points[i]);
+        bMax = bMax.cwiseMax(points[i]);
+    }
+
+    Vector<DIM> extent = bMax - bMin;
+    float epsilon = 1e-6f*std::max(extent.maxCoeff(), 1.0f);
+    float volume = 1.0f;
+    int nAxes = 0;
+    for (size_t d = 0; d < DIM; d++) {
+        if (extent[d] > epsilon) {
+            volume *= extent[d];
+            nAxes++;
+        }
+    }
+
+    float h = nAxes > 0 ? std::pow(volume/nPoints, 1.0f/nAxes) : 1.0f;
+    origin = bMin;
+    cellSize = Vector<DIM>::Constant(std::max(h, epsilon));
+
+    // bucket the points with a counting sort over a power of two sized table
+    uint32_t nBuckets = 1;
+    while (nBuckets < 2*(uint32_t)nPoints) nBuckets <<= 1;
+    bucketMask = nBuckets - 1;
+
+    std::vector<Cell> pointCells(nPoints);
+    std::vector<uint32_t> pointBuckets(nPoints);
+    bucketOffsets.assign(nBuckets + 1, 0);
+    cellMin = Cell::Constant(std::numeric_limits<int>::max());
+    cellMax = Cell::Constant(std::numeric_limits<int>::lowest());
+    for (int i = 0; i < nPoints; i++) {
+        pointCells[i] = computeCell(points[i]);
+        pointBuckets[i] = computeBucket(pointCells[i]);
+        bucketOffsets[pointBuckets[i] + 1]++;
+        cellMin = cellMin.cwiseMin(pointCells[i]);
+        cellMax = cellMax.cwiseMax(pointCells[i]);
+    }
+
+    for (uint32_t b = 0; b < nBuckets; b++) {
+        bucketOffsets[b + 1] += bucketOffsets[b];
+    }
+
+    std::vector<uint32_t> fill(bucketOffsets.begin(), bucketOffsets.end() - 1);
+    bucketPointIndices.resize(nPoints);
+    bucketPointCells.resize(nPoints);
+    for (int i = 0; i < nPoints; i++) {
+        uint32_t slot = fill[pointBuckets[i]]++;
+        bucketPointIndices[slot] = i;
+        bucketPointCells[slot] = pointCells[i];
+    }
+}
+
+template <size_t DIM>
+inline typename GridNeighborFinder<DIM>::Cell GridNeighborFinder<DIM>::computeCell(const Vector<DIM>& pt) const
+{
+    Cell cell;
+    for (size_t d = 0; d < DIM; d++) {
+        cell[d] = (int)std::floor((pt[d] - origin[d])/cellSize[d]);
+    }
+
+    return cell;
+}
+
+template <size_t DIM>
+inline uint32_t GridNeighborFinder<DIM>::computeBucket(const Cell& cell) const
+{
+    const uint32_t primes[3] = { 73856093u, 19349663u, 83492791u };
+    uint32_t hash = 0;
+    for (size_t d = 0; d < DIM; d++) {
+        hash = (hash*2654435761u)^((uint32_t)cell[d]*primes[d%3]);
+    }
+
+    return hash & bucketMask;
+}
+
+template <size_t DIM>
+inline bool GridNeighborFinder<DIM>::isLattice() const
+{
+    return lattice;
+}
+
+template <size_t DIM>
+inline size_t GridNeighborFinder<DIM>::kNearest(const Vector<DIM>& queryPt, size_t k,
+                                                std::vector<size_t>& outIndices) const
+{
+    if (k > points.size()) {
+        std::cerr << "k is greater than number of points" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    outIndices.clear();
+    if (k == 0) return 0;
+
+    // grow a ball around the query point until it contains at least k points; the ball
+    // always contains every point once it reaches the farthest corner of the cells
+    Vector<DIM> bMin = origin + cellSize.cwiseProduct(cellMin.template cast<float>());
+    Vector<DIM> bMax = origin + cellSize.cwiseProduct((cellMax + Cell::Ones()).template cast<float>());
+    float maxRadius = (queryPt - bMin).cwiseAbs().cwiseMax((queryPt - bMax).cwiseAbs()).norm()*1.001f;
+    float radius = std::min(cellSize.maxCoeff()*std::pow((float)k, 1.0f/DIM), maxRadius);
+
+    static thread_local std::vector<std::pair<float, size_t>> candidates;
+    while (true) {
+        candidates.clear();
+        radiusSearch(queryPt, radius, [this, &queryPt](size_t index) -> void {
+            candidates.emplace_back(std::make_pair((points[index] - queryPt).squaredNorm(), index));
+        });
+
+        if (candidates.size() >= k || radius >= maxRadius) break;
+        radius = std::min(2.0f*radius, maxRadius);
+    }
+
+    // return the k closest candidates sorted by distance
+    k = std::min(k, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end());
+    outIndices.resize(k);
+    for (size_t i = 0; i < k; i++) {
+        outIndices[i] = candidates[i].second;
+    }
+
+    return k;
+}
+
+template <size_t DIM>
+inline size_t GridNeighborFinder<DIM>::radiusSearch(const Vector<DIM>& queryPt, float radius,
+                                                    std::vector<size_t>& outIndices) const
+{
+    // append directly to the output vector, so callers that reuse it never reallocate
+    outIndices.clear();
+    return radiusSearch(queryPt, radius, [&outIndices](size_t index) -> void {
+        outIndices.emplace_back(index);
+    });
+}
+
+template <size_t DIM>
+template <typename Visitor>
+inline size_t GridNeighborFinder<DIM>::radiusSearch(const Vector<DIM>& queryPt, float radius,
+                                                    Visitor&& visitor) const
+{
+    if (points.size() == 0) return 0;
+
+    // determine the range of cells (lattice nodes) overlapping the ball
+    float squaredRadius = radius*radius;
+    Cell lo, hi;
+    for (size_t d = 0; d < DIM; d++) {
+        float u0 = (queryPt[d] - radius - origin[d])/cellSize[d];
+        float u1 = (queryPt[d] + radius - origin[d])/cellSize[d];
+        float uMin = (float)cellMin[d];
+        float uMax = (float)cellMax[d];
+        if (u1 < uMin || u0 > uMax + 1.0f) return 0;
+
+        // nodes lie at integer coordinates, while hash cells span unit intervals
+        lo[d] = lattice ? (int)std::ceil(std::max(u0, uMin)) : (int)std::floor(std::max(u0, uMin));
+        hi[d] = (int)std::floor(std::min(u1, uMax));
+        if (lo[d] > hi[d]) return 0;
+    }
+
+    // visit the cells in the range
+    size_t count = 0;
+    Cell cell = lo;
+    while (true) {
+        if (lattice) {
+            int node = 0;
+            for (size_t d = 0; d < DIM; d++) node += cell[d]*latticeStrides[d];
+
+            int index = nodeToPoint[node];
+            if (index != -1 && (points[index] - queryPt).squaredNorm() < squaredRadius) {
+                visitor((size_t)index);
+                count++;
+            }
+
+        } else {
+            // skip points from other cells that share the bucket
+            uint32_t bucket = computeBucket(cell);
+            for (uint32_t slot = bucketOffsets[bucket]; slot < bucketOffsets[bucket + 1]; slot++) {
+                uint32_t index = bucketPointIndices[slot];
+                if (bucketPointCells[slot] == cell &&
+                    (points[index] - queryPt).squaredNorm() < squaredRadius) {
+                    visitor((size_t)index);
+                    count++;
+                }
+            }
+        }
+
+        // advance to the next cell
+        size_t d = 0;
+        while (d < DIM && cell[d] == hi[d]) {
+            cell[d] = lo[d];
+            d++;
+        }
+
+        if (d == DIM) break;
+        cell[d]++;
+    }
+
+    return count;
+}
+
+} // zombie
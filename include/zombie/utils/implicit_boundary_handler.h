@@ -0,0 +1,1546 @@
+// This file provides an ImplicitBoundaryHandler class that represents a boundary with a small
+// scene graph of analytic primitives (spheres, boxes and cylinders) combined with constructive
+// solid geometry (CSG) operations, as an alternative to tessellating CAD-like domains for FCPW.
+// Distances are exact for individual primitives and conservative (i.e., never overestimated)
+// for CSG combinations, rays are intersected analytically by combining per-primitive ray
+// intervals, and star radii for reflecting boundaries are computed from the silhouettes of
+// the convex primitives. The 'populateGeometricQueries' overload in this file populates the
+// GeometricQueries structure using ImplicitBoundaryHandler objects for the absorbing and
+// reflecting boundaries, with the domain taken to be the intersection of the two solids and
+// each boundary trimmed against the other solid.
+// The UniformImplicitBoundarySampler class generates uniformly distributed sample points
+// on an implicit boundary for Boundary Value Caching and Reverse Walk Splatting.
+
+#pragma once
+
+#include <zombie/utils/fcpw_boundary_handler.h>
+#include <zombie/variance_reduction/boundary_sampler.h>
+
+#define IMPLICIT_MAX_RAY_INTERVALS 16
+#define IMPLICIT_MAX_PROJECTION_ITERATIONS 16
+
+namespace zombie {
+
+enum class ImplicitNodeType {
+    Sphere,
+    Box,
+    Cylinder,
+    Union,
+    Intersection,
+    Difference
+};
+
+template <size_t DIM>
+struct ImplicitNode {
+    // constructor
+    ImplicitNode(ImplicitNodeType type_): type(type_), center(Vector<DIM>::Zero()),
+                                          extent(Vector<DIM>::Zero()), radius(0.0f),
+                                          height(0.0f), children{-1, -1} {}
+
+    // members
+    ImplicitNodeType type;
+    Vector<DIM> center; // sphere & box center, cylinder base center
+    Vector<DIM> extent; // box half extents, cylinder axis
+    float radius; // sphere & cylinder radius
+    float height; // cylinder height
+    int children[2]; // operands of CSG nodes
+};
+
+// Helper class to describe a boundary as the surface of a CSG combination of analytic
+// primitives, and to perform geometric queries against it. Normals point out of the solid.
+template <size_t DIM>
+class ImplicitBoundaryHandler {
+public:
+    // constructor
+    ImplicitBoundaryHandler();
+
+    // adds a primitive to the scene graph and returns its node index
+    int addSphere(const Vector<DIM>& center, float radius);
+    int addBox(const Vector<DIM>& center, const Vector<DIM>& halfExtents);
+    int addCylinder(const Vector<DIM>& baseCenter, const Vector<DIM>& axis,
+                    float height, float radius); // 3D only
+
+    // adds a CSG operation on two existing nodes and returns its node index
+    int addUnion(int nodeA, int nodeB);
+    int addIntersection(int nodeA, int nodeB);
+    int addDifference(int nodeA, int nodeB);
+
+    // sets the root of the scene graph; defaults to the most recently added node
+    void setRoot(int node);
+
+    // returns whether the scene graph contains any nodes
+    bool isEmpty() const;
+
+    // computes the signed distance to the boundary (negative inside the solid) along with
+    // the outward normal of the closest boundary feature; the distance is exact for single
+    // primitives and a lower bound on the true distance for CSG combinations
+    float computeSignedDistance(const Vector<DIM>& x, Vector<DIM>& normal) const;
+
+    // returns whether a point lies inside the solid, optionally including its boundary
+    bool containsPoint(const Vector<DIM>& x, bool includeBoundary=true) const;
+
+    // projects a point to the boundary; if a trimming solid is provided, only the part of
+    // the boundary inside that solid is considered: points that project to a trimmed away
+    // part are moved to the crease where the boundary meets the surface of the trimming solid
+    void projectToBoundary(Vector<DIM>& x, Vector<DIM>& normal, float& distance,
+                           bool computeSignedDistance,
+                           const ImplicitBoundaryHandler<DIM> *trimmingBoundary=nullptr) const;
+
+    // finds the first intersection of a ray with the boundary within (0, tMax]; hits
+    // outside the trimming solid are ignored if one is provided
+    bool intersect(const Vector<DIM>& origin, const Vector<DIM>& dir, float tMax,
+                   IntersectionPoint<DIM>& intersectionPt,
+                   const ImplicitBoundaryHandler<DIM> *trimmingBoundary=nullptr) const;
+
+    // finds all intersections of a ray with the boundary within (0, tMax]; intersection
+    // points are only recorded if a buffer is provided, and hits outside the trimming
+    // solid are ignored if one is provided, along with hits on the crease with the
+    // trimming surface if includeCrease is false
+    int intersectAll(const Vector<DIM>& origin, const Vector<DIM>& dir, float tMax,
+                     std::vector<IntersectionPoint<DIM>> *intersectionPts=nullptr,
+                     const ImplicitBoundaryHandler<DIM> *trimmingBoundary=nullptr,
+                     bool includeCrease=true) const;
+
+    // returns a lower bound on the distance from a point to the closest silhouette point
+    // on the boundary, which serves as the star radius for reflecting boundaries
+    float computeSilhouetteDistance(const Vector<DIM>& x) const;
+
+    // returns the total surface area of the primitives in the scene graph, which bounds the
+    // area of the boundary from above; primitives whose bounding boxes do not overlap the
+    // ball with the given center and radius are skipped
+    float computePrimitiveSurfaceArea(const Vector<DIM>& c=Vector<DIM>::Zero(),
+                                      float r=std::numeric_limits<float>::max()) const;
+
+    // samples a point uniformly on the surfaces of primitives overlapping the given ball
+    // using DIM random numbers; returns false if the sampled point does not lie on the
+    // boundary or inside the ball, in which case the sample should be treated as having
+    // zero contribution. The density of accepted points is 1/computePrimitiveSurfaceArea(c, r).
+    bool sampleBoundary(const float *u, Vector<DIM>& pt, Vector<DIM>& normal,
+                        const Vector<DIM>& c=Vector<DIM>::Zero(),
+                        float r=std::numeric_limits<float>::max()) const;
+
+    // returns the bounding box of the scene graph
+    std::pair<Vector<DIM>, Vector<DIM>> computeBoundingBox() const;
+
+protected:
+    // adds a node to the scene graph
+    int addNode(const ImplicitNode<DIM>& node);
+
+    // members
+    std::vector<ImplicitNode<DIM>> nodes;
+    std::vector<int> primitiveIndices;
+    int root;
+    float boundaryEpsilon;
+};
+
+// populates the GeometricQueries structure using implicit absorbing and reflecting boundaries;
+// either handler may be empty. Since the domain is the intersection of the two solids, each
+// boundary is trimmed against the other solid in all distance, projection and ray queries.
+// Supports absorbing (Dirichlet) and reflecting Neumann boundaries only: pass the PDE's
+// areRobinConditionsPureNeumann flag, and the function exits if it is false.
+template <size_t DIM>
+void populateGeometricQueries(const ImplicitBoundaryHandler<DIM>& absorbingBoundaryHandler,
+                              const ImplicitBoundaryHandler<DIM>& reflectingBoundaryHandler,
+                              bool areRobinConditionsPureNeumann,
+                              const std::pair<Vector<DIM>, Vector<DIM>>& boundingBoxExtents,
+                              GeometricQueries<DIM>& geometricQueries);
+
+template <typename T, size_t DIM>
+class UniformImplicitBoundarySampler : public BoundarySampler<T, DIM> {
+public:
+    // constructor
+    UniformImplicitBoundarySampler(const ImplicitBoundaryHandler<DIM>& handler_,
+                                   const GeometricQueries<DIM>& queries_,
+                                   const std::function<bool(const Vector<DIM>&)>& insideSolveRegion_,
+                                   int nPilotSamples_=16384);
+
+    // estimates the area of the boundary inside the solve region
+    void initialize(float normalOffsetForBoundary, bool solveDoubleSided);
+
+    // returns the number of sample points to be generated on the user-specified side of the boundary
+    int getSampleCount(int nTotalSamples, bool boundaryNormalAlignedSamples=false) const;
+
+    // generates uniformly distributed sample points on the boundary
+    void generateSamples(int nSamples, SampleType sampleType,
+                         float normalOffsetForBoundary,
+                         std::vector<SamplePoint<T, DIM>>& samplePts,
+                         bool generateBoundaryNormalAlignedSamples=false);
+
+private:
+    // draws a candidate sample point on the boundary, displaced along its normal
+    bool sampleCandidate(float normalOffsetForBoundary, Vector<DIM>& pt, Vector<DIM>& normal);
+
+    // estimates the area of the displaced boundary inside the solve region
+    float estimateArea(float normalOffsetForBoundary);
+
+    // members
+    pcg32 sampler;
+    const ImplicitBoundaryHandler<DIM>& handler;
+    const GeometricQueries<DIM>& queries;
+    const std::function<bool(const Vector<DIM>&)>& insideSolveRegion;
+    int nPilotSamples;
+    float boundaryArea;
+    float boundaryAreaNormalAligned;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Implementation
+
+template <size_t DIM>
+struct ImplicitRayInterval {
+    // members
+    float tEnter, tExit;
+    Vector<DIM> nEnter, nExit; // outward normals of the solid at the interval endpoints
+};
+
+template <size_t DIM>
+struct ImplicitRayIntervals {
+    // constructor
+    ImplicitRayIntervals(): n(0) {}
+
+    // appends an interval, dropping it if the list is full
+    void add(float tEnter, float tExit, const Vector<DIM>& nEnter, const Vector<DIM>& nExit) {
+        if (n < IMPLICIT_MAX_RAY_INTERVALS && tEnter <= tExit) {
+            intervals[n].tEnter = tEnter;
+            intervals[n].tExit = tExit;
+            intervals[n].nEnter = nEnter;
+            intervals[n].nExit = nExit;
+            n++;
+        }
+    }
+
+    // members
+    int n;
+    ImplicitRayInterval<DIM> intervals[IMPLICIT_MAX_RAY_INTERVALS]; // sorted and disjoint
+};
+
+template <size_t DIM>
+inline void computeOrthonormalBasis(const Vector<DIM>& n, Vector<DIM>& b1, Vector<DIM>& b2)
+{
+    std::cerr << "computeOrthonormalBasis(): DIM: " << DIM << " not supported" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+template <>
+inline void computeOrthonormalBasis<3>(const Vector3& n, Vector3& b1, Vector3& b2)
+{
+    // source: https://graphics.pixar.com/library/OrthonormalB/paper.pdf
+    float sign = std::copysign(1.0f, n[2]);
+    const float a = -1.0f/(sign + n[2]);
+    const float b = n[0]*n[1]*a;
+    b1 = Vector3(1.0f + sign*n[0]*n[0]*a, sign*b, -sign*n[0]);
+    b2 = Vector3(b, sign + n[1]*n[1]*a, -n[1]);
+}
+
+template <size_t DIM>
+inline float computeSphereSignedDistance(const ImplicitNode<DIM>& node, const Vector<DIM>& x,
+                                         Vector<DIM>& normal)
+{
+    Vector<DIM> v = x - node.center;
+    float d = v.norm();
+    normal = Vector<DIM>::Zero();
+    if (d > 0.0f) normal = v/d;
+    else normal(0) = 1.0f;
+
+    return d - node.radius;
+}
+
+template <size_t DIM>
+inline float computeBoxSignedDistance(const ImplicitNode<DIM>& node, const Vector<DIM>& x,
+                                      Vector<DIM>& normal)
+{
+    Vector<DIM> v = x - node.center;
+    Vector<DIM> q = v.cwiseAbs() - node.extent;
+    Vector<DIM> qOut = q.cwiseMax(0.0f);
+    float dOut = qOut.norm();
+    normal = Vector<DIM>::Zero();
+
+    if (dOut > 0.0f) {
+        // outside: closest point lies on a face, edge or corner
+        for (size_t i = 0; i < DIM; i++) {
+            normal(i) = std::copysign(qOut(i), v(i))/dOut;
+        }
+
+        return dOut;
+    }
+
+    // inside: closest point lies on the face with the largest coordinate
+    int axis = 0;
+    q.maxCoeff(&axis);
+    normal(axis) = std::copysign(1.0f, v(axis));
+
+    return q(axis);
+}
+
+template <size_t DIM>
+inline float computeCylinderSignedDistance(const ImplicitNode<DIM>& node, const Vector<DIM>& x,
+                                           Vector<DIM>& normal)
+{
+    // compute axial and radial coordinates relative to the cylinder center
+    const Vector<DIM>& axis = node.extent;
+    Vector<DIM> v = x - node.center;
+    float z = v.dot(axis) - 0.5f*node.height;
+    Vector<DIM> radial = v - (z + 0.5f*node.height)*axis;
+    float rho = radial.norm();
+    Vector<DIM> radialDir = rho > 0.0f ? Vector<DIM>(radial/rho) : Vector<DIM>::Zero();
+    if (rho == 0.0f) {
+        // pick any direction orthogonal to the axis
+        Vector<DIM> e = Vector<DIM>::Zero();
+        e(std::fabs(axis(0)) < 0.9f ? 0 : 1) = 1.0f;
+        radialDir = (e - e.dot(axis)*axis).normalized();
+    }
+
+    // evaluate a 2D box distance in (radial, axial) coordinates
+    float qr = rho - node.radius;
+    float qz = std::fabs(z) - 0.5f*node.height;
+    float axialSign = std::copysign(1.0f, z);
+    float qrOut = std::max(qr, 0.0f);
+    float qzOut = std::max(qz, 0.0f);
+    float dOut = std::sqrt(qrOut*qrOut + qzOut*qzOut);
+
+    if (dOut > 0.0f) {
+        normal = (qrOut*radialDir + qzOut*axialSign*axis)/dOut;
+        return dOut;
+    }
+
+    if (qr > qz) {
+        normal = radialDir;
+        return qr;
+    }
+
+    normal = axialSign*axis;
+    return qz;
+}
+
+template <size_t DIM>
+inline float computePrimitiveSignedDistance(const ImplicitNode<DIM>& node, const Vector<DIM>& x,
+                                            Vector<DIM>& normal)
+{
+    if (node.type == ImplicitNodeType::Sphere) return computeSphereSignedDistance<DIM>(node, x, normal);
+    if (node.type == ImplicitNodeType::Box) return computeBoxSignedDistance<DIM>(node, x, normal);
+    return computeCylinderSignedDistance<DIM>(node, x, normal);
+}
+
+template <size_t DIM>
+inline float computeNodeSignedDistance(const std::vector<ImplicitNode<DIM>>& nodes, int nodeIndex,
+                                       const Vector<DIM>& x, Vector<DIM>& normal)
+{
+    const ImplicitNode<DIM>& node = nodes[nodeIndex];
+    if (node.children[0] < 0) return computePrimitiveSignedDistance<DIM>(node, x, normal);
+
+    Vector<DIM> normalA, normalB;
+    float dA = computeNodeSignedDistance<DIM>(nodes, node.children[0], x, normalA);
+    float dB = computeNodeSignedDistance<DIM>(nodes, node.children[1], x, normalB);
+
+    if (node.type == ImplicitNodeType::Union) {
+        normal = dA < dB ? normalA : normalB;
+        return std::min(dA, dB);
+
+    } else if (node.type == ImplicitNodeType::Intersection) {
+        normal = dA > dB ? normalA : normalB;
+        return std::max(dA, dB);
+    }
+
+    // difference: intersection with the complement of the second operand
+    normal = dA > -dB ? normalA : Vector<DIM>(-normalB);
+    return std::max(dA, -dB);
+}
+
+template <size_t DIM>
+inline void computeSphereRayIntervals(const ImplicitNode<DIM>& node, const Vector<DIM>& o,
+                                      const Vector<DIM>& d, ImplicitRayIntervals<DIM>& intervals)
+{
+    Vector<DIM> oc = o - node.center;
+    float b = oc.dot(d);
+    float c = oc.squaredNorm() - node.radius*node.radius;
+    float disc = b*b - c;
+    if (disc < 0.0f) return;
+
+    float sqrtDisc = std::sqrt(disc);
+    float t0 = -b - sqrtDisc;
+    float t1 = -b + sqrtDisc;
+    intervals.add(t0, t1, (oc + t0*d)/node.radius, (oc + t1*d)/node.radius);
+}
+
+template <size_t DIM>
+inline void computeBoxRayIntervals(const ImplicitNode<DIM>& node, const Vector<DIM>& o,
+                                   const Vector<DIM>& d, ImplicitRayIntervals<DIM>& intervals)
+{
+    float tEnter = -maxFloat;
+    float tExit = maxFloat;
+    int enterAxis = -1, exitAxis = -1;
+    float enterSign = 0.0f, exitSign = 0.0f;
+
+    for (size_t i = 0; i < DIM; i++) {
+        float pMin = node.center(i) - node.extent(i);
+        float pMax = node.center(i) + node.extent(i);
+
+        if (std::fabs(d(i)) < 1e-12f) {
+            // ray is parallel to the slab
+            if (o(i) < pMin || o(i) > pMax) return;
+            continue;
+        }
+
+        float invD = 1.0f/d(i);
+        float t0 = (pMin - o(i))*invD;
+        float t1 = (pMax - o(i))*invD;
+        float sign0 = -1.0f, sign1 = 1.0f;
+        if (t0 > t1) {
+            std::swap(t0, t1);
+            std::swap(sign0, sign1);
+        }
+
+        if (t0 > tEnter) {
+            tEnter = t0;
+            enterAxis = (int)i;
+            enterSign = sign0;
+        }
+
+        if (t1 < tExit) {
+            tExit = t1;
+            exitAxis = (int)i;
+            exitSign = sign1;
+        }
+
+        if (tEnter > tExit) return;
+    }
+
+    Vector<DIM> nEnter = Vector<DIM>::Zero();
+    Vector<DIM> nExit = Vector<DIM>::Zero();
+    if (enterAxis >= 0) nEnter(enterAxis) = enterSign;
+    if (exitAxis >= 0) nExit(exitAxis) = exitSign;
+    intervals.add(tEnter, tExit, nEnter, nExit);
+}
+
+template <size_t DIM>
+inline void computeCylinderRayIntervals(const ImplicitNode<DIM>& node, const Vector<DIM>& o,
+                                        const Vector<DIM>& d, ImplicitRayIntervals<DIM>& intervals)
+{
+    const Vector<DIM>& axis = node.extent;
+    Vector<DIM> v = o - node.center;
+    float oa = v.dot(axis);
+    float da = d.dot(axis);
+    Vector<DIM> op = v - oa*axis;
+    Vector<DIM> dp = d - da*axis;
+
+    // intersect the infinite cylinder
+    float tEnter = -maxFloat;
+    float tExit = maxFloat;
+    bool enterLateral = false, exitLateral = false;
+    float a = dp.squaredNorm();
+    float c = op.squaredNorm() - node.radius*node.radius;
+    if (a < 1e-12f) {
+        // ray is parallel to the axis
+        if (c > 0.0f) return;
+
+    } else {
+        float b = op.dot(dp);
+        float disc = b*b - a*c;
+        if (disc < 0.0f) return;
+
+        float sqrtDisc = std::sqrt(disc);
+        tEnter = (-b - sqrtDisc)/a;
+        tExit = (-b + sqrtDisc)/a;
+        enterLateral = exitLateral = true;
+    }
+
+    // clip against the caps
+    float capSignEnter = 0.0f, capSignExit = 0.0f;
+    if (std::fabs(da) < 1e-12f) {
+        if (oa < 0.0f || oa > node.height) return;
+
+    } else {
+        float t0 = -oa/da;
+        float t1 = (node.height - oa)/da;
+        float sign0 = -1.0f, sign1 = 1.0f;
+        if (t0 > t1) {
+            std::swap(t0, t1);
+            std::swap(sign0, sign1);
+        }
+
+        if (t0 > tEnter) {
+            tEnter = t0;
+            enterLateral = false;
+            capSignEnter = sign0;
+        }
+
+        if (t1 < tExit) {
+            tExit = t1;
+            exitLateral = false;
+            capSignExit = sign1;
+        }
+
+        if (tEnter > tExit) return;
+    }
+
+    Vector<DIM> nEnter = enterLateral ? Vector<DIM>((op + tEnter*dp)/node.radius) : Vector<DIM>(capSignEnter*axis);
+    Vector<DIM> nExit = exitLateral ? Vector<DIM>((op + tExit*dp)/node.radius) : Vector<DIM>(capSignExit*axis);
+    intervals.add(tEnter, tExit, nEnter, nExit);
+}
+
+template <size_t DIM>
+inline void computeUnionRayIntervals(const ImplicitRayIntervals<DIM>& A, const ImplicitRayIntervals<DIM>& B,
+                                     ImplicitRayIntervals<DIM>& intervals)
+{
+    // merge the two sorted lists by entry distance, then coalesce overlapping intervals
+    if (A.n + B.n == 0) return;
+    int i = 0, j = 0;
+    auto popNext = [&]() -> const ImplicitRayInterval<DIM>& {
+        return j >= B.n || (i < A.n && A.intervals[i].tEnter <= B.intervals[j].tEnter) ?
+               A.intervals[i++] : B.intervals[j++];
+    };
+
+    ImplicitRayInterval<DIM> current = popNext();
+    while (i < A.n || j < B.n) {
+        const ImplicitRayInterval<DIM>& next = popNext();
+        if (next.tEnter <= current.tExit) {
+            if (next.tExit > current.tExit) {
+                current.tExit = next.tExit;
+                current.nExit = next.nExit;
+            }
+
+        } else {
+            intervals.add(current.tEnter, current.tExit, current.nEnter, current.nExit);
+            current = next;
+        }
+    }
+
+    intervals.add(current.tEnter, current.tExit, current.nEnter, current.nExit);
+}
+
+template <size_t DIM>
+inline void computeIntersectionRayIntervals(const ImplicitRayIntervals<DIM>& A, const ImplicitRayIntervals<DIM>& B,
+                                            ImplicitRayIntervals<DIM>& intervals)
+{
+    int i = 0, j = 0;
+    while (i < A.n && j < B.n) {
+        const ImplicitRayInterval<DIM>& a = A.intervals[i];
+        const ImplicitRayInterval<DIM>& b = B.intervals[j];
+        bool enterA = a.tEnter >= b.tEnter;
+        bool exitA = a.tExit <= b.tExit;
+        float tEnter = enterA ? a.tEnter : b.tEnter;
+        float tExit = exitA ? a.tExit : b.tExit;
+
+        if (tEnter <= tExit) {
+            intervals.add(tEnter, tExit, enterA ? a.nEnter : b.nEnter, exitA ? a.nExit : b.nExit);
+        }
+
+        if (exitA) i++;
+        else j++;
+    }
+}
+
+template <size_t DIM>
+inline void computeComplementRayIntervals(const ImplicitRayIntervals<DIM>& A,
+                                          ImplicitRayIntervals<DIM>& intervals)
+{
+    // the complement's outward normals point into the original solid
+    Vector<DIM> zero = Vector<DIM>::Zero();
+    float tEnter = -maxFloat;
+    Vector<DIM> nEnter = zero;
+
+    for (int i = 0; i < A.n; i++) {
+        const ImplicitRayInterval<DIM>& a = A.intervals[i];
+        if (a.tEnter > tEnter) intervals.add(tEnter, a.tEnter, nEnter, -a.nEnter);
+
+        tEnter = a.tExit;
+        nEnter = -a.nExit;
+    }
+
+    if (tEnter < maxFloat) intervals.add(tEnter, maxFloat, nEnter, zero);
+}
+
+template <size_t DIM>
+inline void computeNodeRayIntervals(const std::vector<ImplicitNode<DIM>>& nodes, int nodeIndex,
+                                    const Vector<DIM>& o, const Vector<DIM>& d,
+                                    ImplicitRayIntervals<DIM>& intervals)
+{
+    const ImplicitNode<DIM>& node = nodes[nodeIndex];
+    if (node.type == ImplicitNodeType::Sphere) {
+        computeSphereRayIntervals<DIM>(node, o, d, intervals);
+
+    } else if (node.type == ImplicitNodeType::Box) {
+        computeBoxRayIntervals<DIM>(node, o, d, intervals);
+
+    } else if (node.type == ImplicitNodeType::Cylinder) {
+        computeCylinderRayIntervals<DIM>(node, o, d, intervals);
+
+    } else {
+        ImplicitRayIntervals<DIM> A, B;
+        computeNodeRayIntervals<DIM>(nodes, node.children[0], o, d, A);
+        computeNodeRayIntervals<DIM>(nodes, node.children[1], o, d, B);
+
+        if (node.type == ImplicitNodeType::Union) {
+            computeUnionRayIntervals<DIM>(A, B, intervals);
+
+        } else if (node.type == ImplicitNodeType::Intersection) {
+            computeIntersectionRayIntervals<DIM>(A, B, intervals);
+
+        } else {
+            ImplicitRayIntervals<DIM> complementB;
+            computeComplementRayIntervals<DIM>(B, complementB);
+            computeIntersectionRayIntervals<DIM>(A, complementB, intervals);
+        }
+    }
+}
+
+template <size_t DIM>
+inline float computeSphereSilhouetteDistance(const ImplicitNode<DIM>& node, const Vector<DIM>& x)
+{
+    // silhouette points are the tangent points seen from x
+    float d2 = (x - node.center).squaredNorm();
+    float r2 = node.radius*node.radius;
+
+    return d2 > r2 ? std::sqrt(d2 - r2) : maxFloat;
+}
+
+template <size_t DIM>
+inline float computeBoxSilhouetteDistance(const ImplicitNode<DIM>& node, const Vector<DIM>& x)
+{
+    // silhouette points lie on ridges (corners in 2D, edges in 3D) shared by a front
+    // facing and a back facing face
+    float d2Min = maxFloat;
+    Vector<DIM> v = x - node.center;
+
+    for (size_t i = 0; i < DIM; i++) {
+        for (size_t j = i + 1; j < DIM; j++) {
+            for (int si = -1; si <= 1; si += 2) {
+                for (int sj = -1; sj <= 1; sj += 2) {
+                    bool frontFacingI = si*v(i) > node.extent(i);
+                    bool frontFacingJ = sj*v(j) > node.extent(j);
+                    if (frontFacingI == frontFacingJ) continue;
+
+                    // closest point on the ridge
+                    Vector<DIM> q = v.cwiseMax(-node.extent).cwiseMin(node.extent);
+                    q(i) = si*node.extent(i);
+                    q(j) = sj*node.extent(j);
+                    d2Min = std::min(d2Min, (v - q).squaredNorm());
+                }
+            }
+        }
+    }
+
+    return d2Min < maxFloat ? std::sqrt(d2Min) : maxFloat;
+}
+
+template <size_t DIM>
+inline float computeCylinderSilhouetteDistance(const ImplicitNode<DIM>& node, const Vector<DIM>& x)
+{
+    const Vector<DIM>& axis = node.extent;
+    Vector<DIM> v = x - node.center;
+    float z = v.dot(axis);
+    float rho = (v - z*axis).norm();
+    float r = node.radius;
+    float d2Min = maxFloat;
+
+    // lateral contour lines, visible when x lies outside the infinite cylinder
+    if (rho > r) {
+        float dz = std::max(0.0f, std::max(z - node.height, -z));
+        d2Min = std::min(d2Min, rho*rho - r*r + dz*dz);
+    }
+
+    // rims, where a cap and the lateral surface face opposite directions relative to x
+    for (int k = 0; k < 2; k++) {
+        float dz = z - k*node.height;
+        bool capFrontFacing = k == 0 ? z < 0.0f : z > node.height;
+
+        if (capFrontFacing) {
+            float dr2 = rho > r ? rho*rho - r*r : (rho - r)*(rho - r);
+            d2Min = std::min(d2Min, dz*dz + dr2);
+
+        } else if (rho > r) {
+            d2Min = std::min(d2Min, dz*dz + (rho - r)*(rho - r));
+        }
+    }
+
+    return d2Min < maxFloat ? std::sqrt(d2Min) : maxFloat;
+}
+
+template <size_t DIM>
+inline float computeNodeSilhouetteDistance(const std::vector<ImplicitNode<DIM>>& nodes, int nodeIndex,
+                                           const Vector<DIM>& x, float& signedDistance)
+{
+    const ImplicitNode<DIM>& node = nodes[nodeIndex];
+    Vector<DIM> normal;
+
+    if (node.type == ImplicitNodeType::Sphere) {
+        signedDistance = computeSphereSignedDistance<DIM>(node, x, normal);
+        return computeSphereSilhouetteDistance<DIM>(node, x);
+
+    } else if (node.type == ImplicitNodeType::Box) {
+        signedDistance = computeBoxSignedDistance<DIM>(node, x, normal);
+        return computeBoxSilhouetteDistance<DIM>(node, x);
+
+    } else if (node.type == ImplicitNodeType::Cylinder) {
+        signedDistance = computeCylinderSignedDistance<DIM>(node, x, normal);
+        return computeCylinderSilhouetteDistance<DIM>(node, x);
+    }
+
+    float dA, dB;
+    float silhouetteDistA = computeNodeSilhouetteDistance<DIM>(nodes, node.children[0], x, dA);
+    float silhouetteDistB = computeNodeSilhouetteDistance<DIM>(nodes, node.children[1], x, dB);
+    if (node.type == ImplicitNodeType::Union) signedDistance = std::min(dA, dB);
+    else if (node.type == ImplicitNodeType::Intersection) signedDistance = std::max(dA, dB);
+    else signedDistance = std::max(dA, -dB);
+
+    // creases where the operand boundaries meet lie on both boundaries, and hence no
+    // closer than the larger of the two (conservative) boundary distances
+    float creaseDist = std::max(std::fabs(dA), std::fabs(dB));
+
+    return std::min(creaseDist, std::min(silhouetteDistA, silhouetteDistB));
+}
+
+template <size_t DIM>
+inline std::pair<Vector<DIM>, Vector<DIM>> computePrimitiveBoundingBox(const ImplicitNode<DIM>& node)
+{
+    if (node.type == ImplicitNodeType::Sphere) {
+        Vector<DIM> r = Vector<DIM>::Constant(node.radius);
+        return std::make_pair(node.center - r, node.center + r);
+
+    } else if (node.type == ImplicitNodeType::Box) {
+        return std::make_pair(node.center - node.extent, node.center + node.extent);
+    }
+
+    // cylinder: bound the two cap disks
+    Vector<DIM> top = node.center + node.height*node.extent;
+    Vector<DIM> e = (Vector<DIM>::Ones() - node.extent.cwiseProduct(node.extent)).cwiseMax(0.0f).cwiseSqrt()*node.radius;
+    return std::make_pair(node.center.cwiseMin(top) - e, node.center.cwiseMax(top) + e);
+}
+
+template <size_t DIM>
+inline float computePrimitiveSurfaceArea(const ImplicitNode<DIM>& node)
+{
+    if (node.type == ImplicitNodeType::Sphere) {
+        return DIM == 2 ? 2.0f*M_PI*node.radius : 4.0f*M_PI*node.radius*node.radius;
+
+    } else if (node.type == ImplicitNodeType::Box) {
+        float area = 0.0f;
+        for (size_t i = 0; i < DIM; i++) {
+            float faceArea = 1.0f;
+            for (size_t j = 0; j < DIM; j++) {
+                if (j != i) faceArea *= 2.0f*node.extent(j);
+            }
+
+            area += 2.0f*faceArea;
+        }
+
+        return area;
+    }
+
+    return 2.0f*M_PI*node.radius*(node.radius + node.height);
+}
+
+template <size_t DIM>
+inline void samplePrimitiveSurface(const ImplicitNode<DIM>& node, float *u, Vector<DIM>& pt)
+{
+    if (node.type == ImplicitNodeType::Sphere) {
+        pt = node.center + node.radius*SphereSampler<DIM>::sampleUnitSphereUniform(u);
+
+    } else if (node.type == ImplicitNodeType::Box) {
+        // select a face in proportion to its area, then sample it uniformly
+        float totalArea = computePrimitiveSurfaceArea<DIM>(node);
+        float target = u[0]*totalArea;
+        float cumulativeArea = 0.0f;
+        pt = node.center;
+
+        for (size_t i = 0; i < DIM; i++) {
+            float faceArea = 1.0f;
+            for (size_t j = 0; j < DIM; j++) {
+                if (j != i) faceArea *= 2.0f*node.extent(j);
+            }
+
+            if (target <= cumulativeArea + 2.0f*faceArea || i == DIM - 1) {
+                float w = std::clamp((target - cumulativeArea)/(2.0f*faceArea), 0.0f, 1.0f);
+                float side = w < 0.5f ? -1.0f : 1.0f;
+                u[0] = w < 0.5f ? 2.0f*w : 2.0f*w - 1.0f;
+
+                for (size_t j = 0, k = 0; j < DIM; j++) {
+                    if (j == i) pt(j) += side*node.extent(j);
+                    else pt(j) += (2.0f*u[k++] - 1.0f)*node.extent(j);
+                }
+
+                break;
+            }
+
+            cumulativeArea += 2.0f*faceArea;
+        }
+
+    } else {
+        Vector<DIM> b1, b2;
+        computeOrthonormalBasis<DIM>(node.extent, b1, b2);
+        float r = node.radius;
+        float lateralArea = 2.0f*M_PI*r*node.height;
+        float capArea = M_PI*r*r;
+        float target = u[0]*(lateralArea + 2.0f*capArea);
+
+        if (target < lateralArea) {
+            float phi = 2.0f*M_PI*target/lateralArea;
+            pt = node.center + u[1]*node.height*node.extent + r*(std::cos(phi)*b1 + std::sin(phi)*b2);
+
+        } else {
+            float w = (target - lateralArea)/capArea;
+            float z = w < 1.0f ? 0.0f : node.height;
+            float phi = 2.0f*M_PI*(w < 1.0f ? w : w - 1.0f);
+            float rs = r*std::sqrt(u[1]);
+            pt = node.center + z*node.extent + rs*(std::cos(phi)*b1 + std::sin(phi)*b2);
+        }
+    }
+}
+
+template <size_t DIM>
+inline bool overlapsBall(const std::pair<Vector<DIM>, Vector<DIM>>& box, const Vector<DIM>& c, float r)
+{
+    if (r >= maxFloat) return true;
+    Vector<DIM> q = c.cwiseMax(box.first).cwiseMin(box.second);
+
+    return (q - c).squaredNorm() <= r*r;
+}
+
+template <size_t DIM>
+inline ImplicitBoundaryHandler<DIM>::ImplicitBoundaryHandler(): root(-1), boundaryEpsilon(1e-5f)
+{
+    // do nothing
+}
+
+template <size_t DIM>
+inline int ImplicitBoundaryHandler<DIM>::addNode(const ImplicitNode<DIM>& node)
+{
+    int index = (int)nodes.size();
+    nodes.emplace_back(node);
+    if (node.children[0] < 0) primitiveIndices.emplace_back(index);
+    root = index;
+
+    // scale the tolerance for classifying points as on the boundary with the scene extent
+    std::pair<Vector<DIM>, Vector<DIM>> box = computeBoundingBox();
+    boundaryEpsilon = std::max(1e-5f, 1e-5f*(box.second - box.first).norm());
+
+    return index;
+}
+
+template <size_t DIM>
+inline int ImplicitBoundaryHandler<DIM>::addSphere(const Vector<DIM>& center, float radius)
+{
+    ImplicitNode<DIM> node(ImplicitNodeType::Sphere);
+    node.center = center;
+    node.radius = radius;
+
+    return addNode(node);
+}
+
+template <size_t DIM>
+inline int ImplicitBoundaryHandler<DIM>::addBox(const Vector<DIM>& center, const Vector<DIM>& halfExtents)
+{
+    ImplicitNode<DIM> node(ImplicitNodeType::Box);
+    node.center = center;
+    node.extent = halfExtents.cwiseAbs();
+
+    return addNode(node);
+}
+
+template <size_t DIM>
+inline int ImplicitBoundaryHandler<DIM>::addCylinder(const Vector<DIM>& baseCenter, const Vector<DIM>& axis,
+                                                     float height, float radius)
+{
+    if (DIM != 3) {
+        std::cerr << "ImplicitBoundaryHandler::addCylinder(): cylinders are only supported in 3D" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    ImplicitNode<DIM> node(ImplicitNodeType::Cylinder);
+    node.center = baseCenter;
+    node.extent = axis.normalized();
+    node.height = height;
+    node.radius = radius;
+
+    return addNode(node);
+}
+
+template <size_t DIM>
+inline int ImplicitBoundaryHandler<DIM>::addUnion(int nodeA, int nodeB)
+{
+    ImplicitNode<DIM> node(ImplicitNodeType::Union);
+    node.children[0] = nodeA;
+    node.children[1] = nodeB;
+
+    return addNode(node);
+}
+
+template <size_t DIM>
+inline int ImplicitBoundaryHandler<DIM>::addIntersection(int nodeA, int nodeB)
+{
+    ImplicitNode<DIM> node(ImplicitNodeType::Intersection);
+    node.children[0] = nodeA;
+    node.children[1] = nodeB;
+
+    return addNode(node);
+}
+
+template <size_t DIM>
+inline int ImplicitBoundaryHandler<DIM>::addDifference(int nodeA, int nodeB)
+{
+    ImplicitNode<DIM> node(ImplicitNodeType::Difference);
+    node.children[0] = nodeA;
+    node.children[1] = nodeB;
+
+    return addNode(node);
+}
+
+template <size_t DIM>
+inline void ImplicitBoundaryHandler<DIM>::setRoot(int node)
+{
+    if (node < 0 || node >= (int)nodes.size()) {
+        std::cerr << "ImplicitBoundaryHandler::setRoot(): invalid node index " << node << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    root = node;
+}
+
+template <size_t DIM>
+inline bool ImplicitBoundaryHandler<DIM>::isEmpty() const
+{
+    return root < 0;
+}
+
+template <size_t DIM>
+inline float ImplicitBoundaryHandler<DIM>::computeSignedDistance(const Vector<DIM>& x, Vector<DIM>& normal) const
+{
+    return computeNodeSignedDistance<DIM>(nodes, root, x, normal);
+}
+
+template <size_t DIM>
+inline bool ImplicitBoundaryHandler<DIM>::containsPoint(const Vector<DIM>& x, bool includeBoundary) const
+{
+    Vector<DIM> normal;
+    float d = computeNodeSignedDistance<DIM>(nodes, root, x, normal);
+
+    return includeBoundary ? d <= boundaryEpsilon : d < -boundaryEpsilon;
+}
+
+template <size_t DIM>
+inline void ImplicitBoundaryHandler<DIM>::projectToBoundary(Vector<DIM>& x, Vector<DIM>& normal, float& distance,
+                                                            bool computeSignedDistance,
+                                                            const ImplicitBoundaryHandler<DIM> *trimmingBoundary) const
+{
+    // step along the distance gradient from the query point and from its closest points on
+    // each primitive; a single step suffices for individual primitives, while CSG combinations
+    // may require a few more since their distances are conservative
+    Vector<DIM> queryPt = x;
+    Vector<DIM> queryNormal;
+    float queryDist = computeNodeSignedDistance<DIM>(nodes, root, queryPt, queryNormal);
+    float bestDist2 = maxFloat;
+    float bestResidual = maxFloat;
+    bool foundBoundaryPt = false;
+
+    for (int i = -1; i < (int)primitiveIndices.size(); i++) {
+        Vector<DIM> pt = queryPt;
+        Vector<DIM> n = queryNormal;
+        float d = queryDist;
+        if (i >= 0) {
+            Vector<DIM> primitiveNormal;
+            pt -= computePrimitiveSignedDistance<DIM>(nodes[primitiveIndices[i]], queryPt, primitiveNormal)*primitiveNormal;
+            d = computeNodeSignedDistance<DIM>(nodes, root, pt, n);
+        }
+
+        for (int j = 0; j < IMPLICIT_MAX_PROJECTION_ITERATIONS && std::fabs(d) > boundaryEpsilon; j++) {
+            pt -= d*n;
+            d = computeNodeSignedDistance<DIM>(nodes, root, pt, n);
+        }
+
+        bool onBoundary = std::fabs(d) <= boundaryEpsilon;
+        if (onBoundary && trimmingBoundary != nullptr && !trimmingBoundary->containsPoint(pt)) {
+            // the point lies on a part of the boundary that is trimmed away, so slide it onto
+            // the crease with the trimming surface by alternating projections onto both surfaces
+            onBoundary = false;
+            for (int j = 0; j < IMPLICIT_MAX_PROJECTION_ITERATIONS && !onBoundary; j++) {
+                Vector<DIM> trimmingNormal;
+                pt -= trimmingBoundary->computeSignedDistance(pt, trimmingNormal)*trimmingNormal;
+                d = computeNodeSignedDistance<DIM>(nodes, root, pt, n);
+                pt -= d*n;
+                d = computeNodeSignedDistance<DIM>(nodes, root, pt, n);
+                onBoundary = std::fabs(d) <= boundaryEpsilon && trimmingBoundary->containsPoint(pt);
+            }
+        }
+
+        float dist2 = (pt - queryPt).squaredNorm();
+        if ((onBoundary && (!foundBoundaryPt || dist2 < bestDist2)) ||
+            (!foundBoundaryPt && std::fabs(d) < bestResidual)) {
+            x = pt;
+            normal = n;
+            bestDist2 = dist2;
+            bestResidual = std::fabs(d);
+            foundBoundaryPt = onBoundary;
+        }
+    }
+
+    if (!foundBoundaryPt) {
+        // the iterations stalled near a crease; fall back to the boundary point along the
+        // distance gradient, which lies on the boundary but need not be the closest point
+        IntersectionPoint<DIM> intersectionPt;
+        Vector<DIM> dir = queryDist > 0.0f ? Vector<DIM>(-queryNormal) : queryNormal;
+        if (intersect(queryPt, dir, maxFloat, intersectionPt, trimmingBoundary) ||
+            intersect(queryPt, -dir, maxFloat, intersectionPt, trimmingBoundary)) {
+            x = intersectionPt.pt;
+            normal = intersectionPt.normal;
+        }
+    }
+
+    distance = (x - queryPt).norm();
+    if (computeSignedDistance && queryDist < 0.0f) distance *= -1.0f;
+}
+
+template <size_t DIM>
+inline bool ImplicitBoundaryHandler<DIM>::intersect(const Vector<DIM>& origin, const Vector<DIM>& dir, float tMax,
+                                                    IntersectionPoint<DIM>& intersectionPt,
+                                                    const ImplicitBoundaryHandler<DIM> *trimmingBoundary) const
+{
+    Vector<DIM> d = dir.normalized();
+    ImplicitRayIntervals<DIM> intervals;
+    computeNodeRayIntervals<DIM>(nodes, root, origin, d, intervals);
+
+    for (int i = 0; i < intervals.n; i++) {
+        const ImplicitRayInterval<DIM>& interval = intervals.intervals[i];
+        if (interval.tEnter > 0.0f && interval.tEnter <= tMax) {
+            Vector<DIM> pt = origin + interval.tEnter*d;
+            if (trimmingBoundary == nullptr || trimmingBoundary->containsPoint(pt)) {
+                intersectionPt = IntersectionPoint<DIM>(pt, interval.nEnter, interval.tEnter);
+                return true;
+            }
+        }
+
+        if (interval.tExit > 0.0f && interval.tExit <= tMax && interval.tExit < maxFloat) {
+            Vector<DIM> pt = origin + interval.tExit*d;
+            if (trimmingBoundary == nullptr || trimmingBoundary->containsPoint(pt)) {
+                intersectionPt = IntersectionPoint<DIM>(pt, interval.nExit, interval.tExit);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+template <size_t DIM>
+inline int ImplicitBoundaryHandler<DIM>::intersectAll(const Vector<DIM>& origin, const Vector<DIM>& dir, float tMax,
+                                                      std::vector<IntersectionPoint<DIM>> *intersectionPts,
+                                                      const ImplicitBoundaryHandler<DIM> *trimmingBoundary,
+                                                      bool includeCrease) const
+{
+    Vector<DIM> d = dir.normalized();
+    ImplicitRayIntervals<DIM> intervals;
+    computeNodeRayIntervals<DIM>(nodes, root, origin, d, intervals);
+    int nHits = 0;
+
+    for (int i = 0; i < intervals.n; i++) {
+        const ImplicitRayInterval<DIM>& interval = intervals.intervals[i];
+        if (interval.tEnter > 0.0f && interval.tEnter <= tMax) {
+            Vector<DIM> pt = origin + interval.tEnter*d;
+            if (trimmingBoundary == nullptr || trimmingBoundary->containsPoint(pt, includeCrease)) {
+                if (intersectionPts) intersectionPts->emplace_back(pt, interval.nEnter, interval.tEnter);
+                nHits++;
+            }
+        }
+
+        if (interval.tExit > 0.0f && interval.tExit <= tMax && interval.tExit < maxFloat) {
+            Vector<DIM> pt = origin + interval.tExit*d;
+            if (trimmingBoundary == nullptr || trimmingBoundary->containsPoint(pt, includeCrease)) {
+                if (intersectionPts) intersectionPts->emplace_back(pt, interval.nExit, interval.tExit);
+                nHits++;
+            }
+        }
+    }
+
+    return nHits;
+}
+
+template <size_t DIM>
+inline float ImplicitBoundaryHandler<DIM>::computeSilhouetteDistance(const Vector<DIM>& x) const
+{
+    float signedDistance;
+    return computeNodeSilhouetteDistance<DIM>(nodes, root, x, signedDistance);
+}
+
+template <size_t DIM>
+inline float ImplicitBoundaryHandler<DIM>::computePrimitiveSurfaceArea(const Vector<DIM>& c, float r) const
+{
+    float area = 0.0f;
+    for (int index: primitiveIndices) {
+        const ImplicitNode<DIM>& node = nodes[index];
+        if (overlapsBall<DIM>(computePrimitiveBoundingBox<DIM>(node), c, r)) {
+            area += zombie::computePrimitiveSurfaceArea<DIM>(node);
+        }
+    }
+
+    return area;
+}
+
+template <size_t DIM>
+inline bool ImplicitBoundaryHandler<DIM>::sampleBoundary(const float *u, Vector<DIM>& pt, Vector<DIM>& normal,
+                                                         const Vector<DIM>& c, float r) const
+{
+    // select a primitive in proportion to its surface area, reusing the first random number
+    float totalArea = computePrimitiveSurfaceArea(c, r);
+    if (totalArea <= 0.0f) return false;
+
+    float target = u[0]*totalArea;
+    float cumulativeArea = 0.0f;
+    int selected = -1;
+    float selectedArea = 0.0f;
+    for (int index: primitiveIndices) {
+        const ImplicitNode<DIM>& node = nodes[index];
+        if (!overlapsBall<DIM>(computePrimitiveBoundingBox<DIM>(node), c, r)) continue;
+
+        selected = index;
+        selectedArea = zombie::computePrimitiveSurfaceArea<DIM>(node);
+        if (target <= cumulativeArea + selectedArea) break;
+        cumulativeArea += selectedArea;
+    }
+
+    if (selected < 0 || selectedArea <= 0.0f) return false;
+    float v[DIM];
+    v[0] = std::clamp((target - cumulativeArea)/selectedArea, 0.0f, 1.0f);
+    for (size_t i = 1; i < DIM; i++) v[i] = u[i];
+    samplePrimitiveSurface<DIM>(nodes[selected], v, pt);
+
+    // reject points that lie outside the ball or on primitive surface patches that are
+    // not part of the boundary
+    if (r < maxFloat && (pt - c).squaredNorm() > r*r) return false;
+    float d = computeNodeSignedDistance<DIM>(nodes, root, pt, normal);
+
+    return std::fabs(d) <= boundaryEpsilon;
+}
+
+template <size_t DIM>
+inline std::pair<Vector<DIM>, Vector<DIM>> ImplicitBoundaryHandler<DIM>::computeBoundingBox() const
+{
+    Vector<DIM> pMin = Vector<DIM>::Constant(maxFloat);
+    Vector<DIM> pMax = Vector<DIM>::Constant(-maxFloat);
+    for (int index: primitiveIndices) {
+        std::pair<Vector<DIM>, Vector<DIM>> box = computePrimitiveBoundingBox<DIM>(nodes[index]);
+        pMin = pMin.cwiseMin(box.first);
+        pMax = pMax.cwiseMax(box.second);
+    }
+
+    return std::make_pair(pMin, pMax);
+}
+
+template <size_t DIM>
+inline float estimateImplicitDomainVolume(const ImplicitBoundaryHandler<DIM>& absorbingBoundaryHandler,
+                                          const ImplicitBoundaryHandler<DIM>& reflectingBoundaryHandler,
+                                          const std::pair<Vector<DIM>, Vector<DIM>>& boundingBoxExtents)
+{
+    // count the cells of a regular grid over the bounding box whose jittered sample points are
+    // inside both solids; jittering avoids the bias of sampling cell centers near axis aligned faces
+    const int resolution = DIM == 2 ? 512 : 96;
+    Vector<DIM> cellExtent = (boundingBoxExtents.second - boundingBoxExtents.first)/resolution;
+    float cellVolume = cellExtent.prod();
+    int nCells = 1;
+    for (size_t i = 0; i < DIM; i++) nCells *= resolution;
+
+    int nInside = 0;
+    Vector<DIM> normal;
+    pcg32 sampler;
+    for (int c = 0; c < nCells; c++) {
+        Vector<DIM> x = boundingBoxExtents.first;
+        for (size_t i = 0, index = c; i < DIM; i++, index /= resolution) {
+            x(i) += (index%resolution + sampler.nextFloat())*cellExtent(i);
+        }
+
+        bool inside = (absorbingBoundaryHandler.isEmpty() ||
+                       absorbingBoundaryHandler.computeSignedDistance(x, normal) < 0.0f) &&
+                      (reflectingBoundaryHandler.isEmpty() ||
+                       reflectingBoundaryHandler.computeSignedDistance(x, normal) < 0.0f);
+        if (inside) nInside++;
+    }
+
+    return nInside*cellVolume;
+}
+
+template <size_t DIM>
+inline float computeTrimmedSignedDistance(const ImplicitBoundaryHandler<DIM>& boundaryHandler,
+                                          const ImplicitBoundaryHandler<DIM> *trimmingBoundary,
+                                          const Vector<DIM>& x)
+{
+    // trimming only increases distances, so the conservative distance to the untrimmed
+    // boundary is kept if its closest point lies inside the trimming solid; otherwise the
+    // point is projected to the trimmed boundary
+    Vector<DIM> normal;
+    float d = boundaryHandler.computeSignedDistance(x, normal);
+    if (trimmingBoundary == nullptr || trimmingBoundary->containsPoint(x - d*normal)) return d;
+
+    Vector<DIM> pt = x;
+    boundaryHandler.projectToBoundary(pt, normal, d, true, trimmingBoundary);
+    return d;
+}
+
+template <size_t DIM>
+void populateGeometricQueries(const ImplicitBoundaryHandler<DIM>& absorbingBoundaryHandler,
+                              const ImplicitBoundaryHandler<DIM>& reflectingBoundaryHandler,
+                              bool areRobinConditionsPureNeumann,
+                              const std::pair<Vector<DIM>, Vector<DIM>>& boundingBoxExtents,
+                              GeometricQueries<DIM>& geometricQueries)
+{
+    if (!areRobinConditionsPureNeumann) {
+        std::cerr << "populateGeometricQueries(): Robin boundary conditions are not supported for implicit boundaries!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const ImplicitBoundaryHandler<DIM> *absorbingBoundary = absorbingBoundaryHandler.isEmpty() ?
+                                                            nullptr : &absorbingBoundaryHandler;
+    const ImplicitBoundaryHandler<DIM> *reflectingBoundary = reflectingBoundaryHandler.isEmpty() ?
+                                                             nullptr : &reflectingBoundaryHandler;
+    fcpw::BoundingBox<DIM> boundingBox;
+    boundingBox.expandToInclude(boundingBoxExtents.first);
+    boundingBox.expandToInclude(boundingBoxExtents.second);
+
+    geometricQueries.computeDistToAbsorbingBoundary = [absorbingBoundary, reflectingBoundary, boundingBox](
+                                                       const Vector<DIM>& x, bool computeSignedDistance) -> float {
+        if (absorbingBoundary != nullptr) {
+            float d = computeTrimmedSignedDistance<DIM>(*absorbingBoundary, reflectingBoundary, x);
+            return computeSignedDistance ? d : std::fabs(d);
+        }
+
+        float d2Min, d2Max;
+        boundingBox.computeSquaredDistance(x, d2Min, d2Max);
+        return std::sqrt(d2Max);
+    };
+    geometricQueries.computeDistToReflectingBoundary = [absorbingBoundary, reflectingBoundary](
+                                                        const Vector<DIM>& x, bool computeSignedDistance) -> float {
+        if (reflectingBoundary != nullptr) {
+            float d = computeTrimmedSignedDistance<DIM>(*reflectingBoundary, absorbingBoundary, x);
+            return computeSignedDistance ? d : std::fabs(d);
+        }
+
+        return fcpw::maxFloat;
+    };
+    geometricQueries.computeDistToBoundary = [&geometricQueries](const Vector<DIM>& x,
+                                                                 bool computeSignedDistance) -> float {
+        float d1 = geometricQueries.computeDistToAbsorbingBoundary(x, computeSignedDistance);
+        float d2 = geometricQueries.computeDistToReflectingBoundary(x, computeSignedDistance);
+
+        return std::fabs(d1) < std::fabs(d2) ? d1 : d2;
+    };
+    geometricQueries.projectToAbsorbingBoundary = [absorbingBoundary, reflectingBoundary](
+                                                   Vector<DIM>& x, Vector<DIM>& normal,
+                                                   float& distance, bool computeSignedDistance) -> bool {
+        if (absorbingBoundary != nullptr) {
+            absorbingBoundary->projectToBoundary(x, normal, distance, computeSignedDistance, reflectingBoundary);
+            return true;
+        }
+
+        distance = 0.0f;
+        return false;
+    };
+    geometricQueries.projectToReflectingBoundary = [absorbingBoundary, reflectingBoundary](
+                                                    Vector<DIM>& x, Vector<DIM>& normal,
+                                                    float& distance, bool computeSignedDistance) -> bool {
+        if (reflectingBoundary != nullptr) {
+            reflectingBoundary->projectToBoundary(x, normal, distance, computeSignedDistance, absorbingBoundary);
+            return true;
+        }
+
+        distance = 0.0f;
+        return false;
+    };
+    geometricQueries.projectToBoundary = [&geometricQueries](Vector<DIM>& x, Vector<DIM>& normal,
+                                                             float& distance, bool computeSignedDistance) -> bool {
+        distance = fcpw::maxFloat;
+        bool didProject = false;
+        Vector<DIM> queryPt = x;
+
+        Vector<DIM> absorbingBoundaryPt = queryPt;
+        Vector<DIM> absorbingBoundaryNormal;
+        float distanceToAbsorbingBoundary;
+        if (geometricQueries.projectToAbsorbingBoundary(absorbingBoundaryPt, absorbingBoundaryNormal,
+                                                        distanceToAbsorbingBoundary, computeSignedDistance)) {
+            x = absorbingBoundaryPt;
+            normal = absorbingBoundaryNormal;
+            distance = distanceToAbsorbingBoundary;
+            didProject = true;
+        }
+
+        Vector<DIM> reflectingBoundaryPt = queryPt;
+        Vector<DIM> reflectingBoundaryNormal;
+        float distanceToReflectingBoundary;
+        if (geometricQueries.projectToReflectingBoundary(reflectingBoundaryPt, reflectingBoundaryNormal,
+                                                         distanceToReflectingBoundary, computeSignedDistance)) {
+            if (std::fabs(distanceToReflectingBoundary) < std::fabs(distance)) {
+                x = reflectingBoundaryPt;
+                normal = reflectingBoundaryNormal;
+                distance = distanceToReflectingBoundary;
+            }
+
+            didProject = true;
+        }
+
+        if (!didProject) distance = 0.0f;
+        return didProject;
+    };
+    geometricQueries.offsetPointAlongDirection = [](const Vector<DIM>& x,
+                                                    const Vector<DIM>& dir) -> Vector<DIM> {
+        return offsetPointAlongDirection<DIM>(x, dir);
+    };
+    geometricQueries.intersectAbsorbingBoundary = [&geometricQueries, absorbingBoundary, reflectingBoundary](
+                                                   const Vector<DIM>& origin, const Vector<DIM>& normal,
+                                                   const Vector<DIM>& dir, float tMax, bool onAborbingBoundary,
+                                                   IntersectionPoint<DIM>& intersectionPt) -> bool {
+        if (absorbingBoundary != nullptr) {
+            Vector<DIM> queryOrigin = onAborbingBoundary ?
+                                      geometricQueries.offsetPointAlongDirection(origin, -normal) :
+                                      origin;
+            return absorbingBoundary->intersect(queryOrigin, dir, tMax, intersectionPt, reflectingBoundary);
+        }
+
+        return false;
+    };
+    geometricQueries.intersectReflectingBoundary = [&geometricQueries, absorbingBoundary, reflectingBoundary](
+                                                    const Vector<DIM>& origin, const Vector<DIM>& normal,
+                                                    const Vector<DIM>& dir, float tMax, bool onReflectingBoundary,
+                                                    IntersectionPoint<DIM>& intersectionPt) -> bool {
+        if (reflectingBoundary != nullptr) {
+            Vector<DIM> queryOrigin = onReflectingBoundary ?
+                                      geometricQueries.offsetPointAlongDirection(origin, -normal) :
+                                      origin;
+            return reflectingBoundary->intersect(queryOrigin, dir, tMax, intersectionPt, absorbingBoundary);
+        }
+
+        return false;
+    };
+    geometricQueries.intersectBoundary = [&geometricQueries](
+                                          const Vector<DIM>& origin, const Vector<DIM>& normal,
+                                          const Vector<DIM>& dir, float tMax,
+                                          bool onAborbingBoundary, bool onReflectingBoundary,
+                                          IntersectionPoint<DIM>& intersectionPt) -> bool {
+        IntersectionPoint<DIM> absorbingBoundaryIntersectionPt;
+        bool intersectedAbsorbingBoundary = geometricQueries.intersectAbsorbingBoundary(
+            origin, normal, dir, tMax, onAborbingBoundary, absorbingBoundaryIntersectionPt);
+
+        IntersectionPoint<DIM> reflectingBoundaryIntersectionPt;
+        bool intersectedReflectingBoundary = geometricQueries.intersectReflectingBoundary(
+            origin, normal, dir, tMax, onReflectingBoundary, reflectingBoundaryIntersectionPt);
+
+        if (intersectedAbsorbingBoundary && intersectedReflectingBoundary) {
+            if (absorbingBoundaryIntersectionPt.dist < reflectingBoundaryIntersectionPt.dist) {
+                intersectionPt = absorbingBoundaryIntersectionPt;
+
+            } else {
+                intersectionPt = reflectingBoundaryIntersectionPt;
+            }
+
+        } else if (intersectedAbsorbingBoundary) {
+            intersectionPt = absorbingBoundaryIntersectionPt;
+
+        } else if (intersectedReflectingBoundary) {
+            intersectionPt = reflectingBoundaryIntersectionPt;
+        }
+
+        return intersectedAbsorbingBoundary || intersectedReflectingBoundary;
+    };
+    geometricQueries.intersectBoundaryAllHits = [&geometricQueries, absorbingBoundary, reflectingBoundary](
+                                                 const Vector<DIM>& origin, const Vector<DIM>& normal,
+                                                 const Vector<DIM>& dir, float tMax,
+                                                 bool onAborbingBoundary, bool onReflectingBoundary,
+                                                 std::vector<IntersectionPoint<DIM>>& intersectionPts) -> int {
+        int nIntersections = 0;
+        intersectionPts.clear();
+
+        if (absorbingBoundary != nullptr) {
+            Vector<DIM> queryOrigin = onAborbingBoundary ?
+                                      geometricQueries.offsetPointAlongDirection(origin, -normal) :
+                                      origin;
+            nIntersections += absorbingBoundary->intersectAll(queryOrigin, dir, tMax, &intersectionPts,
+                                                              reflectingBoundary);
+        }
+
+        if (reflectingBoundary != nullptr) {
+            Vector<DIM> queryOrigin = onReflectingBoundary ?
+                                      geometricQueries.offsetPointAlongDirection(origin, -normal) :
+                                      origin;
+            nIntersections += reflectingBoundary->intersectAll(queryOrigin, dir, tMax, &intersectionPts,
+                                                               absorbingBoundary, false);
+        }
+
+        return nIntersections;
+    };
+    geometricQueries.countBoundaryIntersections = [absorbingBoundary, reflectingBoundary](
+                                                   const Vector<DIM>& origin, const Vector<DIM>& dir,
+                                                   float tMax) -> int {
+        // only the parts of each surface inside the other solid bound the domain; hits on the
+        // crease where both surfaces meet are counted once, as hits on the absorbing boundary
+        int nIntersections = 0;
+        if (absorbingBoundary != nullptr) {
+            nIntersections += absorbingBoundary->intersectAll(origin, dir, tMax, nullptr, reflectingBoundary);
+        }
+
+        if (reflectingBoundary != nullptr) {
+            nIntersections += reflectingBoundary->intersectAll(origin, dir, tMax, nullptr, absorbingBoundary, false);
+        }
+
+        return nIntersections;
+    };
+    geometricQueries.intersectsWithReflectingBoundary = [&geometricQueries, absorbingBoundary, reflectingBoundary](
+                                                         const Vector<DIM>& xi, const Vector<DIM>& xj,
+                                                         const Vector<DIM>& ni, const Vector<DIM>& nj,
+                                                         bool offseti, bool offsetj) -> bool {
+        if (reflectingBoundary != nullptr) {
+            Vector<DIM> pt1 = offseti ? geometricQueries.offsetPointAlongDirection(xi, -ni) : xi;
+            Vector<DIM> pt2 = offsetj ? geometricQueries.offsetPointAlongDirection(xj, -nj) : xj;
+            Vector<DIM> dir = pt2 - pt1;
+            float dist = dir.norm();
+            IntersectionPoint<DIM> intersectionPt;
+
+            return dist > 0.0f && reflectingBoundary->intersect(pt1, dir/dist, dist, intersectionPt, absorbingBoundary);
+        }
+
+        return false;
+    };
+    geometricQueries.sampleReflectingBoundary = [absorbingBoundary, reflectingBoundary](
+                                                 const Vector<DIM>& x, float radius, const Vector<DIM>& randNums,
+                                                 BoundarySample<DIM>& boundarySample) -> bool {
+        if (reflectingBoundary != nullptr) {
+            float u[DIM];
+            for (size_t i = 0; i < DIM; i++) u[i] = randNums(i);
+
+            float area = reflectingBoundary->computePrimitiveSurfaceArea(x, radius);
+            if (!reflectingBoundary->sampleBoundary(u, boundarySample.pt, boundarySample.normal, x, radius) ||
+                (absorbingBoundary != nullptr && !absorbingBoundary->containsPoint(boundarySample.pt))) {
+                return false;
+            }
+
+            boundarySample.pdf = 1.0f/area;
+            return true;
+        }
+
+        return false;
+    };
+    geometricQueries.computeStarRadiusForReflectingBoundary = [reflectingBoundary](
+                                                               const Vector<DIM>& x, float minRadius, float maxRadius,
+                                                               float silhouettePrecision, bool flipNormalOrientation) -> float {
+        if (minRadius > maxRadius) return maxRadius;
+        if (reflectingBoundary != nullptr) {
+            // silhouettes of convex primitives do not depend on the normal orientation
+            float silhouetteDist = reflectingBoundary->computeSilhouetteDistance(x);
+            return std::max(std::min(silhouetteDist, maxRadius), minRadius);
+        }
+
+        return std::max(maxRadius, minRadius);
+    };
+    geometricQueries.insideDomain = [&geometricQueries, absorbingBoundary, reflectingBoundary](
+                                     const Vector<DIM>& x, bool useRayIntersections) -> bool {
+        if (!geometricQueries.domainIsWatertight) return true;
+
+        // the domain is the intersection of the two solids, so the sign of each implicit
+        // distance classifies points exactly, without ray casting
+        Vector<DIM> normal;
+        if (absorbingBoundary != nullptr && absorbingBoundary->computeSignedDistance(x, normal) >= 0.0f) return false;
+        if (reflectingBoundary != nullptr && reflectingBoundary->computeSignedDistance(x, normal) >= 0.0f) return false;
+
+        return true;
+    };
+    geometricQueries.outsideBoundingDomain = [boundingBox](const Vector<DIM>& x) -> bool {
+        return !boundingBox.contains(x);
+    };
+
+    float signedVolume = estimateImplicitDomainVolume<DIM>(absorbingBoundaryHandler, reflectingBoundaryHandler,
+                                                           boundingBoxExtents);
+    geometricQueries.computeSignedDomainVolume = [signedVolume]() -> float {
+        return signedVolume;
+    };
+}
+
+template <typename T, size_t DIM>
+inline UniformImplicitBoundarySampler<T, DIM>::UniformImplicitBoundarySampler(const ImplicitBoundaryHandler<DIM>& handler_,
+                                                                              const GeometricQueries<DIM>& queries_,
+                                                                              const std::function<bool(const Vector<DIM>&)>& insideSolveRegion_,
+                                                                              int nPilotSamples_):
+                                                                              handler(handler_), queries(queries_),
+                                                                              insideSolveRegion(insideSolveRegion_),
+                                                                              nPilotSamples(nPilotSamples_),
+                                                                              boundaryArea(0.0f), boundaryAreaNormalAligned(0.0f)
+{
+    auto now = std::chrono::high_resolution_clock::now();
+    uint64_t seed = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    sampler = pcg32(seed);
+}
+
+template <typename T, size_t DIM>
+inline bool UniformImplicitBoundarySampler<T, DIM>::sampleCandidate(float normalOffsetForBoundary,
+                                                                    Vector<DIM>& pt, Vector<DIM>& normal)
+{
+    float u[DIM];
+    for (size_t i = 0; i < DIM; i++) u[i] = sampler.nextFloat();
+    if (!handler.sampleBoundary(u, pt, normal)) return false;
+
+    // don't generate any samples on the boundary outside the solve region
+    pt += normalOffsetForBoundary*normal;
+    return insideSolveRegion(pt);
+}
+
+template <typename T, size_t DIM>
+inline float UniformImplicitBoundarySampler<T, DIM>::estimateArea(float normalOffsetForBoundary)
+{
+    // the fraction of accepted candidates estimates the fraction of primitive surface
+    // area that belongs to the boundary inside the solve region
+    int nAccepted = 0;
+    Vector<DIM> pt, normal;
+    for (int i = 0; i < nPilotSamples; i++) {
+        if (sampleCandidate(normalOffsetForBoundary, pt, normal)) nAccepted++;
+    }
+
+    return handler.computePrimitiveSurfaceArea()*nAccepted/std::max(nPilotSamples, 1);
+}
+
+template <typename T, size_t DIM>
+inline void UniformImplicitBoundarySampler<T, DIM>::initialize(float normalOffsetForBoundary, bool solveDoubleSided)
+{
+    // estimate the area of the boundary displaced along inward normals
+    boundaryArea = estimateArea(-1.0f*normalOffsetForBoundary);
+
+    if (solveDoubleSided) {
+        // estimate the area of the boundary displaced along outward normals
+        boundaryAreaNormalAligned = estimateArea(normalOffsetForBoundary);
+    }
+}
+
+template <typename T, size_t DIM>
+inline int UniformImplicitBoundarySampler<T, DIM>::getSampleCount(int nTotalSamples, bool boundaryNormalAlignedSamples) const
+{
+    float totalBoundaryArea = boundaryArea + boundaryAreaNormalAligned;
+    return boundaryNormalAlignedSamples ? std::ceil(nTotalSamples*boundaryAreaNormalAligned/totalBoundaryArea) :
+                                          std::ceil(nTotalSamples*boundaryArea/totalBoundaryArea);
+}
+
+template <typename T, size_t DIM>
+inline void UniformImplicitBoundarySampler<T, DIM>::generateSamples(int nSamples, SampleType sampleType,
+                                                                    float normalOffsetForBoundary,
+                                                                    std::vector<SamplePoint<T, DIM>>& samplePts,
+                                                                    bool generateBoundaryNormalAlignedSamples)
+{
+    samplePts.clear();
+    float area = generateBoundaryNormalAlignedSamples ? boundaryAreaNormalAligned : boundaryArea;
+    float offset = generateBoundaryNormalAlignedSamples ? normalOffsetForBoundary : -1.0f*normalOffsetForBoundary;
+
+    if (area > 0.0f) {
+        float pdf = 1.0f/area;
+        Vector<DIM> pt, normal;
+
+        // draw candidates until enough samples have been accepted; the expected number of
+        // attempts is bounded by the ratio of primitive to boundary area
+        long long maxAttempts = 1000LL*std::max(nSamples, 1);
+        for (long long attempt = 0; attempt < maxAttempts && (int)samplePts.size() < nSamples; attempt++) {
+            if (!sampleCandidate(offset, pt, normal)) continue;
+
+            float distToAbsorbingBoundary = queries.computeDistToAbsorbingBoundary(pt, false);
+            float distToReflectingBoundary = queries.computeDistToReflectingBoundary(pt, false);
+            samplePts.emplace_back(SamplePoint<T, DIM>(pt, normal, sampleType,
+                                                       pdf, distToAbsorbingBoundary,
+                                                       distToReflectingBoundary));
+            samplePts.back().estimateBoundaryNormalAligned = generateBoundaryNormalAlignedSamples;
+        }
+
+    } else {
+        std::cout << "Implicit boundary has no area inside the solve region!" << std::endl;
+    }
+}
+
+} // zombie
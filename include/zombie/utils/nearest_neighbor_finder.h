@@ -25,6 +25,35 @@ struct PointCloud {
     bool kdtree_get_bbox(BBOX& bb) const { return false; }
 };
 
+// Helper class that forwards each neighbor found by nanoflann within a ball to a visitor,
+// instead of storing it in a result vector
+template <typename Visitor>
+struct RadiusVisitorResultSet {
+    // constructor
+    RadiusVisitorResultSet(float squaredRadius_, Visitor& visitor_):
+                           squaredRadius(squaredRadius_), visitor(visitor_), count(0) {}
+
+    // nanoflann interface
+    inline size_t size() const { return count; }
+    inline bool empty() const { return count == 0; }
+    inline bool full() const { return true; }
+    inline float worstDist() const { return squaredRadius; }
+    template <typename IndexType>
+    inline bool addPoint(float squaredDist, IndexType index) {
+        if (squaredDist < squaredRadius) {
+            visitor((size_t)index);
+            count++;
+        }
+
+        return true;
+    }
+
+    // members
+    float squaredRadius;
+    Visitor& visitor;
+    size_t count;
+};
+
 // Accelerated k nearest neighbor and radius search queries
 template <size_t DIM>
 class NearestNeighborFinder {
@@ -43,6 +72,11 @@ public:
     size_t radiusSearch(const Vector<DIM>& queryPt, float radius,
                         std::vector<size_t>& outIndices) const;
 
+    // invokes visitor(index) on every neighbor within a ball of input radius without
+    // allocating, and returns the number of neighbors visited
+    template <typename Visitor>
+    size_t radiusSearch(const Vector<DIM>& queryPt, float radius, Visitor&& visitor) const;
+
 protected:
     // members
     PointCloud<DIM> data;
@@ -79,8 +113,10 @@ inline size_t NearestNeighborFinder<DIM>::kNearest(const Vector<DIM>& queryPt, s
         exit(EXIT_FAILURE);
     }
 
+    // reuse a per-thread buffer for the distances, which are discarded
+    static thread_local std::vector<float> outSquaredDists;
     outIndices.resize(k);
-    std::vector<float> outSquaredDists(k);
+    outSquaredDists.resize(k);
     return tree.knnSearch(&queryPt[0], k, &outIndices[0], &outSquaredDists[0]);
 }
 
@@ -88,16 +124,23 @@ template <size_t DIM>
 inline size_t NearestNeighborFinder<DIM>::radiusSearch(const Vector<DIM>& queryPt, float radius,
                                                        std::vector<size_t>& outIndices) const
 {
-    float squaredRadius = radius*radius; // nanoflann wants a SQUARED raidus
-    std::vector<nanoflann::ResultItem<uint32_t, float>> resultItems;
-    size_t nResultItems = tree.radiusSearch(&queryPt[0], squaredRadius, resultItems);
+    // append directly to the output vector, so callers that reuse it never reallocate
+    outIndices.clear();
+    return radiusSearch(queryPt, radius, [&outIndices](size_t index) -> void {
+        outIndices.emplace_back(index);
+    });
+}
 
-    outIndices.resize(nResultItems);
-    for (size_t i = 0; i < nResultItems; i++) {
-        outIndices[i] = resultItems[i].first;
-    }
+template <size_t DIM>
+template <typename Visitor>
+inline size_t NearestNeighborFinder<DIM>::radiusSearch(const Vector<DIM>& queryPt, float radius,
+                                                       Visitor&& visitor) const
+{
+    float squaredRadius = radius*radius; // nanoflann wants a SQUARED raidus
+    RadiusVisitorResultSet<Visitor> resultSet(squaredRadius, visitor);
+    tree.findNeighbors(resultSet, &queryPt[0], nanoflann::SearchParameters());
 
-    return nResultItems;
+    return resultSet.size();
 }
 
 } // zombie
@@ -0,0 +1,85 @@
+// This file provides a helper to select the packet width of vectorized acceleration
+// structures. Since the library is header-only, the instruction set used to process the
+// packets is fixed by the flags the including translation unit is compiled with, so the
+// selected width is the widest one that both the compiled instruction set and the host CPU
+// support. NOTE: there is no dispatch between instruction sets at runtime; to target hosts
+// with AVX or AVX-512, compile with the corresponding flags (e.g., -mavx2 or -mavx512f).
+
+#pragma once
+
+#include <algorithm>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+    #include <immintrin.h>
+#endif
+
+namespace zombie {
+
+// returns the packet width to use for vectorized acceleration structures, i.e., the number
+// of 32-bit floats that fit in the widest vector register supported by both the instruction
+// set the code is compiled for and the host CPU: 16 for AVX-512, 8 for AVX/AVX2 and 4 otherwise
+int selectPacketWidth();
+
+// returns the number of 32-bit floats in the widest vector register of the instruction set
+// the code is compiled for
+int queryCompiledSimdWidth();
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Implementation
+
+inline int queryCompiledSimdWidth()
+{
+#if defined(__AVX512F__)
+    return 16;
+#elif defined(__AVX__)
+    return 8;
+#else
+    return 4;
+#endif
+}
+
+inline int queryHostSimdWidth()
+{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    // these builtins check both CPUID flags and OS support for the extended register state
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return 16;
+    if (__builtin_cpu_supports("avx2") || __builtin_cpu_supports("avx")) return 8;
+
+    return 4;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return 4;
+
+    // check that the OS saves the YMM (and ZMM) register state on context switches
+    unsigned long long xcr0 = _xgetbv(0);
+    if ((xcr0 & 0x6) != 0x6) return 4;
+
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        bool avx512f = (info[1] & (1 << 16)) != 0;
+        if (avx512f && (xcr0 & 0xe6) == 0xe6) return 16;
+    }
+
+    return 8;
+#else
+    // NEON and other 128-bit vector units
+    return 4;
+#endif
+}
+
+inline int selectPacketWidth()
+{
+    // packets wider than the compiled instruction set would only be split into several
+    // native operations, while a host narrower than it cannot run the compiled code at all
+    static const int packetWidth = std::min(queryCompiledSimdWidth(), queryHostSimdWidth());
+    return packetWidth;
+}
+
+} // zombie
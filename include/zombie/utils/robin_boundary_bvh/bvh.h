@@ -41,6 +41,20 @@ public:
              SortRobinSoupPositions<typename PrimitiveType::Bound, PrimitiveType, NodeType, DIM> sortPositions_,
              bool packLeaves_=false, int leafSize_=4, int nBuckets_=8);
 
+    // constructor for a hierarchy whose flattened node array was built previously; assumes
+    // the primitives are ordered as they were when the node array was built, and neither
+    // sorts soup positions nor assigns geometric data to nodes
+    RobinBvh(std::vector<PrimitiveType *>& primitives_,
+             std::vector<SilhouettePrimitive<DIM> *>& silhouettes_,
+             std::vector<NodeType>&& flatTree_);
+
+    // returns the flattened node array
+    const std::vector<NodeType>& getFlatTree() const;
+
+    // replaces the flattened node array with one built previously; assumes the primitives
+    // are ordered as they were when the node array was built
+    void setFlatTree(std::vector<NodeType>&& flatTree_);
+
     // refits the bvh
     void refit();
 
@@ -70,6 +84,14 @@ std::unique_ptr<RobinBvh<DIM, RobinBvhNode<DIM>, PrimitiveType, NodeBound>> crea
                                                     std::vector<SilhouettePrimitive<DIM> *>& silhouettes,
                                                     bool printStats=true, bool packLeaves=false, int leafSize=4);
 
+// creates a RobinBvh from a flattened node array built previously (e.g., one loaded from a cache)
+template<size_t DIM, typename PrimitiveType, typename NodeBound>
+std::unique_ptr<RobinBvh<DIM, RobinBvhNode<DIM>, PrimitiveType, NodeBound>> createRobinBvh(
+                                                    std::vector<PrimitiveType *>& primitives,
+                                                    std::vector<SilhouettePrimitive<DIM> *>& silhouettes,
+                                                    std::vector<RobinBvhNode<DIM>>&& flatTree,
+                                                    bool printStats=true);
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Implementation
 
@@ -202,6 +224,54 @@ Bvh<DIM, NodeType, PrimitiveType, SilhouettePrimitive<DIM>>(costHeuristic_, prim
     assignGeometricDataToNodes({});
 }
 
+template<size_t DIM, typename NodeType, typename PrimitiveType, typename NodeBound>
+inline RobinBvh<DIM, NodeType, PrimitiveType, NodeBound>::RobinBvh(std::vector<PrimitiveType *>& primitives_,
+                                                                   std::vector<SilhouettePrimitive<DIM> *>& silhouettes_,
+                                                                   std::vector<NodeType>&& flatTree_):
+Bvh<DIM, NodeType, PrimitiveType, SilhouettePrimitive<DIM>>(CostHeuristic::SurfaceArea, primitives_, silhouettes_,
+                                                            {}, {}, false, std::max((int)primitives_.size(), 1), 8)
+{
+    // the base class builds a hierarchy on construction; a leaf size covering all primitives
+    // reduces that build to a single leaf, which leaves the primitive order untouched, before
+    // the node array built previously is installed
+    setFlatTree(std::move(flatTree_));
+}
+
+template<size_t DIM, typename NodeType, typename PrimitiveType, typename NodeBound>
+inline const std::vector<NodeType>& RobinBvh<DIM, NodeType, PrimitiveType, NodeBound>::getFlatTree() const
+{
+    using BvhBase = Bvh<DIM, NodeType, PrimitiveType>;
+    return BvhBase::flatTree;
+}
+
+template<typename NodeType>
+inline int computeMaxDepthRecursive(const std::vector<NodeType>& flatTree, int nodeIndex, int depth)
+{
+    const NodeType& node(flatTree[nodeIndex]);
+    if (node.nReferences > 0) return depth; // leaf
+
+    return std::max(computeMaxDepthRecursive<NodeType>(flatTree, nodeIndex + 1, depth + 1),
+                    computeMaxDepthRecursive<NodeType>(flatTree, nodeIndex + node.secondChildOffset, depth + 1));
+}
+
+template<size_t DIM, typename NodeType, typename PrimitiveType, typename NodeBound>
+inline void RobinBvh<DIM, NodeType, PrimitiveType, NodeBound>::setFlatTree(std::vector<NodeType>&& flatTree_)
+{
+    using BvhBase = Bvh<DIM, NodeType, PrimitiveType>;
+    BvhBase::flatTree = std::move(flatTree_);
+    BvhBase::nNodes = (int)BvhBase::flatTree.size();
+    BvhBase::nLeafs = 0;
+    BvhBase::maxDepth = 0;
+
+    for (int i = 0; i < BvhBase::nNodes; i++) {
+        if (BvhBase::flatTree[i].nReferences > 0) BvhBase::nLeafs++;
+    }
+
+    if (BvhBase::nNodes > 0) {
+        BvhBase::maxDepth = computeMaxDepthRecursive<NodeType>(BvhBase::flatTree, 0, 0);
+    }
+}
+
 template<size_t DIM>
 inline void mergeBoundingCones(const RobinBvhNode<DIM>& left, const RobinBvhNode<DIM>& right, RobinBvhNode<DIM>& node)
 {
@@ -650,4 +720,32 @@ std::unique_ptr<RobinBvh<DIM, RobinBvhNode<DIM>, PrimitiveType, NodeBound>> crea
     return nullptr;
 }
 
+template<size_t DIM, typename PrimitiveType, typename NodeBound>
+std::unique_ptr<RobinBvh<DIM, RobinBvhNode<DIM>, PrimitiveType, NodeBound>> createRobinBvh(
+                                                    std::vector<PrimitiveType *>& primitives,
+                                                    std::vector<SilhouettePrimitive<DIM> *>& silhouettes,
+                                                    std::vector<RobinBvhNode<DIM>>&& flatTree,
+                                                    bool printStats)
+{
+    if (primitives.size() > 0 && flatTree.size() > 0) {
+        using namespace std::chrono;
+        high_resolution_clock::time_point t1 = high_resolution_clock::now();
+
+        std::unique_ptr<RobinBvh<DIM, RobinBvhNode<DIM>, PrimitiveType, NodeBound>> bvh(
+            new RobinBvh<DIM, RobinBvhNode<DIM>, PrimitiveType, NodeBound>(primitives, silhouettes,
+                                                                           std::move(flatTree)));
+
+        if (printStats) {
+            high_resolution_clock::time_point t2 = high_resolution_clock::now();
+            duration<double> timeSpan = duration_cast<duration<double>>(t2 - t1);
+            std::cout << "RobinBvh load time: " << timeSpan.count() << " seconds" << std::endl;
+            bvh->printStats();
+        }
+
+        return bvh;
+    }
+
+    return nullptr;
+}
+
 } // namespace zombie
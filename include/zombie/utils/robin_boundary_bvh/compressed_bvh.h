@@ -0,0 +1,573 @@
+// This file provides a compressed variant of the 'RobinBvh' node layout for star radius
+// queries: child bounding boxes are quantized to 8 bits (by default) relative to their
+// parent's box, cone axes are stored as octahedral-encoded normals, and cone angles, cone
+// radii and Robin coefficients are quantized conservatively, so that decoded bounds always
+// contain the full precision ones. A node takes 20 bytes in 2D and 24 bytes in 3D, versus
+// 48 and 60 bytes for a 'RobinBvhNode'. Nodes are decoded on the fly during traversal.
+// Users of Zombie need not interact with this file directly.
+
+#pragma once
+
+#include <zombie/utils/robin_boundary_bvh/bvh.h>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#define ROBIN_COEFF_QUANTIZATION_LOG2_MIN -40.0f
+#define ROBIN_COEFF_QUANTIZATION_LOG2_MAX 40.0f
+
+namespace zombie {
+
+using namespace fcpw;
+
+template<size_t DIM, typename QuantizedType>
+struct RobinCompressedBvhNode {
+    // constructor
+    RobinCompressedBvhNode(): offset(0), nReferences(0), coneHalfAngle(0), coneRadius(0),
+                              minRobinCoeff(0), maxRobinCoeff(0) {
+        for (size_t i = 0; i < DIM; i++) {
+            boxMin[i] = 0;
+            boxMax[i] = 0;
+        }
+
+        for (size_t i = 0; i < DIM - 1; i++) {
+            coneAxis[i] = 0;
+        }
+    }
+
+    // members; ordered by decreasing alignment so that the node has no padding
+    int offset; // reference offset for leaf nodes, second child offset otherwise
+    uint16_t nReferences;
+    QuantizedType boxMin[DIM]; // relative to parent box
+    QuantizedType boxMax[DIM]; // relative to parent box
+    uint16_t coneAxis[DIM - 1]; // octahedral encoding in 3D, angle in 2D
+    uint16_t coneHalfAngle;
+    uint16_t coneRadius; // relative to the diagonal of the decoded node box
+    uint16_t minRobinCoeff; // log scale, rounded down
+    uint16_t maxRobinCoeff; // log scale, rounded up
+};
+
+template<size_t DIM, typename PrimitiveType, typename NodeBound, typename QuantizedType=uint8_t>
+class RobinCompressedBvh {
+public:
+    // constructor
+    RobinCompressedBvh(const RobinBvh<DIM, RobinBvhNode<DIM>, PrimitiveType, NodeBound> *bvh,
+                       const std::vector<PrimitiveType *>& primitives_);
+
+    // updates robin coefficients for each node from the (shared) primitives
+    void updateRobinCoefficients();
+
+    // computes the squared Robin star radius
+    int computeSquaredStarRadius(BoundingSphere<DIM>& s,
+                                 bool flipNormalOrientation,
+                                 float silhouettePrecision) const;
+
+    // returns the size of the compressed node array in bytes
+    size_t nodeMemoryFootprint() const;
+
+protected:
+    // decodes a child node, given its parent's decoded box
+    void decodeNode(int nodeIndex, const BoundingBox<DIM>& parentBox, RobinBvhNode<DIM>& node) const;
+
+    // checks whether the decoded node should be visited during traversal
+    bool visitNode(const BoundingSphere<DIM>& s, const RobinBvhNode<DIM>& node,
+                   float& r2MinBound, float& r2MaxBound, bool& hasSilhouette) const;
+
+    // members
+    std::vector<RobinCompressedBvhNode<DIM, QuantizedType>> flatTree;
+    BoundingBox<DIM> rootBox;
+    const std::vector<PrimitiveType *>& primitives;
+};
+
+template<size_t DIM, typename PrimitiveType, typename NodeBound, typename QuantizedType=uint8_t>
+std::unique_ptr<RobinCompressedBvh<DIM, PrimitiveType, NodeBound, QuantizedType>> createCompressedRobinBvh(
+                                                    const RobinBvh<DIM, RobinBvhNode<DIM>, PrimitiveType, NodeBound> *robinBvh,
+                                                    const std::vector<PrimitiveType *>& primitives,
+                                                    bool printStats=true);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Implementation
+
+template<typename QuantizedType>
+inline float dequantizeBoxCoordinate(QuantizedType q, float parentMin, float parentExtent)
+{
+    const float Q = (float)std::numeric_limits<QuantizedType>::max();
+    return parentMin + parentExtent*((float)q/Q);
+}
+
+template<typename QuantizedType>
+inline QuantizedType quantizeBoxCoordinate(float x, float parentMin, float parentExtent, bool roundUp)
+{
+    // quantize conservatively, accounting for floating point rounding during decoding
+    const int Q = (int)std::numeric_limits<QuantizedType>::max();
+    float t = parentExtent > 0.0f ? (x - parentMin)/parentExtent : 0.0f;
+    int q = roundUp ? (int)std::ceil(t*Q) : (int)std::floor(t*Q);
+    q = std::clamp(q, 0, Q);
+
+    if (roundUp) {
+        while (q < Q && dequantizeBoxCoordinate<QuantizedType>((QuantizedType)q, parentMin, parentExtent) < x) q++;
+
+    } else {
+        while (q > 0 && dequantizeBoxCoordinate<QuantizedType>((QuantizedType)q, parentMin, parentExtent) > x) q--;
+    }
+
+    return (QuantizedType)q;
+}
+
+inline float dequantizeUnitInterval(uint16_t q)
+{
+    return (float)q/65535.0f;
+}
+
+inline uint16_t quantizeUnitInterval(float t, bool roundUp)
+{
+    int q = roundUp ? (int)std::ceil(t*65535.0f) : (int)std::floor(t*65535.0f);
+    q = std::clamp(q, 0, 65535);
+
+    if (roundUp) {
+        while (q < 65535 && dequantizeUnitInterval((uint16_t)q) < t) q++;
+
+    } else {
+        while (q > 0 && dequantizeUnitInterval((uint16_t)q) > t) q--;
+    }
+
+    return (uint16_t)q;
+}
+
+inline float dequantizeRobinCoeff(uint16_t q)
+{
+    // 0 and 65535 are reserved for zero (Neumann) and maxFloat (Dirichlet) respectively
+    if (q == 0) return 0.0f;
+    if (q == 65535) return maxFloat;
+
+    const float logRange = ROBIN_COEFF_QUANTIZATION_LOG2_MAX - ROBIN_COEFF_QUANTIZATION_LOG2_MIN;
+    return std::exp2(ROBIN_COEFF_QUANTIZATION_LOG2_MIN + logRange*(float)(q - 1)/65533.0f);
+}
+
+inline uint16_t quantizeRobinCoeff(float coeff, bool roundUp)
+{
+    if (coeff <= 0.0f) return 0;
+    if (coeff >= maxFloat) return 65535;
+
+    const float logRange = ROBIN_COEFF_QUANTIZATION_LOG2_MAX - ROBIN_COEFF_QUANTIZATION_LOG2_MIN;
+    float t = (std::log2(coeff) - ROBIN_COEFF_QUANTIZATION_LOG2_MIN)/logRange;
+    int q = 0;
+    if (t < 0.0f) {
+        q = roundUp ? 1 : 0;
+
+    } else if (t > 1.0f) {
+        q = roundUp ? 65535 : 65534;
+
+    } else {
+        q = 1 + (roundUp ? (int)std::ceil(t*65533.0f) : (int)std::floor(t*65533.0f));
+        q = std::clamp(q, 1, 65534);
+    }
+
+    // account for floating point rounding during decoding
+    if (roundUp) {
+        while (q < 65535 && dequantizeRobinCoeff((uint16_t)q) < coeff) q++;
+
+    } else {
+        while (q > 0 && dequantizeRobinCoeff((uint16_t)q) > coeff) q--;
+    }
+
+    return (uint16_t)q;
+}
+
+template<size_t DIM>
+inline void encodeConeAxis(const Vector<DIM>& axis, uint16_t *encodedAxis)
+{
+    std::cerr << "encodeConeAxis(): DIM: " << DIM << " not supported" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+template<size_t DIM>
+inline Vector<DIM> decodeConeAxis(const uint16_t *encodedAxis)
+{
+    std::cerr << "decodeConeAxis(): DIM: " << DIM << " not supported" << std::endl;
+    exit(EXIT_FAILURE);
+
+    return Vector<DIM>::Zero();
+}
+
+template<>
+inline void encodeConeAxis<2>(const Vector2& axis, uint16_t *encodedAxis)
+{
+    float angle = std::atan2(axis[1], axis[0]); // in [-pi, pi]
+    encodedAxis[0] = (uint16_t)std::lround(std::clamp((angle + M_PI)/(2.0f*M_PI), 0.0, 1.0)*65535.0);
+}
+
+template<>
+inline Vector2 decodeConeAxis<2>(const uint16_t *encodedAxis)
+{
+    float angle = 2.0f*M_PI*dequantizeUnitInterval(encodedAxis[0]) - M_PI;
+    return Vector2(std::cos(angle), std::sin(angle));
+}
+
+template<>
+inline void encodeConeAxis<3>(const Vector3& axis, uint16_t *encodedAxis)
+{
+    // source: "A Survey of Efficient Representations for Independent Unit Vectors", Cigolle et al. 2014
+    float l1Norm = std::fabs(axis[0]) + std::fabs(axis[1]) + std::fabs(axis[2]);
+    float u = l1Norm > 0.0f ? axis[0]/l1Norm : 0.0f;
+    float v = l1Norm > 0.0f ? axis[1]/l1Norm : 0.0f;
+    if (axis[2] < 0.0f) {
+        float uPrev = u;
+        u = (1.0f - std::fabs(v))*(uPrev >= 0.0f ? 1.0f : -1.0f);
+        v = (1.0f - std::fabs(uPrev))*(v >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    encodedAxis[0] = (uint16_t)std::lround(std::clamp(0.5f*(u + 1.0f), 0.0f, 1.0f)*65535.0f);
+    encodedAxis[1] = (uint16_t)std::lround(std::clamp(0.5f*(v + 1.0f), 0.0f, 1.0f)*65535.0f);
+}
+
+template<>
+inline Vector3 decodeConeAxis<3>(const uint16_t *encodedAxis)
+{
+    float u = 2.0f*dequantizeUnitInterval(encodedAxis[0]) - 1.0f;
+    float v = 2.0f*dequantizeUnitInterval(encodedAxis[1]) - 1.0f;
+    Vector3 axis(u, v, 1.0f - std::fabs(u) - std::fabs(v));
+    if (axis[2] < 0.0f) {
+        axis[0] = (1.0f - std::fabs(v))*(u >= 0.0f ? 1.0f : -1.0f);
+        axis[1] = (1.0f - std::fabs(u))*(v >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    return axis.normalized();
+}
+
+template<size_t DIM, typename QuantizedType>
+inline BoundingBox<DIM> decodeBox(const RobinCompressedBvhNode<DIM, QuantizedType>& node,
+                                  const BoundingBox<DIM>& parentBox)
+{
+    BoundingBox<DIM> box;
+    Vector<DIM> parentExtent = parentBox.extent();
+    for (size_t i = 0; i < DIM; i++) {
+        box.pMin[i] = dequantizeBoxCoordinate<QuantizedType>(node.boxMin[i], parentBox.pMin[i], parentExtent[i]);
+        box.pMax[i] = dequantizeBoxCoordinate<QuantizedType>(node.boxMax[i], parentBox.pMin[i], parentExtent[i]);
+    }
+
+    return box;
+}
+
+template<size_t DIM, typename QuantizedType>
+inline void compressNodesRecursive(const std::vector<RobinBvhNode<DIM>>& bvhFlatTree,
+                                   std::vector<RobinCompressedBvhNode<DIM, QuantizedType>>& flatTree,
+                                   const BoundingBox<DIM>& parentBox, int nodeIndex)
+{
+    const RobinBvhNode<DIM>& bvhNode = bvhFlatTree[nodeIndex];
+    RobinCompressedBvhNode<DIM, QuantizedType>& node = flatTree[nodeIndex];
+    if (bvhNode.nReferences > (int)std::numeric_limits<uint16_t>::max()) {
+        std::cerr << "RobinCompressedBvh(): leaf with " << bvhNode.nReferences
+                  << " references exceeds the compressed node limit!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    node.offset = bvhNode.referenceOffset;
+    node.nReferences = (uint16_t)bvhNode.nReferences;
+
+    // quantize box relative to parent box, rounding outwards
+    Vector<DIM> parentExtent = parentBox.extent();
+    for (size_t i = 0; i < DIM; i++) {
+        node.boxMin[i] = quantizeBoxCoordinate<QuantizedType>(bvhNode.box.pMin[i], parentBox.pMin[i], parentExtent[i], false);
+        node.boxMax[i] = quantizeBoxCoordinate<QuantizedType>(bvhNode.box.pMax[i], parentBox.pMin[i], parentExtent[i], true);
+    }
+
+    // the root box is stored at full precision in the tree itself
+    BoundingBox<DIM> box = nodeIndex == 0 ? parentBox : decodeBox<DIM, QuantizedType>(node, parentBox);
+
+    // encode cone axis, and widen the cone angle by the encoding error; the angle is
+    // quantized over [-pi, pi] so that invalid (negative) cones are preserved
+    float halfAngle = std::clamp((float)bvhNode.cone.halfAngle, (float)-M_PI, (float)M_PI);
+    if (halfAngle >= 0.0f && halfAngle < M_PI) {
+        encodeConeAxis<DIM>(bvhNode.cone.axis, node.coneAxis);
+        Vector<DIM> decodedAxis = decodeConeAxis<DIM>(node.coneAxis);
+        float axisError = std::acos(std::clamp(decodedAxis.dot(bvhNode.cone.axis), -1.0f, 1.0f));
+        halfAngle = std::min(halfAngle + axisError, (float)M_PI);
+    }
+
+    node.coneHalfAngle = quantizeUnitInterval(0.5f*(halfAngle/M_PI + 1.0f), true);
+
+    // quantize cone radius relative to the decoded box diagonal, accounting for the
+    // shift in box centroid due to quantization
+    float scale = box.extent().norm();
+    float radius = bvhNode.cone.radius + (box.centroid() - bvhNode.box.centroid()).norm();
+    node.coneRadius = scale > 0.0f ? quantizeUnitInterval(std::min(radius/scale, 1.0f), true) : 0;
+
+    // quantize robin coefficients conservatively
+    node.minRobinCoeff = quantizeRobinCoeff(bvhNode.minRobinCoeff, false);
+    node.maxRobinCoeff = quantizeRobinCoeff(bvhNode.maxRobinCoeff, true);
+
+    // recurse on children
+    if (node.nReferences == 0) { // not a leaf
+        compressNodesRecursive<DIM, QuantizedType>(bvhFlatTree, flatTree, box, nodeIndex + 1);
+        compressNodesRecursive<DIM, QuantizedType>(bvhFlatTree, flatTree, box, nodeIndex + node.offset);
+    }
+}
+
+template<size_t DIM, typename PrimitiveType, typename NodeBound, typename QuantizedType>
+inline RobinCompressedBvh<DIM, PrimitiveType, NodeBound, QuantizedType>::RobinCompressedBvh(
+                                                    const RobinBvh<DIM, RobinBvhNode<DIM>, PrimitiveType, NodeBound> *bvh,
+                                                    const std::vector<PrimitiveType *>& primitives_):
+primitives(primitives_)
+{
+    const std::vector<RobinBvhNode<DIM>>& bvhFlatTree = bvh->getFlatTree();
+    int nNodes = (int)bvhFlatTree.size();
+    flatTree.resize(nNodes);
+
+    if (nNodes > 0) {
+        // the root box is stored at full precision, and is its own parent
+        rootBox = bvhFlatTree[0].box;
+        compressNodesRecursive<DIM, QuantizedType>(bvhFlatTree, flatTree, rootBox, 0);
+    }
+}
+
+template<size_t DIM, typename PrimitiveType, typename QuantizedType>
+inline std::pair<float, float> updateCompressedRobinCoefficientsRecursive(const std::vector<PrimitiveType *>& primitives,
+                                                                          std::vector<RobinCompressedBvhNode<DIM, QuantizedType>>& flatTree,
+                                                                          int nodeIndex)
+{
+    RobinCompressedBvhNode<DIM, QuantizedType>& node(flatTree[nodeIndex]);
+    std::pair<float, float> minMaxRobinCoeffs = std::make_pair(maxFloat, minFloat);
+
+    if (node.nReferences == 0) { // not a leaf
+        std::pair<float, float> minMaxRobinCoeffsLeft =
+            updateCompressedRobinCoefficientsRecursive<DIM, PrimitiveType, QuantizedType>(
+                primitives, flatTree, nodeIndex + 1);
+        std::pair<float, float> minMaxRobinCoeffsRight =
+            updateCompressedRobinCoefficientsRecursive<DIM, PrimitiveType, QuantizedType>(
+                primitives, flatTree, nodeIndex + node.offset);
+
+        minMaxRobinCoeffs.first = std::min(minMaxRobinCoeffsLeft.first, minMaxRobinCoeffsRight.first);
+        minMaxRobinCoeffs.second = std::max(minMaxRobinCoeffsLeft.second, minMaxRobinCoeffsRight.second);
+
+    } else { // leaf
+        for (int i = 0; i < node.nReferences; i++) {
+            const PrimitiveType *prim = primitives[node.offset + i];
+
+            minMaxRobinCoeffs.first = std::min(minMaxRobinCoeffs.first, prim->minRobinCoeff);
+            minMaxRobinCoeffs.second = std::max(minMaxRobinCoeffs.second, prim->maxRobinCoeff);
+        }
+    }
+
+    node.minRobinCoeff = quantizeRobinCoeff(minMaxRobinCoeffs.first, false);
+    node.maxRobinCoeff = quantizeRobinCoeff(minMaxRobinCoeffs.second, true);
+
+    return minMaxRobinCoeffs;
+}
+
+template<size_t DIM, typename PrimitiveType, typename NodeBound, typename QuantizedType>
+inline void RobinCompressedBvh<DIM, PrimitiveType, NodeBound, QuantizedType>::updateRobinCoefficients()
+{
+    if (flatTree.size() > 0) {
+        updateCompressedRobinCoefficientsRecursive<DIM, PrimitiveType, QuantizedType>(
+            primitives, flatTree, 0);
+    }
+}
+
+template<size_t DIM, typename PrimitiveType, typename NodeBound, typename QuantizedType>
+inline void RobinCompressedBvh<DIM, PrimitiveType, NodeBound, QuantizedType>::decodeNode(int nodeIndex,
+                                                                                         const BoundingBox<DIM>& parentBox,
+                                                                                         RobinBvhNode<DIM>& node) const
+{
+    const RobinCompressedBvhNode<DIM, QuantizedType>& compressedNode = flatTree[nodeIndex];
+    node.box = nodeIndex == 0 ? rootBox : decodeBox<DIM, QuantizedType>(compressedNode, parentBox);
+    node.cone.halfAngle = M_PI*(2.0f*dequantizeUnitInterval(compressedNode.coneHalfAngle) - 1.0f);
+    node.cone.axis = decodeConeAxis<DIM>(compressedNode.coneAxis);
+    node.cone.radius = node.box.extent().norm()*dequantizeUnitInterval(compressedNode.coneRadius);
+    node.referenceOffset = compressedNode.offset;
+    node.nReferences = compressedNode.nReferences;
+    node.minRobinCoeff = dequantizeRobinCoeff(compressedNode.minRobinCoeff);
+    node.maxRobinCoeff = dequantizeRobinCoeff(compressedNode.maxRobinCoeff);
+}
+
+template<size_t DIM, typename PrimitiveType, typename NodeBound, typename QuantizedType>
+inline bool RobinCompressedBvh<DIM, PrimitiveType, NodeBound, QuantizedType>::visitNode(const BoundingSphere<DIM>& s,
+                                                                                        const RobinBvhNode<DIM>& node,
+                                                                                        float& r2MinBound, float& r2MaxBound,
+                                                                                        bool& hasSilhouette) const
+{
+    hasSilhouette = true;
+
+    if (node.box.overlap(s, r2MinBound, r2MaxBound)) {
+        if (node.minRobinCoeff < maxFloat - epsilon) { // early out for Dirichlet case
+            // perform silhouette test for Neuamnn and Robin cases
+            float maximalAngles[2];
+            if (node.cone.overlap(s.c, node.box, r2MinBound, maximalAngles[0], maximalAngles[1])) {
+                r2MaxBound = maxFloat;
+
+            } else {
+                hasSilhouette = false;
+                if (node.maxRobinCoeff > epsilon) {
+                    // Robin case: compute radius bounds
+                    float rMin = std::sqrt(r2MinBound);
+                    float rMax = std::sqrt(r2MaxBound);
+                    float minAbsCosTheta = std::min(std::fabs(std::cos(maximalAngles[0])),
+                                                    std::fabs(std::cos(maximalAngles[1])));
+                    float maxAbsCosTheta = 1.0f; // assume maxCosTheta = 1.0f for simplicity
+                    r2MinBound = NodeBound::computeMinSquaredStarRadiusBound(
+                        rMin, rMax, node.minRobinCoeff, node.maxRobinCoeff, minAbsCosTheta, maxAbsCosTheta);
+                    r2MaxBound = NodeBound::computeMaxSquaredStarRadiusBound(
+                        rMin, rMax, node.minRobinCoeff, node.maxRobinCoeff, minAbsCosTheta, maxAbsCosTheta);
+
+                } else {
+                    // Neumann case: r2MinBound becomes infinite, which means the node will not be visited
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+template<size_t DIM>
+struct CompressedTraversalStack {
+    // members
+    int node;
+    float distance;
+    BoundingBox<DIM> box; // decoded box of the node
+};
+
+template<size_t DIM, typename PrimitiveType, typename NodeBound, typename QuantizedType>
+inline int RobinCompressedBvh<DIM, PrimitiveType, NodeBound, QuantizedType>::computeSquaredStarRadius(BoundingSphere<DIM>& s,
+                                                                                                      bool flipNormalOrientation,
+                                                                                                      float silhouettePrecision) const
+{
+    if (flatTree.size() == 0) return 0;
+    CompressedTraversalStack<DIM> subtree[FCPW_BVH_MAX_DEPTH];
+    RobinBvhNode<DIM> children[2];
+    float boxHits[4];
+    bool hasSilhouettes[2];
+    int nodesVisited = 0;
+
+    decodeNode(0, rootBox, children[0]);
+    if (visitNode(s, children[0], boxHits[0], boxHits[1], hasSilhouettes[0])) {
+        subtree[0].node = 0;
+        subtree[0].distance = boxHits[0];
+        subtree[0].box = children[0].box;
+        int stackPtr = 0;
+
+        while (stackPtr >= 0) {
+            // pop off the next node to work on
+            int nodeIndex = subtree[stackPtr].node;
+            float currentDist = subtree[stackPtr].distance;
+            BoundingBox<DIM> nodeBox = subtree[stackPtr].box;
+            stackPtr--;
+
+            // if this node is further than the current radius estimate, continue
+            if (std::fabs(currentDist) > s.r2) continue;
+            const RobinCompressedBvhNode<DIM, QuantizedType>& node(flatTree[nodeIndex]);
+
+            // is leaf -> compute squared distance
+            if (node.nReferences > 0) {
+                for (int p = 0; p < node.nReferences; p++) {
+                    int referenceIndex = node.offset + p;
+                    const PrimitiveType *prim = primitives[referenceIndex];
+                    nodesVisited++;
+
+                    // assume we are working only with Robin primitives
+                    prim->computeSquaredStarRadius(s, flipNormalOrientation, silhouettePrecision, currentDist >= 0.0f);
+                }
+
+            } else { // not a leaf
+                int childIndices[2] = {nodeIndex + 1, nodeIndex + node.offset};
+                decodeNode(childIndices[0], nodeBox, children[0]);
+                decodeNode(childIndices[1], nodeBox, children[1]);
+
+                bool hit0 = visitNode(s, children[0], boxHits[0], boxHits[1], hasSilhouettes[0]);
+                if (hit0) s.r2 = std::min(s.r2, boxHits[1]);
+
+                bool hit1 = visitNode(s, children[1], boxHits[2], boxHits[3], hasSilhouettes[1]);
+                if (hit1) s.r2 = std::min(s.r2, boxHits[3]);
+
+                // is there overlap with both nodes?
+                if (hit0 && hit1) {
+                    // we assume that the left child is a closer hit...
+                    int closer = 0;
+                    int other = 1;
+
+                    // ... if the right child was actually closer, swap the relavent values
+                    if (boxHits[0] == 0.0f && boxHits[2] == 0.0f) {
+                        if (boxHits[3] < boxHits[1]) {
+                            std::swap(hasSilhouettes[0], hasSilhouettes[1]);
+                            std::swap(closer, other);
+                        }
+
+                    } else if (boxHits[2] < boxHits[0]) {
+                        std::swap(boxHits[0], boxHits[2]);
+                        std::swap(hasSilhouettes[0], hasSilhouettes[1]);
+                        std::swap(closer, other);
+                    }
+
+                    // it's possible that the nearest object is still in the other side, but we'll
+                    // check the farther-away node later...
+
+                    // push the farther first, then the closer
+                    stackPtr++;
+                    subtree[stackPtr].node = childIndices[other];
+                    subtree[stackPtr].distance = boxHits[2]*(hasSilhouettes[1] ? 1.0f : -1.0f);
+                    subtree[stackPtr].box = children[other].box;
+
+                    stackPtr++;
+                    subtree[stackPtr].node = childIndices[closer];
+                    subtree[stackPtr].distance = boxHits[0]*(hasSilhouettes[0] ? 1.0f : -1.0f);
+                    subtree[stackPtr].box = children[closer].box;
+
+                } else if (hit0) {
+                    stackPtr++;
+                    subtree[stackPtr].node = childIndices[0];
+                    subtree[stackPtr].distance = boxHits[0]*(hasSilhouettes[0] ? 1.0f : -1.0f);
+                    subtree[stackPtr].box = children[0].box;
+
+                } else if (hit1) {
+                    stackPtr++;
+                    subtree[stackPtr].node = childIndices[1];
+                    subtree[stackPtr].distance = boxHits[2]*(hasSilhouettes[1] ? 1.0f : -1.0f);
+                    subtree[stackPtr].box = children[1].box;
+                }
+
+                nodesVisited++;
+            }
+        }
+    }
+
+    return nodesVisited;
+}
+
+template<size_t DIM, typename PrimitiveType, typename NodeBound, typename QuantizedType>
+inline size_t RobinCompressedBvh<DIM, PrimitiveType, NodeBound, QuantizedType>::nodeMemoryFootprint() const
+{
+    return flatTree.size()*sizeof(RobinCompressedBvhNode<DIM, QuantizedType>);
+}
+
+template<size_t DIM, typename PrimitiveType, typename NodeBound, typename QuantizedType>
+std::unique_ptr<RobinCompressedBvh<DIM, PrimitiveType, NodeBound, QuantizedType>> createCompressedRobinBvh(
+                                                    const RobinBvh<DIM, RobinBvhNode<DIM>, PrimitiveType, NodeBound> *robinBvh,
+                                                    const std::vector<PrimitiveType *>& primitives,
+                                                    bool printStats)
+{
+    if (robinBvh != nullptr && primitives.size() > 0) {
+        using namespace std::chrono;
+        high_resolution_clock::time_point t1 = high_resolution_clock::now();
+
+        std::unique_ptr<RobinCompressedBvh<DIM, PrimitiveType, NodeBound, QuantizedType>> compressedBvh(
+            new RobinCompressedBvh<DIM, PrimitiveType, NodeBound, QuantizedType>(robinBvh, primitives));
+
+        if (printStats) {
+            high_resolution_clock::time_point t2 = high_resolution_clock::now();
+            duration<double> timeSpan = duration_cast<duration<double>>(t2 - t1);
+            size_t nNodes = robinBvh->getFlatTree().size();
+            std::cout << "Compressed RobinBvh construction time: " << timeSpan.count() << " seconds" << std::endl;
+            std::cout << "Node array size: " << compressedBvh->nodeMemoryFootprint() << " bytes"
+                      << " (uncompressed: " << nNodes*sizeof(RobinBvhNode<DIM>) << " bytes)" << std::endl;
+        }
+
+        return compressedBvh;
+    }
+
+    return nullptr;
+}
+
+} // namespace zombie
@@ -85,8 +85,10 @@ protected:
                                                  MaskP<FCPW_MBVH_BRANCHING_FACTOR>& hasSilhouettes) const;
 };
 
-template<size_t DIM, typename PrimitiveType, typename MbvhNodeBound, typename BvhNodeBound>
-std::unique_ptr<RobinMbvh<FCPW_SIMD_WIDTH, DIM, PrimitiveType, RobinMbvhNode<DIM>, MbvhNodeBound>> createVectorizedRobinBvh(
+// WIDTH sets the packet width of leaf nodes; the RobinBvh should be built with packed leaves
+// of the same size
+template<size_t DIM, typename PrimitiveType, typename MbvhNodeBound, typename BvhNodeBound, size_t WIDTH=FCPW_SIMD_WIDTH>
+std::unique_ptr<RobinMbvh<WIDTH, DIM, PrimitiveType, RobinMbvhNode<DIM>, MbvhNodeBound>> createVectorizedRobinBvh(
                                                         RobinBvh<DIM, RobinBvhNode<DIM>, PrimitiveType, BvhNodeBound> *robinBvh,
                                                         std::vector<PrimitiveType *>& primitives,
                                                         std::vector<SilhouettePrimitive<DIM> *>& silhouettes,
@@ -671,8 +673,8 @@ inline int RobinMbvh<WIDTH, DIM, PrimitiveType, NodeType, NodeBound>::computeSqu
     return nodesVisited;
 }
 
-template<size_t DIM, typename PrimitiveType, typename MbvhNodeBound, typename BvhNodeBound>
-std::unique_ptr<RobinMbvh<FCPW_SIMD_WIDTH, DIM, PrimitiveType, RobinMbvhNode<DIM>, MbvhNodeBound>> createVectorizedRobinBvh(
+template<size_t DIM, typename PrimitiveType, typename MbvhNodeBound, typename BvhNodeBound, size_t WIDTH>
+std::unique_ptr<RobinMbvh<WIDTH, DIM, PrimitiveType, RobinMbvhNode<DIM>, MbvhNodeBound>> createVectorizedRobinBvh(
                                                         RobinBvh<DIM, RobinBvhNode<DIM>, PrimitiveType, BvhNodeBound> *robinBvh,
                                                         std::vector<PrimitiveType *>& primitives,
                                                         std::vector<SilhouettePrimitive<DIM> *>& silhouettes,
@@ -682,14 +684,15 @@ std::unique_ptr<RobinMbvh<FCPW_SIMD_WIDTH, DIM, PrimitiveType, RobinMbvhNode<DIM
         using namespace std::chrono;
         high_resolution_clock::time_point t1 = high_resolution_clock::now();
 
-        std::unique_ptr<RobinMbvh<FCPW_SIMD_WIDTH, DIM, PrimitiveType, RobinMbvhNode<DIM>, MbvhNodeBound>> mbvh(
-            new RobinMbvh<FCPW_SIMD_WIDTH, DIM, PrimitiveType, RobinMbvhNode<DIM>, MbvhNodeBound>(primitives, silhouettes));
+        std::unique_ptr<RobinMbvh<WIDTH, DIM, PrimitiveType, RobinMbvhNode<DIM>, MbvhNodeBound>> mbvh(
+            new RobinMbvh<WIDTH, DIM, PrimitiveType, RobinMbvhNode<DIM>, MbvhNodeBound>(primitives, silhouettes));
         mbvh->template initialize<RobinBvhNode<DIM>>(robinBvh);
 
         if (printStats) {
             high_resolution_clock::time_point t2 = high_resolution_clock::now();
             duration<double> timeSpan = duration_cast<duration<double>>(t2 - t1);
-            std::cout << FCPW_MBVH_BRANCHING_FACTOR << "-BVH construction time: " << timeSpan.count() << " seconds" << std::endl;
+            std::cout << FCPW_MBVH_BRANCHING_FACTOR << "-BVH construction time (" << WIDTH << "-wide leaves): "
+                      << timeSpan.count() << " seconds" << std::endl;
             mbvh->printStats();
         }
 
@@ -0,0 +1,349 @@
+// This file provides a WindingNumberTree class that evaluates the generalized winding number
+// of a 2D or 3D boundary mesh with a BVH, where clusters of boundary elements far away from the
+// query point are approximated by their dipole moment (Barill et al. 2018, "Fast Winding Numbers
+// for Soups and Clouds"). Unlike ray parity tests, the winding number degrades gracefully on
+// boundary meshes with small gaps or overlaps. The 'populateWindingNumberQuery' function sets
+// GeometricQueries::computeWindingNumber, which insideDomain then uses to classify points.
+
+#pragma once
+
+#include <zombie/core/geometric_queries.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+
+#define WINDING_NUMBER_MAX_DEPTH 64
+
+namespace zombie {
+
+template <size_t DIM>
+struct WindingNumberNode {
+    // constructor
+    WindingNumberNode(): center(Vector<DIM>::Zero()), dipole(Vector<DIM>::Zero()),
+                         radius(0.0f), referenceOffset(0), nReferences(0), secondChildOffset(0) {}
+
+    // members
+    Vector<DIM> center; // area weighted centroid of the boundary elements in the node
+    Vector<DIM> dipole; // sum of area weighted normals of the boundary elements in the node
+    float radius; // distance from the center to the farthest vertex in the node
+    int referenceOffset;
+    int nReferences; // 0 for interior nodes
+    int secondChildOffset; // first child immediately follows its parent
+};
+
+template <size_t DIM>
+class WindingNumberTree {
+public:
+    // constructor; clusters are approximated by their dipole moment when the query point
+    // is more than 'accuracyScale' times the cluster radius away from the cluster center
+    WindingNumberTree(float accuracyScale_=2.0f, int nPrimitivesPerLeaf_=8);
+
+    // adds a boundary mesh (line segments in 2D, triangles in 3D) with outward facing
+    // normals; call build once all meshes have been added
+    void addMesh(const std::vector<Vector<DIM>>& positions,
+                 const std::vector<std::vector<size_t>>& indices);
+
+    // builds the tree over all added meshes
+    void build(bool printStats=false);
+
+    // computes the generalized winding number at a point, which is close to 1 inside
+    // and close to 0 outside the region enclosed by the boundary
+    float computeWindingNumber(const Vector<DIM>& x) const;
+
+    // computes winding numbers for a batch of points in parallel
+    void computeWindingNumbers(const std::vector<Vector<DIM>>& points,
+                               std::vector<float>& windingNumbers) const;
+
+    // returns the number of boundary elements
+    int getPrimitiveCount() const;
+
+protected:
+    // builds the subtree over the given range of primitive references
+    void buildRecursive(int start, int end, int depth);
+
+    // computes the exact contribution of a boundary element to the winding number
+    float computePrimitiveWindingNumber(int primitive, const Vector<DIM>& x) const;
+
+    // members
+    std::vector<Vector<DIM>> positions;
+    std::vector<std::array<int, DIM>> primitives;
+    std::vector<Vector<DIM>> primitiveCentroids;
+    std::vector<Vector<DIM>> primitiveNormals; // area weighted
+    std::vector<int> references;
+    std::vector<WindingNumberNode<DIM>> nodes;
+    float accuracyScale;
+    int nPrimitivesPerLeaf;
+    int maxDepth;
+};
+
+// sets the winding number query in the GeometricQueries structure; the tree must outlive the queries
+template <size_t DIM>
+void populateWindingNumberQuery(const WindingNumberTree<DIM>& windingNumberTree,
+                                GeometricQueries<DIM>& geometricQueries);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Implementation
+
+template <size_t DIM>
+inline void computeElementMoments(const Vector<DIM> *v, Vector<DIM>& centroid, Vector<DIM>& normal)
+{
+    std::cerr << "computeElementMoments(): DIM: " << DIM << " not supported" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+template <>
+inline void computeElementMoments<2>(const Vector2 *v, Vector2& centroid, Vector2& normal)
+{
+    Vector2 s = v[1] - v[0];
+    centroid = 0.5f*(v[0] + v[1]);
+    normal = Vector2(s(1), -s(0));
+}
+
+template <>
+inline void computeElementMoments<3>(const Vector3 *v, Vector3& centroid, Vector3& normal)
+{
+    centroid = (v[0] + v[1] + v[2])/3.0f;
+    normal = 0.5f*(v[1] - v[0]).cross(v[2] - v[0]);
+}
+
+template <size_t DIM>
+inline float computeElementWindingNumber(const Vector<DIM> *v, const Vector<DIM>& x)
+{
+    std::cerr << "computeElementWindingNumber(): DIM: " << DIM << " not supported" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+template <>
+inline float computeElementWindingNumber<2>(const Vector2 *v, const Vector2& x)
+{
+    // signed angle subtended by the line segment
+    Vector2 a = v[0] - x;
+    Vector2 b = v[1] - x;
+    float angle = std::atan2(a(0)*b(1) - a(1)*b(0), a.dot(b));
+
+    return angle/(2.0f*M_PI);
+}
+
+template <>
+inline float computeElementWindingNumber<3>(const Vector3 *v, const Vector3& x)
+{
+    // signed solid angle subtended by the triangle (Van Oosterom & Strackee 1983)
+    Vector3 a = v[0] - x;
+    Vector3 b = v[1] - x;
+    Vector3 c = v[2] - x;
+    float la = a.norm();
+    float lb = b.norm();
+    float lc = c.norm();
+    float numerator = a.dot(b.cross(c));
+    float denominator = la*lb*lc + a.dot(b)*lc + b.dot(c)*la + c.dot(a)*lb;
+
+    return 2.0f*std::atan2(numerator, denominator)/(4.0f*M_PI);
+}
+
+template <size_t DIM>
+inline float computeDipoleWindingNumber(const Vector<DIM>& dipole, const Vector<DIM>& r)
+{
+    // far field approximation of the winding number of a cluster, where r points from
+    // the query point to the cluster center
+    float r2 = r.squaredNorm();
+    if (DIM == 2) return dipole.dot(r)/(2.0f*M_PI*r2);
+
+    return dipole.dot(r)/(4.0f*M_PI*r2*std::sqrt(r2));
+}
+
+template <size_t DIM>
+inline WindingNumberTree<DIM>::WindingNumberTree(float accuracyScale_, int nPrimitivesPerLeaf_):
+                                                 accuracyScale(accuracyScale_),
+                                                 nPrimitivesPerLeaf(nPrimitivesPerLeaf_),
+                                                 maxDepth(0)
+{
+    // do nothing
+}
+
+template <size_t DIM>
+inline void WindingNumberTree<DIM>::addMesh(const std::vector<Vector<DIM>>& positions_,
+                                            const std::vector<std::vector<size_t>>& indices)
+{
+    int vertexOffset = (int)positions.size();
+    positions.insert(positions.end(), positions_.begin(), positions_.end());
+
+    for (const std::vector<size_t>& index: indices) {
+        std::array<int, DIM> primitive;
+        Vector<DIM> v[DIM];
+        for (size_t j = 0; j < DIM; j++) {
+            primitive[j] = vertexOffset + (int)index[j];
+            v[j] = positions[primitive[j]];
+        }
+
+        Vector<DIM> centroid, normal;
+        computeElementMoments<DIM>(v, centroid, normal);
+        primitives.emplace_back(primitive);
+        primitiveCentroids.emplace_back(centroid);
+        primitiveNormals.emplace_back(normal);
+    }
+}
+
+template <size_t DIM>
+inline void WindingNumberTree<DIM>::buildRecursive(int start, int end, int depth)
+{
+    int nodeIndex = (int)nodes.size();
+    nodes.emplace_back(WindingNumberNode<DIM>());
+    maxDepth = std::max(maxDepth, depth);
+
+    // compute the dipole moment and the area weighted centroid
+    Vector<DIM> center = Vector<DIM>::Zero();
+    Vector<DIM> dipole = Vector<DIM>::Zero();
+    Vector<DIM> pMin = Vector<DIM>::Constant(std::numeric_limits<float>::max());
+    Vector<DIM> pMax = Vector<DIM>::Constant(std::numeric_limits<float>::lowest());
+    float totalArea = 0.0f;
+    for (int i = start; i < end; i++) {
+        int p = references[i];
+        float area = primitiveNormals[p].norm();
+        center += area*primitiveCentroids[p];
+        dipole += primitiveNormals[p];
+        totalArea += area;
+        pMin = pMin.cwiseMin(primitiveCentroids[p]);
+        pMax = pMax.cwiseMax(primitiveCentroids[p]);
+    }
+
+    if (totalArea > 0.0f) center /= totalArea;
+    else center = 0.5f*(pMin + pMax);
+
+    float radius2 = 0.0f;
+    for (int i = start; i < end; i++) {
+        const std::array<int, DIM>& primitive = primitives[references[i]];
+        for (size_t j = 0; j < DIM; j++) {
+            radius2 = std::max(radius2, (positions[primitive[j]] - center).squaredNorm());
+        }
+    }
+
+    nodes[nodeIndex].center = center;
+    nodes[nodeIndex].dipole = dipole;
+    nodes[nodeIndex].radius = std::sqrt(radius2);
+
+    int nPrimitives = end - start;
+    if (nPrimitives <= nPrimitivesPerLeaf || depth >= WINDING_NUMBER_MAX_DEPTH - 1) {
+        nodes[nodeIndex].referenceOffset = start;
+        nodes[nodeIndex].nReferences = nPrimitives;
+        return;
+    }
+
+    // split at the median centroid along the axis of largest extent
+    int axis = 0;
+    (pMax - pMin).maxCoeff(&axis);
+    int mid = (start + end)/2;
+    std::nth_element(references.begin() + start, references.begin() + mid, references.begin() + end,
+                     [this, axis](int a, int b) -> bool {
+        return primitiveCentroids[a](axis) < primitiveCentroids[b](axis);
+    });
+
+    buildRecursive(start, mid, depth + 1);
+    nodes[nodeIndex].secondChildOffset = (int)nodes.size() - nodeIndex;
+    buildRecursive(mid, end, depth + 1);
+}
+
+template <size_t DIM>
+inline void WindingNumberTree<DIM>::build(bool printStats)
+{
+    using namespace std::chrono;
+    high_resolution_clock::time_point t1 = high_resolution_clock::now();
+
+    int nPrimitives = (int)primitives.size();
+    references.resize(nPrimitives);
+    for (int i = 0; i < nPrimitives; i++) references[i] = i;
+
+    nodes.clear();
+    maxDepth = 0;
+    if (nPrimitives > 0) {
+        nodes.reserve(2*nPrimitives/std::max(nPrimitivesPerLeaf, 1) + 1);
+        buildRecursive(0, nPrimitives, 0);
+    }
+
+    if (printStats) {
+        high_resolution_clock::time_point t2 = high_resolution_clock::now();
+        duration<double> timeSpan = duration_cast<duration<double>>(t2 - t1);
+        std::cout << "Built winding number tree with " << nodes.size() << " nodes, "
+                  << nPrimitives << " primitives and max depth " << maxDepth
+                  << " in " << timeSpan.count() << " seconds" << std::endl;
+    }
+}
+
+template <size_t DIM>
+inline float WindingNumberTree<DIM>::computePrimitiveWindingNumber(int primitive, const Vector<DIM>& x) const
+{
+    Vector<DIM> v[DIM];
+    for (size_t j = 0; j < DIM; j++) v[j] = positions[primitives[primitive][j]];
+
+    return computeElementWindingNumber<DIM>(v, x);
+}
+
+template <size_t DIM>
+inline float WindingNumberTree<DIM>::computeWindingNumber(const Vector<DIM>& x) const
+{
+    if (nodes.empty()) return 0.0f;
+
+    float windingNumber = 0.0f;
+    int stack[WINDING_NUMBER_MAX_DEPTH + 1];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        int nodeIndex = stack[--stackSize];
+        const WindingNumberNode<DIM>& node = nodes[nodeIndex];
+        Vector<DIM> r = node.center - x;
+
+        if (r.squaredNorm() > accuracyScale*accuracyScale*node.radius*node.radius) {
+            // approximate the cluster by its dipole moment
+            windingNumber += computeDipoleWindingNumber<DIM>(node.dipole, r);
+
+        } else if (node.nReferences > 0) {
+            // evaluate contributions of boundary elements exactly
+            for (int i = 0; i < node.nReferences; i++) {
+                windingNumber += computePrimitiveWindingNumber(references[node.referenceOffset + i], x);
+            }
+
+        } else {
+            stack[stackSize++] = nodeIndex + node.secondChildOffset;
+            stack[stackSize++] = nodeIndex + 1;
+        }
+    }
+
+    return windingNumber;
+}
+
+template <size_t DIM>
+inline void WindingNumberTree<DIM>::computeWindingNumbers(const std::vector<Vector<DIM>>& points,
+                                                          std::vector<float>& windingNumbers) const
+{
+    int nPoints = (int)points.size();
+    windingNumbers.resize(nPoints);
+
+    auto run = [&](const tbb::blocked_range<int>& range) {
+        for (int i = range.begin(); i < range.end(); ++i) {
+            windingNumbers[i] = computeWindingNumber(points[i]);
+        }
+    };
+
+    tbb::blocked_range<int> range(0, nPoints);
+    tbb::parallel_for(range, run);
+}
+
+template <size_t DIM>
+inline int WindingNumberTree<DIM>::getPrimitiveCount() const
+{
+    return (int)primitives.size();
+}
+
+template <size_t DIM>
+void populateWindingNumberQuery(const WindingNumberTree<DIM>& windingNumberTree,
+                                GeometricQueries<DIM>& geometricQueries)
+{
+    geometricQueries.computeWindingNumber = [&windingNumberTree](const Vector<DIM>& x) -> float {
+        return windingNumberTree.computeWindingNumber(x);
+    };
+}
+
+} // zombie
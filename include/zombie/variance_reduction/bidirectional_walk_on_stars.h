@@ -0,0 +1,400 @@
+// This file implements a bidirectional estimator that combines forward walk-on-stars,
+// which is effective for solutions driven by smooth boundary data, with reverse walk
+// splatting, which is effective for localized sources and boundary conditions. Both
+// techniques estimate the solution at the same set of evaluation points, and their
+// estimates are blended at each point with weights inversely proportional to their
+// variances. The variance of the forward estimate is tracked per walk by SampleStatistics,
+// while the variance of the reverse estimate is computed from independent batches of
+// reverse walks, since the walks splat correlated contributions; the reverse estimate
+// itself is computed from the contributions of all batches. Inverse variance weights only
+// give the minimum variance combination when the variances are known: weights estimated
+// from the same walks they blend are correlated with the estimates, which biases the
+// result for finite sample counts. Fixing the weights with a pilot pass (see fixWeights)
+// that uses its own, freshly drawn forward walks and reverse sample pts removes this
+// correlation. The reverse estimate of the absorbing boundary contribution
+// is also self-normalized when kernel weights are available, which makes it consistent
+// but not unbiased.
+//
+// Resources:
+// - A Bidirectional Formulation for Walk on Spheres [2022]
+
+#pragma once
+
+#include <zombie/point_estimation/walk_on_stars.h>
+#include <zombie/variance_reduction/reverse_walk_splatter.h>
+
+namespace zombie {
+
+template <typename T, size_t DIM>
+class BidirectionalWalkOnStars {
+public:
+    // constructor; the splat and merge callbacks should accumulate contributions into
+    // the evaluation pts passed to solveReverse
+    BidirectionalWalkOnStars(const GeometricQueries<DIM>& queries_,
+                             SplatContributionCallback<T, DIM> splatContribution_,
+                             MergeContributionsCallback mergeContributions_);
+
+    // estimates the solution at the forward sample pts with walk-on-stars; these sample
+    // pts must lie at the evaluation pts (in the same order), and accumulate their estimates
+    // and variances across calls
+    void solveForward(const PDE<T, DIM>& pde,
+                      const WalkSettings& walkSettings,
+                      const std::vector<SampleEstimationData<DIM>>& estimationData,
+                      std::vector<SamplePoint<T, DIM>>& forwardSamplePts,
+                      bool runSingleThreaded=false,
+                      std::function<void(int, int)> reportProgress={}) const;
+
+    // splats contributions from reverse walks starting at the input sample pts, split into
+    // nBatches independent batches whose estimates are recorded at every evaluation pt to
+    // estimate the variance of the reverse estimate; on return, the evaluation pts hold the
+    // contributions of all batches splatted since the last reset, so the reverse estimate is
+    // the ratio over the full sample rather than an average of per-batch ratios; at least
+    // 2 batches are needed to estimate the variance, otherwise combine falls back to equal
+    // weights at evaluation pts with both estimates
+    // NOTE: overwrites the contributions of evaluation pts not on the absorbing boundary
+    void solveReverse(const PDE<T, DIM>& pde,
+                      const WalkSettings& walkSettings,
+                      std::vector<SamplePoint<T, DIM>>& absorbingBoundarySamplePts,
+                      std::vector<SamplePoint<T, DIM>>& absorbingBoundaryNormalAlignedSamplePts,
+                      std::vector<SamplePoint<T, DIM>>& reflectingBoundarySamplePts,
+                      std::vector<SamplePoint<T, DIM>>& reflectingBoundaryNormalAlignedSamplePts,
+                      std::vector<SamplePoint<T, DIM>>& domainSamplePts,
+                      int nBatches, rws::EvaluationPoints<T, DIM>& evalPts,
+                      bool runSingleThreaded=false,
+                      std::function<void(int, int)> reportProgress={});
+
+    // freezes the inverse variance weights at each evaluation pt from the current forward
+    // and reverse estimates; intended for a pilot pass, after which the estimates should be
+    // reset and recomputed with the same numbers of walks and newly drawn reverse sample pts
+    // (reusing the pilot's sample pts correlates the weights with the estimates they blend)
+    void fixWeights(const rws::EvaluationPoints<T, DIM>& evalPts,
+                    const std::vector<SamplePoint<T, DIM>>& forwardSamplePts);
+
+    // combines the forward and reverse estimates at each evaluation pt with inverse variance
+    // weights, using the fixed weights if available, and optionally returns the weight given
+    // to the forward estimates; evaluation pts where either technique has fewer than 2
+    // estimates, and hence no variance estimate, blend both estimates with equal weights
+    void combine(const rws::EvaluationPoints<T, DIM>& evalPts,
+                 const std::vector<SamplePoint<T, DIM>>& forwardSamplePts,
+                 std::vector<T>& solution,
+                 std::vector<T> *forwardWeights=nullptr) const;
+
+    // returns the statistics of the reverse batch estimates at each evaluation pt
+    const std::vector<SampleStatistics<T, DIM>>& getReverseStatistics() const;
+
+    // resets the reverse estimates; weights frozen by fixWeights are kept
+    void reset();
+
+protected:
+    // splats contributions from a batch of reverse walks
+    void solveReverseBatch(const PDE<T, DIM>& pde,
+                           const WalkSettings& walkSettings,
+                           const std::vector<SamplePoint<T, DIM> *>& batchSamplePts,
+                           bool runSingleThreaded,
+                           std::function<void(int, int)> reportProgress) const;
+
+    // returns the estimated reverse solution at the ith evaluation pt from all batches
+    T getReverseSolution(const rws::EvaluationPoints<T, DIM>& evalPts, int i) const;
+
+    // computes the weight given to the forward estimate at the ith evaluation pt from the
+    // current estimates, and returns false if either technique has no variance estimate
+    bool computeForwardWeight(const std::vector<SamplePoint<T, DIM>>& forwardSamplePts,
+                              int i, T& forwardWeight) const;
+
+    // members
+    WalkOnStars<T, DIM> walkOnStars;
+    ReverseWalkOnStars<T, DIM> reverseWalkOnStars;
+    MergeContributionsCallback mergeContributions;
+    std::vector<SampleStatistics<T, DIM>> reverseStatistics;
+    std::vector<float> reversePoissonKernelContribution;
+    std::vector<T> reverseAbsorbingBoundaryContribution;
+    std::vector<T> reverseAbsorbingBoundaryNormalAlignedContribution;
+    std::vector<T> reverseReflectingBoundaryContribution;
+    std::vector<T> reverseReflectingBoundaryNormalAlignedContribution;
+    std::vector<T> reverseSourceContribution;
+    int reverseSampleCounts[5];
+    std::vector<T> fixedForwardWeights;
+    std::vector<uint8_t> hasFixedForwardWeight;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Implementation
+
+template <typename T, size_t DIM>
+inline BidirectionalWalkOnStars<T, DIM>::BidirectionalWalkOnStars(const GeometricQueries<DIM>& queries_,
+                                                                  SplatContributionCallback<T, DIM> splatContribution_,
+                                                                  MergeContributionsCallback mergeContributions_):
+                                                                  walkOnStars(queries_),
+                                                                  reverseWalkOnStars(queries_, splatContribution_),
+                                                                  mergeContributions(mergeContributions_)
+{
+    reset();
+}
+
+template <typename T, size_t DIM>
+inline void BidirectionalWalkOnStars<T, DIM>::solveForward(const PDE<T, DIM>& pde,
+                                                           const WalkSettings& walkSettings,
+                                                           const std::vector<SampleEstimationData<DIM>>& estimationData,
+                                                           std::vector<SamplePoint<T, DIM>>& forwardSamplePts,
+                                                           bool runSingleThreaded,
+                                                           std::function<void(int, int)> reportProgress) const
+{
+    walkOnStars.solve(pde, walkSettings, estimationData, forwardSamplePts, runSingleThreaded, reportProgress);
+}
+
+template <typename T, size_t DIM>
+inline void BidirectionalWalkOnStars<T, DIM>::solveReverseBatch(const PDE<T, DIM>& pde,
+                                                                const WalkSettings& walkSettings,
+                                                                const std::vector<SamplePoint<T, DIM> *>& batchSamplePts,
+                                                                bool runSingleThreaded,
+                                                                std::function<void(int, int)> reportProgress) const
+{
+    int nPoints = (int)batchSamplePts.size();
+    if (runSingleThreaded || walkSettings.printLogs) {
+        for (int i = 0; i < nPoints; i++) {
+            reverseWalkOnStars.solve(pde, walkSettings, *batchSamplePts[i]);
+            if (reportProgress) reportProgress(1, 0);
+        }
+
+    } else {
+        auto run = [&](const tbb::blocked_range<int>& range) {
+            for (int i = range.begin(); i < range.end(); ++i) {
+                reverseWalkOnStars.solve(pde, walkSettings, *batchSamplePts[i]);
+            }
+
+            if (reportProgress) {
+                int tbb_thread_id = tbb::this_task_arena::current_thread_index();
+                reportProgress(range.end() - range.begin(), tbb_thread_id);
+            }
+        };
+
+        tbb::blocked_range<int> range(0, nPoints);
+        tbb::parallel_for(range, run);
+    }
+
+    if (mergeContributions) mergeContributions();
+}
+
+template <typename T, size_t DIM>
+inline void BidirectionalWalkOnStars<T, DIM>::solveReverse(const PDE<T, DIM>& pde,
+                                                           const WalkSettings& walkSettings,
+                                                           std::vector<SamplePoint<T, DIM>>& absorbingBoundarySamplePts,
+                                                           std::vector<SamplePoint<T, DIM>>& absorbingBoundaryNormalAlignedSamplePts,
+                                                           std::vector<SamplePoint<T, DIM>>& reflectingBoundarySamplePts,
+                                                           std::vector<SamplePoint<T, DIM>>& reflectingBoundaryNormalAlignedSamplePts,
+                                                           std::vector<SamplePoint<T, DIM>>& domainSamplePts,
+                                                           int nBatches, rws::EvaluationPoints<T, DIM>& evalPts,
+                                                           bool runSingleThreaded,
+                                                           std::function<void(int, int)> reportProgress)
+{
+    if (nBatches < 1) {
+        std::cerr << "BidirectionalWalkOnStars::solveReverse(): nBatches must be positive!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    int nEvalPts = evalPts.size();
+    if ((int)reverseStatistics.size() != nEvalPts) {
+        reverseStatistics.clear();
+        reverseStatistics.resize(nEvalPts);
+        reversePoissonKernelContribution.assign(nEvalPts, 0.0f);
+        reverseAbsorbingBoundaryContribution.assign(nEvalPts, T(0.0f));
+        reverseAbsorbingBoundaryNormalAlignedContribution.assign(nEvalPts, T(0.0f));
+        reverseReflectingBoundaryContribution.assign(nEvalPts, T(0.0f));
+        reverseReflectingBoundaryNormalAlignedContribution.assign(nEvalPts, T(0.0f));
+        reverseSourceContribution.assign(nEvalPts, T(0.0f));
+        for (int s = 0; s < 5; s++) reverseSampleCounts[s] = 0;
+    }
+
+    std::vector<SamplePoint<T, DIM>> *samplePtSets[5] = {
+        &absorbingBoundarySamplePts, &absorbingBoundaryNormalAlignedSamplePts,
+        &reflectingBoundarySamplePts, &reflectingBoundaryNormalAlignedSamplePts,
+        &domainSamplePts
+    };
+
+    // clears the contributions of evaluation pts not on the absorbing boundary, which
+    // keep their known boundary values
+    auto clearContributions = [&evalPts](const tbb::blocked_range<int>& range) {
+        for (int i = range.begin(); i < range.end(); ++i) {
+            if (evalPts.type[i] == SampleType::OnAbsorbingBoundary) continue;
+
+            evalPts.totalPoissonKernelContribution[i] = 0.0f;
+            evalPts.totalAbsorbingBoundaryContribution[i] = T(0.0f);
+            evalPts.totalAbsorbingBoundaryNormalAlignedContribution[i] = T(0.0f);
+            evalPts.totalReflectingBoundaryContribution[i] = T(0.0f);
+            evalPts.totalReflectingBoundaryNormalAlignedContribution[i] = T(0.0f);
+            evalPts.totalSourceContribution[i] = T(0.0f);
+        }
+    };
+
+    tbb::blocked_range<int> range(0, nEvalPts);
+    std::vector<SamplePoint<T, DIM> *> batchSamplePts;
+    for (int b = 0; b < nBatches; b++) {
+        // gather an equal share of each set of sample pts into the batch
+        int batchCounts[5];
+        batchSamplePts.clear();
+        for (int s = 0; s < 5; s++) {
+            int nSamplePts = (int)samplePtSets[s]->size();
+            int start = (int)(((int64_t)nSamplePts*b)/nBatches);
+            int end = (int)(((int64_t)nSamplePts*(b + 1))/nBatches);
+            batchCounts[s] = end - start;
+            reverseSampleCounts[s] += batchCounts[s];
+            for (int i = start; i < end; i++) {
+                batchSamplePts.emplace_back(&(*samplePtSets[s])[i]);
+            }
+        }
+
+        tbb::parallel_for(range, clearContributions);
+        solveReverseBatch(pde, walkSettings, batchSamplePts, runSingleThreaded, reportProgress);
+
+        // record the batch estimates, and add the batch contributions to the totals
+        auto run = [&](const tbb::blocked_range<int>& range) {
+            for (int i = range.begin(); i < range.end(); ++i) {
+                if (evalPts.type[i] == SampleType::OnAbsorbingBoundary) continue;
+
+                T estimate = evalPts.getEstimatedSolution(i, batchCounts[0], batchCounts[1],
+                                                          batchCounts[2], batchCounts[3],
+                                                          batchCounts[4]);
+                reverseStatistics[i].addSolutionEstimate(estimate);
+
+                reversePoissonKernelContribution[i] += evalPts.totalPoissonKernelContribution[i];
+                reverseAbsorbingBoundaryContribution[i] += evalPts.totalAbsorbingBoundaryContribution[i];
+                reverseAbsorbingBoundaryNormalAlignedContribution[i] += evalPts.totalAbsorbingBoundaryNormalAlignedContribution[i];
+                reverseReflectingBoundaryContribution[i] += evalPts.totalReflectingBoundaryContribution[i];
+                reverseReflectingBoundaryNormalAlignedContribution[i] += evalPts.totalReflectingBoundaryNormalAlignedContribution[i];
+                reverseSourceContribution[i] += evalPts.totalSourceContribution[i];
+            }
+        };
+
+        tbb::parallel_for(range, run);
+    }
+
+    // leave the contributions of all batches in the evaluation pts
+    auto run = [&](const tbb::blocked_range<int>& range) {
+        for (int i = range.begin(); i < range.end(); ++i) {
+            if (evalPts.type[i] == SampleType::OnAbsorbingBoundary) continue;
+
+            evalPts.totalPoissonKernelContribution[i] = reversePoissonKernelContribution[i];
+            evalPts.totalAbsorbingBoundaryContribution[i] = reverseAbsorbingBoundaryContribution[i];
+            evalPts.totalAbsorbingBoundaryNormalAlignedContribution[i] = reverseAbsorbingBoundaryNormalAlignedContribution[i];
+            evalPts.totalReflectingBoundaryContribution[i] = reverseReflectingBoundaryContribution[i];
+            evalPts.totalReflectingBoundaryNormalAlignedContribution[i] = reverseReflectingBoundaryNormalAlignedContribution[i];
+            evalPts.totalSourceContribution[i] = reverseSourceContribution[i];
+        }
+    };
+
+    tbb::parallel_for(range, run);
+}
+
+template <typename T, size_t DIM>
+inline T BidirectionalWalkOnStars<T, DIM>::getReverseSolution(const rws::EvaluationPoints<T, DIM>& evalPts, int i) const
+{
+    return evalPts.getEstimatedSolution(i, reverseSampleCounts[0], reverseSampleCounts[1],
+                                        reverseSampleCounts[2], reverseSampleCounts[3],
+                                        reverseSampleCounts[4]);
+}
+
+template <typename T, size_t DIM>
+inline bool BidirectionalWalkOnStars<T, DIM>::computeForwardWeight(const std::vector<SamplePoint<T, DIM>>& forwardSamplePts,
+                                                                   int i, T& forwardWeight) const
+{
+    // compute the variance of each technique's mean estimate; without a variance estimate
+    // for both techniques (i.e., fewer than two estimates), both are weighted equally, and
+    // a technique without any estimate is ignored
+    const float epsilon = std::numeric_limits<float>::min();
+    const std::shared_ptr<SampleStatistics<T, DIM>>& forwardStatistics = forwardSamplePts[i].statistics;
+    int nForwardEstimates = forwardStatistics ? forwardStatistics->getSolutionEstimateCount() : 0;
+    int nReverseEstimates = i < (int)reverseStatistics.size() ?
+                            reverseStatistics[i].getSolutionEstimateCount() : 0;
+
+    if (nForwardEstimates > 1 && nReverseEstimates > 1) {
+        T forwardVariance = forwardStatistics->getEstimatedSolutionVariance()/float(nForwardEstimates);
+        T reverseVariance = reverseStatistics[i].getEstimatedSolutionVariance()/float(nReverseEstimates);
+        forwardWeight = (reverseVariance + epsilon)/(forwardVariance + reverseVariance + 2.0f*epsilon);
+        return true;
+    }
+
+    if (nForwardEstimates > 0 && nReverseEstimates > 0) forwardWeight = T(0.5f);
+    else forwardWeight = nReverseEstimates == 0 ? T(1.0f) : T(0.0f);
+    return false;
+}
+
+template <typename T, size_t DIM>
+inline void BidirectionalWalkOnStars<T, DIM>::fixWeights(const rws::EvaluationPoints<T, DIM>& evalPts,
+                                                         const std::vector<SamplePoint<T, DIM>>& forwardSamplePts)
+{
+    int nEvalPts = evalPts.size();
+    if ((int)forwardSamplePts.size() != nEvalPts) {
+        std::cerr << "BidirectionalWalkOnStars::fixWeights(): forward sample pts do not match evaluation pts!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // evaluation pts with a single technique keep using whichever estimate is available
+    fixedForwardWeights.resize(nEvalPts);
+    hasFixedForwardWeight.resize(nEvalPts);
+    for (int i = 0; i < nEvalPts; i++) {
+        hasFixedForwardWeight[i] = computeForwardWeight(forwardSamplePts, i, fixedForwardWeights[i]) ? 1 : 0;
+    }
+}
+
+template <typename T, size_t DIM>
+inline void BidirectionalWalkOnStars<T, DIM>::combine(const rws::EvaluationPoints<T, DIM>& evalPts,
+                                                      const std::vector<SamplePoint<T, DIM>>& forwardSamplePts,
+                                                      std::vector<T>& solution,
+                                                      std::vector<T> *forwardWeights) const
+{
+    int nEvalPts = evalPts.size();
+    if ((int)forwardSamplePts.size() != nEvalPts) {
+        std::cerr << "BidirectionalWalkOnStars::combine(): forward sample pts do not match evaluation pts!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    solution.resize(nEvalPts);
+    if (forwardWeights) forwardWeights->resize(nEvalPts);
+    bool useFixedWeights = (int)fixedForwardWeights.size() == nEvalPts;
+
+    for (int i = 0; i < nEvalPts; i++) {
+        // evaluation pts on the absorbing boundary take their known boundary values
+        if (evalPts.type[i] == SampleType::OnAbsorbingBoundary) {
+            solution[i] = evalPts.totalAbsorbingBoundaryContribution[i];
+            if (forwardWeights) (*forwardWeights)[i] = T(0.0f);
+            continue;
+        }
+
+        T forwardWeight;
+        bool hasBothEstimates = computeForwardWeight(forwardSamplePts, i, forwardWeight);
+        if (hasBothEstimates && useFixedWeights && hasFixedForwardWeight[i] == 1) {
+            forwardWeight = fixedForwardWeights[i];
+        }
+
+        const std::shared_ptr<SampleStatistics<T, DIM>>& forwardStatistics = forwardSamplePts[i].statistics;
+        bool hasForwardEstimate = forwardStatistics && forwardStatistics->getSolutionEstimateCount() > 0;
+        bool hasReverseEstimate = i < (int)reverseStatistics.size() &&
+                                  reverseStatistics[i].getSolutionEstimateCount() > 0;
+        T forwardSolution = hasForwardEstimate ? forwardStatistics->getEstimatedSolution() : T(0.0f);
+        T reverseSolution = hasReverseEstimate ? getReverseSolution(evalPts, i) : T(0.0f);
+
+        solution[i] = forwardWeight*forwardSolution + (T(1.0f) - forwardWeight)*reverseSolution;
+        if (forwardWeights) (*forwardWeights)[i] = forwardWeight;
+    }
+}
+
+template <typename T, size_t DIM>
+inline const std::vector<SampleStatistics<T, DIM>>& BidirectionalWalkOnStars<T, DIM>::getReverseStatistics() const
+{
+    return reverseStatistics;
+}
+
+template <typename T, size_t DIM>
+inline void BidirectionalWalkOnStars<T, DIM>::reset()
+{
+    reverseStatistics.clear();
+    reversePoissonKernelContribution.clear();
+    reverseAbsorbingBoundaryContribution.clear();
+    reverseAbsorbingBoundaryNormalAlignedContribution.clear();
+    reverseReflectingBoundaryContribution.clear();
+    reverseReflectingBoundaryNormalAlignedContribution.clear();
+    reverseSourceContribution.clear();
+    for (int s = 0; s < 5; s++) reverseSampleCounts[s] = 0;
+}
+
+} // zombie
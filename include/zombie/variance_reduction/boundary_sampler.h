@@ -3,11 +3,15 @@
 // are required by the Boundary Value Caching (BVC) and Reverse Walk Splatting (RWS) techniques
 // for reducing variance of the walk-on-spheres and walk-on-stars estimators. BVC and RWS currently
 // require sample points on the absorbing boundary to be displaced slightly along the boundary normal.
+// Sample points can also be distributed adaptively, by weighting the boundary primitives with
+// importance estimated from a pilot set of sample points with boundary estimates, and drawn
+// from a low-discrepancy SampleGenerator instead of stratified pseudorandom numbers.
 
 #pragma once
 
 #include <zombie/point_estimation/common.h>
-#include <unordered_map>
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
 
 namespace zombie {
 
@@ -49,6 +53,24 @@ public:
                          std::vector<SamplePoint<T, 2>>& samplePts,
                          bool generateBoundaryNormalAlignedSamples=false);
 
+    // generates sample points on the boundary, and records the index of the primitive
+    // each sample point is generated on
+    void generateSamples(int nSamples, SampleType sampleType,
+                         float normalOffsetForBoundary,
+                         std::vector<SamplePoint<T, 2>>& samplePts,
+                         std::vector<int>& primitiveIndices,
+                         bool generateBoundaryNormalAlignedSamples=false);
+
+    // sets non-negative per-primitive importance weights (e.g., from estimateBoundaryImportance);
+    // subsequent sample points are distributed in proportion to area times importance, with pdfs
+    // that account for the weights. Passing an empty list restores uniform sampling
+    void setImportance(const std::vector<float>& importance_);
+
+    // sets a generator (e.g., an OwenScrambledSobolSampleGenerator) from which subsequent sample
+    // points draw both their mesh face and their position on it; passing nullptr restores the
+    // default stratified sampling
+    void setSampleGenerator(std::shared_ptr<const SampleGenerator> sampleGenerator_);
+
 private:
     // computes normals
     void computeNormals(bool computeWeighted);
@@ -56,11 +78,12 @@ private:
     // builds a cdf table for sampling
     void buildCDFTable(CDFTable& table, float& area, float normalOffsetForBoundary);
 
-    // generates uniformly distributed sample points on the boundary
+    // generates sample points on the boundary distributed according to the cdf table
     void generateSamples(const CDFTable& table, float area,
                          int nSamples, SampleType sampleType,
                          float normalOffsetForBoundary,
-                         std::vector<SamplePoint<T, 2>>& samplePts);
+                         std::vector<SamplePoint<T, 2>>& samplePts,
+                         std::vector<int> *primitiveIndices);
 
     // members
     pcg32 sampler;
@@ -69,8 +92,12 @@ private:
     const GeometricQueries<2>& queries;
     const std::function<bool(const Vector2&)>& insideSolveRegion;
     std::vector<Vector2> normals;
+    std::vector<float> importance;
+    std::shared_ptr<const SampleGenerator> sampleGenerator;
     CDFTable cdfTable, cdfTableNormalAligned;
     float boundaryArea, boundaryAreaNormalAligned;
+    float normalOffset;
+    bool solveDoubleSided;
 };
 
 template <typename T>
@@ -95,6 +122,24 @@ public:
                          std::vector<SamplePoint<T, 3>>& samplePts,
                          bool generateBoundaryNormalAlignedSamples=false);
 
+    // generates sample points on the boundary, and records the index of the primitive
+    // each sample point is generated on
+    void generateSamples(int nSamples, SampleType sampleType,
+                         float normalOffsetForBoundary,
+                         std::vector<SamplePoint<T, 3>>& samplePts,
+                         std::vector<int>& primitiveIndices,
+                         bool generateBoundaryNormalAlignedSamples=false);
+
+    // sets non-negative per-primitive importance weights (e.g., from estimateBoundaryImportance);
+    // subsequent sample points are distributed in proportion to area times importance, with pdfs
+    // that account for the weights. Passing an empty list restores uniform sampling
+    void setImportance(const std::vector<float>& importance_);
+
+    // sets a generator (e.g., an OwenScrambledSobolSampleGenerator) from which subsequent sample
+    // points draw both their mesh face and their position on it; passing nullptr restores the
+    // default stratified sampling
+    void setSampleGenerator(std::shared_ptr<const SampleGenerator> sampleGenerator_);
+
 private:
     // computes normals
     void computeNormals(bool computeWeighted);
@@ -102,11 +147,12 @@ private:
     // builds a cdf table for sampling
     void buildCDFTable(CDFTable& table, float& area, float normalOffsetForBoundary);
 
-    // generates uniformly distributed sample points on the boundary
+    // generates sample points on the boundary distributed according to the cdf table
     void generateSamples(const CDFTable& table, float area,
                          int nSamples, SampleType sampleType,
                          float normalOffsetForBoundary,
-                         std::vector<SamplePoint<T, 3>>& samplePts);
+                         std::vector<SamplePoint<T, 3>>& samplePts,
+                         std::vector<int> *primitiveIndices);
 
     // members
     pcg32 sampler;
@@ -115,15 +161,72 @@ private:
     const GeometricQueries<3>& queries;
     const std::function<bool(const Vector3&)>& insideSolveRegion;
     std::vector<Vector3> normals;
+    std::vector<float> importance;
+    std::shared_ptr<const SampleGenerator> sampleGenerator;
     CDFTable cdfTable, cdfTableNormalAligned;
     float boundaryArea, boundaryAreaNormalAligned;
+    float normalOffset;
+    bool solveDoubleSided;
 };
 
+// estimates per-primitive importance weights for adaptive boundary sampling from a pilot set of sample
+// points with boundary estimates (e.g., computed by BoundaryValueCaching::computeBoundaryEstimates with
+// few walks), and the indices of the primitives they were generated on. BVC splats the boundary data of
+// a sample point as G*a - P*b, where the Green's function G and Poisson kernel P differ by one power of
+// length; lengthScale (e.g., the extent of the domain) converts the G-weighted data a to the units of b,
+// so that the importance of a primitive is the root mean square of the splatted contribution, including
+// the variance of its estimate, over the pilot sample points on that primitive. The weights are normalized
+// to average one, and a fraction of them is spread uniformly over all primitives so that the adaptive pdf
+// remains bounded from below. The pilot sample points are not meant to be splatted: their boundary data
+// is estimated with far fewer walks than the cache, and they are distributed with a different pdf, so
+// combining them with the cache would require mixture pdfs while saving only a small fraction of the work
+template <typename T, size_t DIM>
+std::vector<float> estimateBoundaryImportance(const std::vector<SamplePoint<T, DIM>>& pilotSamplePts,
+                                              const std::vector<int>& primitiveIndices,
+                                              int nPrimitives, float lengthScale,
+                                              float robinCoeffCutoffForNormalDerivative,
+                                              float defensiveFraction=0.1f);
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Implementation
 // FUTURE:
 // - improve stratification, since it helps reduce clumping/singular artifacts
-// - sample points on the boundary in proportion to dirichlet/neumann/robin boundary values
+
+// draws a primitive from the cdf table for each uniform number in u, and sorts the indices of the numbers
+// by primitive with a counting sort: the numbers that select primitive p are u[sortedIndices[j]] for
+// primitiveOffsets[p] <= j < primitiveOffsets[p + 1], in increasing order of j. Numbers sorted in
+// increasing order are drawn with a linear scan over the table rather than a bisection per number
+inline void sortSamplesByPrimitive(const CDFTable& table, const std::vector<float>& u, bool isSorted,
+                                   int nPrimitives, std::vector<int>& primitiveOffsets,
+                                   std::vector<int>& sortedIndices)
+{
+    // draw the primitives in parallel
+    int nSamples = (int)u.size();
+    std::vector<int> primitives(nSamples);
+    auto run = [&](const tbb::blocked_range<int>& range) {
+        if (isSorted) {
+            table.sampleSorted(&u[range.begin()], range.end() - range.begin(), &primitives[range.begin()]);
+
+        } else {
+            for (int i = range.begin(); i < range.end(); ++i) {
+                primitives[i] = table.sample(u[i]);
+            }
+        }
+    };
+
+    tbb::blocked_range<int> range(0, nSamples);
+    tbb::parallel_for(range, run);
+
+    // count the samples per primitive, and compute offsets with a prefix sum
+    primitiveOffsets.assign(nPrimitives + 1, 0);
+    for (int i = 0; i < nSamples; i++) primitiveOffsets[primitives[i] + 1]++;
+    for (int i = 0; i < nPrimitives; i++) primitiveOffsets[i + 1] += primitiveOffsets[i];
+
+    // scatter the sample indices; sorted numbers u are scattered in order
+    std::vector<int> primitiveCursors(primitiveOffsets.begin(), primitiveOffsets.end() - 1);
+    sortedIndices.resize(nSamples);
+    for (int i = 0; i < nSamples; i++) sortedIndices[primitiveCursors[primitives[i]]++] = i;
+}
 
 class UniformLineSegmentSampler {
 public:
@@ -166,7 +269,8 @@ inline UniformLineSegmentBoundarySampler<T>::UniformLineSegmentBoundarySampler(c
                                                                                bool computeWeightedNormals):
                                                                                positions(positions_), indices(indices_),
                                                                                queries(queries_), insideSolveRegion(insideSolveRegion_),
-                                                                               boundaryArea(0.0f), boundaryAreaNormalAligned(0.0f)
+                                                                               boundaryArea(0.0f), boundaryAreaNormalAligned(0.0f),
+                                                                               normalOffset(0.0f), solveDoubleSided(false)
 {
     auto now = std::chrono::high_resolution_clock::now();
     uint64_t seed = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
@@ -215,6 +319,7 @@ inline void UniformLineSegmentBoundarySampler<T>::buildCDFTable(CDFTable& table,
             p0 += normalOffsetForBoundary*normals[index[0]];
             p1 += normalOffsetForBoundary*normals[index[1]];
             weights[i] = UniformLineSegmentSampler::surfaceArea(p0, p1);
+            if (!importance.empty()) weights[i] *= importance[i];
         }
     }
 
@@ -222,8 +327,11 @@ inline void UniformLineSegmentBoundarySampler<T>::buildCDFTable(CDFTable& table,
 }
 
 template <typename T>
-inline void UniformLineSegmentBoundarySampler<T>::initialize(float normalOffsetForBoundary, bool solveDoubleSided)
+inline void UniformLineSegmentBoundarySampler<T>::initialize(float normalOffsetForBoundary, bool solveDoubleSided_)
 {
+    normalOffset = normalOffsetForBoundary;
+    solveDoubleSided = solveDoubleSided_;
+
     // build a cdf table for boundary vertices displaced along inward normals
     buildCDFTable(cdfTable, boundaryArea, -1.0f*normalOffsetForBoundary);
 
@@ -245,54 +353,81 @@ template <typename T>
 inline void UniformLineSegmentBoundarySampler<T>::generateSamples(const CDFTable& table, float area,
                                                                   int nSamples, SampleType sampleType,
                                                                   float normalOffsetForBoundary,
-                                                                  std::vector<SamplePoint<T, 2>>& samplePts)
+                                                                  std::vector<SamplePoint<T, 2>>& samplePts,
+                                                                  std::vector<int> *primitiveIndices)
 {
     samplePts.clear();
+    if (primitiveIndices) primitiveIndices->clear();
     if (area > 0.0f) {
-        // generate stratified samples for CDF table sampling
-        std::vector<float> stratifiedSamples;
-        generateStratifiedSamples<1>(stratifiedSamples, nSamples, sampler);
-
-        // count the number of times a mesh face is sampled from the CDF table
-        std::unordered_map<int, int> indexCount;
-        for (int i = 0; i < nSamples; i++) {
-            float u = stratifiedSamples[i];
-            int offset = table.sample(u);
-
-            if (indexCount.find(offset) == indexCount.end()) {
-                indexCount[offset] = 1;
+        // draw the numbers that select a mesh face from the CDF table for each sample: these are either
+        // the first dimension of the sample generator, or stratified samples that are already sorted
+        std::vector<float> generatorSamples, faceSelectionSamples(nSamples);
+        if (sampleGenerator) {
+            generateSequenceSamples<2>(generatorSamples, nSamples, *sampleGenerator, sampler.nextUInt());
+            for (int i = 0; i < nSamples; i++) faceSelectionSamples[i] = generatorSamples[2*i];
+
+        } else {
+            for (int i = 0; i < nSamples; i++) faceSelectionSamples[i] = (i + sampler.nextFloat())/nSamples;
+        }
 
-            } else {
-                indexCount[offset]++;
+        // sort the samples by mesh face
+        int nPrimitives = (int)indices.size();
+        std::vector<int> faceOffsets, sortedIndices;
+        sortSamplesByPrimitive(table, faceSelectionSamples, !sampleGenerator, nPrimitives,
+                               faceOffsets, sortedIndices);
+
+        // generate the samples on each selected mesh face in parallel; samples not drawn from the
+        // sample generator are stratified within each face, using a random stream per face
+        std::vector<Vector2> samplePositions(nSamples), sampleNormals(nSamples);
+        std::vector<float> samplePdfs(nSamples);
+        std::vector<int> sampleFaces(nSamples);
+        uint64_t seed = sampler.nextUInt();
+        auto generateFaceSamples = [&](const tbb::blocked_range<int>& range) {
+            for (int i = range.begin(); i < range.end(); ++i) {
+                int begin = faceOffsets[i];
+                int nFaceSamples = faceOffsets[i + 1] - begin;
+                if (nFaceSamples == 0) continue;
+
+                pcg32 faceSampler(seed, i);
+                const std::vector<size_t>& index = indices[i];
+                Vector2 p0 = positions[index[0]] + normalOffsetForBoundary*normals[index[0]];
+                Vector2 p1 = positions[index[1]] + normalOffsetForBoundary*normals[index[1]];
+                float pdf = importance.empty() ? 1.0f/area : importance[i]/area;
+
+                for (int j = 0; j < nFaceSamples; j++) {
+                    int k = begin + j;
+                    float u = sampleGenerator ? generatorSamples[2*sortedIndices[k] + 1] :
+                                                (j + faceSampler.nextFloat())/nFaceSamples;
+                    UniformLineSegmentSampler::samplePoint(p0, p1, &u, samplePositions[k], sampleNormals[k]);
+                    samplePdfs[k] = pdf;
+                    sampleFaces[k] = i;
+                }
             }
-        }
+        };
 
-        float pdf = 1.0f/area;
-        for (auto& kv: indexCount) {
-            // generate samples for selected mesh face
-            std::vector<float> indexSamples;
-            const std::vector<size_t>& index = indices[kv.first];
-            if (kv.second == 1) {
-                indexSamples.emplace_back(sampler.nextFloat());
+        tbb::blocked_range<int> faceRange(0, nPrimitives);
+        tbb::parallel_for(faceRange, generateFaceSamples);
 
-            } else {
-                generateStratifiedSamples<1>(indexSamples, kv.second, sampler);
+        // compute the distances to the boundary in parallel
+        std::vector<float> distToAbsorbingBoundary(nSamples), distToReflectingBoundary(nSamples);
+        auto computeDistances = [&](const tbb::blocked_range<int>& range) {
+            for (int i = range.begin(); i < range.end(); ++i) {
+                distToAbsorbingBoundary[i] = queries.computeDistToAbsorbingBoundary(samplePositions[i], false);
+                distToReflectingBoundary[i] = queries.computeDistToReflectingBoundary(samplePositions[i], false);
             }
+        };
 
-            for (int i = 0; i < kv.second; i++) {
-                // generate sample point
-                Vector2 pt = Vector2::Zero();
-                Vector2 normal = Vector2::Zero();
-                Vector2 p0 = positions[index[0]] + normalOffsetForBoundary*normals[index[0]];
-                Vector2 p1 = positions[index[1]] + normalOffsetForBoundary*normals[index[1]];
-                UniformLineSegmentSampler::samplePoint(p0, p1, &indexSamples[i], pt, normal);
-                float distToAbsorbingBoundary = queries.computeDistToAbsorbingBoundary(pt, false);
-                float distToReflectingBoundary = queries.computeDistToReflectingBoundary(pt, false);
+        tbb::blocked_range<int> sampleRange(0, nSamples);
+        tbb::parallel_for(sampleRange, computeDistances);
 
-                samplePts.emplace_back(SamplePoint<T, 2>(pt, normal, sampleType,
-                                                         pdf, distToAbsorbingBoundary,
-                                                         distToReflectingBoundary));
-            }
+        // create the sample points, grouped by mesh face
+        samplePts.reserve(nSamples);
+        if (primitiveIndices) primitiveIndices->reserve(nSamples);
+        for (int i = 0; i < nSamples; i++) {
+            samplePts.emplace_back(SamplePoint<T, 2>(samplePositions[i], sampleNormals[i], sampleType,
+                                                     samplePdfs[i], distToAbsorbingBoundary[i],
+                                                     distToReflectingBoundary[i]));
+            if (primitiveIndices) primitiveIndices->emplace_back(sampleFaces[i]);
         }
 
     } else {
@@ -308,18 +443,58 @@ inline void UniformLineSegmentBoundarySampler<T>::generateSamples(int nSamples,
 {
     if (generateBoundaryNormalAlignedSamples) {
         generateSamples(cdfTableNormalAligned, boundaryAreaNormalAligned,
-                        nSamples, sampleType, normalOffsetForBoundary, samplePts);
+                        nSamples, sampleType, normalOffsetForBoundary, samplePts, nullptr);
 
     } else {
         generateSamples(cdfTable, boundaryArea, nSamples, sampleType,
-                        -1.0f*normalOffsetForBoundary, samplePts);
+                        -1.0f*normalOffsetForBoundary, samplePts, nullptr);
     }
 
-    for (int i = 0; i < nSamples; i++) {
+    for (int i = 0; i < (int)samplePts.size(); i++) {
         samplePts[i].estimateBoundaryNormalAligned = generateBoundaryNormalAlignedSamples;
     }
 }
 
+template <typename T>
+inline void UniformLineSegmentBoundarySampler<T>::generateSamples(int nSamples, SampleType sampleType,
+                                                                  float normalOffsetForBoundary,
+                                                                  std::vector<SamplePoint<T, 2>>& samplePts,
+                                                                  std::vector<int>& primitiveIndices,
+                                                                  bool generateBoundaryNormalAlignedSamples)
+{
+    if (generateBoundaryNormalAlignedSamples) {
+        generateSamples(cdfTableNormalAligned, boundaryAreaNormalAligned,
+                        nSamples, sampleType, normalOffsetForBoundary, samplePts, &primitiveIndices);
+
+    } else {
+        generateSamples(cdfTable, boundaryArea, nSamples, sampleType,
+                        -1.0f*normalOffsetForBoundary, samplePts, &primitiveIndices);
+    }
+
+    for (int i = 0; i < (int)samplePts.size(); i++) {
+        samplePts[i].estimateBoundaryNormalAligned = generateBoundaryNormalAlignedSamples;
+    }
+}
+
+template <typename T>
+inline void UniformLineSegmentBoundarySampler<T>::setImportance(const std::vector<float>& importance_)
+{
+    if (!importance_.empty() && importance_.size() != indices.size()) {
+        std::cerr << "UniformLineSegmentBoundarySampler::setImportance(): expected one weight per primitive!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // rebuild the cdf tables with the importance weights
+    importance = importance_;
+    initialize(normalOffset, solveDoubleSided);
+}
+
+template <typename T>
+inline void UniformLineSegmentBoundarySampler<T>::setSampleGenerator(std::shared_ptr<const SampleGenerator> sampleGenerator_)
+{
+    sampleGenerator = sampleGenerator_;
+}
+
 class UniformTriangleSampler {
 public:
     // returns normal
@@ -371,7 +546,8 @@ inline UniformTriangleBoundarySampler<T>::UniformTriangleBoundarySampler(const s
                                                                          bool computeWeightedNormals):
                                                                          positions(positions_), indices(indices_),
                                                                          queries(queries_), insideSolveRegion(insideSolveRegion_),
-                                                                         boundaryArea(0.0f), boundaryAreaNormalAligned(0.0f)
+                                                                         boundaryArea(0.0f), boundaryAreaNormalAligned(0.0f),
+                                                                         normalOffset(0.0f), solveDoubleSided(false)
 {
     auto now = std::chrono::high_resolution_clock::now();
     uint64_t seed = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
@@ -429,6 +605,7 @@ inline void UniformTriangleBoundarySampler<T>::buildCDFTable(CDFTable& table, fl
             p1 += normalOffsetForBoundary*normals[index[1]];
             p2 += normalOffsetForBoundary*normals[index[2]];
             weights[i] = UniformTriangleSampler::surfaceArea(p0, p1, p2);
+            if (!importance.empty()) weights[i] *= importance[i];
         }
     }
 
@@ -436,8 +613,11 @@ inline void UniformTriangleBoundarySampler<T>::buildCDFTable(CDFTable& table, fl
 }
 
 template <typename T>
-inline void UniformTriangleBoundarySampler<T>::initialize(float normalOffsetForBoundary, bool solveDoubleSided)
+inline void UniformTriangleBoundarySampler<T>::initialize(float normalOffsetForBoundary, bool solveDoubleSided_)
 {
+    normalOffset = normalOffsetForBoundary;
+    solveDoubleSided = solveDoubleSided_;
+
     // build a cdf table for boundary vertices displaced along inward normals
     buildCDFTable(cdfTable, boundaryArea, -1.0f*normalOffsetForBoundary);
 
@@ -459,56 +639,92 @@ template <typename T>
 inline void UniformTriangleBoundarySampler<T>::generateSamples(const CDFTable& table, float area,
                                                                int nSamples, SampleType sampleType,
                                                                float normalOffsetForBoundary,
-                                                               std::vector<SamplePoint<T, 3>>& samplePts)
+                                                               std::vector<SamplePoint<T, 3>>& samplePts,
+                                                               std::vector<int> *primitiveIndices)
 {
     samplePts.clear();
+    if (primitiveIndices) primitiveIndices->clear();
     if (area > 0.0f) {
-        // generate stratified samples for CDF table sampling
-        std::vector<float> stratifiedSamples;
-        generateStratifiedSamples<1>(stratifiedSamples, nSamples, sampler);
-
-        // count the number of times a mesh face is sampled from the CDF table
-        std::unordered_map<int, int> indexCount;
-        for (int i = 0; i < nSamples; i++) {
-            float u = stratifiedSamples[i];
-            int offset = table.sample(u);
-
-            if (indexCount.find(offset) == indexCount.end()) {
-                indexCount[offset] = 1;
-
-            } else {
-                indexCount[offset]++;
-            }
+        // draw the numbers that select a mesh face from the CDF table for each sample: these are either
+        // the first dimension of the sample generator, or stratified samples that are already sorted
+        std::vector<float> generatorSamples, faceSelectionSamples(nSamples);
+        if (sampleGenerator) {
+            generateSequenceSamples<3>(generatorSamples, nSamples, *sampleGenerator, sampler.nextUInt());
+            for (int i = 0; i < nSamples; i++) faceSelectionSamples[i] = generatorSamples[3*i];
+
+        } else {
+            for (int i = 0; i < nSamples; i++) faceSelectionSamples[i] = (i + sampler.nextFloat())/nSamples;
         }
 
-        float pdf = 1.0f/area;
-        for (auto& kv: indexCount) {
-            // generate samples for selected mesh face
-            std::vector<float> indexSamples;
-            const std::vector<size_t>& index = indices[kv.first];
-            if (kv.second == 1) {
-                indexSamples.emplace_back(sampler.nextFloat());
-                indexSamples.emplace_back(sampler.nextFloat());
-
-            } else {
-                generateStratifiedSamples<2>(indexSamples, kv.second, sampler);
-            }
-
-            for (int i = 0; i < kv.second; i++) {
-                // generate sample point
-                Vector3 pt = Vector3::Zero();
-                Vector3 normal = Vector3::Zero();
+        // sort the samples by mesh face
+        int nPrimitives = (int)indices.size();
+        std::vector<int> faceOffsets, sortedIndices;
+        sortSamplesByPrimitive(table, faceSelectionSamples, !sampleGenerator, nPrimitives,
+                               faceOffsets, sortedIndices);
+
+        // generate the samples on each selected mesh face in parallel; samples not drawn from the
+        // sample generator are stratified within each face, using a random stream per face
+        std::vector<Vector3> samplePositions(nSamples), sampleNormals(nSamples);
+        std::vector<float> samplePdfs(nSamples);
+        std::vector<int> sampleFaces(nSamples);
+        std::vector<float> faceSamples(2*nSamples);
+        uint64_t seed = sampler.nextUInt();
+        auto generateFaceSamples = [&](const tbb::blocked_range<int>& range) {
+            for (int i = range.begin(); i < range.end(); ++i) {
+                int begin = faceOffsets[i];
+                int nFaceSamples = faceOffsets[i + 1] - begin;
+                if (nFaceSamples == 0) continue;
+
+                pcg32 faceSampler(seed, i);
+                const std::vector<size_t>& index = indices[i];
                 Vector3 p0 = positions[index[0]] + normalOffsetForBoundary*normals[index[0]];
                 Vector3 p1 = positions[index[1]] + normalOffsetForBoundary*normals[index[1]];
                 Vector3 p2 = positions[index[2]] + normalOffsetForBoundary*normals[index[2]];
-                UniformTriangleSampler::samplePoint(p0, p1, p2, &indexSamples[2*i], pt, normal);
-                float distToAbsorbingBoundary = queries.computeDistToAbsorbingBoundary(pt, false);
-                float distToReflectingBoundary = queries.computeDistToReflectingBoundary(pt, false);
+                float pdf = importance.empty() ? 1.0f/area : importance[i]/area;
+                float *u = &faceSamples[2*begin];
+                if (sampleGenerator) {
+                    for (int j = 0; j < nFaceSamples; j++) {
+                        const float *v = &generatorSamples[3*sortedIndices[begin + j]];
+                        u[2*j + 0] = v[1];
+                        u[2*j + 1] = v[2];
+                    }
+
+                } else {
+                    generateStratifiedSamples<2>(u, nFaceSamples, faceSampler);
+                }
+
+                for (int j = 0; j < nFaceSamples; j++) {
+                    int k = begin + j;
+                    UniformTriangleSampler::samplePoint(p0, p1, p2, &u[2*j], samplePositions[k], sampleNormals[k]);
+                    samplePdfs[k] = pdf;
+                    sampleFaces[k] = i;
+                }
+            }
+        };
+
+        tbb::blocked_range<int> faceRange(0, nPrimitives);
+        tbb::parallel_for(faceRange, generateFaceSamples);
 
-                samplePts.emplace_back(SamplePoint<T, 3>(pt, normal, sampleType,
-                                                         pdf, distToAbsorbingBoundary,
-                                                         distToReflectingBoundary));
+        // compute the distances to the boundary in parallel
+        std::vector<float> distToAbsorbingBoundary(nSamples), distToReflectingBoundary(nSamples);
+        auto computeDistances = [&](const tbb::blocked_range<int>& range) {
+            for (int i = range.begin(); i < range.end(); ++i) {
+                distToAbsorbingBoundary[i] = queries.computeDistToAbsorbingBoundary(samplePositions[i], false);
+                distToReflectingBoundary[i] = queries.computeDistToReflectingBoundary(samplePositions[i], false);
             }
+        };
+
+        tbb::blocked_range<int> sampleRange(0, nSamples);
+        tbb::parallel_for(sampleRange, computeDistances);
+
+        // create the sample points, grouped by mesh face
+        samplePts.reserve(nSamples);
+        if (primitiveIndices) primitiveIndices->reserve(nSamples);
+        for (int i = 0; i < nSamples; i++) {
+            samplePts.emplace_back(SamplePoint<T, 3>(samplePositions[i], sampleNormals[i], sampleType,
+                                                     samplePdfs[i], distToAbsorbingBoundary[i],
+                                                     distToReflectingBoundary[i]));
+            if (primitiveIndices) primitiveIndices->emplace_back(sampleFaces[i]);
         }
 
     } else {
@@ -524,16 +740,155 @@ inline void UniformTriangleBoundarySampler<T>::generateSamples(int nSamples, Sam
 {
     if (generateBoundaryNormalAlignedSamples) {
         generateSamples(cdfTableNormalAligned, boundaryAreaNormalAligned,
-                        nSamples, sampleType, normalOffsetForBoundary, samplePts);
+                        nSamples, sampleType, normalOffsetForBoundary, samplePts, nullptr);
 
     } else {
         generateSamples(cdfTable, boundaryArea, nSamples, sampleType,
-                        -1.0f*normalOffsetForBoundary, samplePts);
+                        -1.0f*normalOffsetForBoundary, samplePts, nullptr);
     }
 
-    for (int i = 0; i < nSamples; i++) {
+    for (int i = 0; i < (int)samplePts.size(); i++) {
         samplePts[i].estimateBoundaryNormalAligned = generateBoundaryNormalAlignedSamples;
     }
 }
 
+template <typename T>
+inline void UniformTriangleBoundarySampler<T>::generateSamples(int nSamples, SampleType sampleType,
+                                                               float normalOffsetForBoundary,
+                                                               std::vector<SamplePoint<T, 3>>& samplePts,
+                                                               std::vector<int>& primitiveIndices,
+                                                               bool generateBoundaryNormalAlignedSamples)
+{
+    if (generateBoundaryNormalAlignedSamples) {
+        generateSamples(cdfTableNormalAligned, boundaryAreaNormalAligned,
+                        nSamples, sampleType, normalOffsetForBoundary, samplePts, &primitiveIndices);
+
+    } else {
+        generateSamples(cdfTable, boundaryArea, nSamples, sampleType,
+                        -1.0f*normalOffsetForBoundary, samplePts, &primitiveIndices);
+    }
+
+    for (int i = 0; i < (int)samplePts.size(); i++) {
+        samplePts[i].estimateBoundaryNormalAligned = generateBoundaryNormalAlignedSamples;
+    }
+}
+
+template <typename T>
+inline void UniformTriangleBoundarySampler<T>::setImportance(const std::vector<float>& importance_)
+{
+    if (!importance_.empty() && importance_.size() != indices.size()) {
+        std::cerr << "UniformTriangleBoundarySampler::setImportance(): expected one weight per primitive!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // rebuild the cdf tables with the importance weights
+    importance = importance_;
+    initialize(normalOffset, solveDoubleSided);
+}
+
+template <typename T>
+inline void UniformTriangleBoundarySampler<T>::setSampleGenerator(std::shared_ptr<const SampleGenerator> sampleGenerator_)
+{
+    sampleGenerator = sampleGenerator_;
+}
+
+template <typename T>
+inline float computeSquaredNorm(const T& value)
+{
+    if constexpr (std::is_arithmetic<T>::value) {
+        return value*value;
+
+    } else {
+        return value.matrix().squaredNorm();
+    }
+}
+
+template <typename T, size_t DIM>
+inline std::vector<float> estimateBoundaryImportance(const std::vector<SamplePoint<T, DIM>>& pilotSamplePts,
+                                                     const std::vector<int>& primitiveIndices,
+                                                     int nPrimitives, float lengthScale,
+                                                     float robinCoeffCutoffForNormalDerivative,
+                                                     float defensiveFraction)
+{
+    if (pilotSamplePts.size() != primitiveIndices.size()) {
+        std::cerr << "estimateBoundaryImportance(): expected one primitive index per pilot sample point!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // accumulate the second moments of the contributions splatted by the pilot sample points
+    // on each primitive; with the splat written as G*a - P*b, the G-weighted data a is scaled
+    // by lengthScale so that both terms have the units of the solution
+    std::vector<float> totalSecondMoment(nPrimitives, 0.0f);
+    std::vector<int> sampleCount(nPrimitives, 0);
+    float lengthScale2 = lengthScale*lengthScale;
+    for (size_t i = 0; i < pilotSamplePts.size(); i++) {
+        const SamplePoint<T, DIM>& samplePt = pilotSamplePts[i];
+        float robinCoeff = samplePt.robinCoeff;
+        float solutionVariance = 0.0f;
+        float normalDerivativeVariance = 0.0f;
+        if (samplePt.statistics) {
+            int nSolutionEstimates = samplePt.statistics->getSolutionEstimateCount();
+            if (nSolutionEstimates > 0) {
+                solutionVariance = computeSquaredNorm(samplePt.statistics->getEstimatedSolutionVariance())/nSolutionEstimates;
+            }
+
+            int nGradientEstimates = samplePt.statistics->getGradientEstimateCount();
+            if (nGradientEstimates > 0) {
+                std::vector<T> gradientVariance = samplePt.statistics->getEstimatedGradientVariance();
+                T directionalVariance(0.0f);
+                for (int j = 0; j < DIM; j++) {
+                    directionalVariance += samplePt.normal(j)*samplePt.normal(j)*gradientVariance[j];
+                }
+
+                normalDerivativeVariance = computeSquaredNorm(directionalVariance)/nGradientEstimates;
+            }
+        }
+
+        float secondMoment = 0.0f;
+        if (robinCoeff > robinCoeffCutoffForNormalDerivative) {
+            // a = normal derivative, b = (robin - normal derivative)/robinCoeff
+            T b = (samplePt.robin - samplePt.normalDerivative)/robinCoeff;
+            secondMoment = lengthScale2*(computeSquaredNorm(samplePt.normalDerivative) + normalDerivativeVariance) +
+                           computeSquaredNorm(b) + normalDerivativeVariance/(robinCoeff*robinCoeff);
+
+        } else if (robinCoeff > 0.0f) {
+            // a = robin - robinCoeff*solution, b = solution
+            T a = samplePt.robin - robinCoeff*samplePt.solution;
+            secondMoment = lengthScale2*(computeSquaredNorm(a) + robinCoeff*robinCoeff*solutionVariance) +
+                           computeSquaredNorm(samplePt.solution) + solutionVariance;
+
+        } else {
+            // a = normal derivative, b = solution
+            secondMoment = lengthScale2*(computeSquaredNorm(samplePt.normalDerivative) + normalDerivativeVariance) +
+                           computeSquaredNorm(samplePt.solution) + solutionVariance;
+        }
+
+        int primitiveIndex = primitiveIndices[i];
+        if (std::isfinite(secondMoment) && primitiveIndex >= 0 && primitiveIndex < nPrimitives) {
+            totalSecondMoment[primitiveIndex] += secondMoment;
+            sampleCount[primitiveIndex]++;
+        }
+    }
+
+    // primitives without pilot sample points are assigned the average weight
+    std::vector<float> importance(nPrimitives, 0.0f);
+    float totalImportance = 0.0f;
+    int nSampledPrimitives = 0;
+    for (int i = 0; i < nPrimitives; i++) {
+        if (sampleCount[i] > 0) {
+            importance[i] = std::sqrt(totalSecondMoment[i]/sampleCount[i]);
+            totalImportance += importance[i];
+            nSampledPrimitives++;
+        }
+    }
+
+    float meanImportance = nSampledPrimitives > 0 ? totalImportance/nSampledPrimitives : 0.0f;
+    for (int i = 0; i < nPrimitives; i++) {
+        if (sampleCount[i] == 0) importance[i] = meanImportance;
+        importance[i] = meanImportance > 0.0f ? (1.0f - defensiveFraction)*importance[i]/meanImportance + defensiveFraction : 1.0f;
+    }
+
+    return importance;
+}
+
 } // zombie
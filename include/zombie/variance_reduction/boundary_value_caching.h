@@ -1,6 +1,10 @@
 // This file implements the Boundary Value Caching technique for reducing variance
 // of the walk-on-spheres and walk-on-stars estimators at a set of user-selected
-// evaluation points via sample caching and reuse.
+// evaluation points via sample caching and reuse. Estimates can be refined progressively:
+// splatting additional sample pts renormalizes the evaluation pts by the new sample counts,
+// while cached sample pts refined with more walks are accounted for by splatting only the
+// change in their boundary data. Since the cached boundary data is independent of the
+// evaluation pts, it can be saved to disk and splatted to other evaluation pts in later runs.
 //
 // Resources:
 // - Boundary Value Caching for Walk on Spheres [2023]
@@ -8,11 +12,26 @@
 #pragma once
 
 #include <zombie/point_estimation/walk_on_stars.h>
+#include <zombie/variance_reduction/splat_tree.h>
+#include <zombie/utils/binary_cache.h>
+
+#define BVC_SPLAT_TILE_SIZE 64
+#define BVC_SPLAT_BLOCK_SIZE 256
+#define BVC_SPLAT_BATCH_SIZE 8192
+#define BVC_CACHE_VERSION 1
 
 namespace zombie {
 
 namespace bvc {
 
+// statistics of the estimates splatted to an evaluation pt; only their mean is ever queried,
+// so the sum-only policy suffices and each splat reduces to a multiply-add
+template <typename T, size_t DIM>
+using SplatStatistics = SampleStatistics<T, DIM, StatisticsPolicy::Sum>;
+
+// a single evaluation pt; the statistics for each category of sample pts are stored inline,
+// so constructing an evaluation pt makes no heap allocations (use EvaluationPoints to splat to
+// many pts at once)
 template <typename T, size_t DIM>
 struct EvaluationPoint {
     // constructor
@@ -39,25 +58,86 @@ struct EvaluationPoint {
     float distToReflectingBoundary;
 
 protected:
+    // returns the statistics for the given category of sample points
+    SplatStatistics<T, DIM>& getStatistics(SplatCategory category);
+
+    // members
+    SplatStatistics<T, DIM> statistics[SPLAT_CATEGORY_COUNT];
+
+    template <typename A, size_t B, EstimationQuantity C>
+    friend class BoundaryValueCaching;
+};
+
+// structure-of-arrays storage for a set of evaluation pts; the statistics for each category
+// of sample pts are stored contiguously, so no per-point allocations are made
+template <typename T, size_t DIM>
+struct EvaluationPoints {
+    // reserves storage for the given number of evaluation pts
+    void reserve(int n);
+
+    // adds an evaluation pt
+    void add(const Vector<DIM>& pt_,
+             const Vector<DIM>& normal_,
+             SampleType type_,
+             float distToAbsorbingBoundary_,
+             float distToReflectingBoundary_);
+
+    // returns the number of evaluation pts
+    int size() const;
+
+    // returns estimated solution at the ith evaluation pt
+    T getEstimatedSolution(int i) const;
+
+    // returns estimated gradient at the ith evaluation pt
+    void getEstimatedGradient(int i, std::vector<T>& gradient) const;
+
+    // resets statistics at the ith evaluation pt
+    void reset(int i);
+
+    // resets statistics at all evaluation pts
+    void reset();
+
+    // members
+    std::vector<Vector<DIM>> pt;
+    std::vector<Vector<DIM>> normal;
+    std::vector<SampleType> type;
+    std::vector<float> distToAbsorbingBoundary;
+    std::vector<float> distToReflectingBoundary;
+
+protected:
+    // returns the statistics at the ith evaluation pt for the given category of sample points
+    SplatStatistics<T, DIM>& getStatistics(int i, SplatCategory category);
+
     // members
-    std::unique_ptr<SampleStatistics<T, DIM>> absorbingBoundaryStatistics;
-    std::unique_ptr<SampleStatistics<T, DIM>> absorbingBoundaryNormalAlignedStatistics;
-    std::unique_ptr<SampleStatistics<T, DIM>> reflectingBoundaryStatistics;
-    std::unique_ptr<SampleStatistics<T, DIM>> reflectingBoundaryNormalAlignedStatistics;
-    std::unique_ptr<SampleStatistics<T, DIM>> sourceStatistics;
+    std::vector<SplatStatistics<T, DIM>> statistics[SPLAT_CATEGORY_COUNT];
 
-    template <typename A, size_t B>
+    template <typename A, size_t B, EstimationQuantity C>
     friend class BoundaryValueCaching;
 };
 
+// running sums of the estimates splatted to an evaluation pt
 template <typename T, size_t DIM>
+struct SplatAccumulator {
+    // resets the sums
+    void reset();
+
+    // members
+    T solution;
+    T gradient[DIM];
+    int count;
+};
+
+// Quantity selects the estimates splatted to evaluation pts: with EstimationQuantity::Solution,
+// the gradient kernels are never evaluated and estimated gradients remain zero
+template <typename T, size_t DIM, EstimationQuantity Quantity=EstimationQuantity::SolutionAndGradient>
 class BoundaryValueCaching {
 public:
     // constructor
     BoundaryValueCaching(const GeometricQueries<DIM>& queries_,
                          const WalkOnStars<T, DIM>& walkOnStars_);
 
-    // solves the given PDE at the provided sample points
+    // solves the given PDE at the provided sample points; calling this again on the same
+    // sample points runs additional walks that are accumulated with the previous ones
     void computeBoundaryEstimates(const PDE<T, DIM>& pde,
                                   const WalkSettings& walkSettings,
                                   int nWalksForSolutionEstimates,
@@ -101,10 +181,11 @@ public:
                float robinCoeffCutoffForNormalDerivative,
                float cutoffDistToAbsorbingBoundary,
                float cutoffDistToReflectingBoundary,
-               std::vector<EvaluationPoint<T, DIM>>& evalPts,
+               EvaluationPoints<T, DIM>& evalPts,
                bool runSingleThreaded=false) const;
 
-    // splats sample pt data to the input evaluation pts
+    // splats sample pt data to the input evaluation pts; tiles of evaluation pts are processed
+    // in parallel, with batches of sample pts streamed through them
     void splat(const PDE<T, DIM>& pde,
                const std::vector<SamplePoint<T, DIM>>& samplePts,
                float radiusClamp,
@@ -112,22 +193,82 @@ public:
                float robinCoeffCutoffForNormalDerivative,
                float cutoffDistToAbsorbingBoundary,
                float cutoffDistToReflectingBoundary,
-               std::vector<EvaluationPoint<T, DIM>>& evalPts,
+               EvaluationPoints<T, DIM>& evalPts,
                std::function<void(int, int)> reportProgress={}) const;
 
-    // estimates the solution at the input evaluation pt near the boundary
+    // splats the change in the boundary data of sample pts that were previously splatted to the
+    // input evaluation pts, e.g., after refining their estimates with computeBoundaryEstimates;
+    // prevSamplePts holds a copy of the sample pts made before the refinement, and the sample
+    // counts at the evaluation pts are left unchanged; the updates are splatted directly, and a
+    // SplatTree built from prevSamplePts must be refit to samplePts before it is splatted again
+    void splatUpdates(const PDE<T, DIM>& pde,
+                      const std::vector<SamplePoint<T, DIM>>& prevSamplePts,
+                      const std::vector<SamplePoint<T, DIM>>& samplePts,
+                      float radiusClamp,
+                      float kernelRegularization,
+                      float robinCoeffCutoffForNormalDerivative,
+                      float cutoffDistToAbsorbingBoundary,
+                      float cutoffDistToReflectingBoundary,
+                      EvaluationPoints<T, DIM>& evalPts,
+                      std::function<void(int, int)> reportProgress={}) const;
+
+    // splats the sample pt data stored in the tree to the input evaluation pt; clusters of
+    // sample pts are approximated by their multipole expansion when the ratio of their radius
+    // to their distance from the evaluation pt is below the opening angle, so smaller angles
+    // are more accurate and an angle of 0 reduces to direct summation
+    void splat(const PDE<T, DIM>& pde,
+               const SplatTree<T, DIM>& splatTree,
+               float openingAngle,
+               float radiusClamp,
+               float kernelRegularization,
+               float cutoffDistToAbsorbingBoundary,
+               float cutoffDistToReflectingBoundary,
+               EvaluationPoint<T, DIM>& evalPt) const;
+
+    // splats the sample pt data stored in the tree to the input evaluation pts
+    void splat(const PDE<T, DIM>& pde,
+               const SplatTree<T, DIM>& splatTree,
+               float openingAngle,
+               float radiusClamp,
+               float kernelRegularization,
+               float cutoffDistToAbsorbingBoundary,
+               float cutoffDistToReflectingBoundary,
+               EvaluationPoints<T, DIM>& evalPts,
+               bool runSingleThreaded=false) const;
+
+    // estimates the solution at the input evaluation pt near the boundary; interior evaluation pts
+    // record the estimate with the boundary whose distance triggered it
     void estimateSolutionNearBoundary(const PDE<T, DIM>& pde,
                                       const WalkSettings& walkSettings,
                                       bool useDistanceToAbsorbingBoundary,
                                       float cutoffDistToBoundary, int nWalks,
                                       EvaluationPoint<T, DIM>& evalPt) const;
 
-    // estimates the solution at the input evaluation pts near the boundary
+    // estimates the solution at the input evaluation pts near the boundary; interior evaluation pts
+    // record the estimate with the boundary whose distance triggered it
     void estimateSolutionNearBoundary(const PDE<T, DIM>& pde,
                                       const WalkSettings& walkSettings,
                                       bool useDistanceToAbsorbingBoundary,
                                       float cutoffDistToBoundary, int nWalks,
-                                      std::vector<EvaluationPoint<T, DIM>>& evalPts,
+                                      EvaluationPoints<T, DIM>& evalPts,
+                                      bool runSingleThreaded=false) const;
+
+    // estimates the solution at the input evaluation pts near the boundary by interpolating the
+    // cached estimates of the nearest visible sample pts in the input boundary cache, weighted by
+    // their inverse squared distance along the boundary to the closest boundary pt; near the
+    // absorbing boundary, the interpolant is blended with the Dirichlet boundary value based on
+    // the distance to the boundary. Only evaluation pts with no cached sample pt visible within
+    // maxDistToCachedSample fall back to walk-on-stars with nWalks walks
+    template <typename NearestNeighborFinder>
+    void estimateSolutionNearBoundary(const PDE<T, DIM>& pde,
+                                      const WalkSettings& walkSettings,
+                                      bool useDistanceToAbsorbingBoundary,
+                                      float cutoffDistToBoundary, int nWalks,
+                                      const std::vector<SamplePoint<T, DIM>>& boundaryCache,
+                                      const NearestNeighborFinder& boundaryCacheFinder,
+                                      int nNearestCachedSamples,
+                                      float maxDistToCachedSample,
+                                      EvaluationPoints<T, DIM>& evalPts,
                                       bool runSingleThreaded=false) const;
 
 protected:
@@ -148,32 +289,168 @@ protected:
                                   bool useFiniteDifferences,
                                   std::vector<SamplePoint<T, DIM>>& samplePts) const;
 
+    // creates the free-space Green's function of the PDE; splatting functions create it once
+    // (per parallel task) and move its pole to each evaluation pt
+    std::unique_ptr<GreensFnFreeSpace<DIM>> createGreensFn(const PDE<T, DIM>& pde) const;
+
+    // splats sample pt data to the statistics of an evaluation pt, after moving the pole of
+    // the Green's function to the evaluation pt
+    void splatSampleData(const SamplePoint<T, DIM>& samplePt,
+                         GreensFnFreeSpace<DIM>& greensFn,
+                         float radiusClamp,
+                         float kernelRegularization,
+                         float robinCoeffCutoffForNormalDerivative,
+                         const Vector<DIM>& x,
+                         SampleType evalPtType,
+                         SplatStatistics<T, DIM>& statistics) const;
+
     // splats boundary sample data
     void splatBoundaryData(const SamplePoint<T, DIM>& samplePt,
-                           const std::unique_ptr<GreensFnFreeSpace<DIM>>& greensFn,
+                           const GreensFnFreeSpace<DIM>& greensFn,
                            float radiusClamp,
                            float kernelRegularization,
                            float robinCoeffCutoffForNormalDerivative,
-                           EvaluationPoint<T, DIM>& evalPt) const;
+                           SampleType evalPtType,
+                           SplatStatistics<T, DIM>& statistics) const;
 
     // splats source sample data
     void splatSourceData(const SamplePoint<T, DIM>& samplePt,
-                         const std::unique_ptr<GreensFnFreeSpace<DIM>>& greensFn,
+                         const GreensFnFreeSpace<DIM>& greensFn,
                          float radiusClamp,
                          float kernelRegularization,
-                         EvaluationPoint<T, DIM>& evalPt) const;
+                         SampleType evalPtType,
+                         SplatStatistics<T, DIM>& statistics) const;
+
+    // splats the sample pt data stored in the tree to the statistics of an evaluation pt,
+    // with one statistics object per category of sample pts; the samples in leaves that are
+    // opened are splatted directly as blocks, and greensFn must come from createGreensFn
+    void splatTreeData(const PDE<T, DIM>& pde,
+                       const SplatTree<T, DIM>& splatTree,
+                       GreensFnFreeSpace<DIM>& greensFn,
+                       float openingAngle,
+                       float radiusClamp,
+                       float kernelRegularization,
+                       const Vector<DIM>& x,
+                       SampleType evalPtType,
+                       SplatStatistics<T, DIM> **statistics) const;
+
+    // estimates the solution at an evaluation pt near the boundary with walk-on-stars;
+    // returns false if the evaluation pt is not within the cutoff distance
+    bool estimateSolutionNearBoundary(const PDE<T, DIM>& pde,
+                                      const WalkSettings& walkSettings,
+                                      bool useDistanceToAbsorbingBoundary,
+                                      float cutoffDistToBoundary, int nWalks,
+                                      const Vector<DIM>& pt,
+                                      const Vector<DIM>& normal,
+                                      SampleType type,
+                                      float distToAbsorbingBoundary,
+                                      float distToReflectingBoundary,
+                                      T& solutionEstimate) const;
+
+    // estimates the solution at an evaluation pt near the boundary by interpolating cached sample pts;
+    // returns false if no cached sample pt is visible within the input distance
+    template <typename NearestNeighborFinder>
+    bool interpolateBoundaryCache(const PDE<T, DIM>& pde,
+                                  const WalkSettings& walkSettings,
+                                  bool useDistanceToAbsorbingBoundary,
+                                  const std::vector<SamplePoint<T, DIM>>& boundaryCache,
+                                  const NearestNeighborFinder& boundaryCacheFinder,
+                                  int nNearestCachedSamples,
+                                  float maxDistToCachedSample,
+                                  const Vector<DIM>& pt,
+                                  float distToBoundary,
+                                  std::vector<size_t>& nnIndices,
+                                  T& solutionEstimate) const;
+
+    // splats a batch of sample pts to the input evaluation pts using the harmonic Green's function,
+    // or the Yukawa Green's function if the absorption coefficient is positive; with
+    // correctExistingEstimates, the splatted sums are added to the existing estimates as corrections
+    void splatBatch(const SplatSampleBatch<T, DIM>& batch,
+                    SplatCategory category,
+                    float absorptionCoeff,
+                    float radiusClamp,
+                    float kernelRegularization,
+                    float cutoffDistToAbsorbingBoundary,
+                    float cutoffDistToReflectingBoundary,
+                    EvaluationPoints<T, DIM>& evalPts,
+                    bool correctExistingEstimates=false) const;
+
+    // accumulates the contributions of a block of sample pts to an evaluation pt using the
+    // harmonic Green's function
+    void accumulateHarmonicBlock(const SplatSampleBatch<T, DIM>& batch,
+                                 int start, int end,
+                                 const Vector<DIM>& x,
+                                 float alpha,
+                                 float radiusClamp,
+                                 float kernelRegularization,
+                                 SplatAccumulator<T, DIM>& accumulator) const;
+
+    // accumulates the contributions of a block of sample pts to the evaluation pt at the pole
+    // of the Yukawa Green's function
+    void accumulateYukawaBlock(const SplatSampleBatch<T, DIM>& batch,
+                               int start, int end,
+                               const YukawaGreensFnFreeSpace<DIM>& greensFn,
+                               float alpha,
+                               float radiusClamp,
+                               float kernelRegularization,
+                               SplatAccumulator<T, DIM>& accumulator) const;
+
+    // splats the multipole expansion of a cluster of sample pts
+    void splatClusterData(const SplatTreeNode<T, DIM>& node,
+                          const Vector<DIM>& x,
+                          float absorptionCoeff,
+                          float alpha,
+                          T& solutionEstimate,
+                          T *gradientEstimate) const;
 
     // members
+    static constexpr bool estimateGradient = Quantity == EstimationQuantity::SolutionAndGradient;
     const GeometricQueries<DIM>& queries;
     const WalkOnStars<T, DIM>& walkOnStars;
 };
 
+// computes the hash of a PDE from a caller-supplied fingerprint of its source term and boundary
+// conditions, which are arbitrary functions that cannot be hashed themselves, and its absorption
+// coefficient; the fingerprint must change whenever the PDE data changes, e.g., a version number
+// or the hash of the files defining the data (see hashFile). The content hash of a boundary value
+// cache combines this hash, the hash of the boundary mesh (see computeBoundaryMeshHash) and the
+// settings used to estimate the cached boundary data
+template <typename T, size_t DIM>
+uint64_t computePDEHash(const PDE<T, DIM>& pde, uint64_t pdeFingerprint,
+                        uint64_t hash=14695981039346656037ull);
+
+// computes a fallback PDE fingerprint for computePDEHash by evaluating the source term, boundary
+// conditions and Robin coefficients at a fixed set of probe pts in the given bounding box, for
+// PDEs whose data has no version or file to fingerprint. NOTE: PDEs that agree at the probe pts
+// collide, so changes confined to small regions are likely missed and a stale cache is loaded;
+// use only when an explicit fingerprint is not available
+template <typename T, size_t DIM>
+uint64_t computeProbedPDEFingerprint(const PDE<T, DIM>& pde,
+                                     const Vector<DIM>& boundingBoxMin,
+                                     const Vector<DIM>& boundingBoxMax,
+                                     int nProbePts=64);
+
+// writes sample pts with cached boundary data (computed by computeBoundaryEstimates and
+// setSourceValues) to a binary cache file; several sets of sample pts can be stored in one file.
+// NOTE: caches are only validated against contentHash, which must change whenever the PDE data,
+// the boundary mesh or the settings used to estimate the cached boundary data change
+template <typename T, size_t DIM>
+bool saveBoundaryValueCache(const std::string& cacheFile, uint64_t contentHash,
+                            const std::vector<const std::vector<SamplePoint<T, DIM>> *>& samplePts);
+
+// loads sets of sample pts from a memory mapped cache file written by saveBoundaryValueCache; returns
+// false if the cache does not exist, was written for a different content hash or holds a different
+// number of sets. The loaded sample pts carry all the data needed for splatting, but no walk statistics,
+// so refining them with computeBoundaryEstimates discards the cached estimates
+template <typename T, size_t DIM>
+bool loadBoundaryValueCache(const std::string& cacheFile, uint64_t contentHash,
+                            const std::vector<std::vector<SamplePoint<T, DIM>> *>& samplePts);
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Implementation
 // FUTURE:
 // - virtual boundary creation and estimation
 // - bias correction/compensation
-// - Barnes-Hut acceleration for splatting
 
 template <typename T, size_t DIM>
 inline EvaluationPoint<T, DIM>::EvaluationPoint(const Vector<DIM>& pt_,
@@ -185,21 +462,16 @@ inline EvaluationPoint<T, DIM>::EvaluationPoint(const Vector<DIM>& pt_,
                                                 distToAbsorbingBoundary(distToAbsorbingBoundary_),
                                                 distToReflectingBoundary(distToReflectingBoundary_)
 {
-    absorbingBoundaryStatistics = std::make_unique<SampleStatistics<T, DIM>>();
-    absorbingBoundaryNormalAlignedStatistics = std::make_unique<SampleStatistics<T, DIM>>();
-    reflectingBoundaryStatistics = std::make_unique<SampleStatistics<T, DIM>>();
-    reflectingBoundaryNormalAlignedStatistics = std::make_unique<SampleStatistics<T, DIM>>();
-    sourceStatistics = std::make_unique<SampleStatistics<T, DIM>>();
+    // do nothing
 }
 
 template <typename T, size_t DIM>
 inline T EvaluationPoint<T, DIM>::getEstimatedSolution() const
 {
-    T solution = absorbingBoundaryStatistics->getEstimatedSolution();
-    solution += absorbingBoundaryNormalAlignedStatistics->getEstimatedSolution();
-    solution += reflectingBoundaryStatistics->getEstimatedSolution();
-    solution += reflectingBoundaryNormalAlignedStatistics->getEstimatedSolution();
-    solution += sourceStatistics->getEstimatedSolution();
+    T solution = statistics[0].getEstimatedSolution();
+    for (int c = 1; c < SPLAT_CATEGORY_COUNT; c++) {
+        solution += statistics[c].getEstimatedSolution();
+    }
 
     return solution;
 }
@@ -207,44 +479,131 @@ inline T EvaluationPoint<T, DIM>::getEstimatedSolution() const
 template <typename T, size_t DIM>
 inline void EvaluationPoint<T, DIM>::getEstimatedGradient(std::vector<T>& gradient) const
 {
-    gradient.resize(DIM);
-    for (int i = 0; i < DIM; i++) {
-        gradient[i] = absorbingBoundaryStatistics->getEstimatedGradient()[i];
-        gradient[i] += absorbingBoundaryNormalAlignedStatistics->getEstimatedGradient()[i];
-        gradient[i] += reflectingBoundaryStatistics->getEstimatedGradient()[i];
-        gradient[i] += reflectingBoundaryNormalAlignedStatistics->getEstimatedGradient()[i];
-        gradient[i] += sourceStatistics->getEstimatedGradient()[i];
+    statistics[0].getEstimatedGradient(gradient);
+    for (int c = 1; c < SPLAT_CATEGORY_COUNT; c++) {
+        const T *categoryGradient = statistics[c].getEstimatedGradient();
+        for (int i = 0; i < DIM; i++) {
+            gradient[i] += categoryGradient[i];
+        }
     }
 }
 
 template <typename T, size_t DIM>
 inline void EvaluationPoint<T, DIM>::reset()
 {
-    absorbingBoundaryStatistics->reset();
-    absorbingBoundaryNormalAlignedStatistics->reset();
-    reflectingBoundaryStatistics->reset();
-    reflectingBoundaryNormalAlignedStatistics->reset();
-    sourceStatistics->reset();
+    for (int c = 0; c < SPLAT_CATEGORY_COUNT; c++) statistics[c].reset();
 }
 
 template <typename T, size_t DIM>
-inline BoundaryValueCaching<T, DIM>::BoundaryValueCaching(const GeometricQueries<DIM>& queries_,
-                                                          const WalkOnStars<T, DIM>& walkOnStars_):
-                                                          queries(queries_), walkOnStars(walkOnStars_)
+inline SplatStatistics<T, DIM>& EvaluationPoint<T, DIM>::getStatistics(SplatCategory category)
 {
-    // do nothing
+    return statistics[(int)category];
+}
+
+template <typename T, size_t DIM>
+inline void EvaluationPoints<T, DIM>::reserve(int n)
+{
+    pt.reserve(n);
+    normal.reserve(n);
+    type.reserve(n);
+    distToAbsorbingBoundary.reserve(n);
+    distToReflectingBoundary.reserve(n);
+    for (int c = 0; c < SPLAT_CATEGORY_COUNT; c++) statistics[c].reserve(n);
+}
+
+template <typename T, size_t DIM>
+inline void EvaluationPoints<T, DIM>::add(const Vector<DIM>& pt_,
+                                          const Vector<DIM>& normal_,
+                                          SampleType type_,
+                                          float distToAbsorbingBoundary_,
+                                          float distToReflectingBoundary_)
+{
+    pt.emplace_back(pt_);
+    normal.emplace_back(normal_);
+    type.emplace_back(type_);
+    distToAbsorbingBoundary.emplace_back(distToAbsorbingBoundary_);
+    distToReflectingBoundary.emplace_back(distToReflectingBoundary_);
+    for (int c = 0; c < SPLAT_CATEGORY_COUNT; c++) statistics[c].emplace_back();
+}
+
+template <typename T, size_t DIM>
+inline int EvaluationPoints<T, DIM>::size() const
+{
+    return (int)pt.size();
 }
 
 template <typename T, size_t DIM>
-inline void BoundaryValueCaching<T, DIM>::computeBoundaryEstimates(const PDE<T, DIM>& pde,
-                                                                   const WalkSettings& walkSettings,
-                                                                   int nWalksForSolutionEstimates,
-                                                                   int nWalksForGradientEstimates,
-                                                                   float robinCoeffCutoffForNormalDerivative,
-                                                                   std::vector<SamplePoint<T, DIM>>& samplePts,
-                                                                   bool useFiniteDifferences,
-                                                                   bool runSingleThreaded,
-                                                                   std::function<void(int,int)> reportProgress) const
+inline T EvaluationPoints<T, DIM>::getEstimatedSolution(int i) const
+{
+    T solution = statistics[0][i].getEstimatedSolution();
+    for (int c = 1; c < SPLAT_CATEGORY_COUNT; c++) {
+        solution += statistics[c][i].getEstimatedSolution();
+    }
+
+    return solution;
+}
+
+template <typename T, size_t DIM>
+inline void EvaluationPoints<T, DIM>::getEstimatedGradient(int i, std::vector<T>& gradient) const
+{
+    statistics[0][i].getEstimatedGradient(gradient);
+    for (int c = 1; c < SPLAT_CATEGORY_COUNT; c++) {
+        const T *categoryGradient = statistics[c][i].getEstimatedGradient();
+        for (int j = 0; j < DIM; j++) {
+            gradient[j] += categoryGradient[j];
+        }
+    }
+}
+
+template <typename T, size_t DIM>
+inline void EvaluationPoints<T, DIM>::reset(int i)
+{
+    for (int c = 0; c < SPLAT_CATEGORY_COUNT; c++) statistics[c][i].reset();
+}
+
+template <typename T, size_t DIM>
+inline void EvaluationPoints<T, DIM>::reset()
+{
+    for (int c = 0; c < SPLAT_CATEGORY_COUNT; c++) {
+        for (int i = 0; i < size(); i++) statistics[c][i].reset();
+    }
+}
+
+template <typename T, size_t DIM>
+inline SplatStatistics<T, DIM>& EvaluationPoints<T, DIM>::getStatistics(int i, SplatCategory category)
+{
+    return statistics[(int)category][i];
+}
+
+template <typename T, size_t DIM>
+inline void SplatAccumulator<T, DIM>::reset()
+{
+    solution = T(0.0f);
+    for (int i = 0; i < DIM; i++) {
+        gradient[i] = T(0.0f);
+    }
+
+    count = 0;
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline BoundaryValueCaching<T, DIM, Quantity>::BoundaryValueCaching(const GeometricQueries<DIM>& queries_,
+                                                                    const WalkOnStars<T, DIM>& walkOnStars_):
+                                                                    queries(queries_), walkOnStars(walkOnStars_)
+{
+    // do nothing
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::computeBoundaryEstimates(const PDE<T, DIM>& pde,
+                                                                             const WalkSettings& walkSettings,
+                                                                             int nWalksForSolutionEstimates,
+                                                                             int nWalksForGradientEstimates,
+                                                                             float robinCoeffCutoffForNormalDerivative,
+                                                                             std::vector<SamplePoint<T, DIM>>& samplePts,
+                                                                             bool useFiniteDifferences,
+                                                                             bool runSingleThreaded,
+                                                                             std::function<void(int,int)> reportProgress) const
 {
     // initialize estimation quantities
     std::vector<SampleEstimationData<DIM>> estimationData;
@@ -261,10 +620,10 @@ inline void BoundaryValueCaching<T, DIM>::computeBoundaryEstimates(const PDE<T,
                              useFiniteDifferences, samplePts);
 }
 
-template <typename T, size_t DIM>
-inline void BoundaryValueCaching<T, DIM>::setSourceValues(const PDE<T, DIM>& pde,
-                                                          std::vector<SamplePoint<T, DIM>>& samplePts,
-                                                          bool runSingleThreaded) const
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::setSourceValues(const PDE<T, DIM>& pde,
+                                                                    std::vector<SamplePoint<T, DIM>>& samplePts,
+                                                                    bool runSingleThreaded) const
 {
     int nSamplePoints = (int)samplePts.size();
     if (runSingleThreaded) {
@@ -284,105 +643,94 @@ inline void BoundaryValueCaching<T, DIM>::setSourceValues(const PDE<T, DIM>& pde
     }
 }
 
-template <typename T, size_t DIM>
-inline void BoundaryValueCaching<T, DIM>::splat(const PDE<T, DIM>& pde,
-                                                const SamplePoint<T, DIM>& samplePt,
-                                                float radiusClamp,
-                                                float kernelRegularization,
-                                                float robinCoeffCutoffForNormalDerivative,
-                                                float cutoffDistToAbsorbingBoundary,
-                                                float cutoffDistToReflectingBoundary,
-                                                EvaluationPoint<T, DIM>& evalPt) const
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::splat(const PDE<T, DIM>& pde,
+                                                          const SamplePoint<T, DIM>& samplePt,
+                                                          float radiusClamp,
+                                                          float kernelRegularization,
+                                                          float robinCoeffCutoffForNormalDerivative,
+                                                          float cutoffDistToAbsorbingBoundary,
+                                                          float cutoffDistToReflectingBoundary,
+                                                          EvaluationPoint<T, DIM>& evalPt) const
 {
     // don't evaluate if the distance to the boundary is smaller than the cutoff distance
     if (evalPt.distToAbsorbingBoundary < cutoffDistToAbsorbingBoundary ||
         evalPt.distToReflectingBoundary < cutoffDistToReflectingBoundary) return;
 
-    // initialize the greens function
-    std::unique_ptr<GreensFnFreeSpace<DIM>> greensFn = nullptr;
-    if (pde.absorptionCoeff > 0.0f) {
-        greensFn = std::make_unique<YukawaGreensFnFreeSpace<DIM>>(pde.absorptionCoeff);
-
-    } else {
-        greensFn = std::make_unique<HarmonicGreensFnFreeSpace<DIM>>();
-    }
-
-    greensFn->updatePole(evalPt.pt);
-
     // evaluate
-    if (samplePt.type == SampleType::OnAbsorbingBoundary ||
-        samplePt.type == SampleType::OnReflectingBoundary) {
-        splatBoundaryData(samplePt, greensFn, radiusClamp, kernelRegularization,
-                          robinCoeffCutoffForNormalDerivative, evalPt);
-
-    } else {
-        splatSourceData(samplePt, greensFn, radiusClamp, kernelRegularization, evalPt);
-    }
+    std::unique_ptr<GreensFnFreeSpace<DIM>> greensFn = createGreensFn(pde);
+    splatSampleData(samplePt, *greensFn, radiusClamp, kernelRegularization,
+                    robinCoeffCutoffForNormalDerivative, evalPt.pt, evalPt.type,
+                    evalPt.getStatistics(getSplatCategory(samplePt)));
 }
 
-template <typename T, size_t DIM>
-inline void BoundaryValueCaching<T, DIM>::splat(const PDE<T, DIM>& pde,
-                                                const std::vector<SamplePoint<T, DIM>>& samplePts,
-                                                float radiusClamp,
-                                                float kernelRegularization,
-                                                float robinCoeffCutoffForNormalDerivative,
-                                                float cutoffDistToAbsorbingBoundary,
-                                                float cutoffDistToReflectingBoundary,
-                                                EvaluationPoint<T, DIM>& evalPt) const
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::splat(const PDE<T, DIM>& pde,
+                                                          const std::vector<SamplePoint<T, DIM>>& samplePts,
+                                                          float radiusClamp,
+                                                          float kernelRegularization,
+                                                          float robinCoeffCutoffForNormalDerivative,
+                                                          float cutoffDistToAbsorbingBoundary,
+                                                          float cutoffDistToReflectingBoundary,
+                                                          EvaluationPoint<T, DIM>& evalPt) const
 {
     // don't evaluate if the distance to the boundary is smaller than the cutoff distance
     if (evalPt.distToAbsorbingBoundary < cutoffDistToAbsorbingBoundary ||
         evalPt.distToReflectingBoundary < cutoffDistToReflectingBoundary) return;
 
     // initialize the greens function
-    std::unique_ptr<GreensFnFreeSpace<DIM>> greensFn = nullptr;
-    if (pde.absorptionCoeff > 0.0f) {
-        greensFn = std::make_unique<YukawaGreensFnFreeSpace<DIM>>(pde.absorptionCoeff);
-
-    } else {
-        greensFn = std::make_unique<HarmonicGreensFnFreeSpace<DIM>>();
-    }
-
+    std::unique_ptr<GreensFnFreeSpace<DIM>> greensFn = createGreensFn(pde);
     greensFn->updatePole(evalPt.pt);
 
     // evaluate
     for (int i = 0; i < (int)samplePts.size(); i++) {
+        SplatStatistics<T, DIM>& statistics = evalPt.getStatistics(getSplatCategory(samplePts[i]));
         if (samplePts[i].type == SampleType::OnAbsorbingBoundary ||
             samplePts[i].type == SampleType::OnReflectingBoundary) {
-            splatBoundaryData(samplePts[i], greensFn, radiusClamp, kernelRegularization,
-                              robinCoeffCutoffForNormalDerivative, evalPt);
+            splatBoundaryData(samplePts[i], *greensFn, radiusClamp, kernelRegularization,
+                              robinCoeffCutoffForNormalDerivative, evalPt.type, statistics);
 
         } else {
-            splatSourceData(samplePts[i], greensFn, radiusClamp, kernelRegularization, evalPt);
+            splatSourceData(samplePts[i], *greensFn, radiusClamp, kernelRegularization,
+                            evalPt.type, statistics);
         }
     }
 }
 
-template <typename T, size_t DIM>
-inline void BoundaryValueCaching<T, DIM>::splat(const PDE<T, DIM>& pde,
-                                                const SamplePoint<T, DIM>& samplePt,
-                                                float radiusClamp,
-                                                float kernelRegularization,
-                                                float robinCoeffCutoffForNormalDerivative,
-                                                float cutoffDistToAbsorbingBoundary,
-                                                float cutoffDistToReflectingBoundary,
-                                                std::vector<EvaluationPoint<T, DIM>>& evalPts,
-                                                bool runSingleThreaded) const
-{
-    int nEvalPoints = (int)evalPts.size();
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::splat(const PDE<T, DIM>& pde,
+                                                          const SamplePoint<T, DIM>& samplePt,
+                                                          float radiusClamp,
+                                                          float kernelRegularization,
+                                                          float robinCoeffCutoffForNormalDerivative,
+                                                          float cutoffDistToAbsorbingBoundary,
+                                                          float cutoffDistToReflectingBoundary,
+                                                          EvaluationPoints<T, DIM>& evalPts,
+                                                          bool runSingleThreaded) const
+{
+    SplatCategory category = getSplatCategory(samplePt);
+    auto splatToEvalPt = [&](int i, GreensFnFreeSpace<DIM>& greensFn) {
+        // don't evaluate if the distance to the boundary is smaller than the cutoff distance
+        if (evalPts.distToAbsorbingBoundary[i] < cutoffDistToAbsorbingBoundary ||
+            evalPts.distToReflectingBoundary[i] < cutoffDistToReflectingBoundary) return;
+
+        splatSampleData(samplePt, greensFn, radiusClamp, kernelRegularization,
+                        robinCoeffCutoffForNormalDerivative, evalPts.pt[i], evalPts.type[i],
+                        evalPts.getStatistics(i, category));
+    };
+
+    int nEvalPoints = evalPts.size();
     if (runSingleThreaded) {
+        std::unique_ptr<GreensFnFreeSpace<DIM>> greensFn = createGreensFn(pde);
         for (int i = 0; i < nEvalPoints; i++) {
-            splat(pde, samplePt, radiusClamp, kernelRegularization,
-                  robinCoeffCutoffForNormalDerivative, cutoffDistToAbsorbingBoundary,
-                  cutoffDistToReflectingBoundary, evalPts[i]);
+            splatToEvalPt(i, *greensFn);
         }
 
     } else {
         auto run = [&](const tbb::blocked_range<int>& range) {
+            std::unique_ptr<GreensFnFreeSpace<DIM>> greensFn = createGreensFn(pde);
             for (int i = range.begin(); i < range.end(); ++i) {
-                splat(pde, samplePt, radiusClamp, kernelRegularization,
-                      robinCoeffCutoffForNormalDerivative, cutoffDistToAbsorbingBoundary,
-                      cutoffDistToReflectingBoundary, evalPts[i]);
+                splatToEvalPt(i, *greensFn);
             }
         };
 
@@ -391,83 +739,279 @@ inline void BoundaryValueCaching<T, DIM>::splat(const PDE<T, DIM>& pde,
     }
 }
 
-template <typename T, size_t DIM>
-inline void BoundaryValueCaching<T, DIM>::splat(const PDE<T, DIM>& pde,
-                                                const std::vector<SamplePoint<T, DIM>>& samplePts,
-                                                float radiusClamp,
-                                                float kernelRegularization,
-                                                float robinCoeffCutoffForNormalDerivative,
-                                                float cutoffDistToAbsorbingBoundary,
-                                                float cutoffDistToReflectingBoundary,
-                                                std::vector<EvaluationPoint<T, DIM>>& evalPts,
-                                                std::function<void(int, int)> reportProgress) const
-{
-    const int reportGranularity = 100;
-    for (int i = 0; i < (int)samplePts.size(); i++) {
-        splat(pde, samplePts[i], radiusClamp, kernelRegularization,
-              robinCoeffCutoffForNormalDerivative, cutoffDistToAbsorbingBoundary,
-              cutoffDistToReflectingBoundary, evalPts);
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::splat(const PDE<T, DIM>& pde,
+                                                          const std::vector<SamplePoint<T, DIM>>& samplePts,
+                                                          float radiusClamp,
+                                                          float kernelRegularization,
+                                                          float robinCoeffCutoffForNormalDerivative,
+                                                          float cutoffDistToAbsorbingBoundary,
+                                                          float cutoffDistToReflectingBoundary,
+                                                          EvaluationPoints<T, DIM>& evalPts,
+                                                          std::function<void(int, int)> reportProgress) const
+{
+    // group sample pts by category, since each category is accumulated into separate statistics
+    int nSamplePoints = (int)samplePts.size();
+    std::vector<int> indices(nSamplePoints);
+    for (int i = 0; i < nSamplePoints; i++) indices[i] = i;
+    std::stable_sort(indices.begin(), indices.end(), [&samplePts](int a, int b) -> bool {
+        return getSplatCategory(samplePts[a]) < getSplatCategory(samplePts[b]);
+    });
+
+    // splat batches of sample pts from the same category
+    SplatSampleBatch<T, DIM> batch;
+    int start = 0;
+    while (start < nSamplePoints) {
+        SplatCategory category = getSplatCategory(samplePts[indices[start]]);
+        int end = start + 1;
+        while (end < nSamplePoints && end - start < BVC_SPLAT_BATCH_SIZE &&
+               getSplatCategory(samplePts[indices[end]]) == category) end++;
+
+        batch.set(samplePts, indices, start, end, robinCoeffCutoffForNormalDerivative);
+        splatBatch(batch, category, pde.absorptionCoeff, radiusClamp, kernelRegularization,
+                   cutoffDistToAbsorbingBoundary, cutoffDistToReflectingBoundary, evalPts);
+
+        if (reportProgress) reportProgress(end - start, 0);
+        start = end;
+    }
+}
 
-        if (reportProgress && (i + 1)%reportGranularity == 0) {
-            reportProgress(reportGranularity, 0);
-        }
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::splatUpdates(const PDE<T, DIM>& pde,
+                                                                 const std::vector<SamplePoint<T, DIM>>& prevSamplePts,
+                                                                 const std::vector<SamplePoint<T, DIM>>& samplePts,
+                                                                 float radiusClamp,
+                                                                 float kernelRegularization,
+                                                                 float robinCoeffCutoffForNormalDerivative,
+                                                                 float cutoffDistToAbsorbingBoundary,
+                                                                 float cutoffDistToReflectingBoundary,
+                                                                 EvaluationPoints<T, DIM>& evalPts,
+                                                                 std::function<void(int, int)> reportProgress) const
+{
+    if (prevSamplePts.size() != samplePts.size()) {
+        std::cerr << "BoundaryValueCaching::splatUpdates(): Sample point counts do not match!" << std::endl;
+        exit(EXIT_FAILURE);
     }
 
-    if (reportProgress) {
-        reportProgress(samplePts.size()%reportGranularity, 0);
+    int nSamplePoints = (int)samplePts.size();
+    // group sample pts by category, and splat the change in the splat weights of batches of
+    // sample pts directly into the existing statistics without counting them as new estimates
+    std::vector<int> indices(nSamplePoints);
+    for (int i = 0; i < nSamplePoints; i++) indices[i] = i;
+    std::stable_sort(indices.begin(), indices.end(), [&samplePts](int a, int b) -> bool {
+        return getSplatCategory(samplePts[a]) < getSplatCategory(samplePts[b]);
+    });
+
+    SplatSampleBatch<T, DIM> batch;
+    int start = 0;
+    while (start < nSamplePoints) {
+        SplatCategory category = getSplatCategory(samplePts[indices[start]]);
+        int end = start + 1;
+        while (end < nSamplePoints && end - start < BVC_SPLAT_BATCH_SIZE &&
+               getSplatCategory(samplePts[indices[end]]) == category) end++;
+
+        batch.setChanges(prevSamplePts, samplePts, indices, start, end, robinCoeffCutoffForNormalDerivative);
+        splatBatch(batch, category, pde.absorptionCoeff, radiusClamp, kernelRegularization,
+                   cutoffDistToAbsorbingBoundary, cutoffDistToReflectingBoundary, evalPts, true);
+
+        if (reportProgress) reportProgress(end - start, 0);
+        start = end;
     }
 }
 
-template <typename T, size_t DIM>
-inline void BoundaryValueCaching<T, DIM>::estimateSolutionNearBoundary(const PDE<T, DIM>& pde,
-                                                                       const WalkSettings& walkSettings,
-                                                                       bool useDistanceToAbsorbingBoundary,
-                                                                       float cutoffDistToBoundary, int nWalks,
-                                                                       EvaluationPoint<T, DIM>& evalPt) const
-{
-    float distToBoundary = useDistanceToAbsorbingBoundary ? evalPt.distToAbsorbingBoundary :
-                                                            evalPt.distToReflectingBoundary;
-    if (distToBoundary < cutoffDistToBoundary) {
-        // NOTE: When the evaluation pt is on the boundary, this setup
-        // evaluates the inward boundary normal aligned solution
-        SamplePoint<T, DIM> samplePt(evalPt.pt, evalPt.normal, evalPt.type, 1.0f,
-                                     evalPt.distToAbsorbingBoundary,
-                                     evalPt.distToReflectingBoundary);
-        SampleEstimationData<DIM> estimationData(nWalks, EstimationQuantity::Solution);
-        walkOnStars.solve(pde, walkSettings, estimationData, samplePt);
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::splat(const PDE<T, DIM>& pde,
+                                                          const SplatTree<T, DIM>& splatTree,
+                                                          float openingAngle,
+                                                          float radiusClamp,
+                                                          float kernelRegularization,
+                                                          float cutoffDistToAbsorbingBoundary,
+                                                          float cutoffDistToReflectingBoundary,
+                                                          EvaluationPoint<T, DIM>& evalPt) const
+{
+    // don't evaluate if the distance to the boundary is smaller than the cutoff distance
+    if (evalPt.distToAbsorbingBoundary < cutoffDistToAbsorbingBoundary ||
+        evalPt.distToReflectingBoundary < cutoffDistToReflectingBoundary) return;
+
+    // evaluate
+    SplatStatistics<T, DIM> *statistics[SPLAT_CATEGORY_COUNT];
+    for (int c = 0; c < SPLAT_CATEGORY_COUNT; c++) {
+        statistics[c] = &evalPt.getStatistics((SplatCategory)c);
+    }
+
+    std::unique_ptr<GreensFnFreeSpace<DIM>> greensFn = createGreensFn(pde);
+    splatTreeData(pde, splatTree, *greensFn, openingAngle, radiusClamp, kernelRegularization,
+                  evalPt.pt, evalPt.type, statistics);
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::splat(const PDE<T, DIM>& pde,
+                                                          const SplatTree<T, DIM>& splatTree,
+                                                          float openingAngle,
+                                                          float radiusClamp,
+                                                          float kernelRegularization,
+                                                          float cutoffDistToAbsorbingBoundary,
+                                                          float cutoffDistToReflectingBoundary,
+                                                          EvaluationPoints<T, DIM>& evalPts,
+                                                          bool runSingleThreaded) const
+{
+    auto splatToEvalPt = [&](int i, GreensFnFreeSpace<DIM>& greensFn) {
+        // don't evaluate if the distance to the boundary is smaller than the cutoff distance
+        if (evalPts.distToAbsorbingBoundary[i] < cutoffDistToAbsorbingBoundary ||
+            evalPts.distToReflectingBoundary[i] < cutoffDistToReflectingBoundary) return;
+
+        SplatStatistics<T, DIM> *statistics[SPLAT_CATEGORY_COUNT];
+        for (int c = 0; c < SPLAT_CATEGORY_COUNT; c++) {
+            statistics[c] = &evalPts.getStatistics(i, (SplatCategory)c);
+        }
 
+        splatTreeData(pde, splatTree, greensFn, openingAngle, radiusClamp, kernelRegularization,
+                      evalPts.pt[i], evalPts.type[i], statistics);
+    };
+
+    int nEvalPoints = evalPts.size();
+    if (runSingleThreaded) {
+        std::unique_ptr<GreensFnFreeSpace<DIM>> greensFn = createGreensFn(pde);
+        for (int i = 0; i < nEvalPoints; i++) {
+            splatToEvalPt(i, *greensFn);
+        }
+
+    } else {
+        auto run = [&](const tbb::blocked_range<int>& range) {
+            std::unique_ptr<GreensFnFreeSpace<DIM>> greensFn = createGreensFn(pde);
+            for (int i = range.begin(); i < range.end(); ++i) {
+                splatToEvalPt(i, *greensFn);
+            }
+        };
+
+        tbb::blocked_range<int> range(0, nEvalPoints);
+        tbb::parallel_for(range, run);
+    }
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::estimateSolutionNearBoundary(const PDE<T, DIM>& pde,
+                                                                                 const WalkSettings& walkSettings,
+                                                                                 bool useDistanceToAbsorbingBoundary,
+                                                                                 float cutoffDistToBoundary, int nWalks,
+                                                                                 EvaluationPoint<T, DIM>& evalPt) const
+{
+    T solutionEstimate;
+    if (estimateSolutionNearBoundary(pde, walkSettings, useDistanceToAbsorbingBoundary,
+                                     cutoffDistToBoundary, nWalks, evalPt.pt, evalPt.normal,
+                                     evalPt.type, evalPt.distToAbsorbingBoundary,
+                                     evalPt.distToReflectingBoundary, solutionEstimate)) {
         // update statistics
         evalPt.reset();
-        T solutionEstimate = samplePt.statistics->getEstimatedSolution();
-        if (evalPt.type == SampleType::OnAbsorbingBoundary) {
+        if (evalPt.type == SampleType::OnAbsorbingBoundary ||
+            (evalPt.type == SampleType::InDomain && useDistanceToAbsorbingBoundary)) {
             evalPt.absorbingBoundaryStatistics->addSolutionEstimate(solutionEstimate);
 
-        } else if (evalPt.type == SampleType::OnReflectingBoundary) {
+        } else {
             evalPt.reflectingBoundaryStatistics->addSolutionEstimate(solutionEstimate);
         }
     }
 }
 
-template <typename T, size_t DIM>
-inline void BoundaryValueCaching<T, DIM>::estimateSolutionNearBoundary(const PDE<T, DIM>& pde,
-                                                                       const WalkSettings& walkSettings,
-                                                                       bool useDistanceToAbsorbingBoundary,
-                                                                       float cutoffDistToBoundary, int nWalks,
-                                                                       std::vector<EvaluationPoint<T, DIM>>& evalPts,
-                                                                       bool runSingleThreaded) const
-{
-    int nEvalPoints = (int)evalPts.size();
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::estimateSolutionNearBoundary(const PDE<T, DIM>& pde,
+                                                                                 const WalkSettings& walkSettings,
+                                                                                 bool useDistanceToAbsorbingBoundary,
+                                                                                 float cutoffDistToBoundary, int nWalks,
+                                                                                 EvaluationPoints<T, DIM>& evalPts,
+                                                                                 bool runSingleThreaded) const
+{
+    auto estimateAtEvalPt = [&](int i) {
+        T solutionEstimate;
+        if (estimateSolutionNearBoundary(pde, walkSettings, useDistanceToAbsorbingBoundary,
+                                         cutoffDistToBoundary, nWalks, evalPts.pt[i], evalPts.normal[i],
+                                         evalPts.type[i], evalPts.distToAbsorbingBoundary[i],
+                                         evalPts.distToReflectingBoundary[i], solutionEstimate)) {
+            // update statistics
+            evalPts.reset(i);
+            if (evalPts.type[i] == SampleType::OnAbsorbingBoundary ||
+                (evalPts.type[i] == SampleType::InDomain && useDistanceToAbsorbingBoundary)) {
+                evalPts.getStatistics(i, SplatCategory::AbsorbingBoundary).addSolutionEstimate(solutionEstimate);
+
+            } else {
+                evalPts.getStatistics(i, SplatCategory::ReflectingBoundary).addSolutionEstimate(solutionEstimate);
+            }
+        }
+    };
+
+    int nEvalPoints = evalPts.size();
     if (runSingleThreaded) {
         for (int i = 0; i < nEvalPoints; i++) {
+            estimateAtEvalPt(i);
+        }
+
+    } else {
+        auto run = [&](const tbb::blocked_range<int>& range) {
+            for (int i = range.begin(); i < range.end(); ++i) {
+                estimateAtEvalPt(i);
+            }
+        };
+
+        tbb::blocked_range<int> range(0, nEvalPoints);
+        tbb::parallel_for(range, run);
+    }
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+template <typename NearestNeighborFinder>
+inline void BoundaryValueCaching<T, DIM, Quantity>::estimateSolutionNearBoundary(const PDE<T, DIM>& pde,
+                                                                                 const WalkSettings& walkSettings,
+                                                                                 bool useDistanceToAbsorbingBoundary,
+                                                                                 float cutoffDistToBoundary, int nWalks,
+                                                                                 const std::vector<SamplePoint<T, DIM>>& boundaryCache,
+                                                                                 const NearestNeighborFinder& boundaryCacheFinder,
+                                                                                 int nNearestCachedSamples,
+                                                                                 float maxDistToCachedSample,
+                                                                                 EvaluationPoints<T, DIM>& evalPts,
+                                                                                 bool runSingleThreaded) const
+{
+    auto estimateAtEvalPt = [&](int i, std::vector<size_t>& nnIndices) {
+        float distToBoundary = useDistanceToAbsorbingBoundary ? evalPts.distToAbsorbingBoundary[i] :
+                                                                evalPts.distToReflectingBoundary[i];
+        if (distToBoundary >= cutoffDistToBoundary) return;
+
+        // interpolate the boundary cache if it is dense enough around the evaluation pt,
+        // and otherwise fall back to walk-on-stars
+        T solutionEstimate;
+        if (evalPts.type[i] != SampleType::InDomain ||
+            !interpolateBoundaryCache(pde, walkSettings, useDistanceToAbsorbingBoundary,
+                                      boundaryCache, boundaryCacheFinder, nNearestCachedSamples,
+                                      maxDistToCachedSample, evalPts.pt[i], distToBoundary,
+                                      nnIndices, solutionEstimate)) {
             estimateSolutionNearBoundary(pde, walkSettings, useDistanceToAbsorbingBoundary,
-                                         cutoffDistToBoundary, nWalks, evalPts[i]);
+                                         cutoffDistToBoundary, nWalks, evalPts.pt[i], evalPts.normal[i],
+                                         evalPts.type[i], evalPts.distToAbsorbingBoundary[i],
+                                         evalPts.distToReflectingBoundary[i], solutionEstimate);
+        }
+
+        // update statistics
+        evalPts.reset(i);
+        if (evalPts.type[i] == SampleType::OnAbsorbingBoundary ||
+            (evalPts.type[i] == SampleType::InDomain && useDistanceToAbsorbingBoundary)) {
+            evalPts.getStatistics(i, SplatCategory::AbsorbingBoundary).addSolutionEstimate(solutionEstimate);
+
+        } else {
+            evalPts.getStatistics(i, SplatCategory::ReflectingBoundary).addSolutionEstimate(solutionEstimate);
+        }
+    };
+
+    int nEvalPoints = evalPts.size();
+    if (runSingleThreaded) {
+        std::vector<size_t> nnIndices;
+        for (int i = 0; i < nEvalPoints; i++) {
+            estimateAtEvalPt(i, nnIndices);
         }
 
     } else {
         auto run = [&](const tbb::blocked_range<int>& range) {
+            std::vector<size_t> nnIndices;
             for (int i = range.begin(); i < range.end(); ++i) {
-                estimateSolutionNearBoundary(pde, walkSettings, useDistanceToAbsorbingBoundary,
-                                             cutoffDistToBoundary, nWalks, evalPts[i]);
+                estimateAtEvalPt(i, nnIndices);
             }
         };
 
@@ -476,15 +1020,15 @@ inline void BoundaryValueCaching<T, DIM>::estimateSolutionNearBoundary(const PDE
     }
 }
 
-template <typename T, size_t DIM>
-inline void BoundaryValueCaching<T, DIM>::setEstimationData(const PDE<T, DIM>& pde,
-                                                            const WalkSettings& walkSettings,
-                                                            int nWalksForSolutionEstimates,
-                                                            int nWalksForGradientEstimates,
-                                                            float robinCoeffCutoffForNormalDerivative,
-                                                            bool useFiniteDifferences,
-                                                            std::vector<SampleEstimationData<DIM>>& estimationData,
-                                                            std::vector<SamplePoint<T, DIM>>& samplePts) const
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::setEstimationData(const PDE<T, DIM>& pde,
+                                                                      const WalkSettings& walkSettings,
+                                                                      int nWalksForSolutionEstimates,
+                                                                      int nWalksForGradientEstimates,
+                                                                      float robinCoeffCutoffForNormalDerivative,
+                                                                      bool useFiniteDifferences,
+                                                                      std::vector<SampleEstimationData<DIM>>& estimationData,
+                                                                      std::vector<SamplePoint<T, DIM>>& samplePts) const
 {
     int nSamples = (int)samplePts.size();
     estimationData.resize(nSamples);
@@ -537,12 +1081,12 @@ inline void BoundaryValueCaching<T, DIM>::setEstimationData(const PDE<T, DIM>& p
     }
 }
 
-template <typename T, size_t DIM>
-inline void BoundaryValueCaching<T, DIM>::setEstimatedBoundaryData(const PDE<T, DIM>& pde,
-                                                                   const WalkSettings& walkSettings,
-                                                                   float robinCoeffCutoffForNormalDerivative,
-                                                                   bool useFiniteDifferences,
-                                                                   std::vector<SamplePoint<T, DIM>>& samplePts) const
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::setEstimatedBoundaryData(const PDE<T, DIM>& pde,
+                                                                             const WalkSettings& walkSettings,
+                                                                             float robinCoeffCutoffForNormalDerivative,
+                                                                             bool useFiniteDifferences,
+                                                                             std::vector<SamplePoint<T, DIM>>& samplePts) const
 {
     for (int i = 0; i < (int)samplePts.size(); i++) {
         SamplePoint<T, DIM>& samplePt = samplePts[i];
@@ -587,13 +1131,48 @@ inline void BoundaryValueCaching<T, DIM>::setEstimatedBoundaryData(const PDE<T,
     }
 }
 
-template <typename T, size_t DIM>
-inline void BoundaryValueCaching<T, DIM>::splatBoundaryData(const SamplePoint<T, DIM>& samplePt,
-                                                            const std::unique_ptr<GreensFnFreeSpace<DIM>>& greensFn,
-                                                            float radiusClamp,
-                                                            float kernelRegularization,
-                                                            float robinCoeffCutoffForNormalDerivative,
-                                                            EvaluationPoint<T, DIM>& evalPt) const
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline std::unique_ptr<GreensFnFreeSpace<DIM>> BoundaryValueCaching<T, DIM, Quantity>::createGreensFn(const PDE<T, DIM>& pde) const
+{
+    if (pde.absorptionCoeff > 0.0f) {
+        return std::make_unique<YukawaGreensFnFreeSpace<DIM>>(pde.absorptionCoeff);
+    }
+
+    return std::make_unique<HarmonicGreensFnFreeSpace<DIM>>();
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::splatSampleData(const SamplePoint<T, DIM>& samplePt,
+                                                                    GreensFnFreeSpace<DIM>& greensFn,
+                                                                    float radiusClamp,
+                                                                    float kernelRegularization,
+                                                                    float robinCoeffCutoffForNormalDerivative,
+                                                                    const Vector<DIM>& x,
+                                                                    SampleType evalPtType,
+                                                                    SplatStatistics<T, DIM>& statistics) const
+{
+    greensFn.updatePole(x);
+
+    // evaluate
+    if (samplePt.type == SampleType::OnAbsorbingBoundary ||
+        samplePt.type == SampleType::OnReflectingBoundary) {
+        splatBoundaryData(samplePt, greensFn, radiusClamp, kernelRegularization,
+                          robinCoeffCutoffForNormalDerivative, evalPtType, statistics);
+
+    } else {
+        splatSourceData(samplePt, greensFn, radiusClamp, kernelRegularization,
+                        evalPtType, statistics);
+    }
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::splatBoundaryData(const SamplePoint<T, DIM>& samplePt,
+                                                                      const GreensFnFreeSpace<DIM>& greensFn,
+                                                                      float radiusClamp,
+                                                                      float kernelRegularization,
+                                                                      float robinCoeffCutoffForNormalDerivative,
+                                                                      SampleType evalPtType,
+                                                                      SplatStatistics<T, DIM>& statistics) const
 {
     // compute the contribution of the boundary sample
     const T& solution = samplePt.solution;
@@ -604,17 +1183,18 @@ inline void BoundaryValueCaching<T, DIM>::splatBoundaryData(const SamplePoint<T,
     float pdf = samplePt.pdf;
     float robinCoeff = samplePt.robinCoeff;
 
-    float r = std::max(radiusClamp, (pt - greensFn->x).norm());
-    float G = greensFn->evaluate(r);
-    float P = greensFn->poissonKernel(r, pt, n);
-    Vector<DIM> dG = greensFn->gradient(r, pt);
-    Vector<DIM> dP = greensFn->poissonKernelGradient(r, pt, n);
-    float dGNorm = dG.norm();
-    float dPNorm = dP.norm();
-
-    if (std::isinf(G) || std::isinf(P) || std::isinf(dGNorm) || std::isinf(dPNorm) ||
-        std::isnan(G) || std::isnan(P) || std::isnan(dGNorm) || std::isnan(dPNorm)) {
-        return;
+    float r = std::max(radiusClamp, (pt - greensFn.x).norm());
+    float G = greensFn.evaluate(r);
+    float P = greensFn.poissonKernel(r, pt, n);
+    if (std::isinf(G) || std::isinf(P) || std::isnan(G) || std::isnan(P)) return;
+
+    Vector<DIM> dG, dP;
+    if constexpr (estimateGradient) {
+        dG = greensFn.gradient(r, pt);
+        dP = greensFn.poissonKernelGradient(r, pt, n);
+        float dGNorm = dG.norm();
+        float dPNorm = dP.norm();
+        if (std::isinf(dGNorm) || std::isinf(dPNorm) || std::isnan(dGNorm) || std::isnan(dPNorm)) return;
     }
 
     if (kernelRegularization > 0.0f) {
@@ -625,77 +1205,68 @@ inline void BoundaryValueCaching<T, DIM>::splatBoundaryData(const SamplePoint<T,
 
     T solutionEstimate;
     T gradientEstimate[DIM];
-    float alpha = evalPt.type == SampleType::OnAbsorbingBoundary ||
-                  evalPt.type == SampleType::OnReflectingBoundary ?
+    float alpha = evalPtType == SampleType::OnAbsorbingBoundary ||
+                  evalPtType == SampleType::OnReflectingBoundary ?
                   2.0f : 1.0f;
 
     if (robinCoeff > robinCoeffCutoffForNormalDerivative) {
         solutionEstimate = alpha*((G + P/robinCoeff)*normalDerivative - P*robin/robinCoeff)/pdf;
 
-        if (alpha > 1.0f) alpha = 0.0f; // FUTURE: estimate gradient on the boundary
-        for (int i = 0; i < DIM; i++) {
-            gradientEstimate[i] = alpha*((dG[i] + dP[i]/robinCoeff)*normalDerivative - dP[i]*robin/robinCoeff)/pdf;
+        if constexpr (estimateGradient) {
+            if (alpha > 1.0f) alpha = 0.0f; // FUTURE: estimate gradient on the boundary
+            for (int i = 0; i < DIM; i++) {
+                gradientEstimate[i] = alpha*((dG[i] + dP[i]/robinCoeff)*normalDerivative - dP[i]*robin/robinCoeff)/pdf;
+            }
         }
 
     } else if (robinCoeff > 0.0f) {
         solutionEstimate = alpha*(G*robin - (P + robinCoeff*G)*solution)/pdf;
 
-        if (alpha > 1.0f) alpha = 0.0f; // FUTURE: estimate gradient on the boundary
-        for (int i = 0; i < DIM; i++) {
-            gradientEstimate[i] = alpha*(dG[i]*robin - (dP[i] + robinCoeff*dG[i])*solution)/pdf;
+        if constexpr (estimateGradient) {
+            if (alpha > 1.0f) alpha = 0.0f; // FUTURE: estimate gradient on the boundary
+            for (int i = 0; i < DIM; i++) {
+                gradientEstimate[i] = alpha*(dG[i]*robin - (dP[i] + robinCoeff*dG[i])*solution)/pdf;
+            }
         }
 
     } else {
         solutionEstimate = alpha*(G*normalDerivative - P*solution)/pdf;
 
-        if (alpha > 1.0f) alpha = 0.0f; // FUTURE: estimate gradient on the boundary
-        for (int i = 0; i < DIM; i++) {
-            gradientEstimate[i] = alpha*(dG[i]*normalDerivative - dP[i]*solution)/pdf;
+        if constexpr (estimateGradient) {
+            if (alpha > 1.0f) alpha = 0.0f; // FUTURE: estimate gradient on the boundary
+            for (int i = 0; i < DIM; i++) {
+                gradientEstimate[i] = alpha*(dG[i]*normalDerivative - dP[i]*solution)/pdf;
+            }
         }
     }
 
     // update statistics
-    if (samplePt.estimateBoundaryNormalAligned) {
-        if (samplePt.type == SampleType::OnAbsorbingBoundary) {
-            evalPt.absorbingBoundaryNormalAlignedStatistics->addSolutionEstimate(solutionEstimate);
-            evalPt.absorbingBoundaryNormalAlignedStatistics->addGradientEstimate(gradientEstimate);
-
-        } else if (samplePt.type == SampleType::OnReflectingBoundary) {
-            evalPt.reflectingBoundaryNormalAlignedStatistics->addSolutionEstimate(solutionEstimate);
-            evalPt.reflectingBoundaryNormalAlignedStatistics->addGradientEstimate(gradientEstimate);
-        }
-
-    } else {
-        if (samplePt.type == SampleType::OnAbsorbingBoundary) {
-            evalPt.absorbingBoundaryStatistics->addSolutionEstimate(solutionEstimate);
-            evalPt.absorbingBoundaryStatistics->addGradientEstimate(gradientEstimate);
-
-        } else if (samplePt.type == SampleType::OnReflectingBoundary) {
-            evalPt.reflectingBoundaryStatistics->addSolutionEstimate(solutionEstimate);
-            evalPt.reflectingBoundaryStatistics->addGradientEstimate(gradientEstimate);
-        }
-    }
+    statistics.addSolutionEstimate(solutionEstimate);
+    if constexpr (estimateGradient) statistics.addGradientEstimate(gradientEstimate);
 }
 
-template <typename T, size_t DIM>
-inline void BoundaryValueCaching<T, DIM>::splatSourceData(const SamplePoint<T, DIM>& samplePt,
-                                                          const std::unique_ptr<GreensFnFreeSpace<DIM>>& greensFn,
-                                                          float radiusClamp,
-                                                          float kernelRegularization,
-                                                          EvaluationPoint<T, DIM>& evalPt) const
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::splatSourceData(const SamplePoint<T, DIM>& samplePt,
+                                                                    const GreensFnFreeSpace<DIM>& greensFn,
+                                                                    float radiusClamp,
+                                                                    float kernelRegularization,
+                                                                    SampleType evalPtType,
+                                                                    SplatStatistics<T, DIM>& statistics) const
 {
     // compute the contribution of the source sample
     const T& source = samplePt.source;
     const Vector<DIM>& pt = samplePt.pt;
     float pdf = samplePt.pdf;
 
-    float r = std::max(radiusClamp, (pt - greensFn->x).norm());
-    float G = greensFn->evaluate(r);
-    Vector<DIM> dG = greensFn->gradient(r, pt);
-    float dGNorm = dG.norm();
+    float r = std::max(radiusClamp, (pt - greensFn.x).norm());
+    float G = greensFn.evaluate(r);
+    if (std::isinf(G) || std::isnan(G)) return;
 
-    if (std::isinf(G) || std::isnan(G) || std::isinf(dGNorm) || std::isnan(dGNorm)) {
-        return;
+    Vector<DIM> dG;
+    if constexpr (estimateGradient) {
+        dG = greensFn.gradient(r, pt);
+        float dGNorm = dG.norm();
+        if (std::isinf(dGNorm) || std::isnan(dGNorm)) return;
     }
 
     if (kernelRegularization > 0.0f) {
@@ -703,20 +1274,680 @@ inline void BoundaryValueCaching<T, DIM>::splatSourceData(const SamplePoint<T, D
         G *= KernelRegularization<DIM>::regularizationForGreensFn(r);
     }
 
-    float alpha = evalPt.type == SampleType::OnAbsorbingBoundary ||
-                  evalPt.type == SampleType::OnReflectingBoundary ?
+    float alpha = evalPtType == SampleType::OnAbsorbingBoundary ||
+                  evalPtType == SampleType::OnReflectingBoundary ?
                   2.0f : 1.0f;
     T solutionEstimate = alpha*G*source/pdf;
 
-    T gradientEstimate[DIM];
-    if (alpha > 1.0f) alpha = 0.0f; // FUTURE: estimate gradient on the boundary
+    // update statistics
+    statistics.addSolutionEstimate(solutionEstimate);
+    if constexpr (estimateGradient) {
+        T gradientEstimate[DIM];
+        if (alpha > 1.0f) alpha = 0.0f; // FUTURE: estimate gradient on the boundary
+        for (int i = 0; i < DIM; i++) {
+            gradientEstimate[i] = alpha*dG[i]*source/pdf;
+        }
+
+        statistics.addGradientEstimate(gradientEstimate);
+    }
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::splatTreeData(const PDE<T, DIM>& pde,
+                                                                  const SplatTree<T, DIM>& splatTree,
+                                                                  GreensFnFreeSpace<DIM>& greensFn,
+                                                                  float openingAngle,
+                                                                  float radiusClamp,
+                                                                  float kernelRegularization,
+                                                                  const Vector<DIM>& x,
+                                                                  SampleType evalPtType,
+                                                                  SplatStatistics<T, DIM> **statistics) const
+{
+    greensFn.updatePole(x);
+    const YukawaGreensFnFreeSpace<DIM> *yukawaGreensFn = nullptr;
+    if (pde.absorptionCoeff > 0.0f) {
+        yukawaGreensFn = static_cast<const YukawaGreensFnFreeSpace<DIM> *>(&greensFn);
+    }
+
+    // clusters closer than this distance are affected by the radius clamp or the kernel
+    // regularization, which the multipole expansion does not account for
+    float minFarFieldDist = std::max(radiusClamp, 4.0f*kernelRegularization);
+    float alpha = evalPtType == SampleType::OnAbsorbingBoundary ||
+                  evalPtType == SampleType::OnReflectingBoundary ?
+                  2.0f : 1.0f;
+
+    for (int c = 0; c < SPLAT_CATEGORY_COUNT; c++) {
+        if (splatTree.rootIndex[c] < 0) continue;
+
+        SplatAccumulator<T, DIM> accumulator;
+        accumulator.reset();
+
+        int stack[SPLAT_TREE_MAX_DEPTH + 1];
+        int stackSize = 0;
+        stack[stackSize++] = splatTree.rootIndex[c];
+
+        while (stackSize > 0) {
+            int nodeIndex = stack[--stackSize];
+            const SplatTreeNode<T, DIM>& node = splatTree.nodes[nodeIndex];
+            float r = (node.center - x).norm();
+
+            if (r*openingAngle > node.radius && r - node.radius > minFarFieldDist) {
+                // approximate the cluster by its multipole expansion
+                splatClusterData(node, x, pde.absorptionCoeff, alpha,
+                                 accumulator.solution, accumulator.gradient);
+                accumulator.count += node.nReferences;
+
+            } else if (node.secondChildOffset == 0) {
+                // splat the leaf's sample pts directly; they are contiguous in the tree
+                int end = node.referenceOffset + node.nReferences;
+                for (int start = node.referenceOffset; start < end; start += BVC_SPLAT_BLOCK_SIZE) {
+                    int blockEnd = std::min(start + BVC_SPLAT_BLOCK_SIZE, end);
+                    if (yukawaGreensFn) {
+                        accumulateYukawaBlock(splatTree.samples, start, blockEnd, *yukawaGreensFn, alpha,
+                                              radiusClamp, kernelRegularization, accumulator);
+
+                    } else {
+                        accumulateHarmonicBlock(splatTree.samples, start, blockEnd, x, alpha,
+                                                radiusClamp, kernelRegularization, accumulator);
+                    }
+                }
+
+            } else {
+                stack[stackSize++] = nodeIndex + node.secondChildOffset;
+                stack[stackSize++] = nodeIndex + 1;
+            }
+        }
+
+        // update statistics
+        statistics[c]->addSolutionEstimateSum(accumulator.solution, accumulator.count);
+        if constexpr (estimateGradient) {
+            statistics[c]->addGradientEstimateSums(accumulator.gradient, accumulator.count);
+        }
+    }
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline bool BoundaryValueCaching<T, DIM, Quantity>::estimateSolutionNearBoundary(const PDE<T, DIM>& pde,
+                                                                                 const WalkSettings& walkSettings,
+                                                                                 bool useDistanceToAbsorbingBoundary,
+                                                                                 float cutoffDistToBoundary, int nWalks,
+                                                                                 const Vector<DIM>& pt,
+                                                                                 const Vector<DIM>& normal,
+                                                                                 SampleType type,
+                                                                                 float distToAbsorbingBoundary,
+                                                                                 float distToReflectingBoundary,
+                                                                                 T& solutionEstimate) const
+{
+    float distToBoundary = useDistanceToAbsorbingBoundary ? distToAbsorbingBoundary :
+                                                            distToReflectingBoundary;
+    if (distToBoundary >= cutoffDistToBoundary) return false;
+
+    // NOTE: When the evaluation pt is on the boundary, this setup
+    // evaluates the inward boundary normal aligned solution
+    SamplePoint<T, DIM> samplePt(pt, normal, type, 1.0f,
+                                 distToAbsorbingBoundary,
+                                 distToReflectingBoundary);
+    SampleEstimationData<DIM> estimationData(nWalks, EstimationQuantity::Solution);
+    walkOnStars.solve(pde, walkSettings, estimationData, samplePt);
+    solutionEstimate = samplePt.statistics->getEstimatedSolution();
+
+    return true;
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+template <typename NearestNeighborFinder>
+inline bool BoundaryValueCaching<T, DIM, Quantity>::interpolateBoundaryCache(const PDE<T, DIM>& pde,
+                                                                             const WalkSettings& walkSettings,
+                                                                             bool useDistanceToAbsorbingBoundary,
+                                                                             const std::vector<SamplePoint<T, DIM>>& boundaryCache,
+                                                                             const NearestNeighborFinder& boundaryCacheFinder,
+                                                                             int nNearestCachedSamples,
+                                                                             float maxDistToCachedSample,
+                                                                             const Vector<DIM>& pt,
+                                                                             float distToBoundary,
+                                                                             std::vector<size_t>& nnIndices,
+                                                                             T& solutionEstimate) const
+{
+    size_t k = std::min((size_t)nNearestCachedSamples, boundaryCache.size());
+    if (k == 0) return false;
+
+    // project the evaluation pt onto the boundary; the cached estimates vary along the boundary,
+    // while their variation across it is accounted for by the blend with the boundary value below
+    Vector<DIM> boundaryPt = pt;
+    Vector<DIM> boundaryNormal;
+    float signedDistance;
+    if (useDistanceToAbsorbingBoundary) {
+        queries.projectToAbsorbingBoundary(boundaryPt, boundaryNormal, signedDistance,
+                                           walkSettings.solveDoubleSided);
+
+    } else {
+        queries.projectToReflectingBoundary(boundaryPt, boundaryNormal, signedDistance,
+                                            walkSettings.solveDoubleSided);
+    }
+
+    // average the cached estimates at the nearest sample pts, weighted by the inverse squared
+    // distance along the boundary between each sample pt and the projected evaluation pt, i.e.,
+    // ignoring their offsets along the boundary normal. Sample pts that are occluded by the
+    // boundary or that estimate the solution on the opposite side of a reflecting boundary
+    // are ignored
+    size_t nnCount = boundaryCacheFinder.kNearest(pt, k, nnIndices);
+    T totalCachedSolution(0.0f);
+    float totalWeight = 0.0f;
+    float totalCachedDistToBoundary = 0.0f;
+    for (size_t j = 0; j < nnCount; j++) {
+        const SamplePoint<T, DIM>& samplePt = boundaryCache[nnIndices[j]];
+        Vector<DIM> dir = samplePt.pt - pt;
+        float r = dir.norm();
+        if (r > maxDistToCachedSample) continue;
+
+        if (samplePt.type == SampleType::OnReflectingBoundary) {
+            bool onNormalAlignedSide = samplePt.normal.dot(dir) < 0.0f;
+            if (onNormalAlignedSide != samplePt.estimateBoundaryNormalAligned) continue;
+        }
+
+        float tMax = r - walkSettings.epsilonShellForReflectingBoundary;
+        if (tMax > 0.0f && queries.countBoundaryIntersections &&
+            queries.countBoundaryIntersections(pt, dir/r, tMax) != 0) continue;
+
+        Vector<DIM> boundaryDir = samplePt.pt - boundaryPt;
+        float normalOffset = boundaryDir.dot(samplePt.normal);
+        float boundaryDist2 = boundaryDir.squaredNorm() - normalOffset*normalOffset;
+        float weight = 1.0f/std::max(boundaryDist2, 1e-12f);
+        totalCachedSolution += weight*samplePt.solution;
+        totalCachedDistToBoundary += weight*(useDistanceToAbsorbingBoundary ? samplePt.distToAbsorbingBoundary :
+                                                                              samplePt.distToReflectingBoundary);
+        totalWeight += weight;
+    }
+
+    if (totalWeight == 0.0f) return false;
+    solutionEstimate = totalCachedSolution/totalWeight;
+
+    if (useDistanceToAbsorbingBoundary) {
+        // the cached sample pts lie at an offset from the absorbing boundary, so linearly
+        // interpolate between the known boundary value and the cached estimates
+        float cachedDistToBoundary = totalCachedDistToBoundary/totalWeight;
+        if (cachedDistToBoundary > distToBoundary) {
+            bool returnBoundaryNormalAlignedValue = walkSettings.solveDoubleSided &&
+                                                    signedDistance > 0.0f;
+            T boundaryValue(0.0f);
+            if (!walkSettings.ignoreAbsorbingBoundaryContribution) {
+                boundaryValue = pde.dirichlet(boundaryPt, returnBoundaryNormalAlignedValue);
+            }
+
+            float t = distToBoundary/cachedDistToBoundary;
+            solutionEstimate = (1.0f - t)*boundaryValue + t*solutionEstimate;
+        }
+    }
+
+    return true;
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::accumulateHarmonicBlock(const SplatSampleBatch<T, DIM>& batch,
+                                                                            int start, int end,
+                                                                            const Vector<DIM>& x,
+                                                                            float alpha,
+                                                                            float radiusClamp,
+                                                                            float kernelRegularization,
+                                                                            SplatAccumulator<T, DIM>& accumulator) const
+{
+    // evaluate the HarmonicGreensFnFreeSpace kernels for the block with Eigen array expressions
+    // over the structure-of-arrays sample data, which use Eigen's SIMD packet math for the square
+    // roots, logarithms and divisions; samples for which the kernels are not finite are masked
+    // out, as in splatBoundaryData
+    using BlockArray = Eigen::Array<float, Eigen::Dynamic, 1, Eigen::ColMajor, BVC_SPLAT_BLOCK_SIZE, 1>;
+    using BlockMask = Eigen::Array<bool, Eigen::Dynamic, 1, Eigen::ColMajor, BVC_SPLAT_BLOCK_SIZE, 1>;
+    using BlockMap = Eigen::Map<const Eigen::Array<float, Eigen::Dynamic, 1>>;
+    const int n = end - start;
+    const float maxFloat = std::numeric_limits<float>::max();
+    BlockArray xy[DIM], r2 = BlockArray::Zero(n), nDotXy = BlockArray::Zero(n);
+
     for (int i = 0; i < DIM; i++) {
-        gradientEstimate[i] = alpha*dG[i]*source/pdf;
+        xy[i] = x(i) - BlockMap(batch.pt[i].data() + start, n);
+        r2 += xy[i].square();
+        nDotXy += BlockMap(batch.normal[i].data() + start, n)*xy[i];
     }
 
-    // update statistics
-    evalPt.sourceStatistics->addSolutionEstimate(solutionEstimate);
-    evalPt.sourceStatistics->addGradientEstimate(gradientEstimate);
+    BlockArray r = r2.sqrt().max(radiusClamp);
+    r2 = r.square();
+    BlockArray k = DIM == 2 ? BlockArray(r2.inverse()/(2.0f*M_PI)) :
+                              BlockArray((r2*r).inverse()/(4.0f*M_PI));
+    BlockMask isFinite = k <= maxFloat; // all kernels are finite whenever k is
+    k = isFinite.select(k, 0.0f);
+    BlockArray G = DIM == 2 ? BlockArray(isFinite.select(-r.log()/(2.0f*M_PI), 0.0f)) : BlockArray(k*r2);
+    BlockArray P = k*nDotXy;
+
+    if (kernelRegularization > 0.0f) {
+        for (int j = 0; j < n; j++) {
+            float rj = r[j]/kernelRegularization;
+            G[j] *= KernelRegularization<DIM>::regularizationForGreensFn(rj);
+            P[j] *= KernelRegularization<DIM>::regularizationForPoissonKernel(rj);
+        }
+    }
+
+    // accumulate the estimates; for scalar-valued PDEs, the sums are computed with Eigen's
+    // vectorized reductions, which a compiler cannot generate itself from a floating point
+    // loop without reassociating it
+    auto accumulate = [&](const BlockArray& GKernel, const BlockArray& PKernel, T& sum) {
+        if constexpr (std::is_same<T, float>::value) {
+            BlockMap charge(batch.charge.data() + start, n);
+            BlockMap dipole(batch.dipole.data() + start, n);
+            sum += (charge*GKernel + dipole*PKernel).sum();
+
+        } else {
+            T blockSum(0.0f);
+            for (int j = 0; j < n; j++) {
+                blockSum += batch.charge[start + j]*GKernel[j] + batch.dipole[start + j]*PKernel[j];
+            }
+
+            sum += blockSum;
+        }
+    };
+
+    T solution(0.0f);
+    accumulate(G, P, solution);
+    accumulator.solution += alpha*solution;
+
+    if constexpr (estimateGradient) {
+        float gradientAlpha = alpha > 1.0f ? 0.0f : alpha; // FUTURE: estimate gradient on the boundary
+        BlockArray c = isFinite.select(float(DIM)*nDotXy/r2, 0.0f);
+
+        for (int i = 0; i < DIM; i++) {
+            BlockArray dG = -k*xy[i];
+            BlockArray dP = k*(BlockMap(batch.normal[i].data() + start, n) - c*xy[i]);
+
+            T gradient(0.0f);
+            accumulate(dG, dP, gradient);
+            accumulator.gradient[i] += gradientAlpha*gradient;
+        }
+    }
+
+    accumulator.count += (int)isFinite.count();
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::accumulateYukawaBlock(const SplatSampleBatch<T, DIM>& batch,
+                                                                          int start, int end,
+                                                                          const YukawaGreensFnFreeSpace<DIM>& greensFn,
+                                                                          float alpha,
+                                                                          float radiusClamp,
+                                                                          float kernelRegularization,
+                                                                          SplatAccumulator<T, DIM>& accumulator) const
+{
+    // the Yukawa kernels are built from Bessel functions (in 2D) that have no vectorized
+    // implementation, so the block is evaluated one sample at a time; the block still stays
+    // in cache while it is splatted to all evaluation pts in a tile. Samples for which the
+    // kernels are not finite are skipped, as in splatBoundaryData
+    float gradientAlpha = alpha > 1.0f ? 0.0f : alpha; // FUTURE: estimate gradient on the boundary
+    for (int j = start; j < end; j++) {
+        Vector<DIM> pt, n;
+        for (int i = 0; i < DIM; i++) {
+            pt(i) = batch.pt[i][j];
+            n(i) = batch.normal[i][j];
+        }
+
+        float r = std::max(radiusClamp, (pt - greensFn.x).norm());
+        float G = greensFn.evaluate(r);
+        float P = greensFn.poissonKernel(r, pt, n);
+        if (!std::isfinite(G) || !std::isfinite(P)) continue;
+
+        Vector<DIM> dG, dP;
+        if constexpr (estimateGradient) {
+            dG = greensFn.gradient(r, pt);
+            dP = greensFn.poissonKernelGradient(r, pt, n);
+            if (!std::isfinite(dG.norm()) || !std::isfinite(dP.norm())) continue;
+        }
+
+        if (kernelRegularization > 0.0f) {
+            r /= kernelRegularization;
+            G *= KernelRegularization<DIM>::regularizationForGreensFn(r);
+            P *= KernelRegularization<DIM>::regularizationForPoissonKernel(r);
+        }
+
+        const T& charge = batch.charge[j];
+        const T& dipole = batch.dipole[j];
+        accumulator.solution += alpha*(charge*G + dipole*P);
+        accumulator.count++;
+
+        if constexpr (estimateGradient) {
+            for (int i = 0; i < DIM; i++) {
+                accumulator.gradient[i] += gradientAlpha*(charge*dG[i] + dipole*dP[i]);
+            }
+        }
+    }
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::splatBatch(const SplatSampleBatch<T, DIM>& batch,
+                                                               SplatCategory category,
+                                                               float absorptionCoeff,
+                                                               float radiusClamp,
+                                                               float kernelRegularization,
+                                                               float cutoffDistToAbsorbingBoundary,
+                                                               float cutoffDistToReflectingBoundary,
+                                                               EvaluationPoints<T, DIM>& evalPts,
+                                                               bool correctExistingEstimates) const
+{
+    int nEvalPoints = evalPts.size();
+    int nTiles = (nEvalPoints + BVC_SPLAT_TILE_SIZE - 1)/BVC_SPLAT_TILE_SIZE;
+
+    auto run = [&](const tbb::blocked_range<int>& range) {
+        SplatAccumulator<T, DIM> accumulators[BVC_SPLAT_TILE_SIZE];
+        std::unique_ptr<YukawaGreensFnFreeSpace<DIM>> yukawaGreensFn = nullptr;
+        if (absorptionCoeff > 0.0f) {
+            yukawaGreensFn = std::make_unique<YukawaGreensFnFreeSpace<DIM>>(absorptionCoeff);
+        }
+
+        for (int t = range.begin(); t < range.end(); ++t) {
+            int tileStart = t*BVC_SPLAT_TILE_SIZE;
+            int tileEnd = std::min(tileStart + BVC_SPLAT_TILE_SIZE, nEvalPoints);
+            for (int i = tileStart; i < tileEnd; i++) accumulators[i - tileStart].reset();
+
+            // stream blocks of sample pts through the tile, so that each block stays in cache
+            // while it is splatted to all evaluation pts in the tile
+            for (int blockStart = 0; blockStart < batch.size; blockStart += BVC_SPLAT_BLOCK_SIZE) {
+                int blockEnd = std::min(blockStart + BVC_SPLAT_BLOCK_SIZE, batch.size);
+
+                for (int i = tileStart; i < tileEnd; i++) {
+                    // don't evaluate if the distance to the boundary is smaller than the cutoff distance
+                    if (evalPts.distToAbsorbingBoundary[i] < cutoffDistToAbsorbingBoundary ||
+                        evalPts.distToReflectingBoundary[i] < cutoffDistToReflectingBoundary) continue;
+
+                    float alpha = evalPts.type[i] == SampleType::OnAbsorbingBoundary ||
+                                  evalPts.type[i] == SampleType::OnReflectingBoundary ?
+                                  2.0f : 1.0f;
+                    if (yukawaGreensFn) {
+                        yukawaGreensFn->updatePole(evalPts.pt[i]);
+                        accumulateYukawaBlock(batch, blockStart, blockEnd, *yukawaGreensFn, alpha,
+                                              radiusClamp, kernelRegularization,
+                                              accumulators[i - tileStart]);
+
+                    } else {
+                        accumulateHarmonicBlock(batch, blockStart, blockEnd, evalPts.pt[i], alpha,
+                                                radiusClamp, kernelRegularization,
+                                                accumulators[i - tileStart]);
+                    }
+                }
+            }
+
+            // update statistics
+            for (int i = tileStart; i < tileEnd; i++) {
+                const SplatAccumulator<T, DIM>& accumulator = accumulators[i - tileStart];
+                SplatStatistics<T, DIM>& statistics = evalPts.getStatistics(i, category);
+                if (correctExistingEstimates) {
+                    statistics.addSolutionCorrection(accumulator.solution);
+                    if constexpr (estimateGradient) {
+                        statistics.addGradientCorrections(accumulator.gradient);
+                    }
+
+                } else {
+                    statistics.addSolutionEstimateSum(accumulator.solution, accumulator.count);
+                    if constexpr (estimateGradient) {
+                        statistics.addGradientEstimateSums(accumulator.gradient, accumulator.count);
+                    }
+                }
+            }
+        }
+    };
+
+    tbb::blocked_range<int> range(0, nTiles);
+    tbb::parallel_for(range, run);
+}
+
+template <typename T, size_t DIM, EstimationQuantity Quantity>
+inline void BoundaryValueCaching<T, DIM, Quantity>::splatClusterData(const SplatTreeNode<T, DIM>& node,
+                                                                     const Vector<DIM>& x,
+                                                                     float absorptionCoeff,
+                                                                     float alpha,
+                                                                     T& solutionEstimate,
+                                                                     T *gradientEstimate) const
+{
+    // evaluate the Green's function and its derivatives with respect to the sample position
+    // at the cluster center, using G(x, y) = g(|y - x|)
+    Vector<DIM> v = node.center - x;
+    float r = v.norm();
+    Vector<DIM> u = v/r;
+    float g, dg, d2g, d3g;
+    computeRadialGreensFnDerivatives<DIM>(r, absorptionCoeff, g, dg, d2g, d3g);
+    float c2 = d2g - dg/r;
+    float c3 = d3g - 3.0f*c2/r;
+
+    // expand the cluster's contribution sum_j q_j G(x, y_j) + m_j.dG(x, y_j)/dy up to second
+    // order about the center; the gradient with respect to x flips the sign of the derivatives
+    T solution = node.charge*g;
+    T gradient[DIM];
+    for (int a = 0; a < DIM; a++) {
+        float dGa = dg*u(a);
+        solution += node.dipole[a]*dGa;
+        if constexpr (estimateGradient) gradient[a] = -node.charge*dGa;
+
+        for (int b = 0; b < DIM; b++) {
+            float d2Gab = c2*u(a)*u(b) + (a == b ? dg/r : 0.0f);
+            solution += node.quadrupole[a][b]*d2Gab;
+
+            if constexpr (estimateGradient) {
+                gradient[a] -= node.dipole[b]*d2Gab;
+                for (int c = 0; c < DIM; c++) {
+                    float d3Gabc = c3*u(a)*u(b)*u(c) + c2/r*((a == b ? u(c) : 0.0f) +
+                                                              (a == c ? u(b) : 0.0f) +
+                                                              (b == c ? u(a) : 0.0f));
+                    gradient[a] -= node.quadrupole[b][c]*d3Gabc;
+                }
+            }
+        }
+    }
+
+    solutionEstimate += alpha*solution;
+    if constexpr (estimateGradient) {
+        if (alpha > 1.0f) alpha = 0.0f; // FUTURE: estimate gradient on the boundary
+        for (int a = 0; a < DIM; a++) {
+            gradientEstimate[a] += alpha*gradient[a];
+        }
+    }
+}
+
+template <typename T, size_t DIM>
+inline uint64_t computePDEHash(const PDE<T, DIM>& pde, uint64_t pdeFingerprint, uint64_t hash)
+{
+    hash = hashValue<uint64_t>(pdeFingerprint, hash);
+    hash = hashValue<float>(pde.absorptionCoeff, hash);
+    hash = hashValue<bool>(pde.areRobinConditionsPureNeumann, hash);
+
+    return hash;
+}
+
+template <typename T, size_t DIM>
+inline uint64_t computeProbedPDEFingerprint(const PDE<T, DIM>& pde,
+                                            const Vector<DIM>& boundingBoxMin,
+                                            const Vector<DIM>& boundingBoxMax,
+                                            int nProbePts)
+{
+    // probe pts are drawn from a fixed sequence, so that the fingerprint is reproducible across runs
+    uint64_t hash = 14695981039346656037ull;
+    pcg32 sampler(BVC_CACHE_VERSION);
+    Vector<DIM> extent = boundingBoxMax - boundingBoxMin;
+    for (int i = 0; i < nProbePts; i++) {
+        Vector<DIM> x = boundingBoxMin;
+        for (int j = 0; j < DIM; j++) x(j) += extent(j)*sampler.nextFloat();
+
+        if (pde.source) {
+            T source = pde.source(x);
+            hash = hashBytes(&source, sizeof(T), hash);
+        }
+
+        for (bool returnBoundaryNormalAlignedValue: {false, true}) {
+            if (pde.dirichlet) {
+                T dirichlet = pde.dirichlet(x, returnBoundaryNormalAlignedValue);
+                hash = hashBytes(&dirichlet, sizeof(T), hash);
+            }
+
+            if (pde.robin) {
+                T robin = pde.robin(x, returnBoundaryNormalAlignedValue);
+                hash = hashBytes(&robin, sizeof(T), hash);
+            }
+
+            if (pde.robinCoeff) {
+                hash = hashValue<float>(pde.robinCoeff(x, returnBoundaryNormalAlignedValue), hash);
+            }
+        }
+
+        if (pde.hasReflectingBoundaryConditions) {
+            hash = hashValue<bool>(pde.hasReflectingBoundaryConditions(x), hash);
+        }
+    }
+
+    return hash;
+}
+
+template <typename T, size_t DIM>
+inline void writeSamplePointsToCache(BinaryCacheWriter& writer,
+                                     const std::vector<SamplePoint<T, DIM>>& samplePts)
+{
+    // scatter the sample pt data into flat arrays; values of type T are stored as
+    // their float channels, as is done for the positions and normals
+    constexpr size_t C = sizeof(T)/sizeof(float);
+    size_t nSamples = samplePts.size();
+    std::vector<float> positions(DIM*nSamples), normals(DIM*nSamples);
+    std::vector<uint8_t> types(nSamples), normalAligned(nSamples);
+    std::vector<float> pdfs(nSamples), distToAbsorbingBoundary(nSamples), distToReflectingBoundary(nSamples);
+    std::vector<float> firstSphereRadii(nSamples), robinCoeffs(nSamples);
+    std::vector<T> solutions(nSamples), normalDerivatives(nSamples), sources(nSamples), robins(nSamples);
+    for (size_t i = 0; i < nSamples; i++) {
+        const SamplePoint<T, DIM>& samplePt = samplePts[i];
+        for (size_t j = 0; j < DIM; j++) {
+            positions[DIM*i + j] = samplePt.pt(j);
+            normals[DIM*i + j] = samplePt.normal(j);
+        }
+
+        types[i] = (uint8_t)samplePt.type;
+        normalAligned[i] = samplePt.estimateBoundaryNormalAligned ? 1 : 0;
+        pdfs[i] = samplePt.pdf;
+        distToAbsorbingBoundary[i] = samplePt.distToAbsorbingBoundary;
+        distToReflectingBoundary[i] = samplePt.distToReflectingBoundary;
+        firstSphereRadii[i] = samplePt.firstSphereRadius;
+        robinCoeffs[i] = samplePt.robinCoeff;
+        solutions[i] = samplePt.solution;
+        normalDerivatives[i] = samplePt.normalDerivative;
+        sources[i] = samplePt.source;
+        robins[i] = samplePt.robin;
+    }
+
+    writer.writeVector(positions);
+    writer.writeVector(normals);
+    writer.writeVector(types);
+    writer.writeVector(normalAligned);
+    writer.writeVector(pdfs);
+    writer.writeVector(distToAbsorbingBoundary);
+    writer.writeVector(distToReflectingBoundary);
+    writer.writeVector(firstSphereRadii);
+    writer.writeVector(robinCoeffs);
+    writer.writeArray<float>(reinterpret_cast<const float *>(solutions.data()), C*nSamples);
+    writer.writeArray<float>(reinterpret_cast<const float *>(normalDerivatives.data()), C*nSamples);
+    writer.writeArray<float>(reinterpret_cast<const float *>(sources.data()), C*nSamples);
+    writer.writeArray<float>(reinterpret_cast<const float *>(robins.data()), C*nSamples);
+}
+
+template <typename T, size_t DIM>
+inline bool readSamplePointsFromCache(BinaryCacheReader& reader,
+                                      std::vector<SamplePoint<T, DIM>>& samplePts)
+{
+    constexpr size_t C = sizeof(T)/sizeof(float);
+    size_t nPositionCoords = 0, nNormalCoords = 0, nTypes = 0, nNormalAligned = 0, nPdfs = 0;
+    size_t nDistToAbsorbingBoundary = 0, nDistToReflectingBoundary = 0, nFirstSphereRadii = 0, nRobinCoeffs = 0;
+    size_t nSolutionChannels = 0, nNormalDerivativeChannels = 0, nSourceChannels = 0, nRobinChannels = 0;
+    const float *positions = reader.readArray<float>(nPositionCoords);
+    const float *normals = reader.readArray<float>(nNormalCoords);
+    const uint8_t *types = reader.readArray<uint8_t>(nTypes);
+    const uint8_t *normalAligned = reader.readArray<uint8_t>(nNormalAligned);
+    const float *pdfs = reader.readArray<float>(nPdfs);
+    const float *distToAbsorbingBoundary = reader.readArray<float>(nDistToAbsorbingBoundary);
+    const float *distToReflectingBoundary = reader.readArray<float>(nDistToReflectingBoundary);
+    const float *firstSphereRadii = reader.readArray<float>(nFirstSphereRadii);
+    const float *robinCoeffs = reader.readArray<float>(nRobinCoeffs);
+    const float *solutions = reader.readArray<float>(nSolutionChannels);
+    const float *normalDerivatives = reader.readArray<float>(nNormalDerivativeChannels);
+    const float *sources = reader.readArray<float>(nSourceChannels);
+    const float *robins = reader.readArray<float>(nRobinChannels);
+    if (positions == nullptr || normals == nullptr || types == nullptr || normalAligned == nullptr ||
+        pdfs == nullptr || distToAbsorbingBoundary == nullptr || distToReflectingBoundary == nullptr ||
+        firstSphereRadii == nullptr || robinCoeffs == nullptr || solutions == nullptr ||
+        normalDerivatives == nullptr || sources == nullptr || robins == nullptr) {
+        return false;
+    }
+
+    size_t nSamples = nTypes;
+    if (nPositionCoords != DIM*nSamples || nNormalCoords != DIM*nSamples ||
+        nNormalAligned != nSamples || nPdfs != nSamples ||
+        nDistToAbsorbingBoundary != nSamples || nDistToReflectingBoundary != nSamples ||
+        nFirstSphereRadii != nSamples || nRobinCoeffs != nSamples ||
+        nSolutionChannels != C*nSamples || nNormalDerivativeChannels != C*nSamples ||
+        nSourceChannels != C*nSamples || nRobinChannels != C*nSamples) {
+        return false;
+    }
+
+    samplePts.clear();
+    samplePts.reserve(nSamples);
+    for (size_t i = 0; i < nSamples; i++) {
+        if (types[i] > (uint8_t)SampleType::OnReflectingBoundary) return false;
+
+        Vector<DIM> pt, normal;
+        for (size_t j = 0; j < DIM; j++) {
+            pt(j) = positions[DIM*i + j];
+            normal(j) = normals[DIM*i + j];
+        }
+
+        samplePts.emplace_back(SamplePoint<T, DIM>(pt, normal, (SampleType)types[i], pdfs[i],
+                                                   distToAbsorbingBoundary[i], distToReflectingBoundary[i]));
+        SamplePoint<T, DIM>& samplePt = samplePts.back();
+        samplePt.firstSphereRadius = firstSphereRadii[i];
+        samplePt.estimateBoundaryNormalAligned = normalAligned[i] != 0;
+        samplePt.robinCoeff = robinCoeffs[i];
+        std::memcpy(&samplePt.solution, solutions + C*i, sizeof(T));
+        std::memcpy(&samplePt.normalDerivative, normalDerivatives + C*i, sizeof(T));
+        std::memcpy(&samplePt.source, sources + C*i, sizeof(T));
+        std::memcpy(&samplePt.robin, robins + C*i, sizeof(T));
+    }
+
+    return true;
+}
+
+template <typename T, size_t DIM>
+inline bool saveBoundaryValueCache(const std::string& cacheFile, uint64_t contentHash,
+                                   const std::vector<const std::vector<SamplePoint<T, DIM>> *>& samplePts)
+{
+    static_assert(sizeof(T)%sizeof(float) == 0, "saveBoundaryValueCache(): type must be composed of floats");
+    BinaryCacheWriter writer(cacheFile, BVC_CACHE_VERSION, contentHash);
+    if (!writer.isOpen()) return false;
+
+    writer.write<uint32_t>((uint32_t)DIM);
+    writer.write<uint32_t>((uint32_t)(sizeof(T)/sizeof(float)));
+    writer.write<uint64_t>((uint64_t)samplePts.size());
+    for (size_t i = 0; i < samplePts.size(); i++) {
+        writeSamplePointsToCache<T, DIM>(writer, *samplePts[i]);
+    }
+
+    return writer.close();
+}
+
+template <typename T, size_t DIM>
+inline bool loadBoundaryValueCache(const std::string& cacheFile, uint64_t contentHash,
+                                   const std::vector<std::vector<SamplePoint<T, DIM>> *>& samplePts)
+{
+    static_assert(sizeof(T)%sizeof(float) == 0, "loadBoundaryValueCache(): type must be composed of floats");
+    BinaryCacheReader reader;
+    if (!reader.open(cacheFile, BVC_CACHE_VERSION, contentHash)) return false;
+
+    uint32_t dim = 0, nChannels = 0;
+    uint64_t nSets = 0;
+    if (!reader.read(dim) || dim != DIM) return false;
+    if (!reader.read(nChannels) || nChannels != sizeof(T)/sizeof(float)) return false;
+    if (!reader.read(nSets) || nSets != samplePts.size()) return false;
+
+    for (size_t i = 0; i < samplePts.size(); i++) {
+        if (!readSamplePointsFromCache<T, DIM>(reader, *samplePts[i])) return false;
+    }
+
+    return true;
 }
 
 } // bvc
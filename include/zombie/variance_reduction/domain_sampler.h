@@ -1,11 +1,17 @@
 // This file defines a DomainSampler for generating uniformly distributed sample points
 // in a 2D or 3D domain. These sample points are required by the Boundary Value Caching (BVC)
 // and Reverse Walk Splatting (RWS) techniques for reducing variance of the walk-on-spheres
-// and walk-on-stars estimators for PDEs with non-zero source.
+// and walk-on-stars estimators for PDEs with non-zero source. Sample points can also be
+// distributed in proportion to the magnitude of the source, which avoids wasting samples
+// in regions where the source vanishes (e.g., for localized sources), or generated from a
+// precomputed voxel classification of the solve region, which avoids testing and rejecting
+// most candidate points for thin or sparse domains.
 
 #pragma once
 
 #include <zombie/point_estimation/common.h>
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
 
 namespace zombie {
 
@@ -19,7 +25,9 @@ public:
 template <typename T, size_t DIM>
 class UniformDomainSampler: public DomainSampler<T, DIM> {
 public:
-    // constructor
+    // constructor; candidate points are classified by calling insideSolveRegion in parallel,
+    // which can classify points with winding numbers (e.g., through GeometricQueries::insideDomain
+    // when GeometricQueries::computeWindingNumber is set)
     UniformDomainSampler(const GeometricQueries<DIM>& queries_,
                          const std::function<bool(const Vector<DIM>&)>& insideSolveRegion_,
                          const Vector<DIM>& solveRegionMin_,
@@ -31,21 +39,159 @@ public:
     // solve region volume does not match the volume of its bounding extents
     void generateSamples(int nSamples, std::vector<SamplePoint<T, DIM>>& samplePts);
 
+    // sets a generator (e.g., an OwenScrambledSobolSampleGenerator) from which subsequent candidate
+    // points are drawn; passing nullptr restores the default stratified sampling
+    void setSampleGenerator(std::shared_ptr<const SampleGenerator> sampleGenerator_);
+
+protected:
+    // members
+    pcg32 sampler;
+    std::shared_ptr<const SampleGenerator> sampleGenerator;
+    const GeometricQueries<DIM>& queries;
+    const std::function<bool(const Vector<DIM>&)>& insideSolveRegion;
+    const Vector<DIM>& solveRegionMin;
+    const Vector<DIM>& solveRegionMax;
+    float solveRegionVolume;
+};
+
+template <typename T, size_t DIM>
+class SourceImportanceDomainSampler: public DomainSampler<T, DIM> {
+public:
+    // constructor; builds a piecewise constant density over a regular grid with gridResolution
+    // cells along each axis of the bounding extents of the solve region, from the magnitude of the
+    // source estimated at nSourceSamplesPerCell random points per cell. A uniformFraction of the
+    // density is spread uniformly over the grid, so that the density remains bounded from below
+    // wherever the source is underestimated. NOTE: insideSolveRegion is called in parallel
+    SourceImportanceDomainSampler(const GeometricQueries<DIM>& queries_,
+                                  const std::function<bool(const Vector<DIM>&)>& insideSolveRegion_,
+                                  const Vector<DIM>& solveRegionMin_,
+                                  const Vector<DIM>& solveRegionMax_,
+                                  const std::function<T(const Vector<DIM>&)>& source,
+                                  int gridResolution_=64, float uniformFraction=0.1f,
+                                  int nSourceSamplesPerCell=4);
+
+    // generates sample points inside the solve region distributed according to the density;
+    // the pdfs of the sample points are normalized by the fraction of candidate points that land
+    // inside the solve region. NOTE: may not generate exactly the requested number of samples
+    void generateSamples(int nSamples, std::vector<SamplePoint<T, DIM>>& samplePts);
+
+    // sets a generator (e.g., an OwenScrambledSobolSampleGenerator) from which subsequent candidate
+    // points are drawn; passing nullptr restores the default stratified sampling
+    void setSampleGenerator(std::shared_ptr<const SampleGenerator> sampleGenerator_);
+
+protected:
+    // builds the alias table over the grid cells
+    void buildDensity(const std::function<T(const Vector<DIM>&)>& source,
+                      float uniformFraction, int nSourceSamplesPerCell);
+
+    // members
+    pcg32 sampler;
+    std::shared_ptr<const SampleGenerator> sampleGenerator;
+    const GeometricQueries<DIM>& queries;
+    const std::function<bool(const Vector<DIM>&)>& insideSolveRegion;
+    const Vector<DIM>& solveRegionMin;
+    const Vector<DIM>& solveRegionMax;
+    int gridResolution;
+    Vector<DIM> cellExtent;
+    AliasTable aliasTable;
+    std::vector<float> cellPdfs;
+    float acceptanceRate;
+};
+
+template <typename T, size_t DIM>
+class VoxelClassifiedDomainSampler: public DomainSampler<T, DIM> {
+public:
+    // constructor; classifies the cells of a regular grid with gridResolution cells along each axis
+    // of the bounding extents of the solve region as inside, outside or straddling the solve region,
+    // by comparing the distance from each cell center to the boundary with the cell's circumradius.
+    // The distance defaults to GeometricQueries::computeDistToBoundary, which assumes the solve region
+    // is bounded by the domain boundary (e.g., when insideSolveRegion tests whether points are inside
+    // the domain); otherwise, the distance to the boundary of the solve region should be provided.
+    // NOTE: insideSolveRegion is called in parallel
+    VoxelClassifiedDomainSampler(const GeometricQueries<DIM>& queries_,
+                                 const std::function<bool(const Vector<DIM>&)>& insideSolveRegion_,
+                                 const Vector<DIM>& solveRegionMin_,
+                                 const Vector<DIM>& solveRegionMax_,
+                                 float solveRegionVolume_,
+                                 int gridResolution_=32,
+                                 const std::function<float(const Vector<DIM>&)>& computeDistToSolveRegionBoundary={});
+
+    // generates uniformly distributed sample points inside the cells that are not outside the solve
+    // region; only candidate points in straddling cells are tested against the solve region.
+    // NOTE: may not generate exactly the requested number of samples when the solve region volume
+    // does not match the volume of its inside and straddling cells
+    void generateSamples(int nSamples, std::vector<SamplePoint<T, DIM>>& samplePts);
+
+    // sets a generator (e.g., an OwenScrambledSobolSampleGenerator) from which subsequent candidate
+    // points are drawn; passing nullptr restores the default stratified sampling
+    void setSampleGenerator(std::shared_ptr<const SampleGenerator> sampleGenerator_);
+
+    // returns the number of cells inside the solve region
+    int getInsideCellCount() const;
+
+    // returns the number of cells straddling the boundary of the solve region
+    int getStraddlingCellCount() const;
+
 protected:
+    // classifies the grid cells
+    void classifyCells(const std::function<float(const Vector<DIM>&)>& computeDistToSolveRegionBoundary);
+
     // members
     pcg32 sampler;
+    std::shared_ptr<const SampleGenerator> sampleGenerator;
     const GeometricQueries<DIM>& queries;
     const std::function<bool(const Vector<DIM>&)>& insideSolveRegion;
     const Vector<DIM>& solveRegionMin;
     const Vector<DIM>& solveRegionMax;
     float solveRegionVolume;
+    int gridResolution;
+    Vector<DIM> cellExtent;
+    std::vector<int> cellIndices; // cells inside the solve region, followed by straddling cells
+    int nInsideCells;
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Implementation
 // FUTURE:
 // - improve stratification, since it helps reduce clumping/singular artifacts
-// - sample points in the domain in proportion to source values
+
+// classifies candidate points against the solve region in parallel, and returns the number of
+// points inside it; NOTE: insideSolveRegion must be safe to call concurrently
+template <size_t DIM>
+inline int classifyCandidatePoints(const std::function<bool(const Vector<DIM>&)>& insideSolveRegion,
+                                   const std::vector<Vector<DIM>>& candidatePts,
+                                   std::vector<uint8_t>& insideRegion)
+{
+    int nCandidates = (int)candidatePts.size();
+    insideRegion.resize(nCandidates);
+    auto run = [&](const tbb::blocked_range<int>& range) {
+        for (int i = range.begin(); i < range.end(); ++i) {
+            insideRegion[i] = insideSolveRegion(candidatePts[i]) ? 1 : 0;
+        }
+    };
+
+    tbb::blocked_range<int> range(0, nCandidates);
+    tbb::parallel_for(range, run);
+
+    int nInside = 0;
+    for (int i = 0; i < nCandidates; i++) nInside += insideRegion[i];
+
+    return nInside;
+}
+
+// returns the minimum corner of a cell of a regular grid with gridResolution cells along each axis
+template <size_t DIM>
+inline Vector<DIM> getGridCellMin(const Vector<DIM>& gridMin, const Vector<DIM>& cellExtent,
+                                  int gridResolution, int cellIndex)
+{
+    Vector<DIM> cellMin = gridMin;
+    for (int j = 0; j < DIM; j++) {
+        cellMin[j] += (cellIndex%gridResolution)*cellExtent[j];
+        cellIndex /= gridResolution;
+    }
+
+    return cellMin;
+}
 
 template <typename T, size_t DIM>
 inline UniformDomainSampler<T, DIM>::UniformDomainSampler(const GeometricQueries<DIM>& queries_,
@@ -76,15 +222,173 @@ inline void UniformDomainSampler<T, DIM>::generateSamples(int nSamples, std::vec
     std::vector<float> stratifiedSamples;
     int nStratifiedSamples = nSamples;
     if (solveRegionVolume > 0.0f) nStratifiedSamples *= regionExtent.prod()*pdf;
-    generateStratifiedSamples<DIM>(stratifiedSamples, nStratifiedSamples, sampler);
+    if (sampleGenerator) {
+        generateSequenceSamples<DIM>(stratifiedSamples, nStratifiedSamples, *sampleGenerator, sampler.nextUInt());
 
-    // generate sample points inside the solve region
+    } else {
+        generateStratifiedSamples<DIM>(stratifiedSamples, nStratifiedSamples, sampler);
+    }
+
+    // generate candidate points inside the bounding extents of the solve region
+    std::vector<Vector<DIM>> candidatePts(nStratifiedSamples);
     for (int i = 0; i < nStratifiedSamples; i++) {
         Vector<DIM> randomVector = Vector<DIM>::Zero();
         for (int j = 0; j < DIM; j++) randomVector[j] = stratifiedSamples[DIM*i + j];
-        Vector<DIM> pt = (solveRegionMin.array() + regionExtent.array()*randomVector.array()).matrix();
+        candidatePts[i] = (solveRegionMin.array() + regionExtent.array()*randomVector.array()).matrix();
+    }
+
+    // classify candidate points against the solve region
+    std::vector<uint8_t> insideRegion;
+    classifyCandidatePoints<DIM>(insideSolveRegion, candidatePts, insideRegion);
+
+    // generate sample points inside the solve region
+    for (int i = 0; i < nStratifiedSamples; i++) {
+        const Vector<DIM>& pt = candidatePts[i];
+
+        if (insideRegion[i]) {
+            float distToAbsorbingBoundary = queries.computeDistToAbsorbingBoundary(pt, false);
+            float distToReflectingBoundary = queries.computeDistToReflectingBoundary(pt, false);
+            SamplePoint<T, DIM> samplePt(pt, Vector<DIM>::Zero(), SampleType::InDomain, pdf,
+                                         distToAbsorbingBoundary, distToReflectingBoundary);
+            samplePts.emplace_back(samplePt);
+        }
+    }
+}
+
+template <typename T, size_t DIM>
+inline void UniformDomainSampler<T, DIM>::setSampleGenerator(std::shared_ptr<const SampleGenerator> sampleGenerator_)
+{
+    sampleGenerator = sampleGenerator_;
+}
+
+template <typename T, size_t DIM>
+inline SourceImportanceDomainSampler<T, DIM>::SourceImportanceDomainSampler(const GeometricQueries<DIM>& queries_,
+                                                                            const std::function<bool(const Vector<DIM>&)>& insideSolveRegion_,
+                                                                            const Vector<DIM>& solveRegionMin_,
+                                                                            const Vector<DIM>& solveRegionMax_,
+                                                                            const std::function<T(const Vector<DIM>&)>& source,
+                                                                            int gridResolution_, float uniformFraction,
+                                                                            int nSourceSamplesPerCell):
+                                                                            queries(queries_),
+                                                                            insideSolveRegion(insideSolveRegion_),
+                                                                            solveRegionMin(solveRegionMin_),
+                                                                            solveRegionMax(solveRegionMax_),
+                                                                            gridResolution(std::max(1, gridResolution_)),
+                                                                            acceptanceRate(0.0f)
+{
+    auto now = std::chrono::high_resolution_clock::now();
+    uint64_t seed = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    sampler = pcg32(seed);
+    buildDensity(source, uniformFraction, std::max(1, nSourceSamplesPerCell));
+}
+
+template <typename T, size_t DIM>
+inline void SourceImportanceDomainSampler<T, DIM>::buildDensity(const std::function<T(const Vector<DIM>&)>& source,
+                                                                float uniformFraction, int nSourceSamplesPerCell)
+{
+    int nCells = 1;
+    for (int j = 0; j < DIM; j++) nCells *= gridResolution;
+    cellExtent = (solveRegionMax - solveRegionMin)/float(gridResolution);
+    float cellVolume = cellExtent.prod();
+
+    // estimate the source magnitude and the fraction of each cell inside the solve region;
+    // each cell uses its own random stream so that the estimates are independent of the
+    // order in which the cells are processed
+    std::vector<float> sourceMagnitude(nCells, 0.0f);
+    std::vector<float> insideFraction(nCells, 0.0f);
+    uint64_t seed = sampler.nextUInt();
+    auto run = [&](const tbb::blocked_range<int>& range) {
+        for (int i = range.begin(); i < range.end(); ++i) {
+            pcg32 cellSampler(seed, i);
+            Vector<DIM> cellMin = getGridCellMin<DIM>(solveRegionMin, cellExtent, gridResolution, i);
 
-        if (insideSolveRegion(pt)) {
+            for (int j = 0; j < nSourceSamplesPerCell; j++) {
+                Vector<DIM> pt = cellMin;
+                for (int k = 0; k < DIM; k++) pt[k] += cellSampler.nextFloat()*cellExtent[k];
+
+                if (insideSolveRegion(pt)) {
+                    T value = source(pt);
+                    if constexpr (std::is_arithmetic<T>::value) {
+                        sourceMagnitude[i] += std::fabs(value);
+
+                    } else {
+                        sourceMagnitude[i] += value.matrix().norm();
+                    }
+
+                    insideFraction[i] += 1.0f;
+                }
+            }
+
+            sourceMagnitude[i] /= nSourceSamplesPerCell;
+            insideFraction[i] /= nSourceSamplesPerCell;
+        }
+    };
+
+    tbb::blocked_range<int> range(0, nCells);
+    tbb::parallel_for(range, run);
+
+    // mix the normalized source magnitudes with a uniform distribution over the cells,
+    // and fall back to uniform sampling if the source vanishes everywhere
+    double totalSourceMagnitude = 0.0;
+    for (int i = 0; i < nCells; i++) {
+        if (std::isfinite(sourceMagnitude[i])) totalSourceMagnitude += sourceMagnitude[i];
+        else sourceMagnitude[i] = 0.0f;
+    }
+
+    float alpha = totalSourceMagnitude > 0.0 ? std::clamp(uniformFraction, 0.0f, 1.0f) : 1.0f;
+    std::vector<float> cellProbabilities(nCells);
+    cellPdfs.resize(nCells);
+    acceptanceRate = 0.0f;
+    for (int i = 0; i < nCells; i++) {
+        float sourceProbability = totalSourceMagnitude > 0.0 ? float(sourceMagnitude[i]/totalSourceMagnitude) : 0.0f;
+        cellProbabilities[i] = (1.0f - alpha)*sourceProbability + alpha/nCells;
+        cellPdfs[i] = cellProbabilities[i]/cellVolume;
+        acceptanceRate += cellProbabilities[i]*insideFraction[i];
+    }
+
+    aliasTable.build(cellProbabilities);
+}
+
+template <typename T, size_t DIM>
+inline void SourceImportanceDomainSampler<T, DIM>::generateSamples(int nSamples, std::vector<SamplePoint<T, DIM>>& samplePts)
+{
+    // initialize sample points
+    samplePts.clear();
+    if (nSamples <= 0 || cellPdfs.empty()) return;
+
+    // generate enough candidate points to produce the requested number of samples on average;
+    // the first two dimensions of each candidate select a cell, the remaining ones a point inside it
+    constexpr size_t nDims = DIM + 2;
+    int nCandidates = acceptanceRate > 0.0f ? (int)std::ceil(nSamples/acceptanceRate) : nSamples;
+    std::vector<float> candidateSamples;
+    if (sampleGenerator) {
+        generateSequenceSamples<nDims>(candidateSamples, nCandidates, *sampleGenerator, sampler.nextUInt());
+
+    } else {
+        generateStratifiedSamples<nDims>(candidateSamples, nCandidates, sampler);
+    }
+
+    std::vector<Vector<DIM>> candidatePts(nCandidates);
+    std::vector<int> candidateCells(nCandidates);
+    for (int i = 0; i < nCandidates; i++) {
+        const float *u = &candidateSamples[nDims*i];
+        candidateCells[i] = (int)aliasTable.sample(u[0], u[1]);
+        candidatePts[i] = getGridCellMin<DIM>(solveRegionMin, cellExtent, gridResolution, candidateCells[i]);
+        for (int j = 0; j < DIM; j++) candidatePts[i][j] += u[2 + j]*cellExtent[j];
+    }
+
+    // classify candidate points against the solve region
+    std::vector<uint8_t> insideRegion;
+    int nAccepted = classifyCandidatePoints<DIM>(insideSolveRegion, candidatePts, insideRegion);
+
+    // generate sample points inside the solve region, with pdfs normalized by the
+    // fraction of accepted candidate points
+    float pdfNormalization = nAccepted > 0 ? float(nCandidates)/nAccepted : 0.0f;
+    samplePts.reserve(nAccepted);
+    for (int i = 0; i < nCandidates; i++) {
+        if (insideRegion[i]) {
+            const Vector<DIM>& pt = candidatePts[i];
+            float pdf = cellPdfs[candidateCells[i]]*pdfNormalization;
             float distToAbsorbingBoundary = queries.computeDistToAbsorbingBoundary(pt, false);
             float distToReflectingBoundary = queries.computeDistToReflectingBoundary(pt, false);
             SamplePoint<T, DIM> samplePt(pt, Vector<DIM>::Zero(), SampleType::InDomain, pdf,
@@ -94,4 +398,161 @@ inline void UniformDomainSampler<T, DIM>::generateSamples(int nSamples, std::vec
     }
 }
 
+template <typename T, size_t DIM>
+inline void SourceImportanceDomainSampler<T, DIM>::setSampleGenerator(std::shared_ptr<const SampleGenerator> sampleGenerator_)
+{
+    sampleGenerator = sampleGenerator_;
+}
+
+template <typename T, size_t DIM>
+inline VoxelClassifiedDomainSampler<T, DIM>::VoxelClassifiedDomainSampler(const GeometricQueries<DIM>& queries_,
+                                                                          const std::function<bool(const Vector<DIM>&)>& insideSolveRegion_,
+                                                                          const Vector<DIM>& solveRegionMin_,
+                                                                          const Vector<DIM>& solveRegionMax_,
+                                                                          float solveRegionVolume_,
+                                                                          int gridResolution_,
+                                                                          const std::function<float(const Vector<DIM>&)>& computeDistToSolveRegionBoundary):
+                                                                          queries(queries_),
+                                                                          insideSolveRegion(insideSolveRegion_),
+                                                                          solveRegionMin(solveRegionMin_),
+                                                                          solveRegionMax(solveRegionMax_),
+                                                                          solveRegionVolume(solveRegionVolume_),
+                                                                          gridResolution(std::max(1, gridResolution_)),
+                                                                          nInsideCells(0)
+{
+    auto now = std::chrono::high_resolution_clock::now();
+    uint64_t seed = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    sampler = pcg32(seed);
+    classifyCells(computeDistToSolveRegionBoundary);
+}
+
+template <typename T, size_t DIM>
+inline void VoxelClassifiedDomainSampler<T, DIM>::classifyCells(const std::function<float(const Vector<DIM>&)>& computeDistToSolveRegionBoundary)
+{
+    int nCells = 1;
+    for (int j = 0; j < DIM; j++) nCells *= gridResolution;
+    cellExtent = (solveRegionMax - solveRegionMin)/float(gridResolution);
+    float cellRadius = 0.5f*cellExtent.norm();
+    bool hasDistToBoundary = computeDistToSolveRegionBoundary || queries.computeDistToBoundary;
+
+    // a cell lies entirely on one side of the boundary if its center is farther from the boundary
+    // than its circumradius, in which case testing its center suffices; all other cells straddle
+    // the boundary (or are conservatively assumed to, if no distance is available)
+    enum class CellType : uint8_t { Outside, Inside, Straddling };
+    std::vector<CellType> cellTypes(nCells, CellType::Straddling);
+    auto run = [&](const tbb::blocked_range<int>& range) {
+        for (int i = range.begin(); i < range.end(); ++i) {
+            if (!hasDistToBoundary) continue;
+
+            Vector<DIM> cellCenter = getGridCellMin<DIM>(solveRegionMin, cellExtent, gridResolution, i) + 0.5f*cellExtent;
+            float distToBoundary = computeDistToSolveRegionBoundary ? computeDistToSolveRegionBoundary(cellCenter) :
+                                                                      queries.computeDistToBoundary(cellCenter, false);
+            if (std::fabs(distToBoundary) > cellRadius) {
+                cellTypes[i] = insideSolveRegion(cellCenter) ? CellType::Inside : CellType::Outside;
+            }
+        }
+    };
+
+    tbb::blocked_range<int> range(0, nCells);
+    tbb::parallel_for(range, run);
+
+    // record the inside cells followed by the straddling cells
+    cellIndices.clear();
+    for (int i = 0; i < nCells; i++) {
+        if (cellTypes[i] == CellType::Inside) cellIndices.emplace_back(i);
+    }
+
+    nInsideCells = (int)cellIndices.size();
+    for (int i = 0; i < nCells; i++) {
+        if (cellTypes[i] == CellType::Straddling) cellIndices.emplace_back(i);
+    }
+}
+
+template <typename T, size_t DIM>
+inline void VoxelClassifiedDomainSampler<T, DIM>::generateSamples(int nSamples, std::vector<SamplePoint<T, DIM>>& samplePts)
+{
+    // initialize sample points
+    samplePts.clear();
+    int nCells = (int)cellIndices.size();
+    if (nSamples <= 0 || nCells == 0) return;
+    float pdf = 1.0f/solveRegionVolume;
+
+    // generate stratified samples; the first dimension of each candidate selects
+    // a cell uniformly, and the remaining dimensions a point inside it
+    constexpr size_t nDims = DIM + 1;
+    float cellsVolume = nCells*cellExtent.prod();
+    int nCandidates = nSamples;
+    if (solveRegionVolume > 0.0f) nCandidates = (int)std::ceil(nSamples*cellsVolume*pdf);
+    std::vector<float> candidateSamples;
+    if (sampleGenerator) {
+        generateSequenceSamples<nDims>(candidateSamples, nCandidates, *sampleGenerator, sampler.nextUInt());
+
+    } else {
+        generateStratifiedSamples<nDims>(candidateSamples, nCandidates, sampler);
+    }
+
+    // generate candidate points, and test only those in straddling cells against the solve region
+    std::vector<Vector<DIM>> candidatePts(nCandidates);
+    std::vector<uint8_t> acceptCandidate(nCandidates, 1);
+    auto generateCandidates = [&](const tbb::blocked_range<int>& range) {
+        for (int i = range.begin(); i < range.end(); ++i) {
+            const float *u = &candidateSamples[nDims*i];
+            int cell = std::min(nCells - 1, (int)(u[0]*nCells));
+            candidatePts[i] = getGridCellMin<DIM>(solveRegionMin, cellExtent, gridResolution, cellIndices[cell]);
+            for (int j = 0; j < DIM; j++) candidatePts[i][j] += u[1 + j]*cellExtent[j];
+            if (cell >= nInsideCells) acceptCandidate[i] = insideSolveRegion(candidatePts[i]);
+        }
+    };
+
+    tbb::blocked_range<int> candidateRange(0, nCandidates);
+    tbb::parallel_for(candidateRange, generateCandidates);
+
+    // compute distances to the boundary for the accepted candidate points
+    std::vector<int> acceptedIndices;
+    acceptedIndices.reserve(nCandidates);
+    for (int i = 0; i < nCandidates; i++) {
+        if (acceptCandidate[i]) acceptedIndices.emplace_back(i);
+    }
+
+    int nAccepted = (int)acceptedIndices.size();
+    std::vector<float> distToAbsorbingBoundary(nAccepted), distToReflectingBoundary(nAccepted);
+    auto computeDistances = [&](const tbb::blocked_range<int>& range) {
+        for (int i = range.begin(); i < range.end(); ++i) {
+            const Vector<DIM>& pt = candidatePts[acceptedIndices[i]];
+            distToAbsorbingBoundary[i] = queries.computeDistToAbsorbingBoundary(pt, false);
+            distToReflectingBoundary[i] = queries.computeDistToReflectingBoundary(pt, false);
+        }
+    };
+
+    tbb::blocked_range<int> acceptedRange(0, nAccepted);
+    tbb::parallel_for(acceptedRange, computeDistances);
+
+    // generate sample points inside the solve region
+    samplePts.reserve(nAccepted);
+    for (int i = 0; i < nAccepted; i++) {
+        SamplePoint<T, DIM> samplePt(candidatePts[acceptedIndices[i]], Vector<DIM>::Zero(),
+                                     SampleType::InDomain, pdf, distToAbsorbingBoundary[i],
+                                     distToReflectingBoundary[i]);
+        samplePts.emplace_back(samplePt);
+    }
+}
+
+template <typename T, size_t DIM>
+inline void VoxelClassifiedDomainSampler<T, DIM>::setSampleGenerator(std::shared_ptr<const SampleGenerator> sampleGenerator_)
+{
+    sampleGenerator = sampleGenerator_;
+}
+
+template <typename T, size_t DIM>
+inline int VoxelClassifiedDomainSampler<T, DIM>::getInsideCellCount() const
+{
+    return nInsideCells;
+}
+
+template <typename T, size_t DIM>
+inline int VoxelClassifiedDomainSampler<T, DIM>::getStraddlingCellCount() const
+{
+    return (int)cellIndices.size() - nInsideCells;
+}
+
 } // zombie
@@ -9,12 +9,24 @@
 #pragma once
 
 #include <zombie/point_estimation/reverse_walk_on_stars.h>
-#include "tbb/mutex.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "tbb/enumerable_thread_specific.h"
+
+#define RWS_SPLAT_BLOCK_SIZE 256
 
 namespace zombie {
 
 namespace rws {
 
+enum class AccumulationMode {
+    ThreadLocal, // contributions are accumulated into per-thread blocks without contention
+    Atomic // contributions are added with atomics, which avoids the blocks when walks rarely overlap
+};
+
+// a single evaluation pt and its totals, stored by value; splatting goes through
+// EvaluationPoints, which evaluation pts can be added to and read back from in this form
 template <typename T, size_t DIM>
 struct EvaluationPoint {
     // constructor
@@ -46,7 +58,162 @@ struct EvaluationPoint {
     T totalReflectingBoundaryContribution;
     T totalReflectingBoundaryNormalAlignedContribution;
     T totalSourceContribution;
-    std::unique_ptr<tbb::mutex> mutex;
+};
+
+// structure-of-arrays storage for a set of evaluation pts; contributions are staged without
+// locks in per-thread blocks or atomic storage, and only reach the totals once mergeContributions
+// is called (ReverseWalkOnStars does so at the end of solving for a set of sample pts); reading
+// the estimated solution while contributions are unmerged is an error
+template <typename T, size_t DIM>
+struct EvaluationPoints {
+    // constructor; in ThreadLocal mode, per-thread blocks of RWS_SPLAT_BLOCK_SIZE evaluation pts
+    // are allocated as threads first splat to them, and once the blocks of all threads use
+    // threadLocalMemoryBudget times the memory of the totals, further contributions fall back
+    // to atomics
+    EvaluationPoints(AccumulationMode accumulationMode_=AccumulationMode::ThreadLocal,
+                     float threadLocalMemoryBudget_=4.0f);
+
+    // reserves storage for the given number of evaluation pts
+    void reserve(int n);
+
+    // adds an evaluation pt; evaluation pts outside the solve region (e.g., outside the domain
+    // in single-sided problems) are stored but never splatted to; evaluation pts cannot be
+    // added while contributions are unmerged
+    void add(const Vector<DIM>& pt_,
+             const Vector<DIM>& normal_,
+             SampleType type_,
+             float distToAbsorbingBoundary_,
+             float distToReflectingBoundary_,
+             bool insideSolveRegion_=true);
+
+    // adds an evaluation pt along with its totals
+    void add(const EvaluationPoint<T, DIM>& evalPt, bool insideSolveRegion_=true);
+
+    // returns the number of evaluation pts
+    int size() const;
+
+    // returns the ith evaluation pt along with its merged totals
+    EvaluationPoint<T, DIM> getEvaluationPoint(int i) const;
+
+    // returns estimated solution at the ith evaluation pt
+    T getEstimatedSolution(int i,
+                           int nAbsorbingBoundarySamples,
+                           int nAbsorbingBoundaryNormalAlignedSamples,
+                           int nReflectingBoundarySamples,
+                           int nReflectingBoundaryNormalAlignedSamples,
+                           int nSourceSamples) const;
+
+    // per-thread contributions to a block of evaluation pts; the contributions are ordered
+    // like the totals, i.e., absorbing, absorbing normal aligned, reflecting, reflecting
+    // normal aligned and source
+    struct ContributionBlock {
+        // constructor
+        ContributionBlock();
+
+        // members
+        float totalPoissonKernelContribution[RWS_SPLAT_BLOCK_SIZE];
+        T totalContribution[5][RWS_SPLAT_BLOCK_SIZE];
+    };
+
+    // per-thread contributions, grouped in blocks of evaluation pts
+    struct ContributionBuffer {
+        std::vector<std::unique_ptr<ContributionBlock>> blocks;
+    };
+
+    // returns the contribution buffer of the calling thread in ThreadLocal mode, and nullptr
+    // otherwise; fetching it once per splat avoids a thread-local lookup per contribution
+    ContributionBuffer *getContributionBuffer();
+
+    // adds a weighted sample contribution to the ith evaluation pt; safe to call concurrently,
+    // with buffer set to the calling thread's buffer (it is looked up if not provided)
+    void addContribution(int i, const SampleContribution<T>& sampleContribution,
+                         float weight, bool useSelfNormalization,
+                         ContributionBuffer *buffer=nullptr);
+
+    // merges the contributions accumulated by all threads into the totals
+    void mergeContributions();
+
+    // returns whether contributions have been added since the last merge
+    bool hasUnmergedContributions() const;
+
+    // resets statistics
+    void reset();
+
+    // members
+    std::vector<Vector<DIM>> pt;
+    std::vector<Vector<DIM>> normal;
+    std::vector<SampleType> type;
+    std::vector<float> distToAbsorbingBoundary;
+    std::vector<float> distToReflectingBoundary;
+    std::vector<uint8_t> insideSolveRegion;
+    std::vector<float> totalPoissonKernelContribution;
+    std::vector<T> totalAbsorbingBoundaryContribution;
+    std::vector<T> totalAbsorbingBoundaryNormalAlignedContribution;
+    std::vector<T> totalReflectingBoundaryContribution;
+    std::vector<T> totalReflectingBoundaryNormalAlignedContribution;
+    std::vector<T> totalSourceContribution;
+
+    AccumulationMode accumulationMode;
+    float threadLocalMemoryBudget;
+
+protected:
+    // returns the index of the totals a sample contribution is added to, or -1 if none
+    int getContributionIndex(const SampleContribution<T>& sampleContribution) const;
+
+    // returns the totals with the given index
+    std::vector<T>& getTotalContribution(int k);
+
+    // allocates the atomic storage, if it does not cover the evaluation pts yet; evaluation pts
+    // are only added while no contributions are unmerged, so reallocating never drops any
+    void allocateAtomicContributions();
+
+    // members
+    static constexpr int nChannels = sizeof(T)/sizeof(float);
+    static constexpr int atomicStride = 1 + 5*nChannels;
+    tbb::enumerable_thread_specific<ContributionBuffer> buffers;
+    std::atomic<int> nBufferedBlocks;
+    std::unique_ptr<std::atomic<float>[]> atomicContributions;
+    std::atomic<int> nAtomicContributions;
+    std::mutex atomicContributionsMutex;
+    std::atomic<bool> unmergedContributions;
+};
+
+enum class VisibilityMode {
+    TraceRays, // traces a visibility ray to every evaluation pt in the ball
+    SkipNearbyRays, // skips rays to evaluation pts closer to the walk position than to the reflecting boundary
+    TrustStarShapedRegion // also skips rays to evaluation pts in a shrunken star-shaped ball; assumes all
+                          // evaluation pts in the solve region lie on the same side of the reflecting
+                          // boundary as the walk, i.e., single-sided problems where evaluation pts
+                          // outside the domain are marked as outside the solve region
+};
+
+// counts of the visibility rays traced and skipped while splatting
+struct VisibilityStatistics {
+    // constructor
+    VisibilityStatistics();
+
+    // resets statistics
+    void reset();
+
+    // members
+    std::atomic<int64_t> nVisibilityChecks;
+    std::atomic<int64_t> nSkippedRays;
+    std::atomic<int64_t> nValidatedRays;
+    std::atomic<int64_t> nFailedValidations;
+};
+
+struct VisibilitySettings {
+    // constructor
+    VisibilitySettings(VisibilityMode mode_=VisibilityMode::TraceRays,
+                       float starRadiusShrinkFactor_=0.95f,
+                       float validationProbability_=0.0f,
+                       VisibilityStatistics *statistics_=nullptr);
+
+    // members
+    VisibilityMode mode;
+    float starRadiusShrinkFactor; // fraction of the star radius within which rays are skipped
+    float validationProbability; // probability of tracing a skipped ray anyway to verify it
+    VisibilityStatistics *statistics; // optional
 };
 
 template <typename T, size_t DIM, typename NearestNeighborFinder>
@@ -57,7 +224,8 @@ void splatContribution(const WalkState<T, DIM>& state,
                        const PDE<T, DIM>& pde,
                        float normalOffsetForAbsorbingBoundary,
                        float radiusClamp, float kernelRegularization,
-                       std::vector<EvaluationPoint<T, DIM>>& evalPts);
+                       EvaluationPoints<T, DIM>& evalPts,
+                       const VisibilitySettings& visibilitySettings=VisibilitySettings());
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Implementation
@@ -78,7 +246,6 @@ inline EvaluationPoint<T, DIM>::EvaluationPoint(const Vector<DIM>& pt_,
                                                 distToAbsorbingBoundary(distToAbsorbingBoundary_),
                                                 distToReflectingBoundary(distToReflectingBoundary_)
 {
-    mutex = std::make_unique<tbb::mutex>();
     reset();
 }
 
@@ -133,6 +300,350 @@ void EvaluationPoint<T, DIM>::reset()
     totalSourceContribution = T(0.0f);
 }
 
+template <typename T, size_t DIM>
+inline EvaluationPoints<T, DIM>::EvaluationPoints(AccumulationMode accumulationMode_,
+                                                   float threadLocalMemoryBudget_):
+                                                   accumulationMode(accumulationMode_),
+                                                   threadLocalMemoryBudget(threadLocalMemoryBudget_),
+                                                   nBufferedBlocks(0), nAtomicContributions(-1),
+                                                   unmergedContributions(false)
+{
+    // do nothing
+}
+
+template <typename T, size_t DIM>
+inline void EvaluationPoints<T, DIM>::reserve(int n)
+{
+    pt.reserve(n);
+    normal.reserve(n);
+    type.reserve(n);
+    distToAbsorbingBoundary.reserve(n);
+    distToReflectingBoundary.reserve(n);
+    insideSolveRegion.reserve(n);
+    totalPoissonKernelContribution.reserve(n);
+    totalAbsorbingBoundaryContribution.reserve(n);
+    totalAbsorbingBoundaryNormalAlignedContribution.reserve(n);
+    totalReflectingBoundaryContribution.reserve(n);
+    totalReflectingBoundaryNormalAlignedContribution.reserve(n);
+    totalSourceContribution.reserve(n);
+}
+
+template <typename T, size_t DIM>
+inline void EvaluationPoints<T, DIM>::add(const Vector<DIM>& pt_,
+                                          const Vector<DIM>& normal_,
+                                          SampleType type_,
+                                          float distToAbsorbingBoundary_,
+                                          float distToReflectingBoundary_,
+                                          bool insideSolveRegion_)
+{
+    // the staged contributions are laid out by evaluation pt, so growing the set of
+    // evaluation pts before they are merged would lose them
+    if (hasUnmergedContributions()) {
+        std::cerr << "EvaluationPoints::add(): contributions must be merged before adding evaluation pts!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    pt.emplace_back(pt_);
+    normal.emplace_back(normal_);
+    type.emplace_back(type_);
+    distToAbsorbingBoundary.emplace_back(distToAbsorbingBoundary_);
+    distToReflectingBoundary.emplace_back(distToReflectingBoundary_);
+    insideSolveRegion.emplace_back(insideSolveRegion_ ? 1 : 0);
+    totalPoissonKernelContribution.emplace_back(0.0f);
+    totalAbsorbingBoundaryContribution.emplace_back(T(0.0f));
+    totalAbsorbingBoundaryNormalAlignedContribution.emplace_back(T(0.0f));
+    totalReflectingBoundaryContribution.emplace_back(T(0.0f));
+    totalReflectingBoundaryNormalAlignedContribution.emplace_back(T(0.0f));
+    totalSourceContribution.emplace_back(T(0.0f));
+}
+
+template <typename T, size_t DIM>
+inline void EvaluationPoints<T, DIM>::add(const EvaluationPoint<T, DIM>& evalPt, bool insideSolveRegion_)
+{
+    add(evalPt.pt, evalPt.normal, evalPt.type, evalPt.distToAbsorbingBoundary,
+        evalPt.distToReflectingBoundary, insideSolveRegion_);
+    totalPoissonKernelContribution.back() = evalPt.totalPoissonKernelContribution;
+    totalAbsorbingBoundaryContribution.back() = evalPt.totalAbsorbingBoundaryContribution;
+    totalAbsorbingBoundaryNormalAlignedContribution.back() = evalPt.totalAbsorbingBoundaryNormalAlignedContribution;
+    totalReflectingBoundaryContribution.back() = evalPt.totalReflectingBoundaryContribution;
+    totalReflectingBoundaryNormalAlignedContribution.back() = evalPt.totalReflectingBoundaryNormalAlignedContribution;
+    totalSourceContribution.back() = evalPt.totalSourceContribution;
+}
+
+template <typename T, size_t DIM>
+inline int EvaluationPoints<T, DIM>::size() const
+{
+    return (int)pt.size();
+}
+
+template <typename T, size_t DIM>
+inline EvaluationPoint<T, DIM> EvaluationPoints<T, DIM>::getEvaluationPoint(int i) const
+{
+    if (unmergedContributions.load(std::memory_order_relaxed)) {
+        std::cerr << "EvaluationPoints::getEvaluationPoint(): contributions must be merged before reading the totals!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    EvaluationPoint<T, DIM> evalPt(pt[i], normal[i], type[i], distToAbsorbingBoundary[i],
+                                   distToReflectingBoundary[i]);
+    evalPt.totalPoissonKernelContribution = totalPoissonKernelContribution[i];
+    evalPt.totalAbsorbingBoundaryContribution = totalAbsorbingBoundaryContribution[i];
+    evalPt.totalAbsorbingBoundaryNormalAlignedContribution = totalAbsorbingBoundaryNormalAlignedContribution[i];
+    evalPt.totalReflectingBoundaryContribution = totalReflectingBoundaryContribution[i];
+    evalPt.totalReflectingBoundaryNormalAlignedContribution = totalReflectingBoundaryNormalAlignedContribution[i];
+    evalPt.totalSourceContribution = totalSourceContribution[i];
+
+    return evalPt;
+}
+
+template <typename T, size_t DIM>
+T EvaluationPoints<T, DIM>::getEstimatedSolution(int i,
+                                                 int nAbsorbingBoundarySamples,
+                                                 int nAbsorbingBoundaryNormalAlignedSamples,
+                                                 int nReflectingBoundarySamples,
+                                                 int nReflectingBoundaryNormalAlignedSamples,
+                                                 int nSourceSamples) const
+{
+    if (unmergedContributions.load(std::memory_order_relaxed)) {
+        std::cerr << "EvaluationPoints::getEstimatedSolution(): contributions must be merged before reading the solution!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return getEvaluationPoint(i).getEstimatedSolution(nAbsorbingBoundarySamples,
+                                                      nAbsorbingBoundaryNormalAlignedSamples,
+                                                      nReflectingBoundarySamples,
+                                                      nReflectingBoundaryNormalAlignedSamples,
+                                                      nSourceSamples);
+}
+
+inline void atomicAdd(std::atomic<float>& target, float value)
+{
+    float expected = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(expected, expected + value, std::memory_order_relaxed));
+}
+
+template <typename T, size_t DIM>
+inline EvaluationPoints<T, DIM>::ContributionBlock::ContributionBlock()
+{
+    for (int j = 0; j < RWS_SPLAT_BLOCK_SIZE; j++) {
+        totalPoissonKernelContribution[j] = 0.0f;
+        for (int k = 0; k < 5; k++) totalContribution[k][j] = T(0.0f);
+    }
+}
+
+template <typename T, size_t DIM>
+inline int EvaluationPoints<T, DIM>::getContributionIndex(const SampleContribution<T>& sampleContribution) const
+{
+    if (sampleContribution.type == SampleType::OnAbsorbingBoundary) {
+        return sampleContribution.boundaryNormalAligned ? 1 : 0;
+
+    } else if (sampleContribution.type == SampleType::OnReflectingBoundary) {
+        return sampleContribution.boundaryNormalAligned ? 3 : 2;
+
+    } else if (sampleContribution.type == SampleType::InDomain) {
+        return 4;
+    }
+
+    return -1;
+}
+
+template <typename T, size_t DIM>
+inline std::vector<T>& EvaluationPoints<T, DIM>::getTotalContribution(int k)
+{
+    if (k == 0) return totalAbsorbingBoundaryContribution;
+    else if (k == 1) return totalAbsorbingBoundaryNormalAlignedContribution;
+    else if (k == 2) return totalReflectingBoundaryContribution;
+    else if (k == 3) return totalReflectingBoundaryNormalAlignedContribution;
+    return totalSourceContribution;
+}
+
+template <typename T, size_t DIM>
+inline void EvaluationPoints<T, DIM>::allocateAtomicContributions()
+{
+    static_assert(sizeof(T) == nChannels*sizeof(float),
+                  "EvaluationPoints::allocateAtomicContributions(): T must be made of floats");
+    if (nAtomicContributions.load(std::memory_order_acquire) == size()) return;
+
+    std::lock_guard<std::mutex> lock(atomicContributionsMutex);
+    if (nAtomicContributions.load(std::memory_order_relaxed) == size()) return;
+
+    size_t nEntries = (size_t)size()*atomicStride;
+    atomicContributions = std::unique_ptr<std::atomic<float>[]>(new std::atomic<float>[nEntries]);
+    for (size_t e = 0; e < nEntries; e++) atomicContributions[e].store(0.0f, std::memory_order_relaxed);
+    nAtomicContributions.store(size(), std::memory_order_release);
+}
+
+template <typename T, size_t DIM>
+inline typename EvaluationPoints<T, DIM>::ContributionBuffer *EvaluationPoints<T, DIM>::getContributionBuffer()
+{
+    if (accumulationMode != AccumulationMode::ThreadLocal) return nullptr;
+
+    ContributionBuffer& buffer = buffers.local();
+    int nBlocks = (size() + RWS_SPLAT_BLOCK_SIZE - 1)/RWS_SPLAT_BLOCK_SIZE;
+    if ((int)buffer.blocks.size() != nBlocks) buffer.blocks.resize(nBlocks);
+
+    return &buffer;
+}
+
+template <typename T, size_t DIM>
+inline void EvaluationPoints<T, DIM>::addContribution(int i, const SampleContribution<T>& sampleContribution,
+                                                      float weight, bool useSelfNormalization,
+                                                      ContributionBuffer *buffer)
+{
+    int k = getContributionIndex(sampleContribution);
+    if (k < 0) return;
+
+    T weightedContribution = weight*sampleContribution.contribution;
+    bool addPoissonKernelContribution = k == 0 && useSelfNormalization;
+    if (!unmergedContributions.load(std::memory_order_relaxed)) {
+        unmergedContributions.store(true, std::memory_order_relaxed);
+    }
+
+    if (accumulationMode == AccumulationMode::ThreadLocal) {
+        // lazily allocate the block of the calling thread, unless the blocks of all threads
+        // have exhausted the memory budget
+        if (!buffer) buffer = getContributionBuffer();
+        int nBlocks = (int)buffer->blocks.size();
+
+        std::unique_ptr<ContributionBlock>& block = buffer->blocks[i/RWS_SPLAT_BLOCK_SIZE];
+        if (!block && nBufferedBlocks.load(std::memory_order_relaxed) < threadLocalMemoryBudget*nBlocks) {
+            nBufferedBlocks.fetch_add(1, std::memory_order_relaxed);
+            block = std::make_unique<ContributionBlock>();
+        }
+
+        if (block) {
+            int j = i%RWS_SPLAT_BLOCK_SIZE;
+            block->totalContribution[k][j] += weightedContribution;
+            if (addPoissonKernelContribution) block->totalPoissonKernelContribution[j] += weight;
+            return;
+        }
+    }
+
+    allocateAtomicContributions();
+    std::atomic<float> *target = &atomicContributions[(size_t)i*atomicStride];
+    const float *channels = reinterpret_cast<const float *>(&weightedContribution);
+    for (int c = 0; c < nChannels; c++) {
+        atomicAdd(target[1 + k*nChannels + c], channels[c]);
+    }
+
+    if (addPoissonKernelContribution) atomicAdd(target[0], weight);
+}
+
+template <typename T, size_t DIM>
+inline void EvaluationPoints<T, DIM>::mergeContributions()
+{
+    std::vector<const ContributionBuffer *> activeBuffers;
+    for (const ContributionBuffer& buffer: buffers) {
+        if (buffer.blocks.size() > 0) activeBuffers.emplace_back(&buffer);
+    }
+
+    int nEvalPts = size();
+    if (activeBuffers.size() > 0) {
+        // reduce the per-thread blocks in parallel over the blocks
+        int nBlocks = (nEvalPts + RWS_SPLAT_BLOCK_SIZE - 1)/RWS_SPLAT_BLOCK_SIZE;
+        auto run = [&](const tbb::blocked_range<int>& range) {
+            for (int b = range.begin(); b < range.end(); ++b) {
+                int start = b*RWS_SPLAT_BLOCK_SIZE;
+                int end = std::min(start + RWS_SPLAT_BLOCK_SIZE, nEvalPts);
+
+                for (const ContributionBuffer *buffer: activeBuffers) {
+                    if (b >= (int)buffer->blocks.size() || !buffer->blocks[b]) continue;
+
+                    const ContributionBlock& block = *buffer->blocks[b];
+                    for (int i = start; i < end; i++) {
+                        totalPoissonKernelContribution[i] += block.totalPoissonKernelContribution[i - start];
+                    }
+
+                    for (int k = 0; k < 5; k++) {
+                        std::vector<T>& totalContribution = getTotalContribution(k);
+                        for (int i = start; i < end; i++) {
+                            totalContribution[i] += block.totalContribution[k][i - start];
+                        }
+                    }
+                }
+            }
+        };
+
+        tbb::blocked_range<int> range(0, nBlocks);
+        tbb::parallel_for(range, run);
+    }
+
+    if (nAtomicContributions.load(std::memory_order_acquire) == nEvalPts) {
+        // move the atomic contributions into the totals
+        auto run = [&](const tbb::blocked_range<int>& range) {
+            for (int i = range.begin(); i < range.end(); ++i) {
+                std::atomic<float> *target = &atomicContributions[(size_t)i*atomicStride];
+                totalPoissonKernelContribution[i] += target[0].exchange(0.0f, std::memory_order_relaxed);
+
+                for (int k = 0; k < 5; k++) {
+                    T contribution(0.0f);
+                    float *channels = reinterpret_cast<float *>(&contribution);
+                    for (int c = 0; c < nChannels; c++) {
+                        channels[c] = target[1 + k*nChannels + c].exchange(0.0f, std::memory_order_relaxed);
+                    }
+
+                    getTotalContribution(k)[i] += contribution;
+                }
+            }
+        };
+
+        tbb::blocked_range<int> range(0, nEvalPts);
+        tbb::parallel_for(range, run);
+    }
+
+    buffers.clear();
+    nBufferedBlocks = 0;
+    unmergedContributions = false;
+}
+
+template <typename T, size_t DIM>
+inline bool EvaluationPoints<T, DIM>::hasUnmergedContributions() const
+{
+    return unmergedContributions.load(std::memory_order_relaxed);
+}
+
+template <typename T, size_t DIM>
+void EvaluationPoints<T, DIM>::reset()
+{
+    std::fill(totalPoissonKernelContribution.begin(), totalPoissonKernelContribution.end(), 0.0f);
+    std::fill(totalAbsorbingBoundaryContribution.begin(), totalAbsorbingBoundaryContribution.end(), T(0.0f));
+    std::fill(totalAbsorbingBoundaryNormalAlignedContribution.begin(),
+              totalAbsorbingBoundaryNormalAlignedContribution.end(), T(0.0f));
+    std::fill(totalReflectingBoundaryContribution.begin(), totalReflectingBoundaryContribution.end(), T(0.0f));
+    std::fill(totalReflectingBoundaryNormalAlignedContribution.begin(),
+              totalReflectingBoundaryNormalAlignedContribution.end(), T(0.0f));
+    std::fill(totalSourceContribution.begin(), totalSourceContribution.end(), T(0.0f));
+    buffers.clear();
+    nBufferedBlocks = 0;
+    atomicContributions.reset();
+    nAtomicContributions = -1;
+    unmergedContributions = false;
+}
+
+inline VisibilityStatistics::VisibilityStatistics()
+{
+    reset();
+}
+
+inline void VisibilityStatistics::reset()
+{
+    nVisibilityChecks = 0;
+    nSkippedRays = 0;
+    nValidatedRays = 0;
+    nFailedValidations = 0;
+}
+
+inline VisibilitySettings::VisibilitySettings(VisibilityMode mode_, float starRadiusShrinkFactor_,
+                                              float validationProbability_,
+                                              VisibilityStatistics *statistics_):
+                                              mode(mode_),
+                                              starRadiusShrinkFactor(starRadiusShrinkFactor_),
+                                              validationProbability(validationProbability_),
+                                              statistics(statistics_)
+{
+    // do nothing
+}
+
 template <typename T, size_t DIM, typename NearestNeighborFinder>
 void splatContribution(const WalkState<T, DIM>& state,
                        const SampleContribution<T>& sampleContribution,
@@ -141,32 +652,77 @@ void splatContribution(const WalkState<T, DIM>& state,
                        const PDE<T, DIM>& pde,
                        float normalOffsetForAbsorbingBoundary,
                        float radiusClamp, float kernelRegularization,
-                       std::vector<EvaluationPoint<T, DIM>>& evalPts)
+                       EvaluationPoints<T, DIM>& evalPts,
+                       const VisibilitySettings& visibilitySettings)
 {
-    // perform nearest neighbor queries to determine evaluation points that lie
-    // within the sphere centered at the current random walk position
-    std::vector<size_t> nnIndices;
-    size_t nnCount = nearestNeighborFinder.radiusSearch(state.currentPt, state.greensFn->R, nnIndices);
     bool hasRobinCoeffs = pde.robin ? true : false;
     bool useSelfNormalization = queries.domainIsWatertight && pde.absorptionCoeff == 0.0f;
     if (pde.robin && useSelfNormalization) useSelfNormalization = pde.areRobinConditionsPureNeumann;
 
-    for (size_t i = 0; i < nnCount; i++) {
-        EvaluationPoint<T, DIM>& evalPt = evalPts[nnIndices[i]];
+    // points in the ball are visible from its center if the ball is star-shaped, so rays
+    // can be skipped inside a shrunken ball when the points lie on the walk's side of the
+    // reflecting boundary; independently, a point is always visible from a walk position
+    // that is closer to it than its distance to the reflecting boundary
+    float trustedSquaredRadius = 0.0f;
+    if (visibilitySettings.mode == VisibilityMode::TrustStarShapedRegion) {
+        float trustedRadius = visibilitySettings.starRadiusShrinkFactor*state.greensFn->R;
+        trustedSquaredRadius = trustedRadius*trustedRadius;
+    }
 
-        // ignore evaluation points on the absorbing boundary
-        if (evalPt.type == SampleType::OnAbsorbingBoundary) continue;
+    static thread_local pcg32 validationSampler(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    typename EvaluationPoints<T, DIM>::ContributionBuffer *buffer = evalPts.getContributionBuffer();
+    int64_t nVisibilityChecks = 0;
+    int64_t nSkippedRays = 0;
+    int64_t nValidatedRays = 0;
+    int64_t nFailedValidations = 0;
+
+    // perform nearest neighbor queries to determine evaluation points that lie
+    // within the sphere centered at the current random walk position, splatting
+    // to each point as it is found to avoid allocating an index buffer per step
+    nearestNeighborFinder.radiusSearch(state.currentPt, state.greensFn->R, [&](size_t i) -> void {
+        int j = (int)i;
+
+        // ignore evaluation points on the absorbing boundary or outside the solve region
+        if (evalPts.type[j] == SampleType::OnAbsorbingBoundary || !evalPts.insideSolveRegion[j]) return;
 
         // ensure evaluation points are visible from current random walk position
-        if (!queries.intersectsWithReflectingBoundary(
-                state.currentPt, evalPt.pt, state.currentNormal, evalPt.normal,
-                state.onReflectingBoundary, evalPt.type == SampleType::OnReflectingBoundary)) {
+        bool skipRay = false;
+        nVisibilityChecks++;
+        if (visibilitySettings.mode != VisibilityMode::TraceRays) {
+            float squaredDist = (evalPts.pt[j] - state.currentPt).squaredNorm();
+            float distToReflectingBoundary = std::fabs(evalPts.distToReflectingBoundary[j]);
+            skipRay = squaredDist < trustedSquaredRadius ||
+                      squaredDist < distToReflectingBoundary*distToReflectingBoundary;
+        }
+
+        bool isVisible = true;
+        if (skipRay) {
+            nSkippedRays++;
+
+            // trace a fraction of the skipped rays to verify the visibility assumption, and
+            // fall back on the traced result when it does not hold
+            if (visibilitySettings.validationProbability > 0.0f &&
+                validationSampler.nextFloat() < visibilitySettings.validationProbability) {
+                isVisible = !queries.intersectsWithReflectingBoundary(
+                    state.currentPt, evalPts.pt[j], state.currentNormal, evalPts.normal[j],
+                    state.onReflectingBoundary, evalPts.type[j] == SampleType::OnReflectingBoundary);
+                nValidatedRays++;
+                if (!isVisible) nFailedValidations++;
+            }
+
+        } else {
+            isVisible = !queries.intersectsWithReflectingBoundary(
+                state.currentPt, evalPts.pt[j], state.currentNormal, evalPts.normal[j],
+                state.onReflectingBoundary, evalPts.type[j] == SampleType::OnReflectingBoundary);
+        }
+
+        if (isVisible) {
             // compute greens function weighting
             float samplePtAlpha = state.onReflectingBoundary ? 2.0f : 1.0f;
             state.greensFn->rClamp = radiusClamp;
-            float G = state.greensFn->evaluate(state.currentPt, evalPt.pt);
+            float G = state.greensFn->evaluate(state.currentPt, evalPts.pt[j]);
             if (kernelRegularization > 0.0f) {
-                float r = std::max(radiusClamp, (state.currentPt - evalPt.pt).norm());
+                float r = std::max(radiusClamp, (state.currentPt - evalPts.pt[j]).norm());
                 r /= kernelRegularization;
                 G *= KernelRegularization<DIM>::regularizationForGreensFn(r);
             }
@@ -174,29 +730,16 @@ void splatContribution(const WalkState<T, DIM>& state,
             float weight = samplePtAlpha*state.throughput*G/sampleContribution.pdf;
 
             // add sample contribution to evaluation point
-            tbb::mutex::scoped_lock lock(*evalPt.mutex);
-            if (sampleContribution.type == SampleType::OnAbsorbingBoundary) {
-                weight /= normalOffsetForAbsorbingBoundary;
-                if (sampleContribution.boundaryNormalAligned) {
-                    evalPt.totalAbsorbingBoundaryNormalAlignedContribution += weight*sampleContribution.contribution;
-
-                } else {
-                    evalPt.totalAbsorbingBoundaryContribution += weight*sampleContribution.contribution;
-                    if (useSelfNormalization) evalPt.totalPoissonKernelContribution += weight;
-                }
-
-            } else if (sampleContribution.type == SampleType::OnReflectingBoundary) {
-                if (sampleContribution.boundaryNormalAligned) {
-                    evalPt.totalReflectingBoundaryNormalAlignedContribution += weight*sampleContribution.contribution;
-
-                } else {
-                    evalPt.totalReflectingBoundaryContribution += weight*sampleContribution.contribution;
-                }
-
-            } else if (sampleContribution.type == SampleType::InDomain) {
-                evalPt.totalSourceContribution += weight*sampleContribution.contribution;
-            }
+            evalPts.addContribution(j, sampleContribution, weight, useSelfNormalization, buffer);
         }
+    });
+
+    if (visibilitySettings.statistics) {
+        VisibilityStatistics *statistics = visibilitySettings.statistics;
+        statistics->nVisibilityChecks += nVisibilityChecks;
+        statistics->nSkippedRays += nSkippedRays;
+        statistics->nValidatedRays += nValidatedRays;
+        statistics->nFailedValidations += nFailedValidations;
     }
 }
 
@@ -0,0 +1,484 @@
+// This file provides a SplatTree class that organizes the sample points cached by Boundary
+// Value Caching into a hierarchy of clusters, for use with tree code (Barnes-Hut) splatting.
+// In the boundary integral representation of the solution, each boundary sample acts as a
+// point charge and a dipole, and each source sample as a point charge, of the free-space
+// Green's function. The contribution of a cluster of samples far away from an evaluation
+// point is therefore replaced by a Taylor expansion of the Green's function about the cluster
+// center, truncated after the quadrupole term. Since the expansion only relies on the kernel
+// being radially symmetric, it is used for both the harmonic and Yukawa Green's functions.
+//
+// Resources:
+// - A Hierarchical O(N log N) Force-Calculation Algorithm [1986]
+// - Boundary Value Caching for Walk on Spheres [2023]
+
+#pragma once
+
+#include <zombie/point_estimation/common.h>
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#define SPLAT_TREE_MAX_DEPTH 64
+#define SPLAT_CATEGORY_COUNT 5
+
+namespace zombie {
+
+namespace bvc {
+
+enum class SplatCategory {
+    AbsorbingBoundary,
+    AbsorbingBoundaryNormalAligned,
+    ReflectingBoundary,
+    ReflectingBoundaryNormalAligned,
+    Source
+};
+
+// structure-of-arrays copy of the positions, normals and splat weights of a batch of
+// sample pts from the same category, streamed through the direct splatting kernels
+template <typename T, size_t DIM>
+struct SplatSampleBatch {
+    // sets the batch from the given range of sample pt indices
+    void set(const std::vector<SamplePoint<T, DIM>>& samplePts,
+             const std::vector<int>& indices, int start, int end,
+             float robinCoeffCutoffForNormalDerivative);
+
+    // sets the batch from the change in the splat weights of the given range of sample pt
+    // indices between prevSamplePts and samplePts, which share positions and normals
+    void setChanges(const std::vector<SamplePoint<T, DIM>>& prevSamplePts,
+                    const std::vector<SamplePoint<T, DIM>>& samplePts,
+                    const std::vector<int>& indices, int start, int end,
+                    float robinCoeffCutoffForNormalDerivative);
+
+    // members
+    std::vector<float> pt[DIM];
+    std::vector<float> normal[DIM];
+    std::vector<T> charge;
+    std::vector<T> dipole;
+    int size = 0;
+};
+
+template <typename T, size_t DIM>
+struct SplatTreeNode {
+    // constructor
+    SplatTreeNode();
+
+    // members
+    Vector<DIM> center; // centroid of the sample points in the node
+    float radius; // distance from the center to the farthest sample point in the node
+    T charge; // sum of sample charges
+    T dipole[DIM]; // sum of sample dipoles and first moments of the charges about the center
+    T quadrupole[DIM][DIM]; // second moments of the charges and first moments of the dipoles
+    int referenceOffset;
+    int nReferences; // number of sample points in the subtree
+    int secondChildOffset; // 0 for leaf nodes; first child immediately follows its parent
+};
+
+template <typename T, size_t DIM>
+class SplatTree {
+public:
+    // constructor
+    SplatTree(int nSamplesPerLeaf_=16);
+
+    // builds a separate hierarchy for each category of sample points (absorbing and reflecting
+    // boundary samples with either normal orientation, and source samples); the sample points
+    // must have their boundary data and source values set, and are copied into the tree
+    void build(const std::vector<SamplePoint<T, DIM>>& samplePts,
+               float robinCoeffCutoffForNormalDerivative,
+               bool printStats=false);
+
+    // updates the splat weights and cluster moments after the boundary data or source values
+    // of the sample points the tree was built from have changed, e.g., when their estimates
+    // are refined for BoundaryValueCaching::splatUpdates; the positions, normals and categories
+    // of the sample points must not change, otherwise the tree must be rebuilt
+    void refit(const std::vector<SamplePoint<T, DIM>>& samplePts);
+
+    // returns the number of sample points in the tree
+    int getSampleCount() const;
+
+    // returns the robin coefficient cutoff the tree was built with
+    float getRobinCoeffCutoffForNormalDerivative() const;
+
+protected:
+    // builds the subtree over the given range of sample references
+    void buildRecursive(const SplatSampleBatch<T, DIM>& unorderedSamples,
+                        int start, int end, int depth);
+
+    // computes the moments of the sample charges and dipoles about the node centers
+    void computeMoments();
+
+    // members
+    SplatSampleBatch<T, DIM> samples; // copy of the sample points, in the order of the references
+    std::vector<int> references; // index of each sample in the sample points the tree was built from
+    std::vector<SplatTreeNode<T, DIM>> nodes;
+    int rootIndex[SPLAT_CATEGORY_COUNT]; // -1 for categories without samples
+    float robinCoeffCutoffForNormalDerivative;
+    int nSamplesPerLeaf;
+    int maxDepth;
+
+    template <typename A, size_t B, EstimationQuantity C>
+    friend class BoundaryValueCaching;
+};
+
+// returns the category of a sample point
+template <typename T, size_t DIM>
+SplatCategory getSplatCategory(const SamplePoint<T, DIM>& samplePt);
+
+// computes the weights with which a sample point contributes to the solution at an
+// evaluation pt x, namely charge*G(x, y) + dipole*P(x, y), where P = n.dG/dy is the
+// Poisson kernel for the (possibly flipped) sample normal n; both weights include the pdf
+template <typename T, size_t DIM>
+void computeSplatWeights(const SamplePoint<T, DIM>& samplePt,
+                         float robinCoeffCutoffForNormalDerivative,
+                         T& charge, T& dipole);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Implementation
+
+template <size_t DIM>
+inline void computeRadialGreensFnDerivatives(float r, float absorptionCoeff,
+                                             float& G, float& dG, float& d2G, float& d3G)
+{
+    std::cerr << "computeRadialGreensFnDerivatives(): DIM: " << DIM << " not supported" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+template <>
+inline void computeRadialGreensFnDerivatives<2>(float r, float absorptionCoeff,
+                                                float& G, float& dG, float& d2G, float& d3G)
+{
+    // free-space Green's function and its first three derivatives with respect to r
+    if (absorptionCoeff > 0.0f) {
+        float sqrtLambda = std::sqrt(absorptionCoeff);
+        float mur = r*sqrtLambda;
+        float K0mur = bessel::bessk0(mur);
+        float K1mur = bessel::bessk1(mur);
+        float K2mur = bessel::bessk(2, mur);
+        float K3mur = bessel::bessk(3, mur);
+        G = K0mur/(2.0f*M_PI);
+        dG = -sqrtLambda*K1mur/(2.0f*M_PI);
+        d2G = absorptionCoeff*(K0mur + K2mur)/(4.0f*M_PI);
+        d3G = -absorptionCoeff*sqrtLambda*(3.0f*K1mur + K3mur)/(8.0f*M_PI);
+
+    } else {
+        G = -std::log(r)/(2.0f*M_PI);
+        dG = -1.0f/(2.0f*M_PI*r);
+        d2G = 1.0f/(2.0f*M_PI*r*r);
+        d3G = -2.0f/(2.0f*M_PI*r*r*r);
+    }
+}
+
+template <>
+inline void computeRadialGreensFnDerivatives<3>(float r, float absorptionCoeff,
+                                                float& G, float& dG, float& d2G, float& d3G)
+{
+    // free-space Green's function and its first three derivatives with respect to r
+    if (absorptionCoeff > 0.0f) {
+        float sqrtLambda = std::sqrt(absorptionCoeff);
+        float mur = r*sqrtLambda;
+        float expmur = std::exp(-mur);
+        G = expmur/(4.0f*M_PI*r);
+        dG = -expmur*(1.0f + mur)/(4.0f*M_PI*r*r);
+        d2G = expmur*(2.0f + 2.0f*mur + mur*mur)/(4.0f*M_PI*r*r*r);
+        d3G = -expmur*(6.0f + 6.0f*mur + 3.0f*mur*mur + mur*mur*mur)/(4.0f*M_PI*r*r*r*r);
+
+    } else {
+        G = 1.0f/(4.0f*M_PI*r);
+        dG = -1.0f/(4.0f*M_PI*r*r);
+        d2G = 2.0f/(4.0f*M_PI*r*r*r);
+        d3G = -6.0f/(4.0f*M_PI*r*r*r*r);
+    }
+}
+
+template <typename T, size_t DIM>
+inline SplatCategory getSplatCategory(const SamplePoint<T, DIM>& samplePt)
+{
+    if (samplePt.type == SampleType::OnAbsorbingBoundary) {
+        return samplePt.estimateBoundaryNormalAligned ? SplatCategory::AbsorbingBoundaryNormalAligned :
+                                                        SplatCategory::AbsorbingBoundary;
+
+    } else if (samplePt.type == SampleType::OnReflectingBoundary) {
+        return samplePt.estimateBoundaryNormalAligned ? SplatCategory::ReflectingBoundaryNormalAligned :
+                                                        SplatCategory::ReflectingBoundary;
+    }
+
+    return SplatCategory::Source;
+}
+
+template <typename T, size_t DIM>
+inline void computeSplatWeights(const SamplePoint<T, DIM>& samplePt,
+                                float robinCoeffCutoffForNormalDerivative,
+                                T& charge, T& dipole)
+{
+    float pdf = samplePt.pdf;
+    if (samplePt.type == SampleType::OnAbsorbingBoundary ||
+        samplePt.type == SampleType::OnReflectingBoundary) {
+        const T& solution = samplePt.solution;
+        const T& normalDerivative = samplePt.normalDerivative;
+        const T& robin = samplePt.robin;
+        float robinCoeff = samplePt.robinCoeff;
+
+        if (robinCoeff > robinCoeffCutoffForNormalDerivative) {
+            charge = normalDerivative/pdf;
+            dipole = (normalDerivative - robin)/(robinCoeff*pdf);
+
+        } else if (robinCoeff > 0.0f) {
+            charge = (robin - robinCoeff*solution)/pdf;
+            dipole = -solution/pdf;
+
+        } else {
+            charge = normalDerivative/pdf;
+            dipole = -solution/pdf;
+        }
+
+    } else {
+        charge = samplePt.source/pdf;
+        dipole = T(0.0f);
+    }
+}
+
+template <typename T, size_t DIM>
+inline void SplatSampleBatch<T, DIM>::set(const std::vector<SamplePoint<T, DIM>>& samplePts,
+                                          const std::vector<int>& indices, int start, int end,
+                                          float robinCoeffCutoffForNormalDerivative)
+{
+    size = end - start;
+    for (int i = 0; i < DIM; i++) {
+        pt[i].resize(size);
+        normal[i].resize(size);
+    }
+
+    charge.resize(size);
+    dipole.resize(size);
+
+    for (int j = 0; j < size; j++) {
+        const SamplePoint<T, DIM>& samplePt = samplePts[indices[start + j]];
+        Vector<DIM> n = samplePt.normal*(samplePt.estimateBoundaryNormalAligned ? -1.0f : 1.0f);
+        for (int i = 0; i < DIM; i++) {
+            pt[i][j] = samplePt.pt(i);
+            normal[i][j] = n(i);
+        }
+
+        computeSplatWeights(samplePt, robinCoeffCutoffForNormalDerivative, charge[j], dipole[j]);
+    }
+}
+
+template <typename T, size_t DIM>
+inline void SplatSampleBatch<T, DIM>::setChanges(const std::vector<SamplePoint<T, DIM>>& prevSamplePts,
+                                                 const std::vector<SamplePoint<T, DIM>>& samplePts,
+                                                 const std::vector<int>& indices, int start, int end,
+                                                 float robinCoeffCutoffForNormalDerivative)
+{
+    // the splat weights depend linearly on the boundary and source data, so the change
+    // in the splatted estimates is given by the change in the weights
+    set(samplePts, indices, start, end, robinCoeffCutoffForNormalDerivative);
+
+    for (int j = 0; j < size; j++) {
+        T prevCharge, prevDipole;
+        computeSplatWeights(prevSamplePts[indices[start + j]], robinCoeffCutoffForNormalDerivative,
+                            prevCharge, prevDipole);
+        charge[j] -= prevCharge;
+        dipole[j] -= prevDipole;
+    }
+}
+
+template <typename T, size_t DIM>
+inline SplatTreeNode<T, DIM>::SplatTreeNode(): center(Vector<DIM>::Zero()), radius(0.0f),
+                                               charge(T(0.0f)), referenceOffset(0),
+                                               nReferences(0), secondChildOffset(0)
+{
+    for (int i = 0; i < DIM; i++) {
+        dipole[i] = T(0.0f);
+        for (int j = 0; j < DIM; j++) {
+            quadrupole[i][j] = T(0.0f);
+        }
+    }
+}
+
+template <typename T, size_t DIM>
+inline SplatTree<T, DIM>::SplatTree(int nSamplesPerLeaf_):
+                                    robinCoeffCutoffForNormalDerivative(0.0f),
+                                    nSamplesPerLeaf(nSamplesPerLeaf_),
+                                    maxDepth(0)
+{
+    for (int i = 0; i < SPLAT_CATEGORY_COUNT; i++) rootIndex[i] = -1;
+}
+
+template <typename T, size_t DIM>
+inline void SplatTree<T, DIM>::buildRecursive(const SplatSampleBatch<T, DIM>& unorderedSamples,
+                                              int start, int end, int depth)
+{
+    int nodeIndex = (int)nodes.size();
+    nodes.emplace_back(SplatTreeNode<T, DIM>());
+    maxDepth = std::max(maxDepth, depth);
+
+    // compute the centroid and bounding box of the sample points
+    auto samplePt = [&unorderedSamples](int s) -> Vector<DIM> {
+        Vector<DIM> pt;
+        for (int a = 0; a < DIM; a++) pt(a) = unorderedSamples.pt[a][s];
+        return pt;
+    };
+
+    Vector<DIM> center = Vector<DIM>::Zero();
+    Vector<DIM> pMin = Vector<DIM>::Constant(std::numeric_limits<float>::max());
+    Vector<DIM> pMax = Vector<DIM>::Constant(std::numeric_limits<float>::lowest());
+    for (int i = start; i < end; i++) {
+        Vector<DIM> pt = samplePt(references[i]);
+        center += pt;
+        pMin = pMin.cwiseMin(pt);
+        pMax = pMax.cwiseMax(pt);
+    }
+
+    center /= (float)(end - start);
+
+    float radius2 = 0.0f;
+    for (int i = start; i < end; i++) {
+        radius2 = std::max(radius2, (samplePt(references[i]) - center).squaredNorm());
+    }
+
+    int nSamples = end - start;
+    SplatTreeNode<T, DIM>& node = nodes[nodeIndex];
+    node.center = center;
+    node.radius = std::sqrt(radius2);
+    node.referenceOffset = start;
+    node.nReferences = nSamples;
+    if (nSamples <= nSamplesPerLeaf || depth >= SPLAT_TREE_MAX_DEPTH - 1) return;
+
+    // split at the median sample point along the axis of largest extent
+    int axis = 0;
+    (pMax - pMin).maxCoeff(&axis);
+    int mid = (start + end)/2;
+    const std::vector<float>& coords = unorderedSamples.pt[axis];
+    std::nth_element(references.begin() + start, references.begin() + mid, references.begin() + end,
+                     [&coords](int a, int b) -> bool {
+        return coords[a] < coords[b];
+    });
+
+    buildRecursive(unorderedSamples, start, mid, depth + 1);
+    nodes[nodeIndex].secondChildOffset = (int)nodes.size() - nodeIndex;
+    buildRecursive(unorderedSamples, mid, end, depth + 1);
+}
+
+template <typename T, size_t DIM>
+inline void SplatTree<T, DIM>::computeMoments()
+{
+    // the dipole of a sample points along its (possibly flipped) normal; the moments of each
+    // node are accumulated from its own samples, since the children's moments about their
+    // centers do not determine the parent's second moments
+    auto run = [&](const tbb::blocked_range<int>& range) {
+        for (int k = range.begin(); k < range.end(); ++k) {
+            SplatTreeNode<T, DIM>& node = nodes[k];
+            node.charge = T(0.0f);
+            for (int a = 0; a < DIM; a++) {
+                node.dipole[a] = T(0.0f);
+                for (int b = 0; b < DIM; b++) node.quadrupole[a][b] = T(0.0f);
+            }
+
+            for (int i = node.referenceOffset; i < node.referenceOffset + node.nReferences; i++) {
+                Vector<DIM> d;
+                for (int a = 0; a < DIM; a++) d(a) = samples.pt[a][i] - node.center(a);
+                const T& q = samples.charge[i];
+                T m[DIM];
+                for (int a = 0; a < DIM; a++) m[a] = samples.dipole[i]*samples.normal[a][i];
+
+                node.charge += q;
+                for (int a = 0; a < DIM; a++) {
+                    node.dipole[a] += q*d(a) + m[a];
+                    for (int b = 0; b < DIM; b++) {
+                        node.quadrupole[a][b] += 0.5f*q*d(a)*d(b) + m[a]*d(b);
+                    }
+                }
+            }
+        }
+    };
+
+    tbb::blocked_range<int> range(0, (int)nodes.size());
+    tbb::parallel_for(range, run);
+}
+
+template <typename T, size_t DIM>
+inline void SplatTree<T, DIM>::build(const std::vector<SamplePoint<T, DIM>>& samplePts,
+                                     float robinCoeffCutoffForNormalDerivative_,
+                                     bool printStats)
+{
+    using namespace std::chrono;
+    high_resolution_clock::time_point t1 = high_resolution_clock::now();
+
+    // sort sample references by category, so that each hierarchy spans a contiguous range
+    robinCoeffCutoffForNormalDerivative = robinCoeffCutoffForNormalDerivative_;
+    int nSamples = (int)samplePts.size();
+    references.resize(nSamples);
+    for (int i = 0; i < nSamples; i++) references[i] = i;
+    std::stable_sort(references.begin(), references.end(), [&samplePts](int a, int b) -> bool {
+        return getSplatCategory(samplePts[a]) < getSplatCategory(samplePts[b]);
+    });
+
+    // build the hierarchies over a copy of the sample positions
+    std::vector<int> identity(nSamples);
+    for (int i = 0; i < nSamples; i++) identity[i] = i;
+    SplatSampleBatch<T, DIM> unorderedSamples;
+    unorderedSamples.set(samplePts, identity, 0, nSamples, robinCoeffCutoffForNormalDerivative);
+
+    nodes.clear();
+    maxDepth = 0;
+    nodes.reserve(2*nSamples/std::max(nSamplesPerLeaf, 1) + SPLAT_CATEGORY_COUNT);
+    int start = 0;
+    for (int c = 0; c < SPLAT_CATEGORY_COUNT; c++) {
+        int end = start;
+        while (end < nSamples && (int)getSplatCategory(samplePts[references[end]]) == c) end++;
+
+        rootIndex[c] = -1;
+        if (end > start) {
+            rootIndex[c] = (int)nodes.size();
+            buildRecursive(unorderedSamples, start, end, 0);
+        }
+
+        start = end;
+    }
+
+    // store the samples in the order of the references, so that each node's samples are
+    // contiguous and can be splatted directly as a block
+    samples.set(samplePts, references, 0, nSamples, robinCoeffCutoffForNormalDerivative);
+    computeMoments();
+
+    if (printStats) {
+        high_resolution_clock::time_point t2 = high_resolution_clock::now();
+        duration<double> timeSpan = duration_cast<duration<double>>(t2 - t1);
+        std::cout << "Built splat tree with " << nodes.size() << " nodes, "
+                  << nSamples << " samples and max depth " << maxDepth
+                  << " in " << timeSpan.count() << " seconds" << std::endl;
+    }
+}
+
+template <typename T, size_t DIM>
+inline void SplatTree<T, DIM>::refit(const std::vector<SamplePoint<T, DIM>>& samplePts)
+{
+    if ((int)samplePts.size() != getSampleCount()) {
+        std::cerr << "SplatTree::refit(): Sample point count does not match the tree!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < getSampleCount(); i++) {
+        computeSplatWeights(samplePts[references[i]], robinCoeffCutoffForNormalDerivative,
+                            samples.charge[i], samples.dipole[i]);
+    }
+
+    computeMoments();
+}
+
+template <typename T, size_t DIM>
+inline int SplatTree<T, DIM>::getSampleCount() const
+{
+    return (int)references.size();
+}
+
+template <typename T, size_t DIM>
+inline float SplatTree<T, DIM>::getRobinCoeffCutoffForNormalDerivative() const
+{
+    return robinCoeffCutoffForNormalDerivative;
+}
+
+} // bvc
+
+} // zombie
@@ -2,10 +2,17 @@
 
 #include <zombie/point_estimation/walk_on_spheres.h>
 #include <zombie/point_estimation/walk_on_stars.h>
+#include <zombie/variance_reduction/bidirectional_walk_on_stars.h>
 #include <zombie/variance_reduction/boundary_sampler.h>
 #include <zombie/variance_reduction/domain_sampler.h>
 #include <zombie/variance_reduction/boundary_value_caching.h>
 #include <zombie/variance_reduction/reverse_walk_splatter.h>
+#include <zombie/variance_reduction/splat_tree.h>
+#include <zombie/utils/binary_cache.h>
 #include <zombie/utils/fcpw_boundary_handler.h>
+#include <zombie/utils/grid_neighbor_finder.h>
+#include <zombie/utils/implicit_boundary_handler.h>
 #include <zombie/utils/nearest_neighbor_finder.h>
-#include <zombie/utils/progress.h>
\ No newline at end of file
+#include <zombie/utils/progress.h>
+#include <zombie/utils/packet_width.h>
+#include <zombie/utils/winding_number.h>
\ No newline at end of file